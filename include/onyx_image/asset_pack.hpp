@@ -0,0 +1,127 @@
+#ifndef ONYX_IMAGE_ASSET_PACK_HPP_
+#define ONYX_IMAGE_ASSET_PACK_HPP_
+
+#include <onyx_image/onyx_image_export.h>
+#include <onyx_image/types.hpp>
+#include <onyx_image/surface.hpp>
+#include <onyx_image/shared_surface.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace onyx_image {
+
+class file_mapping;
+
+// ============================================================================
+// Asset Packs
+// ============================================================================
+
+/**
+ * Collects decoded images under unique names and writes them as one pack
+ * file for asset_pack. Images keep their palette and subrects, so atlases
+ * (e.g. DCX pages or ICO entries decoded with enable_packing) are stored
+ * with their frame tables.
+ */
+class ONYX_IMAGE_EXPORT asset_pack_writer {
+public:
+    /**
+     * Add an image without copying its pixels.
+     * @param name Unique name
+     * @param image Image or crop
+     * @return false if the name is taken or the image is empty
+     */
+    bool add(std::string_view name, shared_surface image);
+
+    /**
+     * Add a decoded image, taking over its storage.
+     * @param name Unique name
+     * @param image Image (moved from)
+     * @return false if the name is taken or the image is empty
+     */
+    bool add(std::string_view name, memory_surface&& image);
+
+    [[nodiscard]] std::size_t size() const noexcept { return entries_.size(); }
+
+    /**
+     * Write the pack, atomically replacing an existing file.
+     * @param path Output file
+     * @return false on an I/O error
+     */
+    [[nodiscard]] bool save(const std::filesystem::path& path) const;
+
+private:
+    struct entry {
+        std::string name;
+        shared_surface image;
+    };
+    std::vector<entry> entries_;
+};
+
+/**
+ * Read-only pack of images mapped into memory.
+ *
+ * Opening a pack maps the file and reads its index; images() are
+ * shared_surfaces pointing into the mapping, so nothing is decoded or
+ * copied and pages are read on first access. Each image keeps the pack
+ * mapped while it is alive. Entries are ordered by name.
+ */
+class ONYX_IMAGE_EXPORT asset_pack : public std::enable_shared_from_this<asset_pack> {
+public:
+    /**
+     * Map a pack written by asset_pack_writer.
+     * @param path Pack file
+     * @return The pack, or nullptr if the file is missing or invalid
+     */
+    [[nodiscard]] static std::shared_ptr<const asset_pack> open(const std::filesystem::path& path);
+
+    ~asset_pack();
+
+    asset_pack(const asset_pack&) = delete;
+    asset_pack& operator=(const asset_pack&) = delete;
+
+    [[nodiscard]] std::size_t size() const noexcept { return entries_.size(); }
+    [[nodiscard]] std::string_view name(std::size_t index) const noexcept;
+
+    /**
+     * Index of the entry with the given name.
+     */
+    [[nodiscard]] std::optional<std::size_t> find(std::string_view name) const noexcept;
+
+    /**
+     * Image of an entry; empty if index is out of range.
+     */
+    [[nodiscard]] shared_surface image(std::size_t index) const;
+
+    /**
+     * Image of the entry with the given name; empty if there is none.
+     */
+    [[nodiscard]] shared_surface image(std::string_view name) const;
+
+private:
+    asset_pack();
+
+    struct entry {
+        std::string_view name;
+        const std::uint8_t* pixels = nullptr;
+        std::span<const std::uint8_t> palette;
+        std::vector<subrect> subrects;
+        int width = 0;
+        int height = 0;
+        std::size_t pitch = 0;
+        pixel_format format = pixel_format::rgba8888;
+    };
+
+    std::unique_ptr<file_mapping> mapping_;
+    std::vector<entry> entries_;
+};
+
+} // namespace onyx_image
+
+#endif // ONYX_IMAGE_ASSET_PACK_HPP_
@@ -0,0 +1,118 @@
+#ifndef ONYX_IMAGE_BYTE_SOURCE_HPP_
+#define ONYX_IMAGE_BYTE_SOURCE_HPP_
+
+#include <onyx_image/onyx_image_export.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace onyx_image {
+
+// ============================================================================
+// Byte Source Interface
+// ============================================================================
+
+/**
+ * Sequential input for decoders that can consume a stream (JPEG, TGA, GIF)
+ * without the whole file in memory. Other decoders read the source to the
+ * end first (see read_all).
+ */
+class ONYX_IMAGE_EXPORT byte_source {
+public:
+    virtual ~byte_source() = default;
+
+    /**
+     * Read up to size bytes. A source may return fewer bytes than asked
+     * before its end, as a pipe does; callers read again until it
+     * returns 0.
+     * @param dst Destination buffer
+     * @param size Maximum number of bytes to read
+     * @return Number of bytes read; 0 only at the end of input
+     */
+    [[nodiscard]] virtual std::size_t read(std::uint8_t* dst, std::size_t size) = 0;
+
+    /**
+     * Skip forward. The default reads and discards.
+     * @param count Number of bytes to skip
+     * @return Number of bytes skipped; less than count only at the end of input
+     */
+    virtual std::size_t skip(std::size_t count);
+
+    /**
+     * @return true once no more bytes can be read
+     */
+    [[nodiscard]] virtual bool at_end() const = 0;
+};
+
+/**
+ * Read everything left in a source.
+ * @param src Source to drain
+ * @return The remaining bytes
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT std::vector<std::uint8_t> read_all(byte_source& src);
+
+// ============================================================================
+// Memory Source
+// ============================================================================
+
+/**
+ * Byte source over a caller-owned buffer.
+ */
+class ONYX_IMAGE_EXPORT memory_source : public byte_source {
+public:
+    explicit memory_source(std::span<const std::uint8_t> data) noexcept : data_(data) {}
+
+    [[nodiscard]] std::size_t read(std::uint8_t* dst, std::size_t size) override;
+    std::size_t skip(std::size_t count) override;
+    [[nodiscard]] bool at_end() const override { return pos_ == data_.size(); }
+
+private:
+    std::span<const std::uint8_t> data_;
+    std::size_t pos_ = 0;
+};
+
+// ============================================================================
+// File Source
+// ============================================================================
+
+/**
+ * Byte source over a C stdio stream: a file opened by path, or any open
+ * FILE* such as stdin or a pipe. Skips seek when the stream allows it.
+ */
+class ONYX_IMAGE_EXPORT file_source : public byte_source {
+public:
+    /**
+     * Open a file for reading; check is_open() afterwards.
+     * @param path File path
+     */
+    explicit file_source(const std::filesystem::path& path);
+
+    /**
+     * Read from an already open stream, which is not closed on destruction.
+     * @param file Open stream positioned at the start of the image
+     */
+    explicit file_source(std::FILE* file) noexcept : file_(file), owned_(false) {}
+
+    ~file_source() override;
+
+    file_source(const file_source&) = delete;
+    file_source& operator=(const file_source&) = delete;
+
+    [[nodiscard]] bool is_open() const noexcept { return file_ != nullptr; }
+
+    [[nodiscard]] std::size_t read(std::uint8_t* dst, std::size_t size) override;
+    std::size_t skip(std::size_t count) override;
+    [[nodiscard]] bool at_end() const override;
+
+private:
+    std::FILE* file_ = nullptr;
+    bool owned_ = true;
+};
+
+} // namespace onyx_image
+
+#endif // ONYX_IMAGE_BYTE_SOURCE_HPP_
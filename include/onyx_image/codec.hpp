@@ -4,6 +4,7 @@
 #include <onyx_image/onyx_image_export.h>
 #include <onyx_image/types.hpp>
 #include <onyx_image/surface.hpp>
+#include <onyx_image/byte_source.hpp>
 
 #include <cstdint>
 #include <memory>
@@ -32,6 +33,14 @@ public:
     [[nodiscard]] virtual decode_result decode(std::span<const std::uint8_t> data,
                                                 surface& surf,
                                                 const decode_options& options) const = 0;
+
+    /**
+     * Decode from a stream. The default reads the source to the end and
+     * calls decode(); codecs that can consume a stream override it.
+     */
+    [[nodiscard]] virtual decode_result decode_stream(byte_source& src,
+                                                       surface& surf,
+                                                       const decode_options& options) const;
 };
 
 // ============================================================================
@@ -126,6 +135,44 @@ private:
                                                       std::string_view codec_name,
                                                       const decode_options& options = {});
 
+/**
+ * Decode from a stream (explicit codec).
+ * JPEG, TGA and GIF are decoded as the bytes arrive; other codecs read the
+ * whole source first. Format detection needs the complete file, so there
+ * is no auto-detecting stream overload: use read_all() and decode().
+ * @param src Byte source positioned at the start of the image
+ * @param surf Destination surface
+ * @param codec_name Name of codec to use
+ * @param options Decode options
+ * @return Decode result
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT decode_result decode(byte_source& src,
+                                                      surface& surf,
+                                                      std::string_view codec_name,
+                                                      const decode_options& options = {});
+
+/**
+ * Check that image data decodes cleanly (auto-detect format).
+ * Runs the full decode into a null_surface: all encoded data is consumed
+ * and validated, but no pixel buffer is allocated or converted.
+ * @param data Raw file data
+ * @param options Decode options (dimension limits apply as for decode)
+ * @return The decode result a real decode would return
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT decode_result verify(std::span<const std::uint8_t> data,
+                                                      const decode_options& options = {});
+
+/**
+ * Check that image data decodes cleanly (explicit codec).
+ * @param data Raw file data
+ * @param codec_name Name of codec to use
+ * @param options Decode options
+ * @return The decode result a real decode would return
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT decode_result verify(std::span<const std::uint8_t> data,
+                                                      std::string_view codec_name,
+                                                      const decode_options& options = {});
+
 } // namespace onyx_image
 
 #endif // ONYX_IMAGE_CODEC_HPP_
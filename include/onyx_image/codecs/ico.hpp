@@ -8,9 +8,26 @@
 #include <cstdint>
 #include <span>
 #include <string_view>
+#include <vector>
 
 namespace onyx_image {
 
+// ============================================================================
+// Icon Directory Entry
+// ============================================================================
+
+/**
+ * Description of one image in an icon directory, read without decoding
+ * any pixels.
+ */
+struct icon_entry {
+    int index = 0;      // Position in the icon directory
+    int width = 0;      // Width in pixels
+    int height = 0;     // Height in pixels
+    int bit_depth = 0;  // Bits per pixel (0 if unknown)
+    bool png = false;   // PNG-compressed (Vista+) image
+};
+
 // ============================================================================
 // ICO/CUR Decoder
 // ============================================================================
@@ -29,7 +46,10 @@ namespace onyx_image {
  * - Single icon: decoded to surface at native size
  * - Multiple icons: vertically stacked atlas with subrects
  *   - subrect.kind = subrect_kind::sprite
- *   - subrect.user_tag = icon index
+ *   - subrect.user_tag = directory index (entries that fail to decode
+ *     leave a gap)
+ * - With decode_options::icon_size / icon_bit_depth set: only the best
+ *   matching entry is decoded (subrect.user_tag = directory index)
  */
 class ONYX_IMAGE_EXPORT ico_decoder {
 public:
@@ -57,6 +77,27 @@ public:
     [[nodiscard]] static decode_result decode(std::span<const std::uint8_t> data,
                                                surface& surf,
                                                const decode_options& options = {});
+
+    /**
+     * List the images in an ICO/CUR directory without decoding them.
+     * Sizes come from the directory; bit depths from the image headers.
+     * @param data Raw file data
+     * @return Directory entries (empty if the file is not a valid ICO/CUR)
+     */
+    [[nodiscard]] static std::vector<icon_entry> entries(std::span<const std::uint8_t> data);
+
+    /**
+     * Decode a single directory entry to a surface.
+     * @param data Raw file data
+     * @param index Directory index (see icon_entry::index)
+     * @param surf Destination surface
+     * @param options Decode options
+     * @return Decode result with success/error status
+     */
+    [[nodiscard]] static decode_result decode_entry(std::span<const std::uint8_t> data,
+                                                     int index,
+                                                     surface& surf,
+                                                     const decode_options& options = {});
 };
 
 // ============================================================================
@@ -72,8 +113,11 @@ public:
  * - LX (OS/2 2.x) executables
  * - Multiple icon resources per executable
  * - Creates atlas with all icons
+ * - With decode_options::icon_size / icon_bit_depth set: only the best
+ *   matching icon is decoded (subrect.user_tag = catalog index)
  *
- * Uses libexe (mz-explode) for executable parsing.
+ * NE and PE resources are located by walking the resource table directly
+ * (see exe_icon_directory); LX executables use libexe (mz-explode).
  */
 class ONYX_IMAGE_EXPORT exe_icon_decoder {
 public:
@@ -101,6 +145,80 @@ public:
     [[nodiscard]] static decode_result decode(std::span<const std::uint8_t> data,
                                                surface& surf,
                                                const decode_options& options = {});
+
+    /**
+     * List the icons of an NE/PE executable without decoding them.
+     * Equivalent to exe_icon_directory(data).entries().
+     * @param data Raw executable data
+     * @return Icon catalog (empty if there are no icons or the format is unsupported)
+     */
+    [[nodiscard]] static std::vector<icon_entry> entries(std::span<const std::uint8_t> data);
+
+    /**
+     * Decode a single icon of an NE/PE executable.
+     * @param data Raw executable data
+     * @param index Catalog index (see icon_entry::index)
+     * @param surf Destination surface
+     * @param options Decode options
+     * @return Decode result with success/error status
+     */
+    [[nodiscard]] static decode_result decode_entry(std::span<const std::uint8_t> data,
+                                                     int index,
+                                                     surface& surf,
+                                                     const decode_options& options = {});
+};
+
+// ============================================================================
+// EXE Icon Directory
+// ============================================================================
+
+/**
+ * Parsed icon catalog of an NE (Win16) or PE (Win32/Win64) executable.
+ *
+ * Construction walks only the resource table down to RT_ICON and
+ * RT_GROUP_ICON; no pixels are decoded. Keep the directory around to run
+ * several queries against the same executable without re-parsing it.
+ *
+ * Catalog entries follow RT_ICON resource order, so icon_entry::index
+ * matches the user_tag of the full atlas produced by exe_icon_decoder.
+ * Sizes and depths come from the group icon directories, or from the
+ * image header for icons no group refers to.
+ *
+ * The directory keeps views into the input; the data must outlive it.
+ */
+class ONYX_IMAGE_EXPORT exe_icon_directory {
+public:
+    exe_icon_directory() = default;
+    explicit exe_icon_directory(std::span<const std::uint8_t> data);
+
+    /**
+     * @return true if the input is an NE/PE executable whose resource
+     *         table could be read (it may still contain no icons)
+     */
+    [[nodiscard]] bool valid() const noexcept { return valid_; }
+
+    /**
+     * @return Icon catalog in RT_ICON resource order
+     */
+    [[nodiscard]] const std::vector<icon_entry>& entries() const noexcept { return entries_; }
+
+    /**
+     * Decode all icons as an atlas, or only the best match when
+     * decode_options::icon_size / icon_bit_depth are set.
+     */
+    [[nodiscard]] decode_result decode(surface& surf, const decode_options& options = {}) const;
+
+    /**
+     * Decode a single catalog entry.
+     * @param index Catalog index (see icon_entry::index)
+     */
+    [[nodiscard]] decode_result decode_entry(int index, surface& surf,
+                                             const decode_options& options = {}) const;
+
+private:
+    std::vector<std::span<const std::uint8_t>> images_;
+    std::vector<icon_entry> entries_;
+    bool valid_ = false;
 };
 
 } // namespace onyx_image
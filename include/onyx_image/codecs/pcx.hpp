@@ -59,6 +59,7 @@ private:
     [[nodiscard]] static decode_result decode_rle(std::span<const std::uint8_t> data,
                                                    std::size_t data_offset,
                                                    const header_info& info,
+                                                   pixel_format format,
                                                    surface& surf);
 
     static void apply_ega_palette(std::span<const std::uint8_t> header_data,
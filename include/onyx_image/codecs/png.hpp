@@ -4,9 +4,11 @@
 #include <onyx_image/onyx_image_export.h>
 #include <onyx_image/types.hpp>
 #include <onyx_image/surface.hpp>
+#include <onyx_image/shared_surface.hpp>
 
 #include <cstdint>
 #include <filesystem>
+#include <functional>
 #include <span>
 #include <string_view>
 #include <vector>
@@ -45,21 +47,100 @@ public:
 // PNG Encoder Functions
 // ============================================================================
 
+// Scanline filter selection
+enum class png_filter {
+    none,
+    sub,
+    up,
+    average,
+    paeth,
+    adaptive   // Per-row minimum-sum heuristic; none for palette images
+};
+
+struct png_encode_options {
+    // zlib effort from 0 (stored, no compression) to 9 (smallest output)
+    int compression_level = 6;
+    png_filter filter = png_filter::adaptive;
+
+    // Threads filtering and deflating row bands (0 = one per hardware thread)
+    int threads = 1;
+
+    // Stored deflate blocks and no filtering: the cheapest valid PNG
+    [[nodiscard]] static constexpr png_encode_options fast() noexcept {
+        return {0, png_filter::none};
+    }
+};
+
+// Receives encoded PNG bytes in order; return false to abort
+using png_sink = std::function<bool(std::span<const std::uint8_t>)>;
+
+/**
+ * Encode a memory surface to PNG, streaming chunks to a sink.
+ * Row bands are filtered and deflated in parallel (see
+ * png_encode_options::threads) and handed over as IDAT chunks as soon as
+ * they are ready, so only a few bands are held in memory.
+ * @param surf Source surface
+ * @param sink Destination for the encoded bytes
+ * @param options Compression, filter and thread settings
+ * @return true if the whole file was written
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT bool write_png(const memory_surface& surf,
+                                                const png_sink& sink,
+                                                const png_encode_options& options = {});
+
 /**
  * Encode a memory surface to PNG format.
+ * Indexed surfaces are written as palette PNGs at the smallest bit depth
+ * that holds every index, rgb888 as RGB and rgba8888 as RGBA.
  * @param surf Source surface
+ * @param options Compression and filter settings
  * @return PNG-encoded data, or empty vector on failure
  */
-[[nodiscard]] ONYX_IMAGE_EXPORT std::vector<std::uint8_t> encode_png(const memory_surface& surf);
+[[nodiscard]] ONYX_IMAGE_EXPORT std::vector<std::uint8_t> encode_png(const memory_surface& surf,
+                                                                     const png_encode_options& options = {});
 
 /**
  * Save a memory surface to a PNG file.
  * @param surf Source surface
  * @param path Output file path
+ * @param options Compression and filter settings
  * @return true on success
  */
 [[nodiscard]] ONYX_IMAGE_EXPORT bool save_png(const memory_surface& surf,
-                                               const std::filesystem::path& path);
+                                               const std::filesystem::path& path,
+                                               const png_encode_options& options = {});
+
+/**
+ * Encode a shared surface or crop to PNG, streaming chunks to a sink.
+ * Same output as the memory_surface overload for the same pixels.
+ * @param surf Source surface
+ * @param sink Destination for the encoded bytes
+ * @param options Compression, filter and thread settings
+ * @return true if the whole file was written; false for an empty surface
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT bool write_png(const shared_surface& surf,
+                                                const png_sink& sink,
+                                                const png_encode_options& options = {});
+
+/**
+ * Encode a shared surface or crop to PNG format.
+ * @param surf Source surface
+ * @param options Compression and filter settings
+ * @return PNG-encoded data, or empty vector on failure
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT std::vector<std::uint8_t> encode_png(const shared_surface& surf,
+                                                                     const png_encode_options& options = {});
+
+/**
+ * Save a shared surface or crop to a PNG file.
+ * @param surf Source surface
+ * @param path Output file path
+ * @param options Compression and filter settings
+ * @return true on success
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT bool save_png(const shared_surface& surf,
+                                               const std::filesystem::path& path,
+                                               const png_encode_options& options = {});
 
 // ============================================================================
 // PNG Surface
@@ -81,16 +162,19 @@ public:
 
     /**
      * Encode surface contents to PNG format.
+     * @param options Compression and filter settings
      * @return PNG-encoded data, or empty vector on failure
      */
-    [[nodiscard]] std::vector<std::uint8_t> encode() const;
+    [[nodiscard]] std::vector<std::uint8_t> encode(const png_encode_options& options = {}) const;
 
     /**
      * Save surface contents to a PNG file.
      * @param path Output file path
+     * @param options Compression and filter settings
      * @return true on success
      */
-    [[nodiscard]] bool save(const std::filesystem::path& path) const;
+    [[nodiscard]] bool save(const std::filesystem::path& path,
+                            const png_encode_options& options = {}) const;
 };
 
 } // namespace onyx_image
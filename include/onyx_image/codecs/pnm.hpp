@@ -37,6 +37,10 @@ public:
      *   - P5: Binary PGM (grayscale, 8/16-bit)
      *   - P6: Binary PPM (RGB, 8/16-bit)
      *
+     * Streams of concatenated images are decoded as a vertical atlas with
+     * one subrect per image (subrect_kind::frame, user_tag = image index).
+     * A single image produces no subrects.
+     *
      * @param data Raw file data
      * @param surf Destination surface
      * @param options Decode options
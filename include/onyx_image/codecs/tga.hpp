@@ -4,6 +4,7 @@
 #include <onyx_image/onyx_image_export.h>
 #include <onyx_image/types.hpp>
 #include <onyx_image/surface.hpp>
+#include <onyx_image/byte_source.hpp>
 
 #include <cstdint>
 #include <span>
@@ -21,6 +22,11 @@ public:
     [[nodiscard]] static decode_result decode(std::span<const std::uint8_t> data,
                                                surface& surf,
                                                const decode_options& options = {});
+
+    // Decode as bytes arrive, without buffering the whole input
+    [[nodiscard]] static decode_result decode(byte_source& src,
+                                               surface& surf,
+                                               const decode_options& options = {});
 };
 
 } // namespace onyx_image
@@ -0,0 +1,130 @@
+#ifndef ONYX_IMAGE_DECODE_CACHE_HPP_
+#define ONYX_IMAGE_DECODE_CACHE_HPP_
+
+#include <onyx_image/onyx_image_export.h>
+#include <onyx_image/types.hpp>
+#include <onyx_image/surface.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace onyx_image {
+
+struct decode_key;
+
+// ============================================================================
+// Decode Cache
+// ============================================================================
+
+/**
+ * In-process cache of decoded images, keyed by a 128-bit hash of the
+ * encoded bytes together with the decode options and codec name.
+ *
+ * Entries are immutable memory_surfaces shared through shared_ptr, so a
+ * hit costs a hash of the input and no copy. The cache holds at most
+ * budget() bytes of decoded data and evicts the least recently used
+ * entries (across all shards) beyond that; an image larger than the whole
+ * budget is decoded but not kept. Entries live in independently locked
+ * shards, so threads decoding different images rarely contend. Two
+ * threads missing on the same image at once both decode it; the first
+ * result is kept.
+ *
+ * Only successful decodes are cached. Set decode_options::cache to route
+ * the decode() convenience functions through a cache.
+ */
+class ONYX_IMAGE_EXPORT decode_cache {
+public:
+    static constexpr std::size_t DEFAULT_BUDGET = 256ULL * 1024ULL * 1024ULL;
+    static constexpr int DEFAULT_SHARDS = 16;
+
+    struct statistics {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+    };
+
+    /**
+     * @param budget Maximum bytes of decoded pixels, palettes and subrects
+     * @param shard_count Number of independently locked partitions (at least 1)
+     */
+    explicit decode_cache(std::size_t budget = DEFAULT_BUDGET, int shard_count = DEFAULT_SHARDS);
+    ~decode_cache();
+
+    decode_cache(const decode_cache&) = delete;
+    decode_cache& operator=(const decode_cache&) = delete;
+
+    /**
+     * Decode through the cache (auto-detect format).
+     * @param data Raw file data
+     * @param image Receives the shared decoded image on success
+     * @param options Decode options (the cache field is ignored)
+     * @return Decode result; a hit reports success
+     */
+    [[nodiscard]] decode_result decode(std::span<const std::uint8_t> data,
+                                       std::shared_ptr<const memory_surface>& image,
+                                       const decode_options& options = {});
+
+    /**
+     * Decode through the cache (explicit codec).
+     * @param data Raw file data
+     * @param image Receives the shared decoded image on success
+     * @param codec_name Name of codec to use
+     * @param options Decode options (the cache field is ignored)
+     * @return Decode result
+     */
+    [[nodiscard]] decode_result decode(std::span<const std::uint8_t> data,
+                                       std::shared_ptr<const memory_surface>& image,
+                                       std::string_view codec_name,
+                                       const decode_options& options = {});
+
+    /**
+     * Decode through the cache and copy the image into any surface.
+     * @param data Raw file data
+     * @param surf Destination surface
+     * @param codec_name Name of codec to use; empty to auto-detect
+     * @param options Decode options (the cache field is ignored)
+     * @return Decode result
+     */
+    [[nodiscard]] decode_result decode(std::span<const std::uint8_t> data,
+                                       surface& surf,
+                                       std::string_view codec_name,
+                                       const decode_options& options = {});
+
+    /**
+     * Drop every entry. Images still referenced elsewhere stay valid.
+     */
+    void clear();
+
+    [[nodiscard]] std::size_t budget() const noexcept { return budget_; }
+    [[nodiscard]] std::size_t size_bytes() const noexcept { return bytes_.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::size_t entry_count() const;
+    [[nodiscard]] statistics stats() const noexcept;
+
+private:
+    struct shard;
+
+    [[nodiscard]] decode_result lookup(std::span<const std::uint8_t> data,
+                                       std::shared_ptr<const memory_surface>& image,
+                                       std::string_view codec_name,
+                                       const decode_options& options);
+    std::shared_ptr<const memory_surface> find(const decode_key& key);
+    void insert(const decode_key& key, std::shared_ptr<const memory_surface> image);
+    void evict_over_budget();
+
+    std::size_t budget_;
+    std::vector<std::unique_ptr<shard>> shards_;
+    std::atomic<std::size_t> bytes_{0};
+    std::atomic<std::uint64_t> clock_{0};  // Orders uses for LRU eviction
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+};
+
+} // namespace onyx_image
+
+#endif // ONYX_IMAGE_DECODE_CACHE_HPP_
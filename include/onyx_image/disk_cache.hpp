@@ -0,0 +1,128 @@
+#ifndef ONYX_IMAGE_DISK_CACHE_HPP_
+#define ONYX_IMAGE_DISK_CACHE_HPP_
+
+#include <onyx_image/onyx_image_export.h>
+#include <onyx_image/types.hpp>
+#include <onyx_image/surface.hpp>
+#include <onyx_image/raw_image.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace onyx_image {
+
+struct decode_key;
+
+// ============================================================================
+// Disk Cache
+// ============================================================================
+
+/**
+ * Persistent cache of decoded images in a directory, shared between runs
+ * and between processes.
+ *
+ * Each entry is a raw container (see save_raw_image()) named after a hash
+ * of the encoded bytes, the decode options, the codec name and the library
+ * version, so entries written by another version are never read back. A
+ * hit maps the file and performs no decode.
+ *
+ * Entries are written under a temporary name and renamed into place, so
+ * processes sharing a directory never see partial files; the last writer
+ * of an entry wins. A hit refreshes the file's modification time, and
+ * when the directory grows past budget() the entries with the oldest
+ * times are deleted. Files that are not valid containers count as misses
+ * and are replaced.
+ */
+class ONYX_IMAGE_EXPORT disk_cache {
+public:
+    static constexpr std::uintmax_t DEFAULT_BUDGET = 1024ULL * 1024ULL * 1024ULL;
+
+    struct statistics {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;
+    };
+
+    /**
+     * @param directory Cache directory; created if missing
+     * @param budget Maximum total size of the entry files in bytes
+     */
+    explicit disk_cache(std::filesystem::path directory, std::uintmax_t budget = DEFAULT_BUDGET);
+    ~disk_cache();
+
+    disk_cache(const disk_cache&) = delete;
+    disk_cache& operator=(const disk_cache&) = delete;
+
+    /**
+     * Check if the directory exists and is usable.
+     */
+    [[nodiscard]] bool is_open() const noexcept { return open_; }
+
+    /**
+     * Decode through the cache (auto-detect format).
+     * @param data Raw file data
+     * @param image Receives the mapped image on success
+     * @param options Decode options (the cache field is ignored)
+     * @return Decode result; io_error if a new entry cannot be written
+     */
+    [[nodiscard]] decode_result decode(std::span<const std::uint8_t> data,
+                                       std::shared_ptr<const mapped_image>& image,
+                                       const decode_options& options = {});
+
+    /**
+     * Decode through the cache (explicit codec).
+     * @param data Raw file data
+     * @param image Receives the mapped image on success
+     * @param codec_name Name of codec to use
+     * @param options Decode options (the cache field is ignored)
+     * @return Decode result
+     */
+    [[nodiscard]] decode_result decode(std::span<const std::uint8_t> data,
+                                       std::shared_ptr<const mapped_image>& image,
+                                       std::string_view codec_name,
+                                       const decode_options& options = {});
+
+    /**
+     * Delete the least recently used entries until the directory fits the
+     * budget. Runs automatically after an entry is added.
+     */
+    void trim();
+
+    /**
+     * Delete every entry. Images already mapped stay valid.
+     */
+    void clear();
+
+    [[nodiscard]] const std::filesystem::path& directory() const noexcept { return directory_; }
+    [[nodiscard]] std::uintmax_t budget() const noexcept { return budget_; }
+
+    /**
+     * Total size of the entry files as last seen by this instance.
+     */
+    [[nodiscard]] std::uintmax_t size_bytes() const noexcept { return bytes_.load(std::memory_order_relaxed); }
+    [[nodiscard]] statistics stats() const noexcept;
+
+private:
+    [[nodiscard]] decode_result lookup(std::span<const std::uint8_t> data,
+                                       std::shared_ptr<const mapped_image>& image,
+                                       std::string_view codec_name,
+                                       const decode_options& options);
+    [[nodiscard]] std::filesystem::path entry_path(const decode_key& key) const;
+
+    std::filesystem::path directory_;
+    std::uintmax_t budget_;
+    bool open_ = false;
+    std::atomic<std::uintmax_t> bytes_{0};
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+};
+
+} // namespace onyx_image
+
+#endif // ONYX_IMAGE_DISK_CACHE_HPP_
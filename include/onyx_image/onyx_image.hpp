@@ -4,7 +4,14 @@
 #include <onyx_image/onyx_image_export.h>
 #include <onyx_image/types.hpp>
 #include <onyx_image/surface.hpp>
+#include <onyx_image/shared_surface.hpp>
+#include <onyx_image/tiled_surface.hpp>
+#include <onyx_image/byte_source.hpp>
 #include <onyx_image/codec.hpp>
+#include <onyx_image/decode_cache.hpp>
+#include <onyx_image/raw_image.hpp>
+#include <onyx_image/disk_cache.hpp>
+#include <onyx_image/asset_pack.hpp>
 #include <onyx_image/palettes.hpp>
 #include <onyx_image/codecs/pcx.hpp>
 #include <onyx_image/codecs/png.hpp>
@@ -39,7 +46,14 @@ namespace onyx_image {
 // See:
 //   - types.hpp:    pixel_format, decode_error, decode_result, decode_options
 //   - surface.hpp:  Surface concept, memory_surface
+//   - shared_surface.hpp: Immutable reference-counted images and crop views
+//   - tiled_surface.hpp: Tiled storage for region access on large images
+//   - byte_source.hpp: Streaming input (memory_source, file_source)
 //   - codec.hpp:    decoder, codec_registry, decode()
+//   - decode_cache.hpp: Shared LRU cache of decoded images
+//   - raw_image.hpp: Raw image container, memory-mapped images
+//   - disk_cache.hpp: Persistent cache of decoded images in a directory
+//   - asset_pack.hpp: Packs of decoded images loaded by memory mapping
 //   - palettes.hpp: Standard retro computer palettes (CGA, EGA, VGA, C64, Amiga, etc.)
 //   - codecs/*.hpp: Individual codec implementations
 
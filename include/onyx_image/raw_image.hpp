@@ -0,0 +1,155 @@
+#ifndef ONYX_IMAGE_RAW_IMAGE_HPP_
+#define ONYX_IMAGE_RAW_IMAGE_HPP_
+
+#include <onyx_image/onyx_image_export.h>
+#include <onyx_image/types.hpp>
+#include <onyx_image/surface.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace onyx_image {
+
+class file_mapping;
+
+// ============================================================================
+// Raw Image Container
+// ============================================================================
+
+/**
+ * Store a decoded image as a raw container: a fixed header, the palette,
+ * the subrects and the pixel rows exactly as held in memory, with the
+ * pixels at a 64-byte aligned offset. Loading it back is a memory map.
+ *
+ * The file is written under a temporary name and renamed into place, so
+ * concurrent readers see either the old file or the complete new one.
+ * @param image Image to store
+ * @param path Destination file
+ * @return false on an I/O error
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT bool save_raw_image(const memory_surface& image,
+                                                    const std::filesystem::path& path);
+
+/**
+ * Read-only image backed by a memory-mapped raw container.
+ * The accessors mirror memory_surface; pixels() points into the mapping,
+ * so nothing is decoded or copied and pages are read on first access.
+ */
+class ONYX_IMAGE_EXPORT mapped_image {
+public:
+    /**
+     * Map a raw container written by save_raw_image().
+     * @param path Container file
+     * @return The image, or nullptr if the file is missing or not a valid container
+     */
+    [[nodiscard]] static std::shared_ptr<const mapped_image> open(const std::filesystem::path& path);
+
+    ~mapped_image();
+
+    mapped_image(const mapped_image&) = delete;
+    mapped_image& operator=(const mapped_image&) = delete;
+
+    [[nodiscard]] int width() const noexcept { return width_; }
+    [[nodiscard]] int height() const noexcept { return height_; }
+    [[nodiscard]] pixel_format format() const noexcept { return format_; }
+    [[nodiscard]] std::size_t pitch() const noexcept { return pitch_; }
+    [[nodiscard]] std::span<const std::uint8_t> pixels() const noexcept { return pixels_; }
+    [[nodiscard]] std::span<const std::uint8_t> palette() const noexcept { return palette_; }
+    [[nodiscard]] const std::vector<subrect>& subrects() const noexcept { return subrects_; }
+
+private:
+    mapped_image();
+
+    std::unique_ptr<file_mapping> mapping_;
+    std::span<const std::uint8_t> pixels_;
+    std::span<const std::uint8_t> palette_;
+    std::vector<subrect> subrects_;
+    int width_ = 0;
+    int height_ = 0;
+    std::size_t pitch_ = 0;
+    pixel_format format_ = pixel_format::rgba8888;
+};
+
+// ============================================================================
+// Mapped Surface
+// ============================================================================
+
+/**
+ * Surface that decodes straight into a raw container file through a
+ * writable memory map, for images larger than memory.
+ *
+ * set_size() creates the file at its full size without allocating disk
+ * space (a sparse file where supported), and rows already written are
+ * dropped from the resident set while decoding moves on, so memory use
+ * stays small whatever the image size. Size is limited by max_bytes
+ * instead of memory_surface's 1 GB; raise decode_options::max_width and
+ * max_height to decode beyond 16384 pixels.
+ *
+ * Pixels go to a temporary file next to path. finish() adds the palette,
+ * subrects and header and renames it to path, ready for
+ * mapped_image::open(). A surface destroyed before finish() removes its
+ * temporary file, so path never holds a partial image.
+ */
+class ONYX_IMAGE_EXPORT mapped_surface : public surface {
+public:
+    static constexpr std::uint64_t DEFAULT_MAX_BYTES = 256ULL * 1024ULL * 1024ULL * 1024ULL;
+
+    /**
+     * @param path Container file to produce
+     * @param max_bytes Largest pixel buffer set_size() accepts
+     */
+    explicit mapped_surface(std::filesystem::path path, std::uint64_t max_bytes = DEFAULT_MAX_BYTES);
+    ~mapped_surface() override;
+
+    mapped_surface(const mapped_surface&) = delete;
+    mapped_surface& operator=(const mapped_surface&) = delete;
+
+    // Surface interface
+    bool set_size(int width, int height, pixel_format format) override;
+    void write_pixels(int x, int y, int count, const std::uint8_t* pixels) override;
+    void write_pixel(int x, int y, std::uint8_t pixel) override;
+    void set_palette_size(int count) override;
+    void write_palette(int start, std::span<const std::uint8_t> colors) override;
+    void set_subrect(int index, const subrect& sr) override;
+
+    /**
+     * Complete the container and move it to path.
+     * @return false if nothing was decoded or the file could not be written
+     */
+    [[nodiscard]] bool finish();
+
+    [[nodiscard]] const std::filesystem::path& path() const noexcept { return path_; }
+    [[nodiscard]] int width() const noexcept { return width_; }
+    [[nodiscard]] int height() const noexcept { return height_; }
+    [[nodiscard]] pixel_format format() const noexcept { return format_; }
+    [[nodiscard]] std::size_t pitch() const noexcept { return pitch_; }
+
+private:
+    void discard() noexcept;
+    void note_write(std::size_t offset, std::size_t length) noexcept;
+
+    std::filesystem::path path_;
+    std::filesystem::path temp_path_;
+    std::unique_ptr<file_mapping> mapping_;
+    std::vector<std::uint8_t> palette_;  // RGB triplets
+    std::vector<subrect> subrects_;
+    std::uint64_t max_bytes_;
+    int width_ = 0;
+    int height_ = 0;
+    std::size_t pitch_ = 0;
+    pixel_format format_ = pixel_format::rgba8888;
+
+    // Part of the mapping written to since pages were last released, and
+    // the bytes written since then
+    std::size_t resident_begin_ = 0;
+    std::size_t resident_end_ = 0;
+    std::size_t written_ = 0;
+};
+
+} // namespace onyx_image
+
+#endif // ONYX_IMAGE_RAW_IMAGE_HPP_
@@ -0,0 +1,141 @@
+#ifndef ONYX_IMAGE_SHARED_SURFACE_HPP_
+#define ONYX_IMAGE_SHARED_SURFACE_HPP_
+
+#include <onyx_image/onyx_image_export.h>
+#include <onyx_image/types.hpp>
+#include <onyx_image/surface.hpp>
+#include <onyx_image/raw_image.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace onyx_image {
+
+// ============================================================================
+// Shared Surface
+// ============================================================================
+
+/**
+ * Immutable image handle backed by reference-counted storage.
+ *
+ * Copying a shared_surface copies a pointer, not pixels: every copy and
+ * every crop() of it keeps the same storage alive, and the storage is
+ * released with the last handle. Since the pixels can no longer change,
+ * handles may be passed to and read from any number of threads.
+ *
+ * Rows are pitch() bytes apart. For a crop that is the pitch of the image
+ * it was cut from, so only its first row_bytes(format(), width()) bytes
+ * of each row belong to it.
+ */
+class ONYX_IMAGE_EXPORT shared_surface {
+public:
+    shared_surface() = default;
+
+    /**
+     * Share an image held by a shared_ptr (e.g. from decode_cache).
+     * @param image Image to share; nullptr gives an empty surface
+     */
+    explicit shared_surface(std::shared_ptr<const memory_surface> image);
+
+    /**
+     * Share a memory-mapped image (e.g. from disk_cache).
+     * @param image Image to share; nullptr gives an empty surface
+     */
+    explicit shared_surface(std::shared_ptr<const mapped_image> image);
+
+    /**
+     * View of pixels held by some other object, which the surface keeps
+     * alive (as with the shared_ptr aliasing constructor). The caller
+     * guarantees that height rows of pitch bytes lie at pixels.
+     * @param owner Object owning the pixels, palette and subrects
+     * @param width Width in pixels
+     * @param height Height in rows
+     * @param format Pixel format
+     * @param pitch Bytes between rows
+     * @param pixels First row
+     * @param palette RGB triplets
+     * @param subrects Subrect table
+     */
+    shared_surface(std::shared_ptr<const void> owner, int width, int height, pixel_format format,
+                   std::size_t pitch, const std::uint8_t* pixels,
+                   std::span<const std::uint8_t> palette = {}, std::span<const subrect> subrects = {});
+
+    [[nodiscard]] bool empty() const noexcept { return width_ == 0; }
+    explicit operator bool() const noexcept { return !empty(); }
+
+    [[nodiscard]] int width() const noexcept { return width_; }
+    [[nodiscard]] int height() const noexcept { return height_; }
+    [[nodiscard]] pixel_format format() const noexcept { return format_; }
+    [[nodiscard]] std::size_t pitch() const noexcept { return pitch_; }
+
+    /**
+     * Pixel bytes from the first pixel to the end of the last row.
+     * Row y starts at pixels().data() + y * pitch().
+     */
+    [[nodiscard]] std::span<const std::uint8_t> pixels() const noexcept;
+
+    /**
+     * The bytes of row y that belong to the image.
+     */
+    [[nodiscard]] std::span<const std::uint8_t> row(int y) const noexcept;
+
+    [[nodiscard]] std::span<const std::uint8_t> palette() const noexcept { return palette_; }
+
+    /**
+     * Subrects of the original image; crops have none.
+     */
+    [[nodiscard]] std::span<const subrect> subrects() const noexcept { return subrects_; }
+
+    /**
+     * View of a rectangle sharing this surface's storage and palette.
+     * For packed formats rect.x must start on a byte boundary.
+     * @param rect Area in pixels; must lie inside the surface
+     * @return The view, or an empty surface if the rectangle is invalid
+     */
+    [[nodiscard]] shared_surface crop(const image_rect& rect) const;
+
+    /**
+     * View of one atlas entry, crop(subrects()[index].rect).
+     * @param index Subrect index
+     * @return The view, or an empty surface if index is out of range
+     */
+    [[nodiscard]] shared_surface subrect_view(std::size_t index) const;
+
+    /**
+     * Number of handles sharing the storage (0 for an empty surface).
+     */
+    [[nodiscard]] long use_count() const noexcept { return owner_.use_count(); }
+
+private:
+    std::shared_ptr<const void> owner_;
+    const std::uint8_t* pixels_ = nullptr;
+    std::span<const std::uint8_t> palette_;
+    std::span<const subrect> subrects_;
+    int width_ = 0;
+    int height_ = 0;
+    std::size_t pitch_ = 0;
+    pixel_format format_ = pixel_format::rgba8888;
+};
+
+/**
+ * Turn a decoded surface into a shared_surface without copying pixels.
+ * @param surf Source surface; moved from
+ * @return Handle owning the former contents of surf
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT shared_surface freeze(memory_surface&& surf);
+
+/**
+ * Copy a shared surface or crop into a memory surface, expanding packed
+ * indexed formats to indexed8 (see the memory_surface overload).
+ * @param src Source surface
+ * @param dst Destination surface (resized)
+ * @return false if src is empty or dst could not be allocated
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT bool expand_packed(const shared_surface& src, memory_surface& dst);
+
+} // namespace onyx_image
+
+#endif // ONYX_IMAGE_SHARED_SURFACE_HPP_
@@ -6,6 +6,7 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <new>
 #include <span>
 #include <vector>
 
@@ -41,6 +42,7 @@ public:
      *
      * NOTE: The x parameter is a BYTE OFFSET within the row, not a pixel coordinate.
      * For RGB formats, use x = pixel_x * 3; for RGBA, use x = pixel_x * 4.
+     * Packed formats (indexed1/2/4) are written as whole bytes of packed data.
      *
      * @param x Starting byte offset within the row (NOT pixel coordinate)
      * @param y Y coordinate (row number)
@@ -50,10 +52,10 @@ public:
     virtual void write_pixels(int x, int y, int count, const std::uint8_t* pixels) = 0;
 
     /**
-     * Write a single pixel (for indexed8 format).
-     * @param x X coordinate
+     * Write a single pixel (for indexed formats).
+     * @param x X coordinate (pixels, also for the packed formats)
      * @param y Y coordinate
-     * @param pixel Pixel value (palette index for indexed8)
+     * @param pixel Palette index
      */
     virtual void write_pixel(int x, int y, std::uint8_t pixel) = 0;
 
@@ -82,19 +84,84 @@ public:
         (void)index;
         (void)sr;
     }
+
+    /**
+     * Whether pixel writes are thrown away.
+     * Decoders may then skip pixel conversion, but must still consume and
+     * validate the complete encoded data so errors match a real decode.
+     * @return true if writes have no observable effect
+     */
+    [[nodiscard]] virtual bool discards_pixels() const noexcept { return false; }
+
+    /**
+     * Whether some writes since set_size() could not be stored, e.g. a
+     * surface that allocates storage lazily ran out of memory. decode()
+     * reports such a decode as failed.
+     * @return true if pixel data was lost
+     */
+    [[nodiscard]] virtual bool failed() const noexcept { return false; }
 };
 
 // ============================================================================
 // Memory Surface (default implementation)
 // ============================================================================
 
+/**
+ * Allocator returning storage aligned to Alignment bytes.
+ */
+template <typename T, std::size_t Alignment>
+struct aligned_allocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = aligned_allocator<U, Alignment>;
+    };
+
+    aligned_allocator() noexcept = default;
+    template <typename U>
+    aligned_allocator(const aligned_allocator<U, Alignment>&) noexcept {}
+
+    [[nodiscard]] T* allocate(std::size_t n) {
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t{Alignment}));
+    }
+    void deallocate(T* p, std::size_t n) noexcept {
+        ::operator delete(p, n * sizeof(T), std::align_val_t{Alignment});
+    }
+
+    friend bool operator==(const aligned_allocator&, const aligned_allocator&) noexcept { return true; }
+};
+
+/**
+ * Placement of rows in a memory_surface.
+ * The default packs rows tightly (pitch = row_bytes(format, width)).
+ */
+struct row_layout {
+    // Every row starts at a multiple of this many bytes from the buffer
+    // start (a power of two). Rows are padded up to it.
+    std::size_t alignment = 1;
+
+    // Exact distance between rows in bytes, overriding alignment
+    // (0 = row size rounded up to alignment). set_size() fails if a row
+    // does not fit.
+    std::size_t pitch = 0;
+};
+
 /**
  * Simple in-memory surface implementation.
  * Stores pixels in a contiguous buffer with optional palette.
+ *
+ * The buffer starts on a BASE_ALIGNMENT boundary and row y starts at byte
+ * y * pitch(). Padding after each row (see row_layout) is zero and is
+ * never written by write_pixels(), so a row_layout matching a graphics
+ * API's pitch requirement lets the buffer be uploaded as is.
  */
 class ONYX_IMAGE_EXPORT memory_surface : public surface {
 public:
+    static constexpr std::size_t BASE_ALIGNMENT = 64;
+
     memory_surface() = default;
+    explicit memory_surface(const row_layout& layout) noexcept : layout_(layout) {}
     ~memory_surface() override = default;
 
     memory_surface(const memory_surface&) = delete;
@@ -102,6 +169,13 @@ public:
     memory_surface(memory_surface&&) noexcept = default;
     memory_surface& operator=(memory_surface&&) noexcept = default;
 
+    /**
+     * Change the row layout used by the next set_size().
+     * @param layout Row alignment and pitch
+     */
+    void set_row_layout(const row_layout& layout) noexcept { layout_ = layout; }
+    [[nodiscard]] const row_layout& layout() const noexcept { return layout_; }
+
     // Surface interface
     bool set_size(int width, int height, pixel_format format) override;
     void write_pixels(int x, int y, int count, const std::uint8_t* pixels) override;
@@ -110,7 +184,7 @@ public:
     void write_palette(int start, std::span<const std::uint8_t> colors) override;
     void set_subrect(int index, const subrect& sr) override;
 
-    // Accessors (read-only)
+    // Accessors (read-only); pixels() spans height() rows of pitch() bytes
     [[nodiscard]] int width() const noexcept { return width_; }
     [[nodiscard]] int height() const noexcept { return height_; }
     [[nodiscard]] pixel_format format() const noexcept { return format_; }
@@ -124,12 +198,72 @@ public:
     [[nodiscard]] std::span<std::uint8_t> mutable_palette() noexcept { return palette_; }
 
 private:
-    std::vector<std::uint8_t> pixels_;
+    std::vector<std::uint8_t, aligned_allocator<std::uint8_t, BASE_ALIGNMENT>> pixels_;
     std::vector<std::uint8_t> palette_;  // RGB triplets
     std::vector<subrect> subrects_;
     int width_ = 0;
     int height_ = 0;
     std::size_t pitch_ = 0;
+    std::size_t row_size_ = 0;  // Bytes of a row that hold pixels
+    pixel_format format_ = pixel_format::rgba8888;
+    row_layout layout_;
+};
+
+// ============================================================================
+// Packed Format Expansion
+// ============================================================================
+
+/**
+ * Expand one row of indexed pixels to one index per byte.
+ * @param format Source format (indexed1, indexed2, indexed4 or indexed8)
+ * @param src Source row in that format
+ * @param dst Destination, at least width bytes
+ * @param width Number of pixels
+ */
+ONYX_IMAGE_EXPORT void unpack_indexed_row(pixel_format format, const std::uint8_t* src,
+                                          std::uint8_t* dst, int width) noexcept;
+
+/**
+ * Copy a surface, expanding packed indexed formats to indexed8.
+ * Other formats are copied unchanged; palette and subrects are kept.
+ * @param src Source surface
+ * @param dst Destination surface (resized)
+ * @return false if dst could not be allocated
+ */
+[[nodiscard]] ONYX_IMAGE_EXPORT bool expand_packed(const memory_surface& src, memory_surface& dst);
+
+// ============================================================================
+// Null Surface (verification)
+// ============================================================================
+
+/**
+ * Surface that records geometry but stores no pixels.
+ * Decoding into it checks that a file decodes cleanly without allocating
+ * the image: set_size() applies the same limits as memory_surface, and all
+ * writes are discarded.
+ */
+class ONYX_IMAGE_EXPORT null_surface : public surface {
+public:
+    // Surface interface
+    bool set_size(int width, int height, pixel_format format) override;
+    void write_pixels(int x, int y, int count, const std::uint8_t* pixels) override;
+    void write_pixel(int x, int y, std::uint8_t pixel) override;
+    void set_palette_size(int count) override;
+    void set_subrect(int index, const subrect& sr) override;
+    [[nodiscard]] bool discards_pixels() const noexcept override { return true; }
+
+    // Accessors (read-only)
+    [[nodiscard]] int width() const noexcept { return width_; }
+    [[nodiscard]] int height() const noexcept { return height_; }
+    [[nodiscard]] pixel_format format() const noexcept { return format_; }
+    [[nodiscard]] int palette_size() const noexcept { return palette_size_; }
+    [[nodiscard]] int subrect_count() const noexcept { return subrect_count_; }
+
+private:
+    int width_ = 0;
+    int height_ = 0;
+    int palette_size_ = 0;
+    int subrect_count_ = 0;
     pixel_format format_ = pixel_format::rgba8888;
 };
 
@@ -0,0 +1,137 @@
+#ifndef ONYX_IMAGE_TILED_SURFACE_HPP_
+#define ONYX_IMAGE_TILED_SURFACE_HPP_
+
+#include <onyx_image/onyx_image_export.h>
+#include <onyx_image/types.hpp>
+#include <onyx_image/surface.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace onyx_image {
+
+// ============================================================================
+// Tiled Surface
+// ============================================================================
+
+/**
+ * Surface storing the image as a grid of fixed-size tiles.
+ *
+ * Each tile holds tile_height() rows of tile_pitch() bytes in one block,
+ * so reading a small window or a column of a huge image touches a few
+ * compact blocks instead of one cache line and page per row. Tiles are
+ * allocated on their first write; tiles never written read as zero and
+ * cost no memory.
+ *
+ * Decoders write rows through the surface interface as usual. Edge tiles
+ * are allocated at full size; their bytes outside the image stay zero.
+ * Tile memory is limited by max_bytes. If a tile cannot be allocated, or
+ * would take the tiles past that limit, its writes are lost and failed()
+ * turns true until the next set_size().
+ */
+class ONYX_IMAGE_EXPORT tiled_surface : public surface {
+public:
+    static constexpr int DEFAULT_TILE_SIZE = 64;
+    static constexpr std::uint64_t DEFAULT_MAX_BYTES = 16ULL * 1024ULL * 1024ULL * 1024ULL;
+
+    /**
+     * @param tile_width Tile width in pixels, rounded up to a multiple of 8
+     *                   so that packed rows split on byte boundaries
+     * @param tile_height Tile height in rows
+     * @param max_bytes Largest total of tile and grid memory the surface
+     *                  allocates
+     */
+    explicit tiled_surface(int tile_width = DEFAULT_TILE_SIZE, int tile_height = DEFAULT_TILE_SIZE,
+                           std::uint64_t max_bytes = DEFAULT_MAX_BYTES);
+    ~tiled_surface() override = default;
+
+    tiled_surface(const tiled_surface&) = delete;
+    tiled_surface& operator=(const tiled_surface&) = delete;
+    tiled_surface(tiled_surface&&) noexcept = default;
+    tiled_surface& operator=(tiled_surface&&) noexcept = default;
+
+    // Surface interface
+    bool set_size(int width, int height, pixel_format format) override;
+    void write_pixels(int x, int y, int count, const std::uint8_t* pixels) override;
+    void write_pixel(int x, int y, std::uint8_t pixel) override;
+    void set_palette_size(int count) override;
+    void write_palette(int start, std::span<const std::uint8_t> colors) override;
+    void set_subrect(int index, const subrect& sr) override;
+    [[nodiscard]] bool failed() const noexcept override { return failed_; }
+
+    // Accessors (read-only)
+    [[nodiscard]] int width() const noexcept { return width_; }
+    [[nodiscard]] int height() const noexcept { return height_; }
+    [[nodiscard]] pixel_format format() const noexcept { return format_; }
+    [[nodiscard]] std::span<const std::uint8_t> palette() const noexcept { return palette_; }
+    [[nodiscard]] const std::vector<subrect>& subrects() const noexcept { return subrects_; }
+
+    // Tile grid
+    [[nodiscard]] int tile_width() const noexcept { return tile_width_; }
+    [[nodiscard]] int tile_height() const noexcept { return tile_height_; }
+    [[nodiscard]] int tiles_x() const noexcept { return tiles_x_; }
+    [[nodiscard]] int tiles_y() const noexcept { return tiles_y_; }
+    [[nodiscard]] std::size_t tile_pitch() const noexcept { return tile_pitch_; }
+
+    /**
+     * Pixels of tile (tx, ty): tile_height() rows of tile_pitch() bytes.
+     * @return The tile, or an empty span if it was never written (all
+     *         zero) or is outside the grid
+     */
+    [[nodiscard]] std::span<const std::uint8_t> tile(int tx, int ty) const noexcept;
+
+    /**
+     * Area of the image covered by tile (tx, ty), clipped to the image.
+     */
+    [[nodiscard]] image_rect tile_rect(int tx, int ty) const noexcept;
+
+    /**
+     * Number of tiles holding memory.
+     */
+    [[nodiscard]] std::size_t allocated_tiles() const noexcept { return allocated_; }
+
+    /**
+     * Copy a rectangle into a linear buffer.
+     * For packed formats rect.x must start on a byte boundary.
+     * @param rect Area in pixels; must lie inside the surface
+     * @param dst Destination, rect.h rows of dst_pitch bytes
+     * @param dst_pitch Bytes between destination rows, at least
+     *                  row_bytes(format(), rect.w)
+     * @return false if the rectangle or pitch is invalid
+     */
+    bool read_region(const image_rect& rect, std::uint8_t* dst, std::size_t dst_pitch) const;
+
+    /**
+     * Copy the whole image, palette and subrects into a row-major surface.
+     * @param dst Destination surface (resized)
+     * @return false if the surface is empty or dst could not be allocated
+     */
+    bool to_linear(memory_surface& dst) const;
+
+private:
+    std::uint8_t* tile_for_write(int tx, int ty);
+
+    using tile_storage = std::vector<std::uint8_t, aligned_allocator<std::uint8_t, memory_surface::BASE_ALIGNMENT>>;
+
+    std::vector<tile_storage> tiles_;  // Row-major grid; empty until written
+    std::vector<std::uint8_t> palette_;  // RGB triplets
+    std::vector<subrect> subrects_;
+    int width_ = 0;
+    int height_ = 0;
+    pixel_format format_ = pixel_format::rgba8888;
+    std::uint64_t max_bytes_;
+    int tile_width_;
+    int tile_height_;
+    int tiles_x_ = 0;
+    int tiles_y_ = 0;
+    std::size_t tile_pitch_ = 0;
+    std::size_t row_size_ = 0;
+    std::size_t allocated_ = 0;
+    bool failed_ = false;
+};
+
+} // namespace onyx_image
+
+#endif // ONYX_IMAGE_TILED_SURFACE_HPP_
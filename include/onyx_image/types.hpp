@@ -3,6 +3,7 @@
 
 #include <onyx_image/onyx_image_export.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
 
@@ -12,21 +13,60 @@ namespace onyx_image {
 // Pixel Formats
 // ============================================================================
 
+// Packed indexed formats (indexed1/2/4) hold several pixels per byte,
+// leftmost pixel in the most significant bits. Each row starts on a byte
+// boundary; bits past the last pixel of a row are zero.
 enum class pixel_format {
     indexed8,   // 8-bit indices, up to 256 colors
     rgb888,     // 24-bit, 8-bit RGB components, no alpha
-    rgba8888    // 32-bit, 8-bit RGBA components
+    rgba8888,   // 32-bit, 8-bit RGBA components
+    indexed1,   // 1-bit indices, 8 pixels per byte
+    indexed2,   // 2-bit indices, 4 pixels per byte
+    indexed4    // 4-bit indices, 2 pixels per byte
 };
 
-[[nodiscard]] constexpr std::size_t bytes_per_pixel(pixel_format fmt) noexcept {
+[[nodiscard]] constexpr std::size_t bits_per_pixel(pixel_format fmt) noexcept {
     switch (fmt) {
-        case pixel_format::indexed8: return 1;
-        case pixel_format::rgb888:   return 3;
-        case pixel_format::rgba8888: return 4;
+        case pixel_format::indexed1: return 1;
+        case pixel_format::indexed2: return 2;
+        case pixel_format::indexed4: return 4;
+        case pixel_format::indexed8: return 8;
+        case pixel_format::rgb888:   return 24;
+        case pixel_format::rgba8888: return 32;
     }
     return 0;
 }
 
+// Whole bytes per pixel; 0 for the packed sub-byte formats
+[[nodiscard]] constexpr std::size_t bytes_per_pixel(pixel_format fmt) noexcept {
+    return bits_per_pixel(fmt) % 8 == 0 ? bits_per_pixel(fmt) / 8 : 0;
+}
+
+[[nodiscard]] constexpr bool is_indexed(pixel_format fmt) noexcept {
+    return bits_per_pixel(fmt) <= 8;
+}
+
+// Bytes needed for one row of `width` pixels
+[[nodiscard]] constexpr std::size_t row_bytes(pixel_format fmt, std::size_t width) noexcept {
+    return (width * bits_per_pixel(fmt) + 7) / 8;
+}
+
+// Store index `pixel` as pixel x of an indexed row. Packed formats keep
+// the leftmost pixel in the high bits and leave the other pixels of the
+// byte unchanged.
+constexpr void put_indexed_pixel(std::uint8_t* row, std::size_t x, pixel_format fmt, std::uint8_t pixel) noexcept {
+    const std::size_t bits = bits_per_pixel(fmt);
+    const std::size_t bit_offset = x * bits;
+    std::uint8_t& target = row[bit_offset / 8];
+    if (bits == 8) {
+        target = pixel;
+        return;
+    }
+    const unsigned shift = static_cast<unsigned>(8 - bits - bit_offset % 8);
+    const unsigned mask = ((1u << bits) - 1) << shift;
+    target = static_cast<std::uint8_t>((target & ~mask) | ((pixel << shift) & mask));
+}
+
 // ============================================================================
 // Subrect Metadata (for multi-image containers)
 // ============================================================================
@@ -92,6 +132,10 @@ struct decode_result {
 // Decode Options
 // ============================================================================
 
+class decode_cache;
+
+// Fields that change the decoded image are part of the decode_cache key
+// (options_key in cache_key.hpp); add new ones there as well.
 struct decode_options {
     // Maximum allowed dimensions (0 = use default)
     int max_width = 16384;
@@ -103,6 +147,33 @@ struct decode_options {
     int pack_max_width = 4096;
     int pack_max_height = 4096;
     bool power_of_two = false;
+
+    // Icon selection for ICO/CUR and executable icons. When either value is
+    // set, only the best matching entry is decoded instead of an atlas.
+    int icon_size = 0;        // Preferred icon width/height in pixels (0 = any)
+    int icon_bit_depth = 0;   // Preferred bits per pixel (0 = highest available)
+
+    // Keep 1, 2 and 4-bit indexed images packed (indexed1/2/4) instead of
+    // expanding them to indexed8. Applies where the source rows are already
+    // packed; other images are unaffected.
+    bool packed_indexed = false;
+
+    // Decode at 1/scale_denom of the stored size where a codec can do so
+    // without decoding at full size first (JPEG: 1, 2, 4 or 8; other values
+    // round down to one of these). Output dimensions round up. Codecs
+    // without reduced decoding ignore it.
+    int scale_denom = 1;
+
+    // Store frames with identical pixels only once in multi-image atlases
+    // (DCX pages, ICO/CUR and executable icons, PNM streams); the subrects
+    // of repeated frames point at the first copy, so the atlas is smaller
+    // and subrects may overlap. Verifying such a file decodes its frames.
+    bool dedup_frames = false;
+
+    // When set, decode() of a memory buffer looks the image up in this
+    // cache first and stores what it decodes there (see decode_cache.hpp).
+    // Stream decodes and verify() bypass it.
+    decode_cache* cache = nullptr;
 };
 
 } // namespace onyx_image
@@ -0,0 +1,263 @@
+#include <onyx_image/asset_pack.hpp>
+#include "atomic_file.hpp"
+#include "file_mapping.hpp"
+#include "raw_container.hpp"
+#include "codecs/byte_io.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace onyx_image {
+
+namespace {
+
+// Layout of a pack (all values little-endian):
+//
+//   0   magic "ONYXPACK"
+//   8   u32 pack version, u32 entry count
+//   16  u64 index offset, u64 names offset, u64 names size, u64 file size
+//   48  reserved (zero) up to PACK_HEADER_SIZE
+//
+// The index holds PACK_ENTRY_SIZE bytes per entry, sorted by name:
+//
+//   0   u32 name offset (into the names), u32 name length
+//   8   u32 pixel_format, u32 width, u32 height
+//   20  u32 palette entries, u32 subrect count, u32 reserved
+//   32  u64 pitch, u64 pixel offset, u64 palette offset, u64 subrect offset
+//
+// followed by the names (UTF-8, not terminated) and, for every entry, its
+// palette, its subrects (raw_container layout) and its pixel rows, which
+// start on a raw_container::PIXEL_ALIGNMENT boundary.
+
+constexpr char PACK_MAGIC[8] = {'O', 'N', 'Y', 'X', 'P', 'A', 'C', 'K'};
+constexpr std::uint32_t PACK_VERSION = 1;
+constexpr std::size_t PACK_HEADER_SIZE = 64;
+constexpr std::size_t PACK_ENTRY_SIZE = 64;
+
+struct entry_layout {
+    std::uint64_t pitch = 0;
+    std::uint64_t palette_offset = 0;
+    std::uint64_t subrect_offset = 0;
+    std::uint64_t pixel_offset = 0;
+    std::uint64_t end = 0;
+};
+
+} // namespace
+
+// ============================================================================
+// asset_pack_writer
+// ============================================================================
+
+bool asset_pack_writer::add(std::string_view name, shared_surface image) {
+    if (image.empty() || std::ranges::any_of(entries_, [&](const entry& e) { return e.name == name; })) {
+        return false;
+    }
+    entries_.push_back({std::string(name), std::move(image)});
+    return true;
+}
+
+bool asset_pack_writer::add(std::string_view name, memory_surface&& image) {
+    if (image.width() <= 0 || image.height() <= 0) {
+        return false;
+    }
+    return add(name, freeze(std::move(image)));
+}
+
+bool asset_pack_writer::save(const std::filesystem::path& path) const {
+    std::vector<const entry*> sorted;
+    sorted.reserve(entries_.size());
+    for (const auto& e : entries_) {
+        sorted.push_back(&e);
+    }
+    std::ranges::sort(sorted, {}, [](const entry* e) { return std::string_view(e->name); });
+
+    // Place everything before writing a byte
+    const std::uint64_t index_offset = PACK_HEADER_SIZE;
+    const std::uint64_t names_offset = index_offset + sorted.size() * PACK_ENTRY_SIZE;
+    std::string names;
+    std::vector<std::uint32_t> name_offsets;
+    for (const auto* e : sorted) {
+        name_offsets.push_back(static_cast<std::uint32_t>(names.size()));
+        names += e->name;
+    }
+    std::vector<entry_layout> layouts;
+    std::uint64_t pos = names_offset + names.size();
+    for (const auto* e : sorted) {
+        const auto& image = e->image;
+        entry_layout l;
+        l.pitch = row_bytes(image.format(), static_cast<std::size_t>(image.width()));
+        l.palette_offset = pos;
+        l.subrect_offset = l.palette_offset + image.palette().size();
+        l.pixel_offset = raw_container::align_up(
+            l.subrect_offset + image.subrects().size() * raw_container::SUBRECT_SIZE, raw_container::PIXEL_ALIGNMENT);
+        l.end = l.pixel_offset + l.pitch * static_cast<std::uint64_t>(image.height());
+        pos = l.end;
+        layouts.push_back(l);
+    }
+
+    std::vector<std::uint8_t> head(static_cast<std::size_t>(names_offset), 0);
+    std::memcpy(head.data(), PACK_MAGIC, sizeof(PACK_MAGIC));
+    write_le32(head.data() + 8, PACK_VERSION);
+    write_le32(head.data() + 12, static_cast<std::uint32_t>(sorted.size()));
+    write_le64(head.data() + 16, index_offset);
+    write_le64(head.data() + 24, names_offset);
+    write_le64(head.data() + 32, names.size());
+    write_le64(head.data() + 40, pos);
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        const auto& image = sorted[i]->image;
+        const auto& l = layouts[i];
+        std::uint8_t* p = head.data() + index_offset + i * PACK_ENTRY_SIZE;
+        write_le32(p + 0, name_offsets[i]);
+        write_le32(p + 4, static_cast<std::uint32_t>(sorted[i]->name.size()));
+        write_le32(p + 8, static_cast<std::uint32_t>(image.format()));
+        write_le32(p + 12, static_cast<std::uint32_t>(image.width()));
+        write_le32(p + 16, static_cast<std::uint32_t>(image.height()));
+        write_le32(p + 20, static_cast<std::uint32_t>(image.palette().size() / 3));
+        write_le32(p + 24, static_cast<std::uint32_t>(image.subrects().size()));
+        write_le64(p + 32, l.pitch);
+        write_le64(p + 40, l.pixel_offset);
+        write_le64(p + 48, l.palette_offset);
+        write_le64(p + 56, l.subrect_offset);
+    }
+
+    atomic_file file(path);
+    file.write(head.data(), head.size());
+    file.write(names.data(), names.size());
+    std::uint64_t written = names_offset + names.size();
+    std::uint8_t record[raw_container::SUBRECT_SIZE];
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        const auto& image = sorted[i]->image;
+        const auto& l = layouts[i];
+        file.write(image.palette().data(), image.palette().size());
+        for (const auto& sr : image.subrects()) {
+            raw_container::encode_subrect(sr, record);
+            file.write(record, sizeof(record));
+        }
+        written = l.subrect_offset + image.subrects().size() * raw_container::SUBRECT_SIZE;
+        file.write_zeros(static_cast<std::size_t>(l.pixel_offset - written));
+
+        // Rows are stored tightly, also for crops of wider images. Bits after
+        // the last pixel of a packed row are zero, as in a decoded image,
+        // whatever the parent of a crop holds there.
+        const unsigned tail_bits = static_cast<unsigned>(
+            static_cast<std::size_t>(image.width()) * bits_per_pixel(image.format()) % 8);
+        for (int y = 0; y < image.height(); ++y) {
+            const auto row = image.row(y);
+            if (tail_bits == 0) {
+                file.write(row.data(), row.size());
+                continue;
+            }
+            const auto last = static_cast<std::uint8_t>(row.back() & (0xFF << (8 - tail_bits)));
+            file.write(row.data(), row.size() - 1);
+            file.write(&last, 1);
+        }
+    }
+    return file.commit();
+}
+
+// ============================================================================
+// asset_pack
+// ============================================================================
+
+asset_pack::asset_pack() = default;
+asset_pack::~asset_pack() = default;
+
+std::shared_ptr<const asset_pack> asset_pack::open(const std::filesystem::path& path) {
+    auto mapping = std::make_unique<file_mapping>();
+    if (!mapping->open(path)) {
+        return nullptr;
+    }
+    const auto data = mapping->data();
+    const std::uint64_t available = data.size();
+    const std::uint8_t* base = data.data();
+    if (available < PACK_HEADER_SIZE || std::memcmp(base, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 ||
+        read_le32(base + 8) != PACK_VERSION) {
+        return nullptr;
+    }
+
+    // Section [offset, offset + size) lies after the header and inside the file
+    const auto fits = [&](std::uint64_t offset, std::uint64_t size) {
+        return offset >= PACK_HEADER_SIZE && offset <= available && size <= available - offset;
+    };
+    const std::uint32_t count = read_le32(base + 12);
+    const std::uint64_t index_offset = read_le64(base + 16);
+    const std::uint64_t names_offset = read_le64(base + 24);
+    const std::uint64_t names_size = read_le64(base + 32);
+    if (!fits(index_offset, std::uint64_t{count} * PACK_ENTRY_SIZE) || !fits(names_offset, names_size) ||
+        read_le64(base + 40) > available) {
+        return nullptr;
+    }
+    const std::string_view names(reinterpret_cast<const char*>(base + names_offset),
+                                 static_cast<std::size_t>(names_size));
+
+    std::shared_ptr<asset_pack> pack(new asset_pack());
+    pack->entries_.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const std::uint8_t* p = base + index_offset + std::uint64_t{i} * PACK_ENTRY_SIZE;
+        const std::uint32_t name_offset = read_le32(p + 0);
+        const std::uint32_t name_size = read_le32(p + 4);
+        raw_container::stored_image s;
+        s.format = read_le32(p + 8);
+        s.width = read_le32(p + 12);
+        s.height = read_le32(p + 16);
+        s.palette_entries = read_le32(p + 20);
+        s.subrect_count = read_le32(p + 24);
+        s.pitch = read_le64(p + 32);
+        s.pixel_offset = read_le64(p + 40);
+        s.palette_offset = read_le64(p + 48);
+        s.subrect_offset = read_le64(p + 56);
+
+        const auto l = raw_container::check_image(s, available, PACK_HEADER_SIZE);
+        if (!l || name_offset > names.size() || name_size > names.size() - name_offset) {
+            return nullptr;
+        }
+
+        entry e;
+        e.name = names.substr(name_offset, name_size);
+        if (!pack->entries_.empty() && !(pack->entries_.back().name < e.name)) {
+            return nullptr;  // Names must be sorted and unique for find()
+        }
+        e.pixels = base + l->pixel_offset;
+        e.palette = data.subspan(static_cast<std::size_t>(l->palette_offset),
+                                 static_cast<std::size_t>(l->palette_entries) * 3);
+        e.subrects.reserve(static_cast<std::size_t>(l->subrect_count));
+        for (int r = 0; r < l->subrect_count; ++r) {
+            e.subrects.push_back(raw_container::decode_subrect(
+                base + l->subrect_offset + static_cast<std::uint64_t>(r) * raw_container::SUBRECT_SIZE));
+        }
+        e.width = l->width;
+        e.height = l->height;
+        e.pitch = static_cast<std::size_t>(l->pitch);
+        e.format = l->format;
+        pack->entries_.push_back(std::move(e));
+    }
+    pack->mapping_ = std::move(mapping);
+    return pack;
+}
+
+std::string_view asset_pack::name(std::size_t index) const noexcept {
+    return index < entries_.size() ? entries_[index].name : std::string_view();
+}
+
+std::optional<std::size_t> asset_pack::find(std::string_view name) const noexcept {
+    const auto it = std::ranges::lower_bound(entries_, name, {}, &entry::name);
+    if (it == entries_.end() || it->name != name) {
+        return std::nullopt;
+    }
+    return static_cast<std::size_t>(it - entries_.begin());
+}
+
+shared_surface asset_pack::image(std::size_t index) const {
+    if (index >= entries_.size()) {
+        return {};
+    }
+    const auto& e = entries_[index];
+    return shared_surface(shared_from_this(), e.width, e.height, e.format, e.pitch, e.pixels, e.palette, e.subrects);
+}
+
+shared_surface asset_pack::image(std::string_view name) const {
+    const auto index = find(name);
+    return index ? image(*index) : shared_surface();
+}
+
+} // namespace onyx_image
@@ -0,0 +1,88 @@
+#include "atomic_file.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <system_error>
+
+namespace onyx_image {
+
+std::filesystem::path temporary_path(const std::filesystem::path& path) {
+    static std::atomic<std::uint64_t> counter{0};
+    const auto now = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    const std::uint64_t unique = now * 0x9E3779B97F4A7C15ull ^
+                                 reinterpret_cast<std::uintptr_t>(&counter) ^
+                                 counter.fetch_add(1, std::memory_order_relaxed);
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%016llx.tmp", static_cast<unsigned long long>(unique));
+    std::filesystem::path tmp = path;
+    tmp += suffix;
+    return tmp;
+}
+
+std::FILE* open_file(const std::filesystem::path& path, const char* mode) {
+#ifdef _WIN32
+    wchar_t wide_mode[8] = {};
+    for (std::size_t i = 0; i + 1 < std::size(wide_mode) && mode[i]; ++i) {
+        wide_mode[i] = static_cast<wchar_t>(mode[i]);
+    }
+    return _wfopen(path.c_str(), wide_mode);
+#else
+    return std::fopen(path.c_str(), mode);
+#endif
+}
+
+atomic_file::atomic_file(std::filesystem::path path)
+    : path_(std::move(path)),
+      temp_(temporary_path(path_)),
+      file_(open_file(temp_, "wb")) {}
+
+atomic_file::~atomic_file() {
+    if (file_) {
+        std::fclose(file_);
+        std::error_code ec;
+        std::filesystem::remove(temp_, ec);
+    }
+}
+
+bool atomic_file::write(const void* data, std::size_t size) noexcept {
+    if (!file_ || !ok_) {
+        return false;
+    }
+    ok_ = size == 0 || std::fwrite(data, 1, size, file_) == size;
+    return ok_;
+}
+
+bool atomic_file::write_zeros(std::size_t size) noexcept {
+    static constexpr std::uint8_t zeros[256] = {};
+    while (size > 0) {
+        const std::size_t n = std::min(size, sizeof(zeros));
+        if (!write(zeros, n)) {
+            return false;
+        }
+        size -= n;
+    }
+    return true;
+}
+
+bool atomic_file::commit() {
+    if (!file_) {
+        return false;
+    }
+    const bool closed = std::fclose(file_) == 0;
+    file_ = nullptr;
+
+    std::error_code ec;
+    if (ok_ && closed) {
+        std::filesystem::rename(temp_, path_, ec);
+        if (!ec) {
+            return true;
+        }
+    }
+    std::filesystem::remove(temp_, ec);
+    return false;
+}
+
+} // namespace onyx_image
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+
+namespace onyx_image {
+
+// Name for a temporary file next to path, unique across threads and
+// (with overwhelming probability) processes
+[[nodiscard]] std::filesystem::path temporary_path(const std::filesystem::path& path);
+
+// fopen() that takes the native path (wide on Windows)
+[[nodiscard]] std::FILE* open_file(const std::filesystem::path& path, const char* mode);
+
+// File written under a temporary name and renamed to its destination by
+// commit(), so readers see either the previous file or the complete new
+// one. Without a successful commit() the temporary file is removed.
+class atomic_file {
+public:
+    explicit atomic_file(std::filesystem::path path);
+    ~atomic_file();
+
+    atomic_file(const atomic_file&) = delete;
+    atomic_file& operator=(const atomic_file&) = delete;
+
+    [[nodiscard]] bool is_open() const noexcept { return file_ != nullptr; }
+
+    // Append bytes; failures are remembered and reported by commit()
+    bool write(const void* data, std::size_t size) noexcept;
+    bool write_zeros(std::size_t size) noexcept;
+
+    [[nodiscard]] bool commit();
+
+private:
+    std::filesystem::path path_;
+    std::filesystem::path temp_;
+    std::FILE* file_ = nullptr;
+    bool ok_ = true;
+};
+
+} // namespace onyx_image
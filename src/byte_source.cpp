@@ -0,0 +1,126 @@
+#include <onyx_image/byte_source.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace onyx_image {
+
+// ============================================================================
+// Byte Source
+// ============================================================================
+
+std::size_t byte_source::skip(std::size_t count) {
+    std::uint8_t buffer[4096];
+    std::size_t skipped = 0;
+    while (skipped < count) {
+        const std::size_t n = read(buffer, std::min(sizeof(buffer), count - skipped));
+        if (n == 0) {
+            break;
+        }
+        skipped += n;
+    }
+    return skipped;
+}
+
+std::vector<std::uint8_t> read_all(byte_source& src) {
+    std::vector<std::uint8_t> data;
+    std::size_t chunk = 64 * 1024;
+    for (;;) {
+        const std::size_t old_size = data.size();
+        data.resize(old_size + chunk);
+        const std::size_t n = src.read(data.data() + old_size, chunk);
+        data.resize(old_size + n);
+        if (n == 0) {
+            break;
+        }
+        // Grow geometrically so large inputs take few reads; a short read
+        // is not the end, so keep the chunk until one fills it
+        if (n == chunk) {
+            chunk = std::min<std::size_t>(chunk * 2, 16 * 1024 * 1024);
+        }
+    }
+    return data;
+}
+
+// ============================================================================
+// Memory Source
+// ============================================================================
+
+std::size_t memory_source::read(std::uint8_t* dst, std::size_t size) {
+    const std::size_t n = std::min(size, data_.size() - pos_);
+    if (n > 0) {
+        std::memcpy(dst, data_.data() + pos_, n);
+    }
+    pos_ += n;
+    return n;
+}
+
+std::size_t memory_source::skip(std::size_t count) {
+    const std::size_t n = std::min(count, data_.size() - pos_);
+    pos_ += n;
+    return n;
+}
+
+// ============================================================================
+// File Source
+// ============================================================================
+
+file_source::file_source(const std::filesystem::path& path) {
+#ifdef _WIN32
+    file_ = _wfopen(path.c_str(), L"rb");
+#else
+    file_ = std::fopen(path.c_str(), "rb");
+#endif
+}
+
+file_source::~file_source() {
+    if (file_ && owned_) {
+        std::fclose(file_);
+    }
+}
+
+std::size_t file_source::read(std::uint8_t* dst, std::size_t size) {
+    if (!file_) {
+        return 0;
+    }
+    return std::fread(dst, 1, size, file_);
+}
+
+std::size_t file_source::skip(std::size_t count) {
+    if (!file_) {
+        return 0;
+    }
+
+    // Seek where the stream supports it and the target is inside the file;
+    // pipes fall back to reading
+    const long start = std::ftell(file_);
+    if (start >= 0 && count <= static_cast<std::size_t>(std::numeric_limits<long>::max() - start) &&
+        std::fseek(file_, 0, SEEK_END) == 0) {
+        const long end = std::ftell(file_);
+        const long target = std::min(end, start + static_cast<long>(count));
+        if (end >= 0 && std::fseek(file_, target, SEEK_SET) == 0) {
+            return static_cast<std::size_t>(target - start);
+        }
+        std::fseek(file_, start, SEEK_SET);
+    }
+    return byte_source::skip(count);
+}
+
+bool file_source::at_end() const {
+    if (!file_) {
+        return true;
+    }
+    if (std::feof(file_) || std::ferror(file_)) {
+        return true;
+    }
+    // feof is only set by a read past the end; look one byte ahead
+    const int c = std::fgetc(file_);
+    if (c == EOF) {
+        return true;
+    }
+    std::ungetc(c, file_);
+    return false;
+}
+
+} // namespace onyx_image
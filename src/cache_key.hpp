@@ -0,0 +1,55 @@
+#pragma once
+
+#include <onyx_image/types.hpp>
+#include "codecs/content_hash.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+namespace onyx_image {
+
+// Identity of a decode for the caches: the input bytes plus everything
+// else that can change the decoded image
+struct decode_key {
+    hash128 content;
+    std::uint64_t size = 0;
+    std::uint64_t options = 0;  // options_key()
+
+    friend bool operator==(const decode_key&, const decode_key&) = default;
+};
+
+// Every field of decode_options that can change the decoded image, and
+// the codec name (empty when the format is auto-detected)
+inline std::uint64_t options_key(const decode_options& options, std::string_view codec_name) noexcept {
+    const std::int32_t fields[] = {
+        options.max_width,
+        options.max_height,
+        options.enable_packing ? 1 : 0,
+        options.padding,
+        options.pack_max_width,
+        options.pack_max_height,
+        options.power_of_two ? 1 : 0,
+        options.icon_size,
+        options.icon_bit_depth,
+        options.packed_indexed ? 1 : 0,
+        options.scale_denom,
+        options.dedup_frames ? 1 : 0,
+    };
+    std::uint8_t buffer[sizeof(fields) + 64] = {};
+    std::memcpy(buffer, fields, sizeof(fields));
+    const std::size_t name_size = std::min(codec_name.size(), sizeof(buffer) - sizeof(fields));
+    std::memcpy(buffer + sizeof(fields), codec_name.data(), name_size);
+    return content_hash(buffer, sizeof(fields) + name_size).lo;
+}
+
+inline decode_key make_decode_key(std::span<const std::uint8_t> data,
+                                  const decode_options& options,
+                                  std::string_view codec_name) noexcept {
+    return {content_hash(data.data(), data.size()), static_cast<std::uint64_t>(data.size()),
+            options_key(options, codec_name)};
+}
+
+} // namespace onyx_image
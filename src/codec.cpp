@@ -1,4 +1,5 @@
 #include <onyx_image/codec.hpp>
+#include <onyx_image/decode_cache.hpp>
 #include <onyx_image/codecs/pcx.hpp>
 #include <onyx_image/codecs/png.hpp>
 #include <onyx_image/codecs/lbm.hpp>
@@ -28,6 +29,17 @@
 
 namespace onyx_image {
 
+// ============================================================================
+// Decoder Interface
+// ============================================================================
+
+decode_result decoder::decode_stream(byte_source& src,
+                                     surface& surf,
+                                     const decode_options& options) const {
+    const auto data = read_all(src);
+    return decode(data, surf, options);
+}
+
 // ============================================================================
 // Decoder Wrappers
 // ============================================================================
@@ -116,6 +128,12 @@ public:
                                         const decode_options& options) const override {
         return jpeg_decoder::decode(data, surf, options);
     }
+
+    [[nodiscard]] decode_result decode_stream(byte_source& src,
+                                               surface& surf,
+                                               const decode_options& options) const override {
+        return jpeg_decoder::decode(src, surf, options);
+    }
 };
 
 class tga_decoder_impl : public decoder {
@@ -137,6 +155,12 @@ public:
                                         const decode_options& options) const override {
         return tga_decoder::decode(data, surf, options);
     }
+
+    [[nodiscard]] decode_result decode_stream(byte_source& src,
+                                               surface& surf,
+                                               const decode_options& options) const override {
+        return tga_decoder::decode(src, surf, options);
+    }
 };
 
 class gif_decoder_impl : public decoder {
@@ -158,6 +182,12 @@ public:
                                         const decode_options& options) const override {
         return gif_decoder::decode(data, surf, options);
     }
+
+    [[nodiscard]] decode_result decode_stream(byte_source& src,
+                                               surface& surf,
+                                               const decode_options& options) const override {
+        return gif_decoder::decode(src, surf, options);
+    }
 };
 
 class bmp_decoder_impl : public decoder {
@@ -764,26 +794,69 @@ const decoder* codec_registry::find_decoder(std::string_view name) const {
 // Convenience Functions
 // ============================================================================
 
+namespace {
+
+// A decode is only as good as what the surface kept
+decode_result check_surface(decode_result result, const surface& surf) {
+    if (result.ok && surf.failed()) {
+        return decode_result::failure(decode_error::internal_error, "Failed to store decoded pixels");
+    }
+    return result;
+}
+
+} // namespace
+
 decode_result decode(std::span<const std::uint8_t> data,
                      surface& surf,
                      const decode_options& options) {
+    if (options.cache && !surf.discards_pixels()) {
+        return check_surface(options.cache->decode(data, surf, {}, options), surf);
+    }
     const auto* dec = codec_registry::instance().find_decoder(data);
     if (!dec) {
         return decode_result::failure(decode_error::invalid_format, "Unknown image format");
     }
-    return dec->decode(data, surf, options);
+    return check_surface(dec->decode(data, surf, options), surf);
 }
 
 decode_result decode(std::span<const std::uint8_t> data,
                      surface& surf,
                      std::string_view codec_name,
                      const decode_options& options) {
+    if (options.cache && !surf.discards_pixels()) {
+        return check_surface(options.cache->decode(data, surf, codec_name, options), surf);
+    }
+    const auto* dec = codec_registry::instance().find_decoder(codec_name);
+    if (!dec) {
+        return decode_result::failure(decode_error::invalid_format,
+            std::string("Unknown codec: ") + std::string(codec_name));
+    }
+    return check_surface(dec->decode(data, surf, options), surf);
+}
+
+decode_result decode(byte_source& src,
+                     surface& surf,
+                     std::string_view codec_name,
+                     const decode_options& options) {
     const auto* dec = codec_registry::instance().find_decoder(codec_name);
     if (!dec) {
         return decode_result::failure(decode_error::invalid_format,
             std::string("Unknown codec: ") + std::string(codec_name));
     }
-    return dec->decode(data, surf, options);
+    return check_surface(dec->decode_stream(src, surf, options), surf);
+}
+
+decode_result verify(std::span<const std::uint8_t> data,
+                     const decode_options& options) {
+    null_surface surf;
+    return decode(data, surf, options);
+}
+
+decode_result verify(std::span<const std::uint8_t> data,
+                     std::string_view codec_name,
+                     const decode_options& options) {
+    null_surface surf;
+    return decode(data, surf, codec_name, options);
 }
 
 } // namespace onyx_image
@@ -1,6 +1,7 @@
 #include <onyx_image/codecs/bmp.hpp>
-#include <formats/bmp/bmp.hh>
 #include "decode_helpers.hpp"
+#include "header_views.hpp"
+#include "pixel_convert.hpp"
 
 #include <algorithm>
 #include <cstring>
@@ -72,27 +73,26 @@ bool parse_header(std::span<const std::uint8_t> data, bmp_info& info) {
         return false;
     }
 
-    const std::uint8_t* ptr = data.data();
-    const std::uint8_t* end = data.data() + data.size();
-
     // Parse file header
-    auto file_header = formats::bmp::bmp_file_header::read(ptr, end);
-    info.data_offset = file_header.data_offset;
-
-    // Parse info header - first read size to determine type
-    const std::uint8_t* info_start = ptr;
-    std::uint32_t header_size = formats::bmp::read_uint32(ptr, end);
-    ptr = info_start;  // Reset to read full header
+    auto file_header = bmp_file_header_view::from(data);
+    if (!file_header) {
+        return false;
+    }
+    info.data_offset = file_header->data_offset();
 
-    info.header_size = header_size;
+    // Parse info header (its size field selects the version)
+    auto header = bmp_info_header_view::from(data.subspan(bmp_file_header_view::SIZE));
+    if (!header) {
+        return false;
+    }
+    info.header_size = header->header_size();
+    info.width = header->width();
+    info.bits_per_pixel = header->bits_per_pixel();
 
-    if (header_size == 12) {
+    if (header->is_core()) {
         // OS/2 1.x BITMAPCOREHEADER
-        auto header = formats::bmp::bmp_core_header::read(ptr, end);
-        info.width = header.width;
-        info.height = header.height < 0 ? -header.height : header.height;
-        info.top_down = header.height < 0;
-        info.bits_per_pixel = header.bits_per_pixel;
+        info.height = header->height() < 0 ? -header->height() : header->height();
+        info.top_down = header->height() < 0;
         info.compression = BI_RGB;
         info.palette_entry_size = 3;
 
@@ -109,15 +109,12 @@ bool parse_header(std::span<const std::uint8_t> data, bmp_info& info) {
                 info.colors_used = max_colors;
             }
         }
-    } else if (header_size == 64) {
+    } else if (header->is_os2_v2()) {
         // OS/2 2.x header
-        auto header = formats::bmp::bmp_os2_v2_header::read(ptr, end);
-        info.width = static_cast<int>(header.width);
-        info.height = static_cast<int>(header.height);
+        info.height = header->height();
         info.top_down = false;  // OS/2 2.x is always bottom-up
-        info.bits_per_pixel = header.bits_per_pixel;
-        info.compression = header.compression;
-        info.colors_used = header.colors_used;
+        info.compression = header->compression();
+        info.colors_used = header->colors_used();
 
         if (info.colors_used == 0 && info.bits_per_pixel <= 8) {
             info.colors_used = 1u << info.bits_per_pixel;
@@ -134,59 +131,25 @@ bool parse_header(std::span<const std::uint8_t> data, bmp_info& info) {
         } else {
             info.palette_entry_size = 4;
         }
-    } else if (header_size >= 40) {
+    } else {
         // Windows BITMAPINFOHEADER or later
-        if (header_size >= 108) {
-            auto header = formats::bmp::bmp_v4_header::read(ptr, end);
-            info.width = header.width;
-            info.height = header.height < 0 ? -header.height : header.height;
-            info.top_down = header.height < 0;
-            info.bits_per_pixel = header.bits_per_pixel;
-            info.compression = header.compression;
-            info.colors_used = header.colors_used;
-            info.red_mask = header.red_mask;
-            info.green_mask = header.green_mask;
-            info.blue_mask = header.blue_mask;
-            info.alpha_mask = header.alpha_mask;
-        } else if (header_size >= 56) {
-            auto header = formats::bmp::bmp_v3_header::read(ptr, end);
-            info.width = header.width;
-            info.height = header.height < 0 ? -header.height : header.height;
-            info.top_down = header.height < 0;
-            info.bits_per_pixel = header.bits_per_pixel;
-            info.compression = header.compression;
-            info.colors_used = header.colors_used;
-            info.red_mask = header.red_mask;
-            info.green_mask = header.green_mask;
-            info.blue_mask = header.blue_mask;
-            info.alpha_mask = header.alpha_mask;
-        } else if (header_size >= 52) {
-            auto header = formats::bmp::bmp_v2_header::read(ptr, end);
-            info.width = header.width;
-            info.height = header.height < 0 ? -header.height : header.height;
-            info.top_down = header.height < 0;
-            info.bits_per_pixel = header.bits_per_pixel;
-            info.compression = header.compression;
-            info.colors_used = header.colors_used;
-            info.red_mask = header.red_mask;
-            info.green_mask = header.green_mask;
-            info.blue_mask = header.blue_mask;
-        } else {
-            auto header = formats::bmp::bmp_info_header::read(ptr, end);
-            info.width = header.width;
-            info.height = header.height < 0 ? -header.height : header.height;
-            info.top_down = header.height < 0;
-            info.bits_per_pixel = header.bits_per_pixel;
-            info.compression = header.compression;
-            info.colors_used = header.colors_used;
+        info.height = header->height() < 0 ? -header->height() : header->height();
+        info.top_down = header->height() < 0;
+        info.compression = header->compression();
+        info.colors_used = header->colors_used();
+        if (header->has_masks()) {
+            info.red_mask = header->red_mask();
+            info.green_mask = header->green_mask();
+            info.blue_mask = header->blue_mask();
+        }
+        if (header->has_alpha_mask()) {
+            info.alpha_mask = header->alpha_mask();
         }
         info.palette_entry_size = 4;
 
         if (info.colors_used == 0 && info.bits_per_pixel <= 8) {
             info.colors_used = 1u << info.bits_per_pixel;
         }
-    } else {
-        return false;
     }
 
     // Handle bitfields
@@ -194,10 +157,11 @@ bool parse_header(std::span<const std::uint8_t> data, bmp_info& info) {
         // Masks might be in header or after it
         if (info.red_mask == 0 && info.green_mask == 0 && info.blue_mask == 0) {
             // Read masks from after header
-            if (ptr + 12 <= end) {
-                info.red_mask = formats::bmp::read_uint32(ptr, end);
-                info.green_mask = formats::bmp::read_uint32(ptr, end);
-                info.blue_mask = formats::bmp::read_uint32(ptr, end);
+            const std::size_t mask_offset = bmp_file_header_view::SIZE + header->stored_size();
+            if (mask_offset + 12 <= data.size()) {
+                info.red_mask = read_le32(data.data() + mask_offset);
+                info.green_mask = read_le32(data.data() + mask_offset + 4);
+                info.blue_mask = read_le32(data.data() + mask_offset + 8);
             }
         }
 
@@ -224,25 +188,72 @@ bool parse_header(std::span<const std::uint8_t> data, bmp_info& info) {
     return true;
 }
 
+// 16-bit layouts with a dedicated row converter
+enum class rgb16_layout {
+    x1r5g5b5,
+    r5g6b5,
+    other
+};
+
+rgb16_layout classify_rgb16(const bmp_info& info) {
+    if (info.red_mask == 0x7C00 && info.green_mask == 0x03E0 && info.blue_mask == 0x001F) {
+        return rgb16_layout::x1r5g5b5;
+    }
+    if (info.red_mask == 0xF800 && info.green_mask == 0x07E0 && info.blue_mask == 0x001F) {
+        return rgb16_layout::r5g6b5;
+    }
+    return rgb16_layout::other;
+}
+
+// Receives RLE output one row at a time. RLE bitmaps are stored bottom-up,
+// so stream row y lands on surface row (height - 1 - y). Rows skipped by
+// delta codes or left out at the end are written as index 0.
+class rle_row_sink {
+public:
+    rle_row_sink(surface& surf, int width, int height)
+        : surf_(surf), row_(static_cast<std::size_t>(width), 0), height_(height) {}
+
+    [[nodiscard]] std::uint8_t* row() noexcept { return row_.data(); }
+    [[nodiscard]] int y() const noexcept { return y_; }
+
+    // Emit the current row and move down by `rows`
+    void advance(int rows) {
+        for (int i = 0; i < rows && y_ < height_; ++i) {
+            surf_.write_pixels(0, height_ - 1 - y_, static_cast<int>(row_.size()), row_.data());
+            if (i == 0) {
+                std::fill(row_.begin(), row_.end(), std::uint8_t{0});
+            }
+            ++y_;
+        }
+    }
+
+    // Emit the current row and blank all remaining rows
+    void finish() { advance(height_ - y_); }
+
+private:
+    surface& surf_;
+    std::vector<std::uint8_t> row_;
+    int height_;
+    int y_ = 0;
+};
+
 void decode_rle8(const std::uint8_t* src, std::size_t src_size,
-                 std::vector<std::uint8_t>& indices,
-                 int width, int height) {
-    indices.resize(static_cast<std::size_t>(width) * height, 0);
+                 rle_row_sink& sink, int width, int height) {
     const std::uint8_t* end = src + src_size;
 
     int x = 0;
-    int y = 0;
 
-    while (src + 1 < end && y < height) {
+    while (src + 1 < end && sink.y() < height) {
         std::uint8_t count = *src++;
         std::uint8_t value = *src++;
+        std::uint8_t* row = sink.row();
 
         if (count == 0) {
             // Escape code
             if (value == 0) {
                 // End of line
                 x = 0;
-                y++;
+                sink.advance(1);
             } else if (value == 1) {
                 // End of bitmap
                 break;
@@ -250,51 +261,50 @@ void decode_rle8(const std::uint8_t* src, std::size_t src_size,
                 // Delta
                 if (src + 1 < end) {
                     x += *src++;
-                    y += *src++;
+                    sink.advance(*src++);
                 }
             } else {
                 // Absolute mode
-                for (int i = 0; i < value && src < end && y < height; i++) {
-                    if (x < width) {
-                        indices[static_cast<std::size_t>(y) * width + x] = *src;
-                        x++;
-                    }
-                    src++;
+                const std::size_t avail = static_cast<std::size_t>(end - src);
+                const int n = static_cast<int>(std::min<std::size_t>(value, avail));
+                if (x < width) {
+                    std::memcpy(row + x, src, static_cast<std::size_t>(std::min(n, width - x)));
                 }
+                x = std::min(x + n, width);
+                src += n;
                 // Pad to word boundary
                 if (value & 1) src++;
             }
         } else {
             // Run of pixels
-            for (int i = 0; i < count && y < height; i++) {
-                if (x < width) {
-                    indices[static_cast<std::size_t>(y) * width + x] = value;
-                    x++;
-                }
+            if (x < width) {
+                const int n = std::min<int>(count, width - x);
+                std::memset(row + x, value, static_cast<std::size_t>(n));
+                x += n;
             }
         }
     }
+
+    sink.finish();
 }
 
 void decode_rle4(const std::uint8_t* src, std::size_t src_size,
-                 std::vector<std::uint8_t>& indices,
-                 int width, int height) {
-    indices.resize(static_cast<std::size_t>(width) * height, 0);
+                 rle_row_sink& sink, int width, int height) {
     const std::uint8_t* end = src + src_size;
 
     int x = 0;
-    int y = 0;
 
-    while (src + 1 < end && y < height) {
+    while (src + 1 < end && sink.y() < height) {
         std::uint8_t count = *src++;
         std::uint8_t value = *src++;
+        std::uint8_t* row = sink.row();
 
         if (count == 0) {
             // Escape code
             if (value == 0) {
                 // End of line
                 x = 0;
-                y++;
+                sink.advance(1);
             } else if (value == 1) {
                 // End of bitmap
                 break;
@@ -302,15 +312,12 @@ void decode_rle4(const std::uint8_t* src, std::size_t src_size,
                 // Delta
                 if (src + 1 < end) {
                     x += *src++;
-                    y += *src++;
+                    sink.advance(*src++);
                 }
             } else {
                 // Absolute mode
-                int pixels_read = 0;
-                for (int i = 0; i < value && y < height; i++) {
-                    if (pixels_read % 2 == 0) {
-                        if (src >= end) break;
-                    }
+                for (int i = 0; i < value; i++) {
+                    if (i % 2 == 0 && src >= end) break;
                     std::uint8_t nibble;
                     if (i % 2 == 0) {
                         nibble = (*src >> 4) & 0x0F;
@@ -319,10 +326,8 @@ void decode_rle4(const std::uint8_t* src, std::size_t src_size,
                         src++;
                     }
                     if (x < width) {
-                        indices[static_cast<std::size_t>(y) * width + x] = nibble;
-                        x++;
+                        row[x++] = nibble;
                     }
-                    pixels_read++;
                 }
                 if (value % 2 == 1) src++;
                 // Pad to word boundary
@@ -333,14 +338,13 @@ void decode_rle4(const std::uint8_t* src, std::size_t src_size,
             // Run of pixels (alternating nibbles)
             std::uint8_t hi = (value >> 4) & 0x0F;
             std::uint8_t lo = value & 0x0F;
-            for (int i = 0; i < count && y < height; i++) {
-                if (x < width) {
-                    indices[static_cast<std::size_t>(y) * width + x] = (i % 2 == 0) ? hi : lo;
-                    x++;
-                }
+            for (int i = 0; i < count && x < width; i++) {
+                row[x++] = (i % 2 == 0) ? hi : lo;
             }
         }
     }
+
+    sink.finish();
 }
 
 } // namespace
@@ -360,12 +364,8 @@ decode_result bmp_decoder::decode(std::span<const std::uint8_t> data,
     }
 
     bmp_info info;
-    try {
-        if (!parse_header(data, info)) {
-            return decode_result::failure(decode_error::invalid_format, "Failed to parse BMP header");
-        }
-    } catch (const std::exception& e) {
-        return decode_result::failure(decode_error::invalid_format, e.what());
+    if (!parse_header(data, info)) {
+        return decode_result::failure(decode_error::invalid_format, "Failed to parse BMP header");
     }
 
     if (info.width <= 0 || info.height <= 0) {
@@ -407,9 +407,11 @@ decode_result bmp_decoder::decode(std::span<const std::uint8_t> data,
     }
 
     // Determine output format
+    const bool is_rle = info.compression == BI_RLE8 || info.compression == BI_RLE4;
     pixel_format out_format;
     if (info.bits_per_pixel <= 8 && !palette.empty()) {
-        out_format = pixel_format::indexed8;
+        // Uncompressed 1/2/4-bit rows can be kept packed
+        out_format = is_rle ? pixel_format::indexed8 : indexed_format_for(info.bits_per_pixel, options);
     } else {
         out_format = pixel_format::rgba8888;
     }
@@ -419,31 +421,35 @@ decode_result bmp_decoder::decode(std::span<const std::uint8_t> data,
     }
 
     // Set palette if indexed
-    if (out_format == pixel_format::indexed8 && !palette.empty()) {
+    if (is_indexed(out_format) && !palette.empty()) {
         surf.set_palette_size(static_cast<int>(info.colors_used));
         surf.write_palette(0, palette);
     }
 
     // Handle RLE compression
-    if (info.compression == BI_RLE8 || info.compression == BI_RLE4) {
-        std::vector<std::uint8_t> indices;
+    if (is_rle) {
+        rle_row_sink sink(surf, info.width, info.height);
         if (info.compression == BI_RLE8) {
-            decode_rle8(pixel_data, pixel_data_size, indices, info.width, info.height);
+            decode_rle8(pixel_data, pixel_data_size, sink, info.width, info.height);
         } else {
-            decode_rle4(pixel_data, pixel_data_size, indices, info.width, info.height);
-        }
-
-        // Write to surface (RLE is always bottom-up, need to flip)
-        for (int y = 0; y < info.height; y++) {
-            int src_y = info.height - 1 - y;
-            surf.write_pixels(0, y, info.width, indices.data() + static_cast<std::size_t>(src_y) * info.width);
+            decode_rle4(pixel_data, pixel_data_size, sink, info.width, info.height);
         }
         return decode_result::success();
     }
 
     // Uncompressed data
     const std::size_t src_row_size = row_stride_4byte(info.width, info.bits_per_pixel);
+
+    if (surf.discards_pixels()) {
+        // Verification: every row must be present, nothing to convert
+        if (src_row_size * static_cast<std::size_t>(info.height) > pixel_data_size) {
+            return decode_result::failure(decode_error::truncated_data, "Unexpected end of data");
+        }
+        return decode_result::success();
+    }
+
     std::vector<std::uint8_t> row_buffer(static_cast<std::size_t>(info.width) * 4);
+    const rgb16_layout layout16 = classify_rgb16(info);
 
     for (int y = 0; y < info.height; y++) {
         int src_y = info.top_down ? y : (info.height - 1 - y);
@@ -453,44 +459,56 @@ decode_result bmp_decoder::decode(std::span<const std::uint8_t> data,
             return decode_result::failure(decode_error::truncated_data, "Unexpected end of data");
         }
 
-        if (info.bits_per_pixel <= 8) {
+        if (info.bits_per_pixel == 8) {
+            // Indexed mode, stored one byte per pixel already
+            surf.write_pixels(0, y, info.width, src_row);
+            continue;
+        }
+
+        if (bytes_per_pixel(out_format) == 0) {
+            // Packed indexed mode, rows copied as stored
+            write_packed_row(surf, y, src_row, info.width, out_format);
+            continue;
+        }
+
+        if (info.bits_per_pixel < 8) {
             // Indexed mode
             for (int x = 0; x < info.width; x++) {
                 row_buffer[x] = extract_pixel(src_row, x, info.bits_per_pixel);
             }
             surf.write_pixels(0, y, info.width, row_buffer.data());
-        } else if (info.bits_per_pixel == 16) {
-            // 16-bit RGB
-            for (int x = 0; x < info.width; x++) {
-                std::uint16_t pixel = src_row[x * 2] | (src_row[x * 2 + 1] << 8);
-                std::uint8_t r = static_cast<std::uint8_t>(((pixel & info.red_mask) >> info.red_shift) << info.red_scale);
-                std::uint8_t g = static_cast<std::uint8_t>(((pixel & info.green_mask) >> info.green_shift) << info.green_scale);
-                std::uint8_t b = static_cast<std::uint8_t>(((pixel & info.blue_mask) >> info.blue_shift) << info.blue_scale);
-                row_buffer[x * 4 + 0] = r;
-                row_buffer[x * 4 + 1] = g;
-                row_buffer[x * 4 + 2] = b;
-                row_buffer[x * 4 + 3] = 0xFF;
-            }
-            surf.write_pixels(0, y, info.width * 4, row_buffer.data());
-        } else if (info.bits_per_pixel == 24) {
-            // 24-bit BGR
-            for (int x = 0; x < info.width; x++) {
-                row_buffer[x * 4 + 0] = src_row[x * 3 + 2];  // R
-                row_buffer[x * 4 + 1] = src_row[x * 3 + 1];  // G
-                row_buffer[x * 4 + 2] = src_row[x * 3 + 0];  // B
-                row_buffer[x * 4 + 3] = 0xFF;
-            }
-            surf.write_pixels(0, y, info.width * 4, row_buffer.data());
-        } else if (info.bits_per_pixel == 32) {
-            // 32-bit BGRA
-            for (int x = 0; x < info.width; x++) {
-                row_buffer[x * 4 + 0] = src_row[x * 4 + 2];  // R
-                row_buffer[x * 4 + 1] = src_row[x * 4 + 1];  // G
-                row_buffer[x * 4 + 2] = src_row[x * 4 + 0];  // B
-                row_buffer[x * 4 + 3] = info.alpha_mask ? src_row[x * 4 + 3] : 0xFF;
-            }
-            surf.write_pixels(0, y, info.width * 4, row_buffer.data());
+            continue;
+        }
+
+        switch (info.bits_per_pixel) {
+            case 16:
+                if (layout16 == rgb16_layout::x1r5g5b5) {
+                    rgb555_to_rgba_row(src_row, row_buffer.data(), info.width);
+                } else if (layout16 == rgb16_layout::r5g6b5) {
+                    rgb565_to_rgba_row(src_row, row_buffer.data(), info.width);
+                } else {
+                    // Arbitrary bitfields
+                    for (int x = 0; x < info.width; x++) {
+                        std::uint16_t pixel = src_row[x * 2] | (src_row[x * 2 + 1] << 8);
+                        row_buffer[x * 4 + 0] = static_cast<std::uint8_t>(((pixel & info.red_mask) >> info.red_shift) << info.red_scale);
+                        row_buffer[x * 4 + 1] = static_cast<std::uint8_t>(((pixel & info.green_mask) >> info.green_shift) << info.green_scale);
+                        row_buffer[x * 4 + 2] = static_cast<std::uint8_t>(((pixel & info.blue_mask) >> info.blue_shift) << info.blue_scale);
+                        row_buffer[x * 4 + 3] = 0xFF;
+                    }
+                }
+                break;
+            case 24:
+                // 24-bit BGR
+                bgr_to_rgba_row(src_row, row_buffer.data(), info.width);
+                break;
+            case 32:
+                // 32-bit BGRX, or BGRA (ARGB8888) when an alpha mask is present
+                bgra_to_rgba_row(src_row, row_buffer.data(), info.width, info.alpha_mask != 0);
+                break;
+            default:
+                continue;
         }
+        surf.write_pixels(0, y, info.width * 4, row_buffer.data());
     }
 
     return decode_result::success();
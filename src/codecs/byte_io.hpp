@@ -5,29 +5,47 @@
 namespace onyx_image {
 
 // Little-endian readers
-inline std::uint16_t read_le16(const std::uint8_t* p) {
+constexpr std::uint16_t read_le16(const std::uint8_t* p) {
     return static_cast<std::uint16_t>(p[0]) |
            (static_cast<std::uint16_t>(p[1]) << 8);
 }
 
-inline std::uint32_t read_le32(const std::uint8_t* p) {
+constexpr std::uint32_t read_le32(const std::uint8_t* p) {
     return static_cast<std::uint32_t>(p[0]) |
            (static_cast<std::uint32_t>(p[1]) << 8) |
            (static_cast<std::uint32_t>(p[2]) << 16) |
            (static_cast<std::uint32_t>(p[3]) << 24);
 }
 
-inline std::int32_t read_le32_signed(const std::uint8_t* p) {
+constexpr std::int32_t read_le32_signed(const std::uint8_t* p) {
     return static_cast<std::int32_t>(read_le32(p));
 }
 
+constexpr std::uint64_t read_le64(const std::uint8_t* p) {
+    return static_cast<std::uint64_t>(read_le32(p)) |
+           (static_cast<std::uint64_t>(read_le32(p + 4)) << 32);
+}
+
+// Little-endian writers
+constexpr void write_le32(std::uint8_t* p, std::uint32_t v) {
+    p[0] = static_cast<std::uint8_t>(v);
+    p[1] = static_cast<std::uint8_t>(v >> 8);
+    p[2] = static_cast<std::uint8_t>(v >> 16);
+    p[3] = static_cast<std::uint8_t>(v >> 24);
+}
+
+constexpr void write_le64(std::uint8_t* p, std::uint64_t v) {
+    write_le32(p, static_cast<std::uint32_t>(v));
+    write_le32(p + 4, static_cast<std::uint32_t>(v >> 32));
+}
+
 // Big-endian readers
-inline std::uint16_t read_be16(const std::uint8_t* p) {
+constexpr std::uint16_t read_be16(const std::uint8_t* p) {
     return (static_cast<std::uint16_t>(p[0]) << 8) |
            static_cast<std::uint16_t>(p[1]);
 }
 
-inline std::uint32_t read_be32(const std::uint8_t* p) {
+constexpr std::uint32_t read_be32(const std::uint8_t* p) {
     return (static_cast<std::uint32_t>(p[0]) << 24) |
            (static_cast<std::uint32_t>(p[1]) << 16) |
            (static_cast<std::uint32_t>(p[2]) << 8) |
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace onyx_image {
+
+// 128-bit content hash for cache keys and duplicate detection.
+//
+// Same construction as XXH3: eight 64-bit accumulators take one 64-byte
+// stripe per step (each lane adds the neighbouring input word plus the
+// 32x32->64 product of its own word xored with a key), are scrambled
+// once per 1 KiB block, and are folded with 128-bit multiplies at the
+// end. The key schedule is our own, so values differ from XXH3; they are
+// stable across builds and platforms of the same endianness.
+
+struct hash128 {
+    std::uint64_t lo = 0;
+    std::uint64_t hi = 0;
+
+    friend constexpr bool operator==(const hash128&, const hash128&) = default;
+};
+
+namespace detail {
+
+constexpr std::uint64_t HASH_PRIME32_1 = 0x9E3779B1u;
+constexpr std::uint64_t HASH_PRIME64_1 = 0x9E3779B185EBCA87ull;
+constexpr std::uint64_t HASH_PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+
+constexpr std::size_t HASH_STRIPE = 64;
+constexpr std::size_t HASH_KEY_WORDS = 24;                         // 192 bytes
+constexpr std::size_t HASH_STRIPES_PER_BLOCK = HASH_KEY_WORDS - 8;  // Key advances one word per stripe
+constexpr std::size_t HASH_SCRAMBLE_KEY = HASH_KEY_WORDS - 8;
+
+constexpr std::array<std::uint64_t, HASH_KEY_WORDS> make_hash_key() noexcept {
+    std::array<std::uint64_t, HASH_KEY_WORDS> key{};
+    std::uint64_t state = 0x6F6E79785F696D67ull;  // splitmix64
+    for (auto& k : key) {
+        state += 0x9E3779B97F4A7C15ull;
+        std::uint64_t z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        k = z ^ (z >> 31);
+    }
+    return key;
+}
+
+inline constexpr auto HASH_KEY = make_hash_key();
+
+inline std::uint64_t load64(const std::uint8_t* p) noexcept {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Low 64 bits xor high 64 bits of the 128-bit product
+inline std::uint64_t mul128_fold64(std::uint64_t a, std::uint64_t b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    __extension__ typedef unsigned __int128 u128;
+    const u128 p = static_cast<u128>(a) * b;
+    return static_cast<std::uint64_t>(p) ^ static_cast<std::uint64_t>(p >> 64);
+#else
+    const std::uint64_t a_lo = a & 0xFFFFFFFFu, a_hi = a >> 32;
+    const std::uint64_t b_lo = b & 0xFFFFFFFFu, b_hi = b >> 32;
+    const std::uint64_t lo_lo = a_lo * b_lo;
+    const std::uint64_t hi_lo = a_hi * b_lo;
+    const std::uint64_t lo_hi = a_lo * b_hi;
+    const std::uint64_t hi_hi = a_hi * b_hi;
+    const std::uint64_t cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFu) + lo_hi;
+    const std::uint64_t hi = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+    const std::uint64_t lo = (cross << 32) | (lo_lo & 0xFFFFFFFFu);
+    return lo ^ hi;
+#endif
+}
+
+inline std::uint64_t hash_avalanche(std::uint64_t h) noexcept {
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ull;
+    return h ^ (h >> 32);
+}
+
+// Accumulate `stripes` consecutive stripes, the key advancing one word per stripe
+inline void hash_accumulate(std::uint64_t* acc, const std::uint8_t* p, std::size_t stripes,
+                            const std::uint64_t* key) noexcept {
+#ifdef ONYX_IMAGE_HAS_SSE2
+    __m128i a[4];
+    for (int i = 0; i < 4; ++i) {
+        a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc + i * 2));
+    }
+    for (std::size_t s = 0; s < stripes; ++s, p += HASH_STRIPE, ++key) {
+        for (int i = 0; i < 4; ++i) {
+            const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+            const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + i * 2));
+            const __m128i dk = _mm_xor_si128(d, k);
+            const __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+            const __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc + i * 2), a[i]);
+    }
+#else
+    for (std::size_t s = 0; s < stripes; ++s, p += HASH_STRIPE, ++key) {
+        for (int i = 0; i < 8; ++i) {
+            const std::uint64_t d = load64(p + i * 8);
+            const std::uint64_t dk = d ^ key[i];
+            acc[i ^ 1] += d;
+            acc[i] += (dk & 0xFFFFFFFFu) * (dk >> 32);
+        }
+    }
+#endif
+}
+
+inline void hash_scramble(std::uint64_t* acc) noexcept {
+    const std::uint64_t* key = HASH_KEY.data() + HASH_SCRAMBLE_KEY;
+    for (int i = 0; i < 8; ++i) {
+        std::uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= key[i];
+        acc[i] = a * HASH_PRIME32_1;
+    }
+}
+
+inline std::uint64_t hash_merge(const std::uint64_t* acc, std::size_t key_offset, std::uint64_t start) noexcept {
+    const std::uint64_t* key = HASH_KEY.data() + key_offset;
+    std::uint64_t h = start;
+    for (int i = 0; i < 4; ++i) {
+        h += mul128_fold64(acc[i * 2] ^ key[i * 2], acc[i * 2 + 1] ^ key[i * 2 + 1]);
+    }
+    return hash_avalanche(h);
+}
+
+} // namespace detail
+
+[[nodiscard]] inline hash128 content_hash(const std::uint8_t* data, std::size_t size) noexcept {
+    using namespace detail;
+    std::uint64_t acc[8] = {HASH_PRIME32_1, HASH_PRIME64_1, HASH_PRIME64_2, HASH_PRIME64_1 ^ HASH_PRIME64_2,
+                            HASH_PRIME64_2 * 3, HASH_PRIME32_1 << 16, HASH_PRIME64_1 * 5, HASH_PRIME32_1 * 7};
+
+    const std::size_t block = HASH_STRIPE * HASH_STRIPES_PER_BLOCK;
+    std::size_t pos = 0;
+    for (; pos + block <= size; pos += block) {
+        hash_accumulate(acc, data + pos, HASH_STRIPES_PER_BLOCK, HASH_KEY.data());
+        hash_scramble(acc);
+    }
+    const std::size_t stripes = (size - pos) / HASH_STRIPE;
+    hash_accumulate(acc, data + pos, stripes, HASH_KEY.data());
+    pos += stripes * HASH_STRIPE;
+
+    // Last partial stripe, zero padded; the length is mixed in below
+    if (pos < size) {
+        std::uint8_t last[HASH_STRIPE] = {};
+        std::memcpy(last, data + pos, size - pos);
+        hash_accumulate(acc, last, 1, HASH_KEY.data() + HASH_STRIPES_PER_BLOCK - 1);
+    }
+
+    const auto length = static_cast<std::uint64_t>(size);
+    return {hash_merge(acc, 1, length * HASH_PRIME64_1),
+            hash_merge(acc, 11, ~(length * HASH_PRIME64_2))};
+}
+
+} // namespace onyx_image
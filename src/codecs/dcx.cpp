@@ -1,6 +1,7 @@
 #include <onyx_image/codecs/dcx.hpp>
 #include <onyx_image/codecs/pcx.hpp>
 #include "byte_io.hpp"
+#include "frame_dedup.hpp"
 
 #include <cstring>
 #include <vector>
@@ -115,52 +116,100 @@ decode_result dcx_decoder::decode(std::span<const std::uint8_t> data,
         return decode_result::failure(decode_error::invalid_format, "No valid pages in DCX file");
     }
 
+    // Second pass: decode each page into the atlas. When verifying, pages
+    // are only checked and nothing is copied.
+    const bool verify_only = surf.discards_pixels();
+    // Pages of different depths share one atlas, so none is kept packed
+    decode_options page_options = options;
+    page_options.packed_indexed = false;
+
+    // Rows of each page in the atlas. With dedup_frames all pages are
+    // decoded up front, and pages equal to an earlier one share its rows.
+    std::vector<int> page_y(pages.size());
+    std::vector<memory_surface> decoded;
+    std::vector<bool> decoded_ok;
+    if (options.dedup_frames) {
+        decoded.resize(pages.size());
+        decoded_ok.resize(pages.size());
+        frame_dedup frames;
+        atlas_height = 0;
+        for (std::size_t i = 0; i < pages.size(); ++i) {
+            auto& page = decoded[i];
+            decoded_ok[i] = pcx_decoder::decode(pages[i].pcx_data, page, page_options).ok;
+            const std::size_t first = decoded_ok[i]
+                ? frames.find_or_add(i, {page.pixels().data(), page.pitch(), page.width(), page.height(), page.format()})
+                : i;
+            if (first != i) {
+                page_y[i] = page_y[first];
+                decoded[i] = {};
+                continue;
+            }
+            page_y[i] = static_cast<int>(atlas_height);
+            atlas_height += static_cast<std::size_t>(pages[i].height);
+        }
+    } else {
+        int y_offset = 0;
+        for (std::size_t i = 0; i < pages.size(); ++i) {
+            page_y[i] = y_offset;
+            y_offset += pages[i].height;
+        }
+    }
+
     // Allocate atlas surface
     if (!surf.set_size(static_cast<int>(atlas_width), static_cast<int>(atlas_height), common_format)) {
         return decode_result::failure(decode_error::internal_error, "Failed to allocate atlas surface");
     }
 
-    // Second pass: decode each page into the atlas
-    int y_offset = 0;
+    int next_y = 0;
     for (std::size_t i = 0; i < pages.size(); ++i) {
         const auto& page = pages[i];
+        const bool shared = page_y[i] < next_y;  // Rows written for an earlier page
+        if (!shared) {
+            next_y += page.height;
+        }
 
         // Decode page to temporary surface
         memory_surface temp_surf;
-        auto result = pcx_decoder::decode(page.pcx_data, temp_surf, options);
-        if (!result) {
-            // Fill with zeros and continue
-            y_offset += page.height;
-            continue;
+        null_surface page_check;
+        bool page_ok = true;
+        if (options.dedup_frames) {
+            page_ok = decoded_ok[i];
+            temp_surf = std::move(decoded[i]);
+        } else {
+            surface& page_surf = verify_only ? static_cast<surface&>(page_check) : temp_surf;
+            page_ok = pcx_decoder::decode(page.pcx_data, page_surf, page_options).ok;
         }
-
-        // Copy palette from first page if indexed
-        if (i == 0 && temp_surf.format() == pixel_format::indexed8) {
-            auto pal = temp_surf.palette();
-            surf.set_palette_size(static_cast<int>(pal.size() / 3));
-            surf.write_palette(0, pal);
+        if (!page_ok) {
+            continue;  // Leave the page's rows zero
         }
 
-        // Copy pixels to atlas at y_offset
-        auto src_pixels = temp_surf.pixels();
-        std::size_t bytes_per_pixel = (temp_surf.format() == pixel_format::rgb888)    ? 3
-                                    : (temp_surf.format() == pixel_format::rgba8888) ? 4
-                                                                                      : 1;
-        std::size_t src_row_bytes = static_cast<std::size_t>(page.width) * bytes_per_pixel;
-
-        for (int y = 0; y < page.height; ++y) {
-            const std::uint8_t* src_row = src_pixels.data() + static_cast<std::size_t>(y) * src_row_bytes;
-            surf.write_pixels(0, y_offset + y, static_cast<int>(src_row_bytes), src_row);
+        if (!verify_only && !shared) {
+            // Copy palette from first page if indexed
+            if (i == 0 && temp_surf.format() == pixel_format::indexed8) {
+                auto pal = temp_surf.palette();
+                surf.set_palette_size(static_cast<int>(pal.size() / 3));
+                surf.write_palette(0, pal);
+            }
+
+            // Copy pixels to atlas at the page's rows
+            auto src_pixels = temp_surf.pixels();
+            std::size_t bytes_per_pixel = (temp_surf.format() == pixel_format::rgb888)    ? 3
+                                        : (temp_surf.format() == pixel_format::rgba8888) ? 4
+                                                                                          : 1;
+            std::size_t src_row_bytes = static_cast<std::size_t>(page.width) * bytes_per_pixel;
+
+            for (int y = 0; y < page.height; ++y) {
+                const std::uint8_t* src_row = src_pixels.data() + static_cast<std::size_t>(y) * temp_surf.pitch();
+                surf.write_pixels(0, page_y[i] + y, static_cast<int>(src_row_bytes), src_row);
+            }
         }
 
         // Set subrect for this page
         subrect sr;
-        sr.rect = {0, y_offset, page.width, page.height};
+        sr.rect = {0, page_y[i], page.width, page.height};
         sr.kind = subrect_kind::frame;
         sr.user_tag = static_cast<std::uint32_t>(i);
         surf.set_subrect(static_cast<int>(i), sr);
-
-        y_offset += page.height;
     }
 
     return decode_result::success();
@@ -45,6 +45,35 @@ inline void write_rows(surface& surf, const std::uint8_t* data,
     }
 }
 
+// Packed output format for a 1, 2 or 4-bit indexed source row when the
+// caller asked for packed_indexed; indexed8 otherwise
+inline pixel_format indexed_format_for(int bits_per_pixel, const decode_options& options) {
+    if (options.packed_indexed) {
+        switch (bits_per_pixel) {
+            case 1: return pixel_format::indexed1;
+            case 2: return pixel_format::indexed2;
+            case 4: return pixel_format::indexed4;
+            default: break;
+        }
+    }
+    return pixel_format::indexed8;
+}
+
+// Write a packed (MSB first) row as stored. The bits after the last pixel
+// are cleared so the padding is zero as pixel_format requires.
+inline void write_packed_row(surface& surf, int y, const std::uint8_t* src,
+                             int width, pixel_format format) {
+    const std::size_t bits = static_cast<std::size_t>(width) * bits_per_pixel(format);
+    const std::size_t whole = bits / 8;
+    if (whole > 0) {
+        surf.write_pixels(0, y, static_cast<int>(whole), src);
+    }
+    if (const unsigned tail = static_cast<unsigned>(bits % 8); tail != 0) {
+        const auto last = static_cast<std::uint8_t>(src[whole] & (0xFF00u >> tail));
+        surf.write_pixels(static_cast<int>(whole), y, 1, &last);
+    }
+}
+
 // Row stride calculation (4-byte aligned, for BMP/ICO/DIB formats)
 inline std::size_t row_stride_4byte(int width, int bits_per_pixel) {
     return ((static_cast<std::size_t>(width) * static_cast<std::size_t>(bits_per_pixel) + 31) / 32) * 4;
@@ -0,0 +1,230 @@
+#include "deflate_join.hpp"
+#include "deflate_tables.hpp"
+
+#include <array>
+
+namespace onyx_image {
+
+namespace {
+
+constexpr std::uint32_t ADLER_BASE = 65521;
+constexpr std::size_t ADLER_NMAX = 5552;  // Largest run before the sums can overflow
+
+// ============================================================================
+// Deflate Block Walker
+// ============================================================================
+//
+// Finds where the final block starts and where the stream ends by decoding
+// the Huffman symbols without producing output (after puff.c). The input
+// is our own encoder output, so only structural errors are checked.
+
+using deflate::MAX_BITS;
+using deflate::MAX_DIST_CODES;
+using deflate::MAX_LITLEN_CODES;
+
+class bit_reader {
+public:
+    bit_reader(const std::uint8_t* data, std::size_t size) noexcept : data_(data), bits_(size * 8) {}
+
+    [[nodiscard]] std::size_t position() const noexcept { return pos_; }
+
+    // Read n bits LSB first; -1 past the end
+    int read(int n) noexcept {
+        if (bits_ - pos_ < static_cast<std::size_t>(n)) return -1;
+        int value = 0;
+        for (int i = 0; i < n; ++i, ++pos_) {
+            value |= ((data_[pos_ >> 3] >> (pos_ & 7)) & 1) << i;
+        }
+        return value;
+    }
+
+    bool skip_bytes(std::size_t n) noexcept {
+        pos_ = (pos_ + 7) & ~std::size_t{7};
+        if ((bits_ - pos_) / 8 < n) return false;
+        pos_ += n * 8;
+        return true;
+    }
+
+private:
+    const std::uint8_t* data_;
+    std::size_t bits_;
+    std::size_t pos_ = 0;
+};
+
+// Canonical Huffman code: symbol counts per length and symbols in code order
+struct huffman {
+    std::array<std::uint16_t, MAX_BITS + 1> count{};
+    std::array<std::uint16_t, MAX_LITLEN_CODES> symbol{};
+
+    void build(const std::uint8_t* lengths, int n) noexcept {
+        count.fill(0);
+        for (int i = 0; i < n; ++i) ++count[lengths[i]];
+
+        std::array<std::uint16_t, MAX_BITS + 1> offset{};
+        for (int len = 1; len < MAX_BITS; ++len) {
+            offset[len + 1] = static_cast<std::uint16_t>(offset[len] + count[len]);
+        }
+        for (int i = 0; i < n; ++i) {
+            if (lengths[i] != 0) symbol[offset[lengths[i]]++] = static_cast<std::uint16_t>(i);
+        }
+    }
+
+    int decode(bit_reader& in) const noexcept {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            const int bit = in.read(1);
+            if (bit < 0) return -1;
+            code |= bit;
+            const int n = count[len];
+            if (code - n < first) return symbol[index + (code - first)];
+            index += n;
+            first = (first + n) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+// Skip the compressed symbols of one block up to end-of-block
+bool skip_codes(bit_reader& in, const huffman& litlen, const huffman& dist) noexcept {
+    for (;;) {
+        int sym = litlen.decode(in);
+        if (sym < 0) return false;
+        if (sym < 256) continue;
+        if (sym == deflate::END_OF_BLOCK) return true;
+
+        sym -= deflate::FIRST_LENGTH_CODE;
+        if (sym >= 29 || in.read(deflate::LENGTH_EXTRA[sym]) < 0) return false;
+        const int dsym = dist.decode(in);
+        if (dsym < 0 || dsym >= MAX_DIST_CODES || in.read(deflate::DIST_EXTRA[dsym]) < 0) return false;
+    }
+}
+
+bool read_dynamic_tables(bit_reader& in, huffman& litlen, huffman& dist) noexcept {
+    const int nlen = in.read(5) + 257;
+    const int ndist = in.read(5) + 1;
+    const int ncode = in.read(4) + 4;
+    if (nlen < 257 || nlen > 286 || ndist < 1 || ndist > MAX_DIST_CODES || ncode < 4) return false;
+
+    std::array<std::uint8_t, MAX_LITLEN_CODES + MAX_DIST_CODES> lengths{};
+    for (int i = 0; i < ncode; ++i) {
+        const int len = in.read(3);
+        if (len < 0) return false;
+        lengths[deflate::CODE_LENGTH_ORDER[i]] = static_cast<std::uint8_t>(len);
+    }
+    huffman code_lengths;
+    code_lengths.build(lengths.data(), 19);
+
+    lengths.fill(0);
+    for (int i = 0; i < nlen + ndist;) {
+        const int sym = code_lengths.decode(in);
+        if (sym < 0) return false;
+        if (sym < 16) {
+            lengths[i++] = static_cast<std::uint8_t>(sym);
+            continue;
+        }
+
+        int repeat = 0;
+        std::uint8_t value = 0;
+        if (sym == 16) {
+            if (i == 0) return false;
+            value = lengths[i - 1];
+            repeat = 3 + in.read(2);
+        } else if (sym == 17) {
+            repeat = 3 + in.read(3);
+        } else {
+            repeat = 11 + in.read(7);
+        }
+        if (repeat < 3 || i + repeat > nlen + ndist) return false;
+        while (repeat-- > 0) lengths[i++] = value;
+    }
+
+    litlen.build(lengths.data(), nlen);
+    dist.build(lengths.data() + nlen, ndist);
+    return true;
+}
+
+} // namespace
+
+std::uint32_t adler32(std::uint32_t adler, const std::uint8_t* data, std::size_t size) noexcept {
+    std::uint32_t a = adler & 0xFFFF;
+    std::uint32_t b = adler >> 16;
+    while (size > 0) {
+        const std::size_t run = size < ADLER_NMAX ? size : ADLER_NMAX;
+        for (std::size_t i = 0; i < run; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+        data += run;
+        size -= run;
+    }
+    return a | (b << 16);
+}
+
+std::uint32_t adler32_combine(std::uint32_t adler_a, std::uint32_t adler_b, std::size_t length_b) noexcept {
+    const auto rem = static_cast<std::uint32_t>(length_b % ADLER_BASE);
+    std::uint32_t sum1 = adler_a & 0xFFFF;
+    std::uint32_t sum2 = static_cast<std::uint32_t>((std::uint64_t{rem} * sum1) % ADLER_BASE);
+    sum1 += (adler_b & 0xFFFF) + ADLER_BASE - 1;
+    sum2 += (adler_a >> 16) + (adler_b >> 16) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= ADLER_BASE * 2) sum2 -= ADLER_BASE * 2;
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
+
+bool deflate_sync_flush(std::vector<std::uint8_t>& stream) {
+    bit_reader in(stream.data(), stream.size());
+    huffman litlen;
+    huffman dist;
+
+    for (;;) {
+        const std::size_t header = in.position();
+        const int final = in.read(1);
+        const int type = in.read(2);
+        if (final < 0 || type < 0) return false;
+
+        if (type == deflate::BLOCK_STORED) {
+            // Stored: byte-aligned LEN, NLEN, then LEN raw bytes
+            if (!in.skip_bytes(0)) return false;
+            const int lo = in.read(16);
+            const int hi = in.read(16);
+            if (lo < 0 || hi < 0 || (lo ^ 0xFFFF) != hi || !in.skip_bytes(static_cast<std::size_t>(lo))) {
+                return false;
+            }
+        } else if (type == deflate::BLOCK_FIXED) {
+            std::array<std::uint8_t, MAX_LITLEN_CODES> lengths{};
+            for (int i = 0; i < MAX_LITLEN_CODES; ++i) {
+                lengths[i] = deflate::fixed_litlen_length(i);
+            }
+            litlen.build(lengths.data(), MAX_LITLEN_CODES);
+            lengths.fill(deflate::FIXED_DIST_LENGTH);
+            dist.build(lengths.data(), MAX_DIST_CODES);
+            if (!skip_codes(in, litlen, dist)) return false;
+        } else if (type == deflate::BLOCK_DYNAMIC) {
+            if (!read_dynamic_tables(in, litlen, dist) || !skip_codes(in, litlen, dist)) return false;
+        } else {
+            return false;
+        }
+
+        if (final) {
+            // Clear BFINAL, then an empty stored block: three zero header
+            // bits, zero padding to the byte boundary, LEN 0 and NLEN FFFF
+            const std::size_t end = in.position();
+            stream[header >> 3] &= static_cast<std::uint8_t>(~(1u << (header & 7)));
+            if (end & 7) {
+                stream[end >> 3] &= static_cast<std::uint8_t>((1u << (end & 7)) - 1);
+            }
+            stream.resize((end + 3 + 7) / 8);
+            stream.insert(stream.end(), {0x00, 0x00, 0xFF, 0xFF});
+            return true;
+        }
+    }
+}
+
+} // namespace onyx_image
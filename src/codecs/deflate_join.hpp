@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace onyx_image {
+
+// Helpers for assembling one zlib stream from independently deflated
+// pieces (pigz style): each piece but the last ends in a sync flush
+// instead of a final block, and the Adler-32 of the whole is combined
+// from the per-piece checksums.
+
+// Running Adler-32; start from 1
+[[nodiscard]] std::uint32_t adler32(std::uint32_t adler, const std::uint8_t* data, std::size_t size) noexcept;
+
+// Adler-32 of A followed by B, given adler(A), adler(B) and B's length
+[[nodiscard]] std::uint32_t adler32_combine(std::uint32_t adler_a, std::uint32_t adler_b,
+                                            std::size_t length_b) noexcept;
+
+// Rewrite a complete raw deflate stream so more data can follow it: the
+// final block's BFINAL bit is cleared and an empty stored block aligns
+// the end to a byte boundary. Returns false if the stream does not parse.
+[[nodiscard]] bool deflate_sync_flush(std::vector<std::uint8_t>& stream);
+
+} // namespace onyx_image
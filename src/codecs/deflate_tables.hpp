@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace onyx_image::deflate {
+
+// Constants of the deflate format (RFC 1951)
+
+constexpr int MAX_BITS = 15;          // Longest Huffman code
+constexpr int MAX_LITLEN_CODES = 288;
+constexpr int MAX_DIST_CODES = 30;
+constexpr int END_OF_BLOCK = 256;
+constexpr int FIRST_LENGTH_CODE = 257;
+
+// Block types (BTYPE)
+constexpr int BLOCK_STORED = 0;
+constexpr int BLOCK_FIXED = 1;
+constexpr int BLOCK_DYNAMIC = 2;
+
+// Length codes 257..285: base length and extra bits
+constexpr std::uint16_t LENGTH_BASE[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::uint8_t LENGTH_EXTRA[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+// Distance codes 0..29: base distance and extra bits
+constexpr std::uint16_t DIST_BASE[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::uint8_t DIST_EXTRA[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order in which code length code lengths are stored in a dynamic header
+constexpr std::uint8_t CODE_LENGTH_ORDER[19] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// Code lengths of the fixed literal/length code (distances are all 5 bits)
+constexpr std::uint8_t fixed_litlen_length(int symbol) noexcept {
+    return symbol < 144 ? 8 : symbol < 256 ? 9 : symbol < 280 ? 7 : 8;
+}
+constexpr std::uint8_t FIXED_DIST_LENGTH = 5;
+
+} // namespace onyx_image::deflate
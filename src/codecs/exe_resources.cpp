@@ -0,0 +1,306 @@
+#include "exe_resources.hpp"
+#include "byte_io.hpp"
+
+#include <algorithm>
+#include <utility>
+
+namespace onyx_image {
+
+namespace {
+
+constexpr std::uint16_t RT_ICON = 3;
+constexpr std::uint16_t RT_GROUP_ICON = 14;
+
+// NE type and name IDs with the high bit set are integers; others are
+// offsets to a name string
+constexpr std::uint16_t NE_INTEGER_ID = 0x8000;
+
+// NE target operating system (header offset 0x36)
+constexpr std::uint8_t NE_OS_OS2 = 1;
+
+// Offset of the extended (NE/PE/LX) header, or 0 if there is none
+std::size_t extended_header_offset(std::span<const std::uint8_t> data) noexcept {
+    if (data.size() < 64 || data[0] != 'M' || data[1] != 'Z') {
+        return 0;
+    }
+    const std::size_t offset = read_le32(data.data() + 0x3C);
+    if (offset < 64 || offset > data.size() - 4) {
+        return 0;
+    }
+    return offset;
+}
+
+void add_resource(std::vector<exe_resource>& out, std::uint32_t id,
+                  std::span<const std::uint8_t> data, std::size_t offset, std::size_t size) {
+    if (offset >= data.size() || size == 0) {
+        return;
+    }
+    // Sizes are often rounded up to the alignment unit; clamp to the file
+    out.push_back({id, data.subspan(offset, std::min(size, data.size() - offset))});
+}
+
+// ============================================================================
+// NE Resource Table
+// ============================================================================
+
+bool read_ne_resources(std::span<const std::uint8_t> data, std::size_t ne,
+                       exe_icon_resources& out) {
+    if (ne + 0x40 > data.size()) {
+        return false;
+    }
+
+    const std::size_t table = ne + read_le16(data.data() + ne + 0x24);
+    if (table + 2 > data.size()) {
+        return false;
+    }
+
+    const unsigned shift = read_le16(data.data() + table);
+    if (shift > 24) {
+        return false;
+    }
+
+    // Type entries: type id, count, reserved dword, then count name entries
+    // of offset, length, flags, id, reserved dword (offset/length in
+    // alignment units). A zero type id ends the table.
+    std::size_t pos = table + 2;
+    while (pos + 2 <= data.size()) {
+        const std::uint16_t type_id = read_le16(data.data() + pos);
+        if (type_id == 0 || pos + 8 > data.size()) {
+            break;
+        }
+
+        const std::size_t count = read_le16(data.data() + pos + 2);
+        pos += 8;
+        if (count > (data.size() - pos) / 12) {
+            return false;
+        }
+
+        std::vector<exe_resource>* target = nullptr;
+        if (type_id == (NE_INTEGER_ID | RT_ICON)) {
+            target = &out.icons;
+        } else if (type_id == (NE_INTEGER_ID | RT_GROUP_ICON)) {
+            target = &out.groups;
+        }
+
+        if (target) {
+            target->reserve(target->size() + count);
+            for (std::size_t i = 0; i < count; ++i) {
+                const std::uint8_t* p = data.data() + pos + i * 12;
+                const std::size_t offset = static_cast<std::size_t>(read_le16(p)) << shift;
+                const std::size_t size = static_cast<std::size_t>(read_le16(p + 2)) << shift;
+                const std::uint16_t raw_id = read_le16(p + 6);
+                const std::uint32_t id = (raw_id & NE_INTEGER_ID) ? (raw_id & 0x7FFFu)
+                                                                  : (exe_resource::NAMED_RESOURCE | raw_id);
+                add_resource(*target, id, data, offset, size);
+            }
+        }
+
+        pos += count * 12;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// PE Resource Directory
+// ============================================================================
+
+struct pe_section {
+    std::uint32_t virtual_address;
+    std::uint32_t virtual_size;
+    std::uint32_t raw_offset;
+    std::uint32_t raw_size;
+};
+
+// Map an RVA to a file offset through the section table (0 if unmapped)
+std::size_t pe_rva_to_offset(std::span<const std::uint8_t> data,
+                             const std::vector<pe_section>& sections, std::uint32_t rva) noexcept {
+    for (const auto& s : sections) {
+        const std::uint32_t extent = std::max(s.virtual_size, s.raw_size);
+        if (rva >= s.virtual_address && rva - s.virtual_address < extent) {
+            const std::size_t offset = static_cast<std::size_t>(s.raw_offset) + (rva - s.virtual_address);
+            return offset < data.size() ? offset : 0;
+        }
+    }
+    return 0;
+}
+
+// Walks type -> name -> language levels of a PE resource directory.
+// All directory offsets are relative to the resource section root.
+class pe_resource_walker {
+public:
+    pe_resource_walker(std::span<const std::uint8_t> data, std::vector<pe_section> sections,
+                       std::size_t root, std::size_t size)
+        : data_(data), sections_(std::move(sections)), root_(root), size_(size) {}
+
+    // Collect every entry of one type directory (second level), taking the
+    // first language of each
+    void read_type(std::size_t type_dir, std::vector<exe_resource>& out) const {
+        for_each_entry(type_dir, [&](std::uint32_t name, std::uint32_t target) {
+            if (!(target & SUBDIRECTORY)) return true;
+
+            const std::uint32_t id = (name & NAMED) ? (exe_resource::NAMED_RESOURCE | (name & 0x7FFFFFFFu))
+                                                    : (name & 0xFFFFu);
+            for_each_entry(target & ~SUBDIRECTORY, [&](std::uint32_t, std::uint32_t leaf) {
+                return (leaf & SUBDIRECTORY) || !read_data_entry(leaf, id, out);
+            });
+            return true;
+        });
+    }
+
+    // Find the type directories for RT_ICON and RT_GROUP_ICON. Only the
+    // first of each is used, so crafted duplicates cannot multiply the work.
+    void read(exe_icon_resources& out) const {
+        bool have_icons = false;
+        bool have_groups = false;
+        for_each_entry(0, [&](std::uint32_t name, std::uint32_t target) {
+            if ((name & NAMED) || !(target & SUBDIRECTORY)) return true;
+            if (name == RT_ICON && !have_icons) {
+                read_type(target & ~SUBDIRECTORY, out.icons);
+                have_icons = true;
+            } else if (name == RT_GROUP_ICON && !have_groups) {
+                read_type(target & ~SUBDIRECTORY, out.groups);
+                have_groups = true;
+            }
+            return !(have_icons && have_groups);
+        });
+    }
+
+private:
+    static constexpr std::uint32_t NAMED = 0x80000000u;
+    static constexpr std::uint32_t SUBDIRECTORY = 0x80000000u;
+
+    // IMAGE_RESOURCE_DIRECTORY: 16-byte header with named and ID entry
+    // counts at 12 and 14, followed by 8-byte (name, target) entries.
+    // fn returns false to stop early.
+    template <typename Fn>
+    void for_each_entry(std::size_t dir, Fn&& fn) const {
+        if (dir > size_ || size_ - dir < 16) return;
+
+        const std::uint8_t* p = data_.data() + root_ + dir;
+        std::size_t count = static_cast<std::size_t>(read_le16(p + 12)) + read_le16(p + 14);
+        count = std::min(count, (size_ - dir - 16) / 8);
+
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint8_t* e = p + 16 + i * 8;
+            if (!fn(read_le32(e), read_le32(e + 4))) return;
+        }
+    }
+
+    bool read_data_entry(std::uint32_t entry, std::uint32_t id, std::vector<exe_resource>& out) const {
+        if (entry > size_ || size_ - entry < 16) return false;
+
+        const std::uint8_t* p = data_.data() + root_ + entry;
+        const std::size_t offset = pe_rva_to_offset(data_, sections_, read_le32(p));
+        if (offset == 0) return false;
+
+        add_resource(out, id, data_, offset, read_le32(p + 4));
+        return true;
+    }
+
+    std::span<const std::uint8_t> data_;
+    std::vector<pe_section> sections_;
+    std::size_t root_;
+    std::size_t size_;
+};
+
+bool read_pe_resources(std::span<const std::uint8_t> data, std::size_t pe,
+                       exe_icon_resources& out) {
+    // COFF header follows the 4-byte signature
+    const std::size_t coff = pe + 4;
+    if (coff + 20 > data.size()) {
+        return false;
+    }
+
+    const std::size_t section_count = read_le16(data.data() + coff + 2);
+    const std::size_t optional_size = read_le16(data.data() + coff + 16);
+    const std::size_t optional = coff + 20;
+    if (optional + optional_size > data.size() || optional_size < 2) {
+        return false;
+    }
+
+    // Data directories sit after the PE32 / PE32+ specific fields
+    std::size_t dir_count_offset = 0;
+    switch (read_le16(data.data() + optional)) {
+        case 0x10B: dir_count_offset = 92; break;
+        case 0x20B: dir_count_offset = 108; break;
+        default: return false;
+    }
+    if (dir_count_offset + 4 + 3 * 8 > optional_size) {
+        return true;  // No resource directory
+    }
+
+    const std::uint32_t dir_count = read_le32(data.data() + optional + dir_count_offset);
+    if (dir_count < 3) {
+        return true;
+    }
+
+    const std::uint8_t* res_dir = data.data() + optional + dir_count_offset + 4 + 2 * 8;
+    const std::uint32_t res_rva = read_le32(res_dir);
+    const std::uint32_t res_size = read_le32(res_dir + 4);
+    if (res_rva == 0 || res_size == 0) {
+        return true;
+    }
+
+    const std::size_t section_table = optional + optional_size;
+    if (section_count > (data.size() - section_table) / 40) {
+        return false;
+    }
+
+    std::vector<pe_section> sections;
+    sections.reserve(section_count);
+    for (std::size_t i = 0; i < section_count; ++i) {
+        const std::uint8_t* s = data.data() + section_table + i * 40;
+        sections.push_back({read_le32(s + 12), read_le32(s + 8), read_le32(s + 20), read_le32(s + 16)});
+    }
+
+    const std::size_t root = pe_rva_to_offset(data, sections, res_rva);
+    if (root == 0) {
+        return false;
+    }
+
+    const std::size_t size = std::min<std::size_t>(res_size, data.size() - root);
+    pe_resource_walker(data, std::move(sections), root, size).read(out);
+    return true;
+}
+
+}  // namespace
+
+exe_kind detect_exe_kind(std::span<const std::uint8_t> data) noexcept {
+    const std::size_t offset = extended_header_offset(data);
+    if (offset == 0) {
+        return exe_kind::unknown;
+    }
+
+    const std::uint8_t* p = data.data() + offset;
+    if (p[0] == 'P' && p[1] == 'E' && p[2] == 0 && p[3] == 0) {
+        return exe_kind::pe;
+    }
+    if (p[0] == 'N' && p[1] == 'E') {
+        // OS/2 1.x NE files keep icons as RT_POINTER, which is not handled
+        if (offset + 0x37 <= data.size() && p[0x36] == NE_OS_OS2) {
+            return exe_kind::unknown;
+        }
+        return exe_kind::ne;
+    }
+    if (p[0] == 'L' && p[1] == 'X') {
+        return exe_kind::lx;
+    }
+    return exe_kind::unknown;
+}
+
+bool read_exe_icon_resources(std::span<const std::uint8_t> data, exe_icon_resources& out) {
+    out.icons.clear();
+    out.groups.clear();
+
+    switch (detect_exe_kind(data)) {
+        case exe_kind::ne:
+            return read_ne_resources(data, extended_header_offset(data), out);
+        case exe_kind::pe:
+            return read_pe_resources(data, extended_header_offset(data), out);
+        default:
+            return false;
+    }
+}
+
+} // namespace onyx_image
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace onyx_image {
+
+// Executable container behind the MZ stub
+enum class exe_kind {
+    unknown,
+    ne,     // 16-bit Windows
+    pe,     // 32/64-bit Windows
+    lx      // OS/2 2.x
+};
+
+// Identify the extended header of an MZ executable (no resource parsing)
+[[nodiscard]] exe_kind detect_exe_kind(std::span<const std::uint8_t> data) noexcept;
+
+// A resource payload. Named resources have NAMED_RESOURCE set in id.
+struct exe_resource {
+    static constexpr std::uint32_t NAMED_RESOURCE = 0x80000000u;
+
+    std::uint32_t id = 0;
+    std::span<const std::uint8_t> data;
+};
+
+// Icon-related resources of an NE or PE executable, in resource table order
+struct exe_icon_resources {
+    std::vector<exe_resource> icons;   // RT_ICON
+    std::vector<exe_resource> groups;  // RT_GROUP_ICON
+};
+
+// Walk the NE resource table or the PE resource directory and collect the
+// RT_ICON and RT_GROUP_ICON payloads as views into data. Nothing else in
+// the executable is parsed. Returns false for anything but NE/PE.
+[[nodiscard]] bool read_exe_icon_resources(std::span<const std::uint8_t> data,
+                                           exe_icon_resources& out);
+
+} // namespace onyx_image
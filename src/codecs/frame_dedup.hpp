@@ -0,0 +1,88 @@
+#pragma once
+
+#include <onyx_image/types.hpp>
+#include "content_hash.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace onyx_image {
+
+// Finds frames of a multi-image atlas whose pixels equal an earlier frame
+// (decode_options::dedup_frames). Frames are keyed by content_hash of
+// their rows and shape; frames with the same key are compared byte for
+// byte, so a hash collision never merges different frames. The pixels of
+// added frames must stay valid while the frame_dedup is in use.
+class frame_dedup {
+public:
+    struct frame {
+        const std::uint8_t* pixels = nullptr;
+        std::size_t pitch = 0;
+        int width = 0;
+        int height = 0;
+        pixel_format format = pixel_format::rgba8888;
+    };
+
+    // Index of the first added frame equal to f; if there is none, f is
+    // added under index and index is returned
+    std::size_t find_or_add(std::size_t index, const frame& f) {
+        const std::uint64_t key = frame_key(f);
+        const auto [first, last] = keys_.equal_range(key);
+        for (auto it = first; it != last; ++it) {
+            const auto& known = frames_[it->second];
+            if (same_pixels(known.view, f)) {
+                return known.index;
+            }
+        }
+        keys_.emplace(key, frames_.size());
+        frames_.push_back({index, f});
+        return index;
+    }
+
+private:
+    struct known_frame {
+        std::size_t index;
+        frame view;
+    };
+
+    static std::uint64_t frame_key(const frame& f) noexcept {
+        const std::size_t row_size = row_bytes(f.format, static_cast<std::size_t>(f.width));
+        hash128 h;
+        if (f.pitch == row_size) {
+            h = content_hash(f.pixels, row_size * static_cast<std::size_t>(f.height));
+        } else {
+            std::vector<hash128> rows(static_cast<std::size_t>(f.height));
+            for (int y = 0; y < f.height; ++y) {
+                rows[static_cast<std::size_t>(y)] =
+                    content_hash(f.pixels + static_cast<std::size_t>(y) * f.pitch, row_size);
+            }
+            h = content_hash(reinterpret_cast<const std::uint8_t*>(rows.data()), rows.size() * sizeof(hash128));
+        }
+        const std::uint64_t shape = (static_cast<std::uint64_t>(f.width) << 32) ^
+                                    (static_cast<std::uint64_t>(f.height) << 4) ^
+                                    static_cast<std::uint64_t>(f.format);
+        return h.lo ^ detail::hash_avalanche(shape * detail::HASH_PRIME64_2);
+    }
+
+    static bool same_pixels(const frame& a, const frame& b) noexcept {
+        if (a.width != b.width || a.height != b.height || a.format != b.format) {
+            return false;
+        }
+        const std::size_t row_size = row_bytes(a.format, static_cast<std::size_t>(a.width));
+        for (int y = 0; y < a.height; ++y) {
+            if (std::memcmp(a.pixels + static_cast<std::size_t>(y) * a.pitch,
+                            b.pixels + static_cast<std::size_t>(y) * b.pitch, row_size) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::unordered_multimap<std::uint64_t, std::size_t> keys_;  // Key -> position in frames_
+    std::vector<known_frame> frames_;
+};
+
+} // namespace onyx_image
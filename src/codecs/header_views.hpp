@@ -0,0 +1,196 @@
+#pragma once
+
+#include "byte_io.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+namespace onyx_image {
+
+// Non-throwing views over fixed-layout file headers.
+//
+// These mirror the structures in src/formats/*.ds for the paths that must
+// not unwind on bad input (sniffing, probing, DCX page scans). A view is
+// only handed out by from() once every byte it exposes is present and the
+// schema constraints hold; a std::nullopt result replaces the
+// ConstraintViolation the generated readers would throw. Accessors are
+// then unchecked.
+
+// ============================================================================
+// PCX (formats::pcx::pcx_header, 128 bytes, little-endian)
+// ============================================================================
+
+class pcx_header_view {
+public:
+    static constexpr std::size_t SIZE = 128;
+    static constexpr std::uint8_t SIGNATURE = 0x0A;
+
+    [[nodiscard]] static constexpr std::optional<pcx_header_view> from(std::span<const std::uint8_t> data) noexcept {
+        if (data.size() < SIZE || data[0] != SIGNATURE) {
+            return std::nullopt;
+        }
+        return pcx_header_view(data.data());
+    }
+
+    [[nodiscard]] constexpr std::uint8_t version() const noexcept { return p_[1]; }
+    [[nodiscard]] constexpr std::uint8_t encoding() const noexcept { return p_[2]; }
+    [[nodiscard]] constexpr std::uint8_t bits_per_pixel() const noexcept { return p_[3]; }
+    [[nodiscard]] constexpr std::uint16_t x_min() const noexcept { return read_le16(p_ + 4); }
+    [[nodiscard]] constexpr std::uint16_t y_min() const noexcept { return read_le16(p_ + 6); }
+    [[nodiscard]] constexpr std::uint16_t x_max() const noexcept { return read_le16(p_ + 8); }
+    [[nodiscard]] constexpr std::uint16_t y_max() const noexcept { return read_le16(p_ + 10); }
+    [[nodiscard]] constexpr std::uint8_t num_planes() const noexcept { return p_[65]; }
+    [[nodiscard]] constexpr std::uint16_t bytes_per_line() const noexcept { return read_le16(p_ + 66); }
+    [[nodiscard]] constexpr std::uint16_t palette_type() const noexcept { return read_le16(p_ + 68); }
+
+private:
+    explicit constexpr pcx_header_view(const std::uint8_t* p) noexcept : p_(p) {}
+    const std::uint8_t* p_;
+};
+
+// ============================================================================
+// BMP (formats::bmp, little-endian)
+// ============================================================================
+
+// BITMAPFILEHEADER (14 bytes)
+class bmp_file_header_view {
+public:
+    static constexpr std::size_t SIZE = 14;
+
+    [[nodiscard]] static constexpr std::optional<bmp_file_header_view> from(std::span<const std::uint8_t> data) noexcept {
+        if (data.size() < SIZE) {
+            return std::nullopt;
+        }
+        return bmp_file_header_view(data.data());
+    }
+
+    [[nodiscard]] constexpr std::uint32_t file_size() const noexcept { return read_le32(p_ + 2); }
+    [[nodiscard]] constexpr std::uint32_t data_offset() const noexcept { return read_le32(p_ + 10); }
+
+private:
+    explicit constexpr bmp_file_header_view(const std::uint8_t* p) noexcept : p_(p) {}
+    const std::uint8_t* p_;
+};
+
+// Any of the info header versions, distinguished by header_size():
+//   12 (OS/2 1.x core), 40 (INFO), 52 (V2), 56 (V3), 64 (OS/2 2.x),
+//   108 (V4), 124 (V5). stored_size() is how many bytes this view reads:
+// the declared size, capped at the 108-byte V4 layout (V5 adds only
+// color management fields).
+class bmp_info_header_view {
+public:
+    [[nodiscard]] static constexpr std::optional<bmp_info_header_view> from(std::span<const std::uint8_t> data) noexcept {
+        if (data.size() < 4) {
+            return std::nullopt;
+        }
+        const std::uint32_t header_size = read_le32(data.data());
+        const std::size_t needed = layout_size(header_size);
+        if (needed == 0 || data.size() < needed) {
+            return std::nullopt;
+        }
+        return bmp_info_header_view(data.data(), needed);
+    }
+
+    [[nodiscard]] constexpr std::uint32_t header_size() const noexcept { return read_le32(p_); }
+    [[nodiscard]] constexpr std::size_t stored_size() const noexcept { return size_; }
+    [[nodiscard]] constexpr bool is_core() const noexcept { return header_size() == 12; }
+    [[nodiscard]] constexpr bool is_os2_v2() const noexcept { return header_size() == 64; }
+
+    // Signed for Windows headers (negative height = top-down), 16-bit for
+    // OS/2 1.x, unsigned for OS/2 2.x
+    [[nodiscard]] constexpr std::int32_t width() const noexcept {
+        if (is_core()) return static_cast<std::int16_t>(read_le16(p_ + 4));
+        return read_le32_signed(p_ + 4);
+    }
+    [[nodiscard]] constexpr std::int32_t height() const noexcept {
+        if (is_core()) return static_cast<std::int16_t>(read_le16(p_ + 6));
+        return read_le32_signed(p_ + 8);
+    }
+    [[nodiscard]] constexpr std::uint16_t bits_per_pixel() const noexcept {
+        return read_le16(p_ + (is_core() ? 10 : 14));
+    }
+
+    // Fields below exist only for headers of at least 40 bytes
+    [[nodiscard]] constexpr std::uint32_t compression() const noexcept { return read_le32(p_ + 16); }
+    [[nodiscard]] constexpr std::uint32_t colors_used() const noexcept { return read_le32(p_ + 32); }
+
+    // Masks are part of the V2+ Windows headers (alpha from V3 on)
+    [[nodiscard]] constexpr bool has_masks() const noexcept { return !is_os2_v2() && size_ >= 52; }
+    [[nodiscard]] constexpr bool has_alpha_mask() const noexcept { return !is_os2_v2() && size_ >= 56; }
+    [[nodiscard]] constexpr std::uint32_t red_mask() const noexcept { return read_le32(p_ + 40); }
+    [[nodiscard]] constexpr std::uint32_t green_mask() const noexcept { return read_le32(p_ + 44); }
+    [[nodiscard]] constexpr std::uint32_t blue_mask() const noexcept { return read_le32(p_ + 48); }
+    [[nodiscard]] constexpr std::uint32_t alpha_mask() const noexcept { return read_le32(p_ + 52); }
+
+private:
+    // Bytes of the structure read for a declared header size (0 = unknown)
+    static constexpr std::size_t layout_size(std::uint32_t header_size) noexcept {
+        if (header_size == 12 || header_size == 64) return header_size;
+        if (header_size >= 108) return 108;
+        if (header_size >= 56) return 56;
+        if (header_size >= 52) return 52;
+        if (header_size >= 40) return 40;
+        return 0;
+    }
+
+    constexpr bmp_info_header_view(const std::uint8_t* p, std::size_t size) noexcept : p_(p), size_(size) {}
+    const std::uint8_t* p_;
+    std::size_t size_;
+};
+
+// ============================================================================
+// LBM (formats::lbm::bmhd, 20 bytes, big-endian)
+// ============================================================================
+
+class bmhd_view {
+public:
+    static constexpr std::size_t SIZE = 20;
+
+    [[nodiscard]] static constexpr std::optional<bmhd_view> from(std::span<const std::uint8_t> data) noexcept {
+        if (data.size() < SIZE) {
+            return std::nullopt;
+        }
+        return bmhd_view(data.data());
+    }
+
+    [[nodiscard]] constexpr std::uint16_t width() const noexcept { return read_be16(p_); }
+    [[nodiscard]] constexpr std::uint16_t height() const noexcept { return read_be16(p_ + 2); }
+    [[nodiscard]] constexpr std::uint8_t num_planes() const noexcept { return p_[8]; }
+    [[nodiscard]] constexpr std::uint8_t masking() const noexcept { return p_[9]; }
+    [[nodiscard]] constexpr std::uint8_t compression() const noexcept { return p_[10]; }
+    [[nodiscard]] constexpr std::uint16_t transparent_color() const noexcept { return read_be16(p_ + 12); }
+
+private:
+    explicit constexpr bmhd_view(const std::uint8_t* p) noexcept : p_(p) {}
+    const std::uint8_t* p_;
+};
+
+// ============================================================================
+// MSP (formats::msp::msp_header, 32 bytes, little-endian)
+// ============================================================================
+
+class msp_header_view {
+public:
+    static constexpr std::size_t SIZE = 32;
+
+    [[nodiscard]] static constexpr std::optional<msp_header_view> from(std::span<const std::uint8_t> data) noexcept {
+        if (data.size() < SIZE) {
+            return std::nullopt;
+        }
+        return msp_header_view(data.data());
+    }
+
+    [[nodiscard]] constexpr std::uint16_t key1() const noexcept { return read_le16(p_); }
+    [[nodiscard]] constexpr std::uint16_t key2() const noexcept { return read_le16(p_ + 2); }
+    [[nodiscard]] constexpr std::uint16_t width() const noexcept { return read_le16(p_ + 4); }
+    [[nodiscard]] constexpr std::uint16_t height() const noexcept { return read_le16(p_ + 6); }
+    [[nodiscard]] constexpr std::uint16_t checksum() const noexcept { return read_le16(p_ + 24); }
+
+private:
+    explicit constexpr msp_header_view(const std::uint8_t* p) noexcept : p_(p) {}
+    const std::uint8_t* p_;
+};
+
+} // namespace onyx_image
@@ -2,12 +2,18 @@
 #include <onyx_image/codecs/png.hpp>
 #include "byte_io.hpp"
 #include "decode_helpers.hpp"
+#include "simd.hpp"
+#include "exe_resources.hpp"
+#include "frame_dedup.hpp"
 
 #include <libexe/libexe.hpp>
 
 #include <algorithm>
+#include <array>
+#include <cstdlib>
 #include <cstring>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 namespace onyx_image {
@@ -91,12 +97,53 @@ bool parse_dib_header(std::span<const std::uint8_t> data, dib_header& header) {
     return true;
 }
 
-// Get AND mask bit (1 = transparent, 0 = opaque)
-bool get_and_mask_bit(const std::uint8_t* and_mask, int width, int x, int y) {
-    std::size_t and_stride = row_stride_4byte(width, 1);
-    std::size_t byte_offset = static_cast<std::size_t>(y) * and_stride + static_cast<std::size_t>(x / 8);
-    int bit_index = 7 - (x % 8);
-    return (and_mask[byte_offset] >> bit_index) & 1;
+// Byte masks that clear the alpha of 4 RGBA pixels, indexed by a nibble of
+// AND-mask bits (MSB = leftmost pixel, 1 = transparent)
+constexpr std::array<std::array<std::uint8_t, 16>, 16> make_and_mask_table() {
+    std::array<std::array<std::uint8_t, 16>, 16> table{};
+    for (std::size_t nibble = 0; nibble < 16; ++nibble) {
+        for (std::size_t px = 0; px < 4; ++px) {
+            table[nibble][px * 4 + 0] = 0xFF;
+            table[nibble][px * 4 + 1] = 0xFF;
+            table[nibble][px * 4 + 2] = 0xFF;
+            table[nibble][px * 4 + 3] = (nibble & (8u >> px)) ? 0x00 : 0xFF;
+        }
+    }
+    return table;
+}
+
+alignas(16) constexpr auto AND_MASK_TABLE = make_and_mask_table();
+
+inline void clear_alpha_4(std::uint8_t* rgba, const std::array<std::uint8_t, 16>& keep) {
+#if defined(ONYX_IMAGE_HAS_SSE2)
+    auto* p = reinterpret_cast<__m128i*>(rgba);
+    const __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(keep.data()));
+    _mm_storeu_si128(p, _mm_and_si128(_mm_loadu_si128(p), k));
+#else
+    for (std::size_t i = 0; i < 16; ++i) {
+        rgba[i] &= keep[i];
+    }
+#endif
+}
+
+// Apply one row of the 1bpp AND mask to an RGBA row: 8 pixels per mask
+// byte, with fully opaque bytes (the common case) skipped outright
+void apply_and_mask_row(std::uint8_t* rgba, const std::uint8_t* and_row, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const std::uint8_t bits = and_row[x / 8];
+        if (bits == 0) {
+            continue;
+        }
+        std::uint8_t* p = rgba + static_cast<std::size_t>(x) * 4;
+        clear_alpha_4(p, AND_MASK_TABLE[bits >> 4]);
+        clear_alpha_4(p + 16, AND_MASK_TABLE[bits & 0x0F]);
+    }
+    for (; x < width; ++x) {
+        if ((and_row[x / 8] >> (7 - (x % 8))) & 1) {
+            rgba[static_cast<std::size_t>(x) * 4 + 3] = 0;
+        }
+    }
 }
 
 // Decoded icon image
@@ -104,6 +151,7 @@ struct decoded_icon {
     int width;
     int height;
     std::vector<std::uint8_t> pixels;  // RGBA format
+    std::uint32_t tag = 0;             // Subrect user_tag in the atlas
 };
 
 // Decode a single icon image (DIB or PNG)
@@ -127,12 +175,16 @@ bool decode_icon_image(std::span<const std::uint8_t> data, decoded_icon& icon,
         icon.pixels.resize(static_cast<std::size_t>(icon.width) * static_cast<std::size_t>(icon.height) * 4);
 
         auto src = temp.pixels();
+        const std::size_t row_size = static_cast<std::size_t>(icon.width) * 4;
         if (temp.format() == pixel_format::rgba8888) {
-            std::memcpy(icon.pixels.data(), src.data(), icon.pixels.size());
+            for (int y = 0; y < icon.height; ++y) {
+                std::memcpy(icon.pixels.data() + static_cast<std::size_t>(y) * row_size,
+                            src.data() + static_cast<std::size_t>(y) * temp.pitch(), row_size);
+            }
         } else if (temp.format() == pixel_format::rgb888) {
             for (int y = 0; y < icon.height; ++y) {
                 for (int x = 0; x < icon.width; ++x) {
-                    std::size_t src_idx = (static_cast<std::size_t>(y) * static_cast<std::size_t>(icon.width) + static_cast<std::size_t>(x)) * 3;
+                    std::size_t src_idx = static_cast<std::size_t>(y) * temp.pitch() + static_cast<std::size_t>(x) * 3;
                     std::size_t dst_idx = (static_cast<std::size_t>(y) * static_cast<std::size_t>(icon.width) + static_cast<std::size_t>(x)) * 4;
                     icon.pixels[dst_idx + 0] = src[src_idx + 0];
                     icon.pixels[dst_idx + 1] = src[src_idx + 1];
@@ -140,6 +192,22 @@ bool decode_icon_image(std::span<const std::uint8_t> data, decoded_icon& icon,
                     icon.pixels[dst_idx + 3] = 0xFF;
                 }
             }
+        } else if (is_indexed(temp.format())) {
+            // Opaque palette or gray PNG, expanded through its palette
+            const auto palette = temp.palette();
+            std::vector<std::uint8_t> indices(static_cast<std::size_t>(icon.width));
+            for (int y = 0; y < icon.height; ++y) {
+                unpack_indexed_row(temp.format(), src.data() + static_cast<std::size_t>(y) * temp.pitch(),
+                                   indices.data(), icon.width);
+                std::uint8_t* dst = icon.pixels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(icon.width) * 4;
+                for (int x = 0; x < icon.width; ++x) {
+                    const std::size_t p = static_cast<std::size_t>(indices[static_cast<std::size_t>(x)]) * 3;
+                    if (p + 2 < palette.size()) {
+                        std::memcpy(dst + x * 4, palette.data() + p, 3);
+                    }
+                    dst[x * 4 + 3] = 0xFF;
+                }
+            }
         } else {
             return false;  // Unsupported format
         }
@@ -230,6 +298,8 @@ bool decode_icon_image(std::span<const std::uint8_t> data, decoded_icon& icon,
     for (int y = 0; y < icon.height; ++y) {
         int src_y = icon.height - 1 - y;  // DIB is bottom-up
         const std::uint8_t* src_row = xor_data + static_cast<std::size_t>(src_y) * xor_stride;
+        std::uint8_t* dst_row = icon.pixels.data() +
+            static_cast<std::size_t>(y) * static_cast<std::size_t>(icon.width) * 4;
 
         for (int x = 0; x < icon.width; ++x) {
             std::size_t dst_idx = (static_cast<std::size_t>(y) * static_cast<std::size_t>(icon.width) + static_cast<std::size_t>(x)) * 4;
@@ -265,42 +335,59 @@ bool decode_icon_image(std::span<const std::uint8_t> data, decoded_icon& icon,
                 a = p[3];
             }
 
-            // Apply AND mask for non-32bpp icons
-            if (and_data && header.bit_count < 32) {
-                if (get_and_mask_bit(and_data, icon.width, x, src_y)) {
-                    a = 0;  // Transparent
-                }
-            }
-
             icon.pixels[dst_idx + 0] = r;
             icon.pixels[dst_idx + 1] = g;
             icon.pixels[dst_idx + 2] = b;
             icon.pixels[dst_idx + 3] = a;
         }
+
+        // Apply AND mask for non-32bpp icons (1 = transparent)
+        if (and_data && header.bit_count < 32) {
+            apply_and_mask_row(dst_row, and_data + static_cast<std::size_t>(src_y) * and_stride,
+                               icon.width);
+        }
     }
 
     return true;
 }
 
-// Create atlas from multiple icons
+// Create atlas from multiple icons. With dedup, icons equal to an earlier
+// one get no rows of their own; their subrects point at the first copy.
 decode_result create_icon_atlas(std::vector<decoded_icon>& icons, surface& surf,
-                                 int max_w, int max_h) {
+                                 int max_w, int max_h, bool dedup = false) {
     if (icons.empty()) {
         return decode_result::failure(decode_error::invalid_format, "No valid icons");
     }
 
-    // Calculate atlas dimensions (stack vertically) with overflow protection
+    // Rows of each icon in the atlas (stacked vertically), with overflow protection
+    std::vector<int> icon_y(icons.size());
+    frame_dedup frames;
     std::size_t atlas_width = 0;
     std::size_t atlas_height = 0;
-    for (const auto& icon : icons) {
+    // Height of every icon stacked, duplicates included, so the limit
+    // does not depend on dedup (as for DCX and PNM)
+    std::size_t stacked_height = 0;
+    for (std::size_t i = 0; i < icons.size(); ++i) {
+        const auto& icon = icons[i];
         atlas_width = std::max(atlas_width, static_cast<std::size_t>(icon.width));
-        atlas_height += static_cast<std::size_t>(icon.height);
+        stacked_height += static_cast<std::size_t>(icon.height);
 
         // Early overflow check
-        if (atlas_height > static_cast<std::size_t>(max_h)) {
+        if (stacked_height > static_cast<std::size_t>(max_h)) {
             return decode_result::failure(decode_error::dimensions_exceeded,
                 "ICO atlas height exceeds limits");
         }
+
+        const std::size_t first = dedup
+            ? frames.find_or_add(i, {icon.pixels.data(), static_cast<std::size_t>(icon.width) * 4,
+                                     icon.width, icon.height, pixel_format::rgba8888})
+            : i;
+        if (first != i) {
+            icon_y[i] = icon_y[first];
+            continue;
+        }
+        icon_y[i] = static_cast<int>(atlas_height);
+        atlas_height += static_cast<std::size_t>(icon.height);
     }
 
     // Check atlas dimensions against limits
@@ -315,29 +402,168 @@ decode_result create_icon_atlas(std::vector<decoded_icon>& icons, surface& surf,
     }
 
     // Copy icons to atlas
-    int y_offset = 0;
+    int next_y = 0;
     for (std::size_t i = 0; i < icons.size(); ++i) {
         const auto& icon = icons[i];
 
-        // Copy each row
-        for (int y = 0; y < icon.height; ++y) {
-            const std::uint8_t* src_row = icon.pixels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(icon.width) * 4;
-            surf.write_pixels(0, y_offset + y, icon.width * 4, src_row);
+        // Copy each row, once per distinct icon
+        if (icon_y[i] == next_y) {
+            for (int y = 0; y < icon.height; ++y) {
+                const std::uint8_t* src_row = icon.pixels.data() + static_cast<std::size_t>(y) * static_cast<std::size_t>(icon.width) * 4;
+                surf.write_pixels(0, icon_y[i] + y, icon.width * 4, src_row);
+            }
+            next_y += icon.height;
         }
 
         // Set subrect
         subrect sr;
-        sr.rect = {0, y_offset, icon.width, icon.height};
+        sr.rect = {0, icon_y[i], icon.width, icon.height};
         sr.kind = subrect_kind::sprite;
-        sr.user_tag = static_cast<std::uint32_t>(i);
+        sr.user_tag = icon.tag;
         surf.set_subrect(static_cast<int>(i), sr);
-
-        y_offset += icon.height;
     }
 
     return decode_result::success();
 }
 
+// Icon directory entry together with its image data
+struct ico_image_ref {
+    icon_entry info;
+    std::span<const std::uint8_t> data;
+};
+
+bool is_png_image(std::span<const std::uint8_t> data) {
+    return data.size() >= 8 && data[0] == 0x89 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G';
+}
+
+// Bits per pixel of an icon image, read from its PNG IHDR or DIB header
+int peek_icon_bit_depth(std::span<const std::uint8_t> image) {
+    if (is_png_image(image)) {
+        if (image.size() < 26) return 0;
+        const int depth = image[24];
+        switch (image[25]) {
+            case 0: return depth;      // Grayscale
+            case 2: return depth * 3;  // RGB
+            case 3: return depth;      // Palette
+            case 4: return depth * 2;  // Grayscale + alpha
+            case 6: return depth * 4;  // RGBA
+            default: return 0;
+        }
+    }
+    if (image.size() < 16) return 0;
+    return read_le16(image.data() + 14);
+}
+
+// Read the ICO/CUR directory. Entries outside the dimension limits or
+// pointing past the end of the file are dropped.
+std::vector<ico_image_ref> read_ico_directory(std::span<const std::uint8_t> data,
+                                              const ico_header& header,
+                                              int max_w, int max_h) {
+    std::vector<ico_image_ref> images;
+    images.reserve(header.count);
+
+    std::size_t dir_offset = 6;
+    for (int i = 0; i < header.count; ++i) {
+        if (dir_offset + 16 > data.size()) break;
+
+        ico_dir_entry entry;
+        parse_ico_dir_entry(data.data() + dir_offset, entry);
+        dir_offset += 16;
+
+        // Validate entry
+        int w = entry.width == 0 ? 256 : entry.width;
+        int h = entry.height == 0 ? 256 : entry.height;
+        if (w > max_w || h > max_h || entry.size == 0 || entry.offset >= data.size() ||
+            entry.size > data.size() - entry.offset) {
+            continue;
+        }
+
+        ico_image_ref ref;
+        ref.data = data.subspan(entry.offset, entry.size);
+        ref.info.index = i;
+        ref.info.width = w;
+        ref.info.height = h;
+        ref.info.png = is_png_image(ref.data);
+        ref.info.bit_depth = peek_icon_bit_depth(ref.data);
+        images.push_back(ref);
+    }
+
+    return images;
+}
+
+bool icon_selection_requested(const decode_options& options) {
+    return options.icon_size > 0 || options.icon_bit_depth > 0;
+}
+
+// Rank how well an entry matches the requested size and depth (lower is
+// better). Size dominates: an exact size wins, then the nearest larger icon
+// (downscaling looks better), then the nearest smaller one. Depth breaks
+// ties: exact, then the deepest below the request, then the shallowest above.
+std::pair<int, int> icon_match_rank(const icon_entry& entry, const decode_options& options) {
+    int size_rank = 0;
+    if (options.icon_size > 0) {
+        const int edge = std::max(entry.width, entry.height);
+        size_rank = edge >= options.icon_size ? edge - options.icon_size
+                                              : 1024 + (options.icon_size - edge);
+    }
+
+    int depth_rank = 0;
+    if (options.icon_bit_depth <= 0) {
+        depth_rank = -entry.bit_depth;
+    } else if (entry.bit_depth <= options.icon_bit_depth) {
+        depth_rank = options.icon_bit_depth - entry.bit_depth;
+    } else {
+        depth_rank = 1024 + (entry.bit_depth - options.icon_bit_depth);
+    }
+
+    return {size_rank, depth_rank};
+}
+
+// Order images from best to worst match for the requested size and depth
+template <typename Ref, typename Info>
+void sort_by_icon_match(std::vector<Ref>& refs, const decode_options& options, Info info) {
+    std::stable_sort(refs.begin(), refs.end(), [&](const Ref& a, const Ref& b) {
+        return icon_match_rank(info(a), options) < icon_match_rank(info(b), options);
+    });
+}
+
+// Describe an icon image from its PNG IHDR or DIB header alone
+icon_entry describe_icon_image(std::span<const std::uint8_t> image) {
+    icon_entry entry;
+    entry.png = is_png_image(image);
+    entry.bit_depth = peek_icon_bit_depth(image);
+    if (entry.png) {
+        if (image.size() >= 24) {
+            entry.width = static_cast<int>(read_be32(image.data() + 16));
+            entry.height = static_cast<int>(read_be32(image.data() + 20));
+        }
+    } else if (image.size() >= 12) {
+        // DIB height covers the XOR and AND masks
+        entry.width = std::abs(read_le32_signed(image.data() + 4));
+        entry.height = std::abs(read_le32_signed(image.data() + 8)) / 2;
+    }
+    return entry;
+}
+
+// Decode the best matching image for the requested size/depth into a
+// single-icon atlas tagged with its index
+template <typename Refs, typename Info, typename Image>
+decode_result decode_best_icon(Refs refs, const decode_options& options, surface& surf,
+                               int max_w, int max_h, Info info, Image image) {
+    sort_by_icon_match(refs, options, info);
+
+    std::vector<decoded_icon> icons;
+    for (const auto& ref : refs) {
+        decoded_icon icon;
+        if (decode_icon_image(image(ref), icon, max_w, max_h)) {
+            icon.tag = static_cast<std::uint32_t>(info(ref).index);
+            icons.push_back(std::move(icon));
+            break;
+        }
+    }
+    return create_icon_atlas(icons, surf, max_w, max_h);
+}
+
 }  // namespace
 
 // ============================================================================
@@ -367,44 +593,76 @@ decode_result ico_decoder::decode(std::span<const std::uint8_t> data,
     const int max_h = options.max_height > 0 ? options.max_height : 256;
 
     // Parse directory entries
-    std::vector<ico_dir_entry> entries;
-    entries.reserve(header.count);
+    auto images = read_ico_directory(data, header, max_w, max_h);
+    if (images.empty()) {
+        return decode_result::failure(decode_error::invalid_format, "No valid icon entries");
+    }
 
-    std::size_t dir_offset = 6;
-    for (int i = 0; i < header.count; ++i) {
-        if (dir_offset + 16 > data.size()) break;
+    if (icon_selection_requested(options)) {
+        // Pick from the directory alone and decode only the best match,
+        // falling back to the next candidate if it turns out to be corrupt
+        return decode_best_icon(std::move(images), options, surf, max_w, max_h,
+                                [](const ico_image_ref& ref) { return ref.info; },
+                                [](const ico_image_ref& ref) { return ref.data; });
+    }
 
-        ico_dir_entry entry;
-        parse_ico_dir_entry(data.data() + dir_offset, entry);
-        dir_offset += 16;
+    // Decode each icon
+    std::vector<decoded_icon> icons;
+    icons.reserve(images.size());
 
-        // Validate entry
-        int w = entry.width == 0 ? 256 : entry.width;
-        int h = entry.height == 0 ? 256 : entry.height;
-        if (w <= max_w && h <= max_h && entry.offset < data.size() && entry.size > 0) {
-            entries.push_back(entry);
+    // Tags are directory indices, so an entry that fails to decode does
+    // not shift the tags of those after it
+    for (const auto& image : images) {
+        decoded_icon icon;
+        if (decode_icon_image(image.data, icon, max_w, max_h)) {
+            icon.tag = static_cast<std::uint32_t>(image.info.index);
+            icons.push_back(std::move(icon));
         }
     }
 
-    if (entries.empty()) {
-        return decode_result::failure(decode_error::invalid_format, "No valid icon entries");
+    return create_icon_atlas(icons, surf, max_w, max_h, options.dedup_frames);
+}
+
+std::vector<icon_entry> ico_decoder::entries(std::span<const std::uint8_t> data) {
+    ico_header header;
+    if (!parse_ico_header(data, header)) {
+        return {};
     }
 
-    // Decode each icon
-    std::vector<decoded_icon> icons;
-    icons.reserve(entries.size());
+    std::vector<icon_entry> result;
+    for (const auto& image : read_ico_directory(data, header, DEFAULT_ICON_MAX_DIMENSION,
+                                                DEFAULT_ICON_MAX_DIMENSION)) {
+        result.push_back(image.info);
+    }
+    return result;
+}
 
-    for (const auto& entry : entries) {
-        if (entry.offset + entry.size > data.size()) continue;
+decode_result ico_decoder::decode_entry(std::span<const std::uint8_t> data,
+                                         int index,
+                                         surface& surf,
+                                         const decode_options& options) {
+    ico_header header;
+    if (!parse_ico_header(data, header)) {
+        return decode_result::failure(decode_error::invalid_format, "Invalid ICO header");
+    }
 
-        auto icon_data = data.subspan(entry.offset, entry.size);
-        decoded_icon icon;
-        if (decode_icon_image(icon_data, icon, max_w, max_h)) {
-            icons.push_back(std::move(icon));
+    const int max_w = options.max_width > 0 ? options.max_width : 256;
+    const int max_h = options.max_height > 0 ? options.max_height : 256;
+
+    for (const auto& image : read_ico_directory(data, header, max_w, max_h)) {
+        if (image.info.index != index) {
+            continue;
         }
+
+        std::vector<decoded_icon> icons(1);
+        if (!decode_icon_image(image.data, icons[0], max_w, max_h)) {
+            return decode_result::failure(decode_error::invalid_format, "Failed to decode icon image");
+        }
+        icons[0].tag = static_cast<std::uint32_t>(index);
+        return create_icon_atlas(icons, surf, max_w, max_h);
     }
 
-    return create_icon_atlas(icons, surf, max_w, max_h);
+    return decode_result::failure(decode_error::invalid_format, "No valid icon entry at index");
 }
 
 // ============================================================================
@@ -412,23 +670,22 @@ decode_result ico_decoder::decode(std::span<const std::uint8_t> data,
 // ============================================================================
 
 bool exe_icon_decoder::sniff(std::span<const std::uint8_t> data) noexcept {
-    if (data.size() < 64) return false;
-
-    // Check for MZ signature
-    if (data[0] != 'M' || data[1] != 'Z') return false;
-
-    // Check for extended header (NE/PE/LX)
-    auto format = libexe::executable_factory::detect_format(data);
-    return format == libexe::format_type::NE_WIN16 ||
-           format == libexe::format_type::PE_WIN32 ||
-           format == libexe::format_type::PE_PLUS_WIN64 ||
-           format == libexe::format_type::LX_OS2_BOUND ||
-           format == libexe::format_type::LX_OS2_RAW;
+    return detect_exe_kind(data) != exe_kind::unknown;
 }
 
 decode_result exe_icon_decoder::decode(std::span<const std::uint8_t> data,
                                         surface& surf,
                                         const decode_options& options) {
+    // NE/PE: walk the resource table directly
+    exe_icon_directory directory(data);
+    if (directory.valid()) {
+        return directory.decode(surf, options);
+    }
+
+    if (detect_exe_kind(data) != exe_kind::lx) {
+        return decode_result::failure(decode_error::invalid_format, "Unsupported executable format");
+    }
+
     // Check dimension limits
     const int max_w = options.max_width > 0 ? options.max_width : 256;
     const int max_h = options.max_height > 0 ? options.max_height : 256;
@@ -438,31 +695,10 @@ decode_result exe_icon_decoder::decode(std::span<const std::uint8_t> data,
     try {
         auto exe = libexe::executable_factory::from_memory(data);
 
-        std::visit([&icons, &options, max_w, max_h](auto& file) {
+        std::visit([&icons, max_w, max_h](auto& file) {
             using T = std::decay_t<decltype(file)>;
 
-            if constexpr (std::is_same_v<T, libexe::ne_file> || std::is_same_v<T, libexe::pe_file>) {
-                // NE/PE: Use resource_directory API
-                auto resources = file.resources();
-                if (!resources) return;
-
-                auto icon_resources = resources->resources_by_type(libexe::resource_type::RT_ICON);
-                icons.reserve(icon_resources.size());
-
-                for (std::size_t i = 0; i < icon_resources.size(); ++i) {
-                    auto icon_res = icon_resources.at(i);
-                    if (!icon_res) continue;
-
-                    auto icon_image = icon_res->as_icon();
-                    if (!icon_image) continue;
-
-                    auto dib_data = icon_image->raw_dib_data();
-                    decoded_icon icon;
-                    if (decode_icon_image(dib_data, icon, max_w, max_h)) {
-                        icons.push_back(std::move(icon));
-                    }
-                }
-            } else if constexpr (std::is_same_v<T, libexe::le_file>) {
+            if constexpr (std::is_same_v<T, libexe::le_file>) {
                 // LX/LE: Use le_resource API (OS/2 uses RT_POINTER for icons)
                 if (!file.has_resources()) return;
 
@@ -470,12 +706,13 @@ decode_result exe_icon_decoder::decode(std::span<const std::uint8_t> data,
                 auto pointer_resources = file.resources_by_type(libexe::le_resource::RT_POINTER);
                 icons.reserve(pointer_resources.size());
 
-                for (const auto& res : pointer_resources) {
-                    auto res_data = file.read_resource_data(res);
+                for (std::size_t i = 0; i < pointer_resources.size(); ++i) {
+                    auto res_data = file.read_resource_data(pointer_resources[i]);
                     if (res_data.empty()) continue;
 
                     decoded_icon icon;
                     if (decode_icon_image(res_data, icon, max_w, max_h)) {
+                        icon.tag = static_cast<std::uint32_t>(i);
                         icons.push_back(std::move(icon));
                     }
                 }
@@ -489,6 +726,131 @@ decode_result exe_icon_decoder::decode(std::span<const std::uint8_t> data,
         return decode_result::failure(decode_error::invalid_format, "No icons in executable");
     }
 
+    return create_icon_atlas(icons, surf, max_w, max_h, options.dedup_frames);
+}
+
+std::vector<icon_entry> exe_icon_decoder::entries(std::span<const std::uint8_t> data) {
+    return exe_icon_directory(data).entries();
+}
+
+decode_result exe_icon_decoder::decode_entry(std::span<const std::uint8_t> data,
+                                              int index,
+                                              surface& surf,
+                                              const decode_options& options) {
+    exe_icon_directory directory(data);
+    if (!directory.valid()) {
+        return decode_result::failure(decode_error::invalid_format, "Unsupported executable format");
+    }
+    return directory.decode_entry(index, surf, options);
+}
+
+// ============================================================================
+// EXE Icon Directory
+// ============================================================================
+
+exe_icon_directory::exe_icon_directory(std::span<const std::uint8_t> data) {
+    exe_icon_resources resources;
+    if (!read_exe_icon_resources(data, resources)) {
+        return;
+    }
+    valid_ = true;
+
+    images_.reserve(resources.icons.size());
+    entries_.reserve(resources.icons.size());
+
+    std::unordered_map<std::uint32_t, std::size_t> by_id;
+    for (const auto& res : resources.icons) {
+        by_id.emplace(res.id, images_.size());
+        images_.push_back(res.data);
+        entries_.push_back({});
+    }
+    std::vector<bool> described(images_.size(), false);
+
+    // GRPICONDIR: reserved, type, count, then 14-byte entries of width,
+    // height, color count, reserved, planes, bit count, size, RT_ICON id
+    for (const auto& group : resources.groups) {
+        if (group.data.size() < 6) continue;
+
+        const std::size_t count = std::min<std::size_t>(read_le16(group.data.data() + 4),
+                                                        (group.data.size() - 6) / 14);
+        for (std::size_t i = 0; i < count; ++i) {
+            const std::uint8_t* p = group.data.data() + 6 + i * 14;
+            auto it = by_id.find(read_le16(p + 12));
+            if (it == by_id.end() || described[it->second]) continue;
+
+            icon_entry& entry = entries_[it->second];
+            entry.width = p[0] == 0 ? 256 : p[0];
+            entry.height = p[1] == 0 ? 256 : p[1];
+            entry.bit_depth = read_le16(p + 6);
+            entry.png = is_png_image(images_[it->second]);
+            if (entry.bit_depth == 0) {
+                // Win 3.x groups often leave the bit count at zero
+                entry.bit_depth = peek_icon_bit_depth(images_[it->second]);
+            }
+            described[it->second] = true;
+        }
+    }
+
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+        if (!described[i]) {
+            entries_[i] = describe_icon_image(images_[i]);
+        }
+        entries_[i].index = static_cast<int>(i);
+    }
+}
+
+decode_result exe_icon_directory::decode(surface& surf, const decode_options& options) const {
+    const int max_w = options.max_width > 0 ? options.max_width : 256;
+    const int max_h = options.max_height > 0 ? options.max_height : 256;
+
+    if (icon_selection_requested(options)) {
+        std::vector<icon_entry> candidates;
+        for (const auto& entry : entries_) {
+            if (entry.width <= max_w && entry.height <= max_h) {
+                candidates.push_back(entry);
+            }
+        }
+        if (candidates.empty()) {
+            return decode_result::failure(decode_error::invalid_format, "No icons in executable");
+        }
+        return decode_best_icon(std::move(candidates), options, surf, max_w, max_h,
+                                [](const icon_entry& entry) { return entry; },
+                                [this](const icon_entry& entry) { return images_[static_cast<std::size_t>(entry.index)]; });
+    }
+
+    std::vector<decoded_icon> icons;
+    icons.reserve(images_.size());
+
+    // Tags are catalog indices, as in entries()
+    for (std::size_t i = 0; i < images_.size(); ++i) {
+        decoded_icon icon;
+        if (decode_icon_image(images_[i], icon, max_w, max_h)) {
+            icon.tag = static_cast<std::uint32_t>(i);
+            icons.push_back(std::move(icon));
+        }
+    }
+
+    if (icons.empty()) {
+        return decode_result::failure(decode_error::invalid_format, "No icons in executable");
+    }
+
+    return create_icon_atlas(icons, surf, max_w, max_h, options.dedup_frames);
+}
+
+decode_result exe_icon_directory::decode_entry(int index, surface& surf,
+                                               const decode_options& options) const {
+    if (index < 0 || static_cast<std::size_t>(index) >= images_.size()) {
+        return decode_result::failure(decode_error::invalid_format, "No icon at index");
+    }
+
+    const int max_w = options.max_width > 0 ? options.max_width : 256;
+    const int max_h = options.max_height > 0 ? options.max_height : 256;
+
+    std::vector<decoded_icon> icons(1);
+    if (!decode_icon_image(images_[static_cast<std::size_t>(index)], icons[0], max_w, max_h)) {
+        return decode_result::failure(decode_error::invalid_format, "Failed to decode icon image");
+    }
+    icons[0].tag = static_cast<std::uint32_t>(index);
     return create_icon_atlas(icons, surf, max_w, max_h);
 }
 
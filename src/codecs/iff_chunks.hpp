@@ -0,0 +1,80 @@
+#pragma once
+
+#include "byte_io.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace onyx_image {
+
+// Build a big-endian FourCC code from a 4-character literal (e.g. "BMHD")
+constexpr std::uint32_t iff_fourcc(const char (&id)[5]) noexcept {
+    return (static_cast<std::uint32_t>(static_cast<std::uint8_t>(id[0])) << 24) |
+           (static_cast<std::uint32_t>(static_cast<std::uint8_t>(id[1])) << 16) |
+           (static_cast<std::uint32_t>(static_cast<std::uint8_t>(id[2])) << 8) |
+           static_cast<std::uint32_t>(static_cast<std::uint8_t>(id[3]));
+}
+
+// A chunk inside an IFF FORM. The payload is a view into the input buffer.
+struct iff_chunk {
+    std::uint32_t id = 0;
+    std::span<const std::uint8_t> data;
+};
+
+// Walks the top-level chunks of an in-memory IFF FORM without copying.
+//
+// Layout: "FORM" <be32 size> <form type> { <id> <be32 size> <payload> [pad] }*
+// Chunk payloads are padded to an even length. A chunk whose declared size
+// runs past the end of the FORM (truncated file) is clamped to the bytes
+// that are actually present, and iteration stops after it.
+class iff_chunk_reader {
+public:
+    explicit iff_chunk_reader(std::span<const std::uint8_t> data) noexcept {
+        if (data.size() < 12 || read_be32(data.data()) != iff_fourcc("FORM")) {
+            return;
+        }
+
+        form_type_ = read_be32(data.data() + 8);
+
+        // FORM size counts everything after the size field (type + chunks)
+        const std::size_t form_size = read_be32(data.data() + 4);
+        const std::size_t form_end = form_size > data.size() - 8 ? data.size() : form_size + 8;
+        data_ = data.first(form_end);
+        pos_ = 12;
+        valid_ = true;
+    }
+
+    [[nodiscard]] bool valid() const noexcept { return valid_; }
+    [[nodiscard]] std::uint32_t form_type() const noexcept { return form_type_; }
+
+    // Advance to the next chunk. Returns false when no chunks are left.
+    bool next(iff_chunk& chunk) noexcept {
+        if (!valid_ || pos_ + 8 > data_.size()) {
+            return false;
+        }
+
+        chunk.id = read_be32(data_.data() + pos_);
+        const std::size_t declared = read_be32(data_.data() + pos_ + 4);
+        const std::size_t payload_start = pos_ + 8;
+        const std::size_t available = data_.size() - payload_start;
+
+        if (declared > available) {
+            chunk.data = data_.subspan(payload_start, available);
+            pos_ = data_.size();
+            return true;
+        }
+
+        chunk.data = data_.subspan(payload_start, declared);
+        pos_ = payload_start + declared + (declared & 1u);
+        return true;
+    }
+
+private:
+    std::span<const std::uint8_t> data_;
+    std::size_t pos_ = 0;
+    std::uint32_t form_type_ = 0;
+    bool valid_ = false;
+};
+
+} // namespace onyx_image
@@ -0,0 +1,524 @@
+#include "inflate.hpp"
+#include "byte_io.hpp"
+#include "deflate_join.hpp"
+#include "deflate_tables.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace onyx_image {
+
+namespace {
+
+using deflate::MAX_BITS;
+using deflate::MAX_DIST_CODES;
+using deflate::MAX_LITLEN_CODES;
+
+constexpr int LITLEN_TABLE_BITS = 11;
+constexpr int DIST_TABLE_BITS = 9;
+
+// Lookup table entry:
+//   bits 0-3    code bits consumed (0 = not in the table: long or invalid code)
+//   bits 4-5    ENTRY_SYMBOL or ENTRY_PAIR
+//   bits 8-16   symbol (first literal for a pair)
+//   bits 17-24  second literal of a pair
+constexpr std::uint32_t ENTRY_SYMBOL = 1u << 4;
+constexpr std::uint32_t ENTRY_PAIR = 2u << 4;
+constexpr std::uint32_t ENTRY_KIND_MASK = 3u << 4;
+
+constexpr std::uint32_t entry_bits(std::uint32_t e) noexcept { return e & 0xF; }
+constexpr int entry_symbol(std::uint32_t e) noexcept { return static_cast<int>((e >> 8) & 0x1FF); }
+constexpr std::uint8_t entry_second(std::uint32_t e) noexcept { return static_cast<std::uint8_t>(e >> 17); }
+
+template <int TableBits, int MaxSymbols>
+class huffman_decoder {
+public:
+    static constexpr std::uint64_t MASK = (1u << TableBits) - 1;
+
+    // Build from code lengths; false if the code is over-subscribed.
+    // Incomplete codes are accepted; their unused codes fail to decode.
+    bool build(const std::uint8_t* lengths, int n, bool pair_literals) noexcept {
+        count_.fill(0);
+        for (int i = 0; i < n; ++i) ++count_[lengths[i]];
+
+        int left = 1;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            left = (left << 1) - count_[len];
+            if (left < 0) return false;
+        }
+
+        std::array<std::uint16_t, MAX_BITS + 2> offset{};
+        std::array<std::uint32_t, MAX_BITS + 2> next_code{};
+        std::uint32_t code = 0;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            offset[len + 1] = static_cast<std::uint16_t>(offset[len] + count_[len]);
+            code = (code + (len > 1 ? count_[len - 1] : 0)) << 1;
+            next_code[len] = code;
+        }
+
+        table_.fill(0);
+        for (int sym = 0; sym < n; ++sym) {
+            const int len = lengths[sym];
+            if (len == 0) continue;
+            symbol_[offset[len]++] = static_cast<std::uint16_t>(sym);
+
+            const std::uint32_t c = next_code[len]++;
+            if (len > TableBits) continue;
+
+            // Codes are stored MSB first; the table is indexed LSB first
+            std::uint32_t reversed = 0;
+            for (int i = 0; i < len; ++i) {
+                reversed |= ((c >> i) & 1u) << (len - 1 - i);
+            }
+            const std::uint32_t e = static_cast<std::uint32_t>(len) | ENTRY_SYMBOL |
+                                    (static_cast<std::uint32_t>(sym) << 8);
+            for (std::uint32_t i = reversed; i < table_.size(); i += 1u << len) {
+                table_[i] = e;
+            }
+        }
+
+        if (pair_literals) {
+            pair_literal_entries();
+        }
+        return true;
+    }
+
+    [[nodiscard]] std::uint32_t lookup(std::uint64_t bits) const noexcept {
+        return table_[bits & MASK];
+    }
+
+    // Canonical decode for codes longer than the table; returns the symbol
+    // and sets consumed, or -1 if no code matches
+    int decode_slow(std::uint64_t bits, int& consumed) const noexcept {
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int len = 1; len <= MAX_BITS; ++len) {
+            code |= static_cast<int>(bits & 1);
+            bits >>= 1;
+            const int n = count_[len];
+            if (code - n < first) {
+                consumed = len;
+                return symbol_[index + (code - first)];
+            }
+            index += n;
+            first = (first + n) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+
+private:
+    // Where a literal's code leaves room for a second literal in the
+    // table bits, store both
+    void pair_literal_entries() noexcept {
+        const auto single = table_;
+        for (std::size_t i = 0; i < single.size(); ++i) {
+            const std::uint32_t first = single[i];
+            if ((first & ENTRY_KIND_MASK) != ENTRY_SYMBOL || entry_symbol(first) >= 256) continue;
+
+            const std::uint32_t first_bits = entry_bits(first);
+            const std::uint32_t second = single[i >> first_bits];
+            if ((second & ENTRY_KIND_MASK) != ENTRY_SYMBOL || entry_symbol(second) >= 256 ||
+                first_bits + entry_bits(second) > TableBits) {
+                continue;
+            }
+            table_[i] = (first_bits + entry_bits(second)) | ENTRY_PAIR | (first & (0x1FFu << 8)) |
+                        (static_cast<std::uint32_t>(entry_symbol(second)) << 17);
+        }
+    }
+
+    std::array<std::uint32_t, std::size_t{1} << TableBits> table_{};
+    std::array<std::uint16_t, MAX_BITS + 1> count_{};
+    std::array<std::uint16_t, MaxSymbols> symbol_{};
+};
+
+using litlen_decoder = huffman_decoder<LITLEN_TABLE_BITS, MAX_LITLEN_CODES>;
+using dist_decoder = huffman_decoder<DIST_TABLE_BITS, MAX_DIST_CODES>;
+
+struct fixed_codes {
+    litlen_decoder litlen;
+    dist_decoder dist;
+
+    fixed_codes() noexcept {
+        std::array<std::uint8_t, MAX_LITLEN_CODES> lengths{};
+        for (int i = 0; i < MAX_LITLEN_CODES; ++i) {
+            lengths[i] = deflate::fixed_litlen_length(i);
+        }
+        (void)litlen.build(lengths.data(), MAX_LITLEN_CODES, true);
+        lengths.fill(deflate::FIXED_DIST_LENGTH);
+        (void)dist.build(lengths.data(), MAX_DIST_CODES, false);
+    }
+};
+
+// Inflates into out_[0, out_size_), which also serves as the match
+// history. advance() stops once out_pos_ reaches limit_ and picks up
+// where it left off on the next call, so a caller can drain the output
+// and slide the window between calls.
+class inflater {
+public:
+    inflater(std::span<const std::uint8_t> in, std::uint8_t* out, std::size_t out_size,
+             std::size_t limit) noexcept
+        : in_(in.data()), in_size_(in.size()), out_(out), out_size_(out_size), limit_(limit) {}
+
+    // zlib header: deflate, window up to 32K, no preset dictionary
+    bool read_header() noexcept {
+        if (in_size_ < 6) return false;
+        const unsigned cmf = in_[0];
+        const unsigned flg = in_[1];
+        if ((cmf & 0x0F) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flg) % 31 != 0 || (flg & 0x20)) {
+            return false;
+        }
+        pos_ = 2;
+        return true;
+    }
+
+    // Decode until the output reaches limit_ or the stream ends
+    bool advance() noexcept {
+        while (out_pos_ < limit_) {
+            switch (block_) {
+                case block_kind::none:
+                    if (last_) {
+                        done_ = true;
+                        return true;
+                    }
+                    refill();
+                    last_ = bits(1) != 0;
+                    switch (bits(2)) {
+                        case deflate::BLOCK_STORED:
+                            if (!begin_stored()) return false;
+                            block_ = block_kind::stored;
+                            break;
+                        case deflate::BLOCK_FIXED:
+                            block_ = block_kind::fixed;
+                            break;
+                        case deflate::BLOCK_DYNAMIC:
+                            if (!read_dynamic_tables()) return false;
+                            block_ = block_kind::dynamic;
+                            break;
+                        default:
+                            return false;
+                    }
+                    break;
+                case block_kind::stored:
+                    if (!inflate_stored()) return false;
+                    break;
+                case block_kind::fixed:
+                    if (!inflate_codes(fixed().litlen, fixed().dist)) return false;
+                    break;
+                case block_kind::dynamic:
+                    if (!inflate_codes(litlen_, dist_)) return false;
+                    break;
+            }
+            if (overrun()) return false;
+        }
+        return true;
+    }
+
+    // Adler-32 trailer follows the byte-aligned end of the deflate data
+    bool check_trailer(std::uint32_t adler) noexcept {
+        const std::size_t p = align_to_byte();
+        if (p > in_size_ || in_size_ - p < 4) return false;
+        return read_be32(in_ + p) == adler;
+    }
+
+    // Move the last `keep` bytes of output to the front of the buffer
+    void slide(std::size_t keep) noexcept {
+        std::memmove(out_, out_ + out_pos_ - keep, keep);
+        out_pos_ = keep;
+    }
+
+    [[nodiscard]] bool done() const noexcept { return done_; }
+    [[nodiscard]] std::size_t out_pos() const noexcept { return out_pos_; }
+
+private:
+    enum class block_kind { none, stored, fixed, dynamic };
+
+    static const fixed_codes& fixed() noexcept {
+        static const fixed_codes codes;
+        return codes;
+    }
+
+    // Top the bit buffer up to at least 56 bits. Past the end of the input
+    // zeros are fed in; overrun() catches streams that consumed them.
+    void refill() noexcept {
+        if (pos_ + 8 <= in_size_) {
+            bitbuf_ |= read_le64(in_ + pos_) << bitcount_;
+            pos_ += (63 - bitcount_) >> 3;
+            bitcount_ |= 56;
+            return;
+        }
+        while (bitcount_ <= 56) {
+            const std::uint64_t byte = pos_ < in_size_ ? in_[pos_] : 0;
+            bitbuf_ |= byte << bitcount_;
+            ++pos_;
+            bitcount_ += 8;
+        }
+    }
+
+    std::uint32_t bits(unsigned n) noexcept {
+        const auto value = static_cast<std::uint32_t>(bitbuf_ & ((std::uint64_t{1} << n) - 1));
+        consume(n);
+        return value;
+    }
+
+    void consume(unsigned n) noexcept {
+        bitbuf_ >>= n;
+        bitcount_ -= n;
+    }
+
+    [[nodiscard]] bool overrun() const noexcept {
+        return pos_ * 8 - bitcount_ > in_size_ * 8;
+    }
+
+    // Drop to a byte boundary and return the offset of the first unread
+    // byte; the bit buffer is emptied
+    std::size_t align_to_byte() noexcept {
+        consume(bitcount_ & 7);
+        const std::size_t p = pos_ - bitcount_ / 8;
+        bitbuf_ = 0;
+        bitcount_ = 0;
+        pos_ = p;
+        return p;
+    }
+
+    template <typename Decoder>
+    int decode(const Decoder& d) noexcept {
+        const std::uint32_t e = d.lookup(bitbuf_);
+        if (entry_bits(e) != 0) {
+            consume(entry_bits(e));
+            return entry_symbol(e);
+        }
+        int consumed = 0;
+        const int sym = d.decode_slow(bitbuf_, consumed);
+        if (sym >= 0) consume(static_cast<unsigned>(consumed));
+        return sym;
+    }
+
+    bool begin_stored() noexcept {
+        std::size_t p = align_to_byte();
+        if (p > in_size_ || in_size_ - p < 4) return false;
+        const std::size_t length = read_le16(in_ + p);
+        if ((length ^ 0xFFFFu) != read_le16(in_ + p + 2)) return false;
+        p += 4;
+        if (in_size_ - p < length) return false;
+
+        stored_left_ = length;
+        pos_ = p;
+        return true;
+    }
+
+    bool inflate_stored() noexcept {
+        const std::size_t length = std::min(stored_left_, limit_ - out_pos_);
+        if (length > out_size_ - out_pos_) return false;
+
+        std::memcpy(out_ + out_pos_, in_ + pos_, length);
+        out_pos_ += length;
+        pos_ += length;
+        stored_left_ -= length;
+        if (stored_left_ == 0) block_ = block_kind::none;
+        return true;
+    }
+
+    bool read_dynamic_tables() noexcept {
+        const unsigned nlen = bits(5) + 257;
+        const unsigned ndist = bits(5) + 1;
+        const unsigned ncode = bits(4) + 4;
+        if (nlen > 286 || ndist > MAX_DIST_CODES) return false;
+
+        std::array<std::uint8_t, MAX_LITLEN_CODES + MAX_DIST_CODES> lengths{};
+        for (unsigned i = 0; i < ncode; ++i) {
+            refill();
+            lengths[deflate::CODE_LENGTH_ORDER[i]] = static_cast<std::uint8_t>(bits(3));
+        }
+        dist_decoder code_lengths;  // 19 symbols, at most 7 bits
+        if (!code_lengths.build(lengths.data(), 19, false)) return false;
+
+        lengths.fill(0);
+        for (unsigned i = 0; i < nlen + ndist;) {
+            refill();
+            const int sym = decode(code_lengths);
+            if (sym < 0) return false;
+            if (sym < 16) {
+                lengths[i++] = static_cast<std::uint8_t>(sym);
+                continue;
+            }
+
+            unsigned repeat = 0;
+            std::uint8_t value = 0;
+            if (sym == 16) {
+                if (i == 0) return false;
+                value = lengths[i - 1];
+                repeat = 3 + bits(2);
+            } else if (sym == 17) {
+                repeat = 3 + bits(3);
+            } else {
+                repeat = 11 + bits(7);
+            }
+            if (i + repeat > nlen + ndist) return false;
+            while (repeat-- > 0) lengths[i++] = value;
+        }
+
+        // A block without end-of-block could never finish
+        if (lengths[deflate::END_OF_BLOCK] == 0) return false;
+        return litlen_.build(lengths.data(), static_cast<int>(nlen), true) &&
+               dist_.build(lengths.data() + nlen, static_cast<int>(ndist), false);
+    }
+
+    bool inflate_codes(const litlen_decoder& litlen, const dist_decoder& dist) noexcept {
+        while (out_pos_ < limit_) {
+            // One refill covers a length code, its extra bits, a distance
+            // code and its extra bits (at most 48 bits)
+            refill();
+            const std::uint32_t e = litlen.lookup(bitbuf_);
+
+            if ((e & ENTRY_KIND_MASK) == ENTRY_PAIR) {
+                if (out_size_ - out_pos_ < 2) return false;
+                out_[out_pos_++] = static_cast<std::uint8_t>(entry_symbol(e));
+                out_[out_pos_++] = entry_second(e);
+                consume(entry_bits(e));
+                continue;
+            }
+
+            int sym = 0;
+            if (entry_bits(e) != 0) {
+                sym = entry_symbol(e);
+                consume(entry_bits(e));
+            } else {
+                int consumed = 0;
+                sym = litlen.decode_slow(bitbuf_, consumed);
+                if (sym < 0) return false;
+                consume(static_cast<unsigned>(consumed));
+            }
+
+            if (sym < 256) {
+                if (out_pos_ == out_size_) return false;
+                out_[out_pos_++] = static_cast<std::uint8_t>(sym);
+                continue;
+            }
+            if (sym == deflate::END_OF_BLOCK) {
+                block_ = block_kind::none;
+                return true;
+            }
+
+            sym -= deflate::FIRST_LENGTH_CODE;
+            if (sym >= 29) return false;
+            const std::size_t length = deflate::LENGTH_BASE[sym] + bits(deflate::LENGTH_EXTRA[sym]);
+
+            const int dsym = decode(dist);
+            if (dsym < 0 || dsym >= MAX_DIST_CODES) return false;
+            const std::size_t distance = deflate::DIST_BASE[dsym] + bits(deflate::DIST_EXTRA[dsym]);
+            if (distance > out_pos_ || length > out_size_ - out_pos_) return false;
+
+            copy_match(distance, length);
+        }
+        return true;
+    }
+
+    void copy_match(std::size_t distance, std::size_t length) noexcept {
+        std::uint8_t* dst = out_ + out_pos_;
+        const std::uint8_t* src = dst - distance;
+        out_pos_ += length;
+
+        if (distance >= length) {
+            std::memcpy(dst, src, length);
+        } else if (distance == 1) {
+            std::memset(dst, *src, length);
+        } else if (distance >= 8) {
+            // Overlapping, but each 8-byte step reads only finished output
+            for (std::size_t i = 0; i < length; i += 8) {
+                std::memcpy(dst + i, src + i, std::min<std::size_t>(8, length - i));
+            }
+        } else {
+            for (std::size_t i = 0; i < length; ++i) {
+                dst[i] = src[i];
+            }
+        }
+    }
+
+    const std::uint8_t* in_;
+    std::size_t in_size_;
+    std::size_t pos_ = 0;
+    std::uint64_t bitbuf_ = 0;
+    unsigned bitcount_ = 0;
+
+    std::uint8_t* out_;
+    std::size_t out_size_;
+    std::size_t out_pos_ = 0;
+    std::size_t limit_;
+
+    block_kind block_ = block_kind::none;
+    bool last_ = false;
+    bool done_ = false;
+    std::size_t stored_left_ = 0;
+
+    litlen_decoder litlen_;
+    dist_decoder dist_;
+};
+
+// Match distances reach back at most 32K
+constexpr std::size_t WINDOW_SIZE = std::size_t{1} << 15;
+
+// Longest output of one inflate_codes step (a maximal match)
+constexpr std::size_t MAX_STEP = 258;
+
+} // namespace
+
+struct zlib_reader::state {
+    // A window of history, room for as much new output, and slack for the
+    // step that crosses the limit
+    std::array<std::uint8_t, 2 * WINDOW_SIZE + MAX_STEP> buffer{};
+    inflater inflate;
+    std::size_t read_pos = 0;
+    std::uint32_t adler = 1;
+    bool ok;
+
+    explicit state(std::span<const std::uint8_t> in) noexcept
+        : inflate(in, buffer.data(), buffer.size(), 2 * WINDOW_SIZE), ok(inflate.read_header()) {}
+
+    // Decode the next batch once everything so far has been read,
+    // keeping only the window
+    bool decode_more() noexcept {
+        if (read_pos > WINDOW_SIZE) {
+            inflate.slide(WINDOW_SIZE);
+            read_pos = WINDOW_SIZE;
+        }
+        return inflate.advance();
+    }
+};
+
+zlib_reader::zlib_reader(std::span<const std::uint8_t> in)
+    : state_(std::make_unique<state>(in)) {}
+
+zlib_reader::~zlib_reader() = default;
+
+bool zlib_reader::read(std::uint8_t* out, std::size_t size) {
+    state& s = *state_;
+    while (s.ok && size > 0) {
+        if (s.read_pos == s.inflate.out_pos()) {
+            s.ok = s.decode_more() && s.inflate.out_pos() > s.read_pos;
+            continue;
+        }
+        const std::size_t n = std::min(size, s.inflate.out_pos() - s.read_pos);
+        std::memcpy(out, s.buffer.data() + s.read_pos, n);
+        s.adler = adler32(s.adler, out, n);
+        s.read_pos += n;
+        out += n;
+        size -= n;
+    }
+    return s.ok;
+}
+
+bool zlib_reader::finish() {
+    state& s = *state_;
+    if (!s.ok || s.read_pos != s.inflate.out_pos()) return false;
+    // The stream may still hold its final end-of-block code
+    if (!s.inflate.done() && (!s.decode_more() || s.inflate.out_pos() != s.read_pos ||
+                              !s.inflate.done())) {
+        return false;
+    }
+    return s.inflate.check_trailer(s.adler);
+}
+
+} // namespace onyx_image
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+
+namespace onyx_image {
+
+// Inflate a zlib stream (RFC 1950/1951) a piece at a time, for callers
+// that consume the output row by row.
+//
+// Literal/length codes are decoded through an 11-bit lookup table whose
+// entries carry two literals whenever both codes fit, with a canonical
+// bit-by-bit decode for longer codes. Only a 32K history window (plus one
+// batch of new output) is held, so memory does not grow with the stream.
+// read() returns false for malformed or truncated input; once the
+// expected output has been read, finish() checks that the stream ends
+// there and that the Adler-32 matches.
+class zlib_reader {
+public:
+    explicit zlib_reader(std::span<const std::uint8_t> in);
+    ~zlib_reader();
+
+    zlib_reader(const zlib_reader&) = delete;
+    zlib_reader& operator=(const zlib_reader&) = delete;
+
+    // Fill out with the next size bytes of output
+    [[nodiscard]] bool read(std::uint8_t* out, std::size_t size);
+
+    [[nodiscard]] bool finish();
+
+private:
+    struct state;
+    std::unique_ptr<state> state_;
+};
+
+} // namespace onyx_image
@@ -0,0 +1,1144 @@
+#include <onyx_image/codecs/jpeg.hpp>
+#include "decode_helpers.hpp"
+#include "jpeg_kernels.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace onyx_image {
+
+namespace {
+
+// ============================================================================
+// Native Decode
+// ============================================================================
+//
+// Huffman-coded 8-bit JPEG, sequential (SOF0/SOF1) or progressive (SOF2),
+// with 1, 3 (YCbCr or RGB) or 4 (CMYK/YCCK) components. Gray decodes to
+// indexed8 with a gray ramp, everything else to rgb888.
+//
+// decode_options::scale_denom picks the IDCT output size: 8x8 at full
+// scale, then 4x4, 2x2 and the DC coefficient alone at 1/8. As in libjpeg,
+// subsampled chroma uses a larger IDCT instead of upsampling where the
+// ratio allows, so 4:2:0 at 1/8 needs no upsampling at all, and
+// progressive AC scans of components decoded DC-only are skipped
+// without Huffman decoding.
+//
+// Sequential images whose first scan holds every component decode
+// straight into the sample planes; other images keep their coefficients
+// until the last scan.
+
+// Markers
+constexpr int M_SOF0 = 0xC0;   // Baseline
+constexpr int M_SOF1 = 0xC1;   // Extended sequential, Huffman
+constexpr int M_SOF2 = 0xC2;   // Progressive, Huffman
+constexpr int M_SOF3 = 0xC3;   // Lossless
+constexpr int M_DHT = 0xC4;
+constexpr int M_SOF15 = 0xCF;
+constexpr int M_DAC = 0xCC;
+constexpr int M_RST0 = 0xD0;
+constexpr int M_RST7 = 0xD7;
+constexpr int M_SOI = 0xD8;
+constexpr int M_EOI = 0xD9;
+constexpr int M_SOS = 0xDA;
+constexpr int M_DQT = 0xDB;
+constexpr int M_DRI = 0xDD;
+constexpr int M_APP0 = 0xE0;
+constexpr int M_APP14 = 0xEE;
+constexpr int M_TEM = 0x01;
+
+// next_marker() / marker_ value for the end of the input
+constexpr int END_OF_INPUT = -1;
+
+constexpr int MAX_COMPONENTS = 4;
+constexpr int HUFF_FAST_BITS = 9;
+constexpr std::size_t INPUT_CHUNK_SIZE = 64 * 1024;
+
+// Compressed input: a span, or a byte_source read in chunks
+class jpeg_input {
+public:
+    explicit jpeg_input(std::span<const std::uint8_t> data) noexcept
+        : pos_(data.data()), end_(data.data() + data.size()) {}
+
+    explicit jpeg_input(byte_source& src) : src_(&src), chunk_(INPUT_CHUNK_SIZE) {}
+
+    // Next byte, or -1 at the end of the input
+    int get() {
+        if (pos_ == end_ && !refill()) {
+            return -1;
+        }
+        return *pos_++;
+    }
+
+    bool read(std::uint8_t* dst, std::size_t size) {
+        while (size > 0) {
+            if (pos_ == end_ && !refill()) {
+                return false;
+            }
+            const std::size_t n = std::min(size, static_cast<std::size_t>(end_ - pos_));
+            std::memcpy(dst, pos_, n);
+            pos_ += n;
+            dst += n;
+            size -= n;
+        }
+        return true;
+    }
+
+private:
+    bool refill() {
+        if (!src_) {
+            return false;
+        }
+        const std::size_t n = src_->read(chunk_.data(), chunk_.size());
+        pos_ = chunk_.data();
+        end_ = pos_ + n;
+        return n > 0;
+    }
+
+    const std::uint8_t* pos_ = nullptr;
+    const std::uint8_t* end_ = nullptr;
+    byte_source* src_ = nullptr;
+    std::vector<std::uint8_t> chunk_;
+};
+
+// Canonical Huffman table: a HUFF_FAST_BITS lookup for short codes and
+// the largest code of each length for the rest
+struct huffman_table {
+    std::array<std::uint16_t, 1 << HUFF_FAST_BITS> fast{};  // (length << 8) | symbol, 0 = longer code
+    std::array<std::int32_t, 17> maxcode{};                 // -1 if there are no codes of a length
+    std::array<std::int32_t, 17> valptr{};                  // values index minus first code of a length
+    std::array<std::uint8_t, 256> values{};
+    // AC tables: run, value and total bits of a code and its magnitude
+    // bits that fit HUFF_FAST_BITS together, as
+    // (value << 8) | (run << 4) | bits; 0 = decode the slow way
+    std::array<std::int32_t, 1 << HUFF_FAST_BITS> fast_ac{};
+    bool defined = false;
+
+    // counts: codes of each length 1-16; false if the code is over-subscribed
+    bool build(const std::uint8_t* counts, const std::uint8_t* symbols, int n) noexcept {
+        fast.fill(0);
+        std::copy(symbols, symbols + n, values.begin());
+        std::int32_t code = 0;
+        int k = 0;
+        for (int len = 1; len <= 16; ++len) {
+            // Reject before filling the lookup, which the codes would overrun
+            if (code + counts[len - 1] > (1 << len)) {
+                return false;
+            }
+            valptr[len] = k - code;
+            for (int i = 0; i < counts[len - 1]; ++i, ++code, ++k) {
+                if (len <= HUFF_FAST_BITS) {
+                    const int shift = HUFF_FAST_BITS - len;
+                    const auto entry = static_cast<std::uint16_t>((len << 8) | values[k]);
+                    for (int j = 0; j < (1 << shift); ++j) {
+                        fast[static_cast<std::size_t>((code << shift) | j)] = entry;
+                    }
+                }
+            }
+            maxcode[len] = counts[len - 1] != 0 ? code - 1 : -1;
+            code <<= 1;
+        }
+
+        for (std::size_t i = 0; i < fast.size(); ++i) {
+            fast_ac[i] = 0;
+            const int len = fast[i] >> 8;
+            const int run = (fast[i] >> 4) & 0x0F;
+            const int size = fast[i] & 0x0F;
+            if (len == 0 || size == 0 || len + size > HUFF_FAST_BITS) continue;
+            int value = static_cast<int>((i << len) & ((1u << HUFF_FAST_BITS) - 1)) >> (HUFF_FAST_BITS - size);
+            if (value < (1 << (size - 1))) value -= (1 << size) - 1;
+            fast_ac[i] = (value * 256) | (run << 4) | (len + size);
+        }
+        defined = true;
+        return true;
+    }
+};
+
+struct jpeg_component {
+    int id = 0;
+    int h = 1;
+    int v = 1;
+    int tq = 0;
+    int dc_table = 0;
+    int ac_table = 0;
+    std::int16_t dc_pred = 0;
+
+    // Quantization table in natural order, latched by the first scan
+    std::array<std::uint16_t, 64> quant{};
+    bool quant_latched = false;
+
+    int blocks_w = 0;   // Blocks holding image samples
+    int blocks_h = 0;
+    int grid_w = 0;     // Blocks including the MCU padding
+    int grid_h = 0;
+    std::vector<std::int16_t> coefs;   // grid_w * grid_h blocks when buffered
+
+    int block_size = 8;   // IDCT output size
+    int up_h = 1;         // Upsampling to the output size
+    int up_v = 1;
+    int width = 0;        // Samples at block_size scale
+    int height = 0;
+    std::vector<std::uint8_t> plane;
+    std::size_t stride = 0;
+
+    [[nodiscard]] std::int16_t* block(int bx, int by) noexcept {
+        return coefs.data() + (static_cast<std::size_t>(by) * static_cast<std::size_t>(grid_w) + static_cast<std::size_t>(bx)) * 64;
+    }
+
+    [[nodiscard]] std::uint8_t* samples(int bx, int by) noexcept {
+        return plane.data() + static_cast<std::size_t>(by * block_size) * stride + static_cast<std::size_t>(bx * block_size);
+    }
+
+    void idct(const std::int16_t* coef, std::uint8_t* out) const noexcept {
+        const auto s = static_cast<std::ptrdiff_t>(stride);
+        switch (block_size) {
+            case 8: jpeg::idct_8x8(coef, quant.data(), out, s); break;
+            case 4: jpeg::idct_4x4(coef, quant.data(), out, s); break;
+            case 2: jpeg::idct_2x2(coef, quant.data(), out, s); break;
+            default: jpeg::idct_1x1(coef, quant.data(), out, s); break;
+        }
+    }
+};
+
+struct jpeg_scan {
+    std::array<int, MAX_COMPONENTS> comps{};   // Indices into the frame components
+    int count = 0;
+    int ss = 0;   // Spectral selection start/end
+    int se = 63;
+    int ah = 0;   // Successive approximation high/low bit
+    int al = 0;
+};
+
+// ----------------------------------------------------------------------------
+// Upsampling (libjpeg's "fancy" triangle filters and plain replication)
+// ----------------------------------------------------------------------------
+
+void upsample_h2v1_fancy(const std::uint8_t* in, std::uint8_t* out, int width) {
+    out[0] = in[0];
+    out[1] = static_cast<std::uint8_t>((in[0] * 3 + in[1] + 2) >> 2);
+    for (int x = 1; x < width - 1; ++x) {
+        const int cur = in[x] * 3;
+        out[x * 2] = static_cast<std::uint8_t>((cur + in[x - 1] + 1) >> 2);
+        out[x * 2 + 1] = static_cast<std::uint8_t>((cur + in[x + 1] + 2) >> 2);
+    }
+    const int last = width - 1;
+    out[last * 2] = static_cast<std::uint8_t>((in[last] * 3 + in[last - 1] + 1) >> 2);
+    out[last * 2 + 1] = in[last];
+}
+
+// near is the row above for the upper output row, the row below for the
+// lower one
+void upsample_h2v2_fancy(const std::uint8_t* in, const std::uint8_t* near, std::uint8_t* out, int width) {
+    int this_sum = in[0] * 3 + near[0];
+    int next_sum = in[1] * 3 + near[1];
+    out[0] = static_cast<std::uint8_t>((this_sum * 4 + 8) >> 4);
+    out[1] = static_cast<std::uint8_t>((this_sum * 3 + next_sum + 7) >> 4);
+    int last_sum = this_sum;
+    this_sum = next_sum;
+    for (int x = 1; x < width - 1; ++x) {
+        next_sum = in[x + 1] * 3 + near[x + 1];
+        out[x * 2] = static_cast<std::uint8_t>((this_sum * 3 + last_sum + 8) >> 4);
+        out[x * 2 + 1] = static_cast<std::uint8_t>((this_sum * 3 + next_sum + 7) >> 4);
+        last_sum = this_sum;
+        this_sum = next_sum;
+    }
+    const int last = width - 1;
+    out[last * 2] = static_cast<std::uint8_t>((this_sum * 3 + last_sum + 8) >> 4);
+    out[last * 2 + 1] = static_cast<std::uint8_t>((this_sum * 4 + 7) >> 4);
+}
+
+// As above; the lower output row rounds up
+void upsample_h1v2_fancy(const std::uint8_t* in, const std::uint8_t* near, std::uint8_t* out,
+                         int width, bool odd) {
+    const int bias = odd ? 2 : 1;
+    for (int x = 0; x < width; ++x) {
+        out[x] = static_cast<std::uint8_t>((in[x] * 3 + near[x] + bias) >> 2);
+    }
+}
+
+void upsample_replicate(const std::uint8_t* in, std::uint8_t* out, int width, int factor) {
+    for (int x = 0; x < width; ++x) {
+        std::memset(out + x * factor, in[x], static_cast<std::size_t>(factor));
+    }
+}
+
+// Adobe CMYK is stored inverted: channel * K / 255
+constexpr std::uint8_t blend_cmyk(int x, int k) noexcept {
+    const int t = x * k + 128;
+    return static_cast<std::uint8_t>((t + (t >> 8)) >> 8);
+}
+
+// ----------------------------------------------------------------------------
+// Decoder
+// ----------------------------------------------------------------------------
+
+class jpeg_reader {
+public:
+    jpeg_reader(jpeg_input& in, const decode_options& options) : in_(in), options_(options) {
+        const int denom = options.scale_denom >= 8 ? 8 : options.scale_denom >= 4 ? 4
+                        : options.scale_denom >= 2 ? 2 : 1;
+        base_block_size_ = 8 / denom;
+    }
+
+    decode_result read(surface& surf) {
+        if (in_.get() != 0xFF || in_.get() != M_SOI) {
+            return decode_result::failure(decode_error::invalid_format, "Not a valid JPEG file");
+        }
+
+        bool scanned = false;
+        for (;;) {
+            const int marker = next_marker();
+            if (marker == END_OF_INPUT) {
+                // A missing EOI is tolerated once there is image data
+                if (!scanned) {
+                    return decode_result::failure(decode_error::truncated_data, "Unexpected end of JPEG data");
+                }
+                break;
+            }
+            if (marker == M_EOI) {
+                if (!scanned) {
+                    return decode_result::failure(decode_error::invalid_format, "JPEG has no image data");
+                }
+                break;
+            }
+
+            decode_result result = decode_result::success();
+            if (marker == M_SOF0 || marker == M_SOF1 || marker == M_SOF2) {
+                result = read_frame(marker == M_SOF2, surf);
+            } else if ((marker >= M_SOF3 && marker <= M_SOF15 && marker != M_DHT) || marker == M_DAC) {
+                result = decode_result::failure(decode_error::unsupported_encoding,
+                    "Lossless, hierarchical and arithmetic-coded JPEG are not supported");
+            } else if (marker == M_DHT) {
+                result = read_huffman_tables();
+            } else if (marker == M_DQT) {
+                result = read_quant_tables();
+            } else if (marker == M_DRI) {
+                result = read_restart_interval();
+            } else if (marker == M_SOS) {
+                result = read_scan();
+                scanned = scanned || result.ok;
+            } else if (marker == M_APP0 || marker == M_APP14) {
+                result = read_app(marker);
+            } else if ((marker >= M_RST0 && marker <= M_RST7) || marker == M_TEM || marker == M_SOI) {
+                // No parameters; a stray RST or SOI is ignored
+            } else {
+                std::vector<std::uint8_t> skipped;
+                result = read_segment(skipped);
+            }
+            if (!result) {
+                return result;
+            }
+        }
+
+        return finish(surf);
+    }
+
+private:
+    // ------------------------------------------------------------------------
+    // Markers and segments
+    // ------------------------------------------------------------------------
+
+    // Next marker code, skipping anything that is not a marker
+    int next_marker() {
+        if (marker_ != 0) {
+            const int marker = marker_;
+            marker_ = 0;
+            return marker;
+        }
+        for (;;) {
+            int c = in_.get();
+            while (c >= 0 && c != 0xFF) {
+                c = in_.get();
+            }
+            while (c == 0xFF) {
+                c = in_.get();
+            }
+            if (c < 0) {
+                return END_OF_INPUT;
+            }
+            if (c != 0) {
+                return c;
+            }
+        }
+    }
+
+    decode_result read_segment(std::vector<std::uint8_t>& payload) {
+        std::uint8_t length[2];
+        if (!in_.read(length, 2)) {
+            return decode_result::failure(decode_error::truncated_data, "Truncated JPEG segment");
+        }
+        const int size = (length[0] << 8) | length[1];
+        if (size < 2) {
+            return decode_result::failure(decode_error::invalid_format, "Invalid JPEG segment length");
+        }
+        payload.resize(static_cast<std::size_t>(size - 2));
+        if (!in_.read(payload.data(), payload.size())) {
+            return decode_result::failure(decode_error::truncated_data, "Truncated JPEG segment");
+        }
+        return decode_result::success();
+    }
+
+    decode_result read_frame(bool progressive, surface& surf) {
+        if (frame_seen_) {
+            return decode_result::failure(decode_error::invalid_format, "Multiple JPEG frames");
+        }
+        std::vector<std::uint8_t> seg;
+        auto result = read_segment(seg);
+        if (!result) return result;
+
+        if (seg.size() < 6) {
+            return decode_result::failure(decode_error::invalid_format, "Invalid JPEG frame header");
+        }
+        if (seg[0] != 8) {
+            return decode_result::failure(decode_error::unsupported_bit_depth, "Only 8-bit JPEG is supported");
+        }
+        height_ = (seg[1] << 8) | seg[2];
+        width_ = (seg[3] << 8) | seg[4];
+        const int count = seg[5];
+        if (height_ == 0) {
+            return decode_result::failure(decode_error::unsupported_encoding, "JPEG height defined by DNL is not supported");
+        }
+        if (width_ == 0) {
+            return decode_result::failure(decode_error::invalid_format, "Invalid JPEG dimensions");
+        }
+        if (count != 1 && count != 3 && count != 4) {
+            return decode_result::failure(decode_error::unsupported_encoding, "Unsupported JPEG component count");
+        }
+        if (seg.size() < 6 + static_cast<std::size_t>(count) * 3) {
+            return decode_result::failure(decode_error::invalid_format, "Invalid JPEG frame header");
+        }
+
+        result = validate_dimensions(width_, height_, options_);
+        if (!result) return result;
+
+        comps_.resize(static_cast<std::size_t>(count));
+        for (int i = 0; i < count; ++i) {
+            const std::uint8_t* p = seg.data() + 6 + i * 3;
+            jpeg_component& c = comps_[static_cast<std::size_t>(i)];
+            c.id = p[0];
+            c.h = p[1] >> 4;
+            c.v = p[1] & 0x0F;
+            c.tq = p[2];
+            if (c.h < 1 || c.h > 4 || c.v < 1 || c.v > 4 || c.tq > 3) {
+                return decode_result::failure(decode_error::invalid_format, "Invalid JPEG component parameters");
+            }
+            hmax_ = std::max(hmax_, c.h);
+            vmax_ = std::max(vmax_, c.v);
+        }
+        // A lone component is never subsampled
+        if (count == 1) {
+            comps_[0].h = comps_[0].v = hmax_ = vmax_ = 1;
+        }
+
+        mcus_x_ = (width_ + 8 * hmax_ - 1) / (8 * hmax_);
+        mcus_y_ = (height_ + 8 * vmax_ - 1) / (8 * vmax_);
+        const int base = base_block_size_;
+        out_width_ = (width_ * base + 7) / 8;
+        out_height_ = (height_ * base + 7) / 8;
+
+        for (auto& c : comps_) {
+            if (hmax_ % c.h != 0 || vmax_ % c.v != 0) {
+                return decode_result::failure(decode_error::unsupported_encoding,
+                    "Fractional JPEG sampling factors are not supported");
+            }
+            const int cw = (width_ * c.h + hmax_ - 1) / hmax_;
+            const int ch = (height_ * c.v + vmax_ - 1) / vmax_;
+            c.blocks_w = (cw + 7) / 8;
+            c.blocks_h = (ch + 7) / 8;
+            c.grid_w = mcus_x_ * c.h;
+            c.grid_h = mcus_y_ * c.v;
+
+            // Scale subsampled components up in the IDCT while the
+            // remaining upsampling stays whole
+            int size = base;
+            while (size < 8 && (hmax_ * base) % (c.h * size * 2) == 0 &&
+                   (vmax_ * base) % (c.v * size * 2) == 0) {
+                size *= 2;
+            }
+            c.block_size = size;
+            c.up_h = hmax_ * base / (c.h * size);
+            c.up_v = vmax_ * base / (c.v * size);
+            c.width = static_cast<int>((static_cast<long long>(width_) * c.h * size + hmax_ * 8 - 1) / (hmax_ * 8));
+            c.height = static_cast<int>((static_cast<long long>(height_) * c.v * size + vmax_ * 8 - 1) / (vmax_ * 8));
+        }
+
+        const auto format = count == 1 ? pixel_format::indexed8 : pixel_format::rgb888;
+        if (!surf.set_size(out_width_, out_height_, format)) {
+            return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+        }
+        if (count == 1) {
+            std::uint8_t ramp[256 * 3];
+            for (int i = 0; i < 256; ++i) {
+                ramp[i * 3 + 0] = ramp[i * 3 + 1] = ramp[i * 3 + 2] = static_cast<std::uint8_t>(i);
+            }
+            surf.set_palette_size(256);
+            surf.write_palette(0, ramp);
+        }
+
+        decode_samples_ = !surf.discards_pixels();
+        if (decode_samples_) {
+            for (auto& c : comps_) {
+                c.stride = static_cast<std::size_t>(c.grid_w) * static_cast<std::size_t>(c.block_size);
+                c.plane.assign(c.stride * static_cast<std::size_t>(c.grid_h * c.block_size), 0);
+            }
+        }
+
+        progressive_ = progressive;
+        frame_seen_ = true;
+        return decode_result::success();
+    }
+
+    decode_result read_huffman_tables() {
+        std::vector<std::uint8_t> seg;
+        auto result = read_segment(seg);
+        if (!result) return result;
+
+        std::size_t pos = 0;
+        while (pos < seg.size()) {
+            if (seg.size() - pos < 17) {
+                return decode_result::failure(decode_error::invalid_format, "Invalid JPEG Huffman table");
+            }
+            const int table_class = seg[pos] >> 4;
+            const int index = seg[pos] & 0x0F;
+            const std::uint8_t* counts = seg.data() + pos + 1;
+            int total = 0;
+            for (int i = 0; i < 16; ++i) {
+                total += counts[i];
+            }
+            pos += 17;
+            if (table_class > 1 || index > 3 || total > 256 || seg.size() - pos < static_cast<std::size_t>(total)) {
+                return decode_result::failure(decode_error::invalid_format, "Invalid JPEG Huffman table");
+            }
+            huffman_table& table = table_class == 0 ? dc_tables_[static_cast<std::size_t>(index)]
+                                                    : ac_tables_[static_cast<std::size_t>(index)];
+            if (!table.build(counts, seg.data() + pos, total)) {
+                return decode_result::failure(decode_error::invalid_format, "Invalid JPEG Huffman table");
+            }
+            pos += static_cast<std::size_t>(total);
+        }
+        return decode_result::success();
+    }
+
+    decode_result read_quant_tables() {
+        std::vector<std::uint8_t> seg;
+        auto result = read_segment(seg);
+        if (!result) return result;
+
+        std::size_t pos = 0;
+        while (pos < seg.size()) {
+            const int precision = seg[pos] >> 4;
+            const int index = seg[pos] & 0x0F;
+            const std::size_t size = precision == 0 ? 64 : 128;
+            ++pos;
+            if (precision > 1 || index > 3 || seg.size() - pos < size) {
+                return decode_result::failure(decode_error::invalid_format, "Invalid JPEG quantization table");
+            }
+            auto& table = quant_tables_[static_cast<std::size_t>(index)];
+            for (int i = 0; i < 64; ++i) {
+                table[jpeg::ZIGZAG[i]] = precision == 0
+                    ? seg[pos + static_cast<std::size_t>(i)]
+                    : static_cast<std::uint16_t>((seg[pos + static_cast<std::size_t>(i) * 2] << 8) |
+                                                 seg[pos + static_cast<std::size_t>(i) * 2 + 1]);
+            }
+            quant_defined_[static_cast<std::size_t>(index)] = true;
+            pos += size;
+        }
+        return decode_result::success();
+    }
+
+    decode_result read_restart_interval() {
+        std::vector<std::uint8_t> seg;
+        auto result = read_segment(seg);
+        if (!result) return result;
+        if (seg.size() < 2) {
+            return decode_result::failure(decode_error::invalid_format, "Invalid JPEG restart interval");
+        }
+        restart_interval_ = (seg[0] << 8) | seg[1];
+        return decode_result::success();
+    }
+
+    // JFIF (APP0) and Adobe (APP14) decide how three or four components
+    // are interpreted
+    decode_result read_app(int marker) {
+        std::vector<std::uint8_t> seg;
+        auto result = read_segment(seg);
+        if (!result) return result;
+        if (marker == M_APP0 && seg.size() >= 5 && std::memcmp(seg.data(), "JFIF\0", 5) == 0) {
+            jfif_ = true;
+        } else if (marker == M_APP14 && seg.size() >= 12 && std::memcmp(seg.data(), "Adobe", 5) == 0) {
+            adobe_ = true;
+            adobe_transform_ = seg[11];
+        }
+        return decode_result::success();
+    }
+
+    // ------------------------------------------------------------------------
+    // Scans
+    // ------------------------------------------------------------------------
+
+    decode_result read_scan() {
+        if (!frame_seen_) {
+            return decode_result::failure(decode_error::invalid_format, "JPEG scan before frame header");
+        }
+        std::vector<std::uint8_t> seg;
+        auto result = read_segment(seg);
+        if (!result) return result;
+
+        jpeg_scan scan;
+        scan.count = seg.empty() ? 0 : seg[0];
+        if (scan.count < 1 || scan.count > static_cast<int>(comps_.size()) ||
+            seg.size() < 4 + static_cast<std::size_t>(scan.count) * 2) {
+            return decode_result::failure(decode_error::invalid_format, "Invalid JPEG scan header");
+        }
+        for (int i = 0; i < scan.count; ++i) {
+            const int id = seg[1 + static_cast<std::size_t>(i) * 2];
+            const int tables = seg[2 + static_cast<std::size_t>(i) * 2];
+            const auto it = std::find_if(comps_.begin(), comps_.end(), [id](const jpeg_component& c) { return c.id == id; });
+            if (it == comps_.end() || (tables >> 4) > 3 || (tables & 0x0F) > 3) {
+                return decode_result::failure(decode_error::invalid_format, "Invalid JPEG scan header");
+            }
+            it->dc_table = tables >> 4;
+            it->ac_table = tables & 0x0F;
+            scan.comps[static_cast<std::size_t>(i)] = static_cast<int>(it - comps_.begin());
+        }
+        const std::uint8_t* p = seg.data() + 1 + scan.count * 2;
+        if (progressive_) {
+            scan.ss = p[0];
+            scan.se = p[1];
+            scan.ah = p[2] >> 4;
+            scan.al = p[2] & 0x0F;
+            if (scan.ss > scan.se || scan.se > 63 || (scan.ss == 0 && scan.se != 0) ||
+                (scan.ss > 0 && scan.count != 1) || scan.al > 13) {
+                return decode_result::failure(decode_error::invalid_format, "Invalid JPEG progressive scan");
+            }
+        }
+
+        // Tables this scan needs
+        const bool needs_dc = !progressive_ || (scan.ss == 0 && scan.ah == 0);
+        const bool needs_ac = !progressive_ || scan.ss > 0;
+        for (int i = 0; i < scan.count; ++i) {
+            jpeg_component& c = comps_[static_cast<std::size_t>(scan.comps[static_cast<std::size_t>(i)])];
+            if ((needs_dc && !dc_tables_[static_cast<std::size_t>(c.dc_table)].defined) ||
+                (needs_ac && !ac_tables_[static_cast<std::size_t>(c.ac_table)].defined)) {
+                return decode_result::failure(decode_error::invalid_format, "Missing JPEG Huffman table");
+            }
+            if (!c.quant_latched) {
+                if (!quant_defined_[static_cast<std::size_t>(c.tq)]) {
+                    return decode_result::failure(decode_error::invalid_format, "Missing JPEG quantization table");
+                }
+                c.quant = quant_tables_[static_cast<std::size_t>(c.tq)];
+                c.quant_latched = true;
+            }
+        }
+
+        // The first scan decides whether coefficients are kept
+        if (!scan_seen_) {
+            scan_seen_ = true;
+            buffered_ = progressive_ || scan.count != static_cast<int>(comps_.size());
+            if (buffered_) {
+                for (auto& c : comps_) {
+                    c.coefs.assign(static_cast<std::size_t>(c.grid_w) * static_cast<std::size_t>(c.grid_h) * 64, 0);
+                }
+            }
+        }
+
+        // Nothing of an AC scan reaches a DC-only component
+        if (progressive_ && scan.ss > 0 && comps_[static_cast<std::size_t>(scan.comps[0])].block_size == 1) {
+            skip_entropy_data();
+            return decode_result::success();
+        }
+
+        return decode_entropy_data(scan);
+    }
+
+    decode_result decode_entropy_data(const jpeg_scan& scan) {
+        bits_ = 0;
+        bit_count_ = 0;
+        eobrun_ = 0;
+        for (auto& c : comps_) {
+            c.dc_pred = 0;
+        }
+
+        alignas(16) std::int16_t scratch[64];
+        int restarts_left = restart_interval_;
+
+        const auto decode_one = [&](jpeg_component& c, int bx, int by) {
+            if (!buffered_) {
+                std::memset(scratch, 0, sizeof(scratch));
+                if (!decode_sequential(c, scratch)) return false;
+                if (decode_samples_) c.idct(scratch, c.samples(bx, by));
+                return true;
+            }
+            std::int16_t* blk = c.block(bx, by);
+            if (!progressive_) return decode_sequential(c, blk);
+            if (scan.ss == 0) return scan.ah == 0 ? decode_dc_first(c, blk, scan.al) : decode_dc_refine(blk, scan.al);
+            return scan.ah == 0 ? decode_ac_first(c, blk, scan) : decode_ac_refine(c, blk, scan);
+        };
+
+        const auto restart = [&] {
+            if (restart_interval_ == 0) return;
+            if (restarts_left == 0) {
+                process_restart();
+                restarts_left = restart_interval_;
+            }
+            --restarts_left;
+        };
+
+        if (scan.count == 1) {
+            // Non-interleaved: one block per MCU, image blocks only
+            jpeg_component& c = comps_[static_cast<std::size_t>(scan.comps[0])];
+            for (int by = 0; by < c.blocks_h; ++by) {
+                for (int bx = 0; bx < c.blocks_w; ++bx) {
+                    restart();
+                    if (!decode_one(c, bx, by)) return corrupt();
+                }
+            }
+        } else {
+            for (int my = 0; my < mcus_y_; ++my) {
+                for (int mx = 0; mx < mcus_x_; ++mx) {
+                    restart();
+                    for (int i = 0; i < scan.count; ++i) {
+                        jpeg_component& c = comps_[static_cast<std::size_t>(scan.comps[static_cast<std::size_t>(i)])];
+                        for (int y = 0; y < c.v; ++y) {
+                            for (int x = 0; x < c.h; ++x) {
+                                if (!decode_one(c, mx * c.h + x, my * c.v + y)) return corrupt();
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return decode_result::success();
+    }
+
+    static decode_result corrupt() {
+        return decode_result::failure(decode_error::invalid_format, "Corrupt JPEG data");
+    }
+
+    // Resynchronize on an RSTn marker; a missing one leaves the rest of
+    // the interval to decode as zeros
+    void process_restart() {
+        bits_ = 0;
+        bit_count_ = 0;
+        if (marker_ == 0) {
+            marker_ = next_marker();
+        }
+        if (marker_ >= M_RST0 && marker_ <= M_RST7) {
+            marker_ = 0;
+        }
+        eobrun_ = 0;
+        for (auto& c : comps_) {
+            c.dc_pred = 0;
+        }
+    }
+
+    // Pass over a scan's entropy-coded data up to the next marker
+    void skip_entropy_data() {
+        for (;;) {
+            int c = in_.get();
+            if (c == 0xFF) {
+                do {
+                    c = in_.get();
+                } while (c == 0xFF);
+                if (c != 0 && (c < M_RST0 || c > M_RST7)) {
+                    marker_ = c < 0 ? END_OF_INPUT : c;
+                    return;
+                }
+            } else if (c < 0) {
+                marker_ = END_OF_INPUT;
+                return;
+            }
+        }
+    }
+
+    // ------------------------------------------------------------------------
+    // Entropy decoding
+    // ------------------------------------------------------------------------
+
+    // Top up the bit buffer. Past a marker or the end of the input the
+    // data reads as zeros.
+    void fill_bits() {
+        while (bit_count_ <= 56) {
+            int byte = 0;
+            if (marker_ == 0) {
+                byte = in_.get();
+                if (byte == 0xFF) {
+                    int next = in_.get();
+                    while (next == 0xFF) {
+                        next = in_.get();
+                    }
+                    if (next != 0) {
+                        marker_ = next < 0 ? END_OF_INPUT : next;
+                        byte = 0;
+                    }
+                } else if (byte < 0) {
+                    marker_ = END_OF_INPUT;
+                    byte = 0;
+                }
+            }
+            bits_ |= static_cast<std::uint64_t>(byte) << (56 - bit_count_);
+            bit_count_ += 8;
+        }
+    }
+
+    int get_bits(int n) {
+        if (bit_count_ < n) fill_bits();
+        const auto v = static_cast<int>(bits_ >> (64 - n));
+        bits_ <<= n;
+        bit_count_ -= n;
+        return v;
+    }
+
+    int get_bit() {
+        return get_bits(1);
+    }
+
+    // n-bit magnitude category value (1 <= n <= 16)
+    int receive_extend(int n) {
+        const int v = get_bits(n);
+        return v < (1 << (n - 1)) ? v - (1 << n) + 1 : v;
+    }
+
+    // Next symbol, or -1 for a code not in the table
+    int decode_huffman(const huffman_table& table) {
+        if (bit_count_ < 16) fill_bits();
+        const auto peek = static_cast<unsigned>(bits_ >> 48);
+        if (const unsigned entry = table.fast[peek >> (16 - HUFF_FAST_BITS)]; entry != 0) {
+            const int len = static_cast<int>(entry >> 8);
+            bits_ <<= len;
+            bit_count_ -= len;
+            return static_cast<int>(entry & 0xFF);
+        }
+        for (int len = HUFF_FAST_BITS + 1; len <= 16; ++len) {
+            const auto code = static_cast<std::int32_t>(peek >> (16 - len));
+            if (code <= table.maxcode[static_cast<std::size_t>(len)]) {
+                bits_ <<= len;
+                bit_count_ -= len;
+                return table.values[static_cast<std::size_t>(code + table.valptr[static_cast<std::size_t>(len)]) & 0xFF];
+            }
+        }
+        return -1;
+    }
+
+    bool decode_dc_diff(jpeg_component& c, int& diff) {
+        const int t = decode_huffman(dc_tables_[static_cast<std::size_t>(c.dc_table)]);
+        if (t < 0 || t > 16) return false;
+        diff = t != 0 ? receive_extend(t) : 0;
+        return true;
+    }
+
+    // Sequential block; AC values of DC-only components are decoded but
+    // not stored
+    bool decode_sequential(jpeg_component& c, std::int16_t* blk) {
+        int diff = 0;
+        if (!decode_dc_diff(c, diff)) return false;
+        c.dc_pred = static_cast<std::int16_t>(c.dc_pred + diff);
+        blk[0] = c.dc_pred;
+
+        const huffman_table& ac = ac_tables_[static_cast<std::size_t>(c.ac_table)];
+        const bool store_ac = c.block_size > 1;
+        for (int k = 1; k < 64;) {
+            if (bit_count_ < 16) fill_bits();
+            if (const std::int32_t entry = ac.fast_ac[bits_ >> (64 - HUFF_FAST_BITS)]; entry != 0) {
+                const int bits = entry & 0x0F;
+                bits_ <<= bits;
+                bit_count_ -= bits;
+                k += (entry >> 4) & 0x0F;
+                if (store_ac) blk[jpeg::ZIGZAG[k]] = static_cast<std::int16_t>(entry >> 8);
+                ++k;
+                continue;
+            }
+            const int rs = decode_huffman(ac);
+            if (rs < 0) return false;
+            const int run = rs >> 4;
+            const int size = rs & 0x0F;
+            if (size == 0) {
+                if (run != 15) break;
+                k += 16;
+                continue;
+            }
+            k += run;
+            const int value = receive_extend(size);
+            if (store_ac) blk[jpeg::ZIGZAG[k]] = static_cast<std::int16_t>(value);
+            ++k;
+        }
+        return true;
+    }
+
+    bool decode_dc_first(jpeg_component& c, std::int16_t* blk, int al) {
+        int diff = 0;
+        if (!decode_dc_diff(c, diff)) return false;
+        c.dc_pred = static_cast<std::int16_t>(c.dc_pred + diff);
+        blk[0] = static_cast<std::int16_t>(c.dc_pred * (1 << al));
+        return true;
+    }
+
+    bool decode_dc_refine(std::int16_t* blk, int al) {
+        if (get_bit()) blk[0] = static_cast<std::int16_t>(blk[0] | (1 << al));
+        return true;
+    }
+
+    bool decode_ac_first(jpeg_component& c, std::int16_t* blk, const jpeg_scan& scan) {
+        if (eobrun_ > 0) {
+            --eobrun_;
+            return true;
+        }
+        const huffman_table& ac = ac_tables_[static_cast<std::size_t>(c.ac_table)];
+        for (int k = scan.ss; k <= scan.se;) {
+            const int rs = decode_huffman(ac);
+            if (rs < 0) return false;
+            const int run = rs >> 4;
+            const int size = rs & 0x0F;
+            if (size == 0) {
+                if (run < 15) {
+                    eobrun_ = (1 << run) - 1;
+                    if (run != 0) eobrun_ += get_bits(run);
+                    break;
+                }
+                k += 16;
+                continue;
+            }
+            k += run;
+            blk[jpeg::ZIGZAG[k]] = static_cast<std::int16_t>(receive_extend(size) * (1 << scan.al));
+            ++k;
+        }
+        return true;
+    }
+
+    // Successive approximation refinement of AC coefficients (ITU T.81
+    // G.1.2.3): one correction bit per nonzero coefficient passed, new
+    // coefficients of magnitude 1 placed on zero positions
+    bool decode_ac_refine(jpeg_component& c, std::int16_t* blk, const jpeg_scan& scan) {
+        const int p1 = 1 << scan.al;
+        const int m1 = -1 * p1;
+        const auto refine = [&](std::int16_t& coef) {
+            if (get_bit() && (coef & p1) == 0) {
+                coef = static_cast<std::int16_t>(coef + (coef >= 0 ? p1 : m1));
+            }
+        };
+
+        int k = scan.ss;
+        if (eobrun_ == 0) {
+            const huffman_table& ac = ac_tables_[static_cast<std::size_t>(c.ac_table)];
+            for (; k <= scan.se; ++k) {
+                const int rs = decode_huffman(ac);
+                if (rs < 0) return false;
+                int run = rs >> 4;
+                const int size = rs & 0x0F;
+                int value = 0;
+                if (size == 0) {
+                    if (run < 15) {
+                        eobrun_ = 1 << run;
+                        if (run != 0) eobrun_ += get_bits(run);
+                        break;
+                    }
+                    // ZRL: skip 16 zero coefficients
+                } else {
+                    // size is 1 in valid data
+                    value = get_bit() ? p1 : m1;
+                }
+
+                // Advance over nonzero coefficients, refining them, until
+                // run zero coefficients have been passed
+                while (k <= scan.se) {
+                    std::int16_t& coef = blk[jpeg::ZIGZAG[k]];
+                    if (coef != 0) {
+                        refine(coef);
+                    } else {
+                        if (run == 0) break;
+                        --run;
+                    }
+                    ++k;
+                }
+                if (value != 0 && k <= scan.se) {
+                    blk[jpeg::ZIGZAG[k]] = static_cast<std::int16_t>(value);
+                }
+            }
+        }
+
+        if (eobrun_ > 0) {
+            // Rest of the band: refine the nonzero coefficients only
+            for (; k <= scan.se; ++k) {
+                std::int16_t& coef = blk[jpeg::ZIGZAG[k]];
+                if (coef != 0) refine(coef);
+            }
+            --eobrun_;
+        }
+        return true;
+    }
+
+    // ------------------------------------------------------------------------
+    // Output
+    // ------------------------------------------------------------------------
+
+    decode_result finish(surface& surf) {
+        if (!decode_samples_) {
+            return decode_result::success();
+        }
+
+        if (buffered_) {
+            for (auto& c : comps_) {
+                for (int by = 0; by < c.blocks_h; ++by) {
+                    for (int bx = 0; bx < c.blocks_w; ++bx) {
+                        c.idct(c.block(bx, by), c.samples(bx, by));
+                    }
+                }
+                c.coefs = {};
+            }
+        }
+
+        const bool fancy = base_block_size_ > 1;
+        std::array<std::vector<std::uint8_t>, MAX_COMPONENTS> upsampled;
+        for (std::size_t i = 0; i < comps_.size(); ++i) {
+            const jpeg_component& c = comps_[i];
+            upsampled[i].resize(static_cast<std::size_t>(c.width) * static_cast<std::size_t>(c.up_h) + 1);
+        }
+
+        // Row of a component at output resolution
+        const auto component_row = [&](std::size_t i, int y) -> const std::uint8_t* {
+            const jpeg_component& c = comps_[i];
+            const int in_y = y / c.up_v;
+            const std::uint8_t* row = c.plane.data() + static_cast<std::size_t>(in_y) * c.stride;
+            if (c.up_h == 1 && c.up_v == 1) {
+                return row;
+            }
+
+            std::uint8_t* out = upsampled[i].data();
+            const bool odd = (y % 2) != 0;
+            const int near_y = std::clamp(in_y + (odd ? 1 : -1), 0, c.height - 1);
+            const std::uint8_t* near = c.plane.data() + static_cast<std::size_t>(near_y) * c.stride;
+            if (c.up_h == 2 && c.up_v == 1 && fancy && c.width > 2) {
+                upsample_h2v1_fancy(row, out, c.width);
+            } else if (c.up_h == 2 && c.up_v == 2 && fancy && c.width > 2) {
+                upsample_h2v2_fancy(row, near, out, c.width);
+            } else if (c.up_h == 1 && c.up_v == 2 && fancy) {
+                upsample_h1v2_fancy(row, near, out, c.width, odd);
+            } else if (c.up_h == 1) {
+                return row;
+            } else {
+                upsample_replicate(row, out, c.width, c.up_h);
+            }
+            return out;
+        };
+
+        const auto width = static_cast<std::size_t>(out_width_);
+        if (comps_.size() == 1) {
+            for (int y = 0; y < out_height_; ++y) {
+                surf.write_pixels(0, y, out_width_, component_row(0, y));
+            }
+            return decode_result::success();
+        }
+
+        // Color transform, following libjpeg's defaults: JFIF means YCbCr,
+        // otherwise the Adobe transform flag or RGB component ids decide
+        const bool rgb = comps_.size() == 3 &&
+            (jfif_ ? false
+                   : adobe_ ? adobe_transform_ == 0
+                            : (comps_[0].id == 'R' && comps_[1].id == 'G' && comps_[2].id == 'B'));
+        const bool ycck = comps_.size() == 4 && adobe_ && adobe_transform_ == 2;
+
+        std::vector<std::uint8_t> line(width * 3);
+        for (int y = 0; y < out_height_; ++y) {
+            const std::uint8_t* c0 = component_row(0, y);
+            const std::uint8_t* c1 = component_row(1, y);
+            const std::uint8_t* c2 = component_row(2, y);
+            if (rgb) {
+                for (std::size_t x = 0; x < width; ++x) {
+                    line[x * 3 + 0] = c0[x];
+                    line[x * 3 + 1] = c1[x];
+                    line[x * 3 + 2] = c2[x];
+                }
+            } else if (comps_.size() == 3 || ycck) {
+                jpeg::ycc_to_rgb_row(c0, c1, c2, line.data(), out_width_);
+            }
+
+            if (comps_.size() == 4) {
+                const std::uint8_t* k = component_row(3, y);
+                for (std::size_t x = 0; x < width; ++x) {
+                    std::uint8_t* px = line.data() + x * 3;
+                    if (ycck) {
+                        px[0] = blend_cmyk(255 - px[0], k[x]);
+                        px[1] = blend_cmyk(255 - px[1], k[x]);
+                        px[2] = blend_cmyk(255 - px[2], k[x]);
+                    } else {
+                        px[0] = blend_cmyk(c0[x], k[x]);
+                        px[1] = blend_cmyk(c1[x], k[x]);
+                        px[2] = blend_cmyk(c2[x], k[x]);
+                    }
+                }
+            }
+            surf.write_pixels(0, y, static_cast<int>(line.size()), line.data());
+        }
+        return decode_result::success();
+    }
+
+    jpeg_input& in_;
+    const decode_options& options_;
+    int base_block_size_ = 8;
+
+    std::array<std::array<std::uint16_t, 64>, 4> quant_tables_{};
+    std::array<bool, 4> quant_defined_{};
+    std::array<huffman_table, 4> dc_tables_{};
+    std::array<huffman_table, 4> ac_tables_{};
+    int restart_interval_ = 0;
+    bool jfif_ = false;
+    bool adobe_ = false;
+    int adobe_transform_ = 1;
+
+    bool frame_seen_ = false;
+    bool progressive_ = false;
+    int width_ = 0;
+    int height_ = 0;
+    int hmax_ = 1;
+    int vmax_ = 1;
+    int mcus_x_ = 0;
+    int mcus_y_ = 0;
+    int out_width_ = 0;
+    int out_height_ = 0;
+    std::vector<jpeg_component> comps_;
+    bool decode_samples_ = false;
+    bool scan_seen_ = false;
+    bool buffered_ = false;
+
+    // Bit reader: left-aligned buffer; marker_ holds a marker met in the
+    // entropy-coded data (or END_OF_INPUT) until the parser takes it
+    std::uint64_t bits_ = 0;
+    int bit_count_ = 0;
+    int marker_ = 0;
+    int eobrun_ = 0;
+};
+
+} // namespace
+
+// ============================================================================
+// JPEG Decoder
+// ============================================================================
+
+bool jpeg_decoder::sniff(std::span<const std::uint8_t> data) noexcept {
+    // JPEG starts with FFD8FF
+    if (data.size() < 3) {
+        return false;
+    }
+    return data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+}
+
+decode_result jpeg_decoder::decode(std::span<const std::uint8_t> data,
+                                    surface& surf,
+                                    const decode_options& options) {
+    if (!sniff(data)) {
+        return decode_result::failure(decode_error::invalid_format, "Not a valid JPEG file");
+    }
+    jpeg_input input(data);
+    return jpeg_reader(input, options).read(surf);
+}
+
+decode_result jpeg_decoder::decode(byte_source& src,
+                                    surface& surf,
+                                    const decode_options& options) {
+    jpeg_input input(src);
+    return jpeg_reader(input, options).read(surf);
+}
+
+} // namespace onyx_image
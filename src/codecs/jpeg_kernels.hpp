@@ -0,0 +1,459 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+namespace onyx_image::jpeg {
+
+// Sample kernels for the JPEG decoder (jpeg.cpp).
+//
+// The IDCTs are the integer "islow" transform and the reduced 4x4, 2x2
+// and 1x1 transforms of the IJG library, and the YCbCr conversion uses
+// its fixed-point constants, so the SSE2 and scalar paths agree bit for
+// bit with each other and with libjpeg's default decode. Coefficients are
+// quantized values in natural (row-major) order; quant is the matching
+// quantization table. Output blocks are written with a row stride.
+
+// Natural position of each zigzag index. The 16 trailing entries absorb
+// run lengths that overshoot coefficient 63 in corrupt data.
+inline constexpr std::uint8_t ZIGZAG[64 + 16] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+    63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+
+namespace detail {
+
+// Scalar IDCT arithmetic is 64-bit, like libjpeg's JLONG: dequantized
+// coefficients of corrupt data overflow 32-bit products and sums. (The
+// SSE2 path works on 16-bit dequantized values in 32-bit lanes, which
+// wrap rather than overflow.)
+using jlong = std::int64_t;
+
+constexpr int CONST_BITS = 13;
+constexpr int PASS1_BITS = 2;
+
+constexpr std::int32_t FIX_0_211164243 = 1730;
+constexpr std::int32_t FIX_0_298631336 = 2446;
+constexpr std::int32_t FIX_0_390180644 = 3196;
+constexpr std::int32_t FIX_0_509795579 = 4176;
+constexpr std::int32_t FIX_0_541196100 = 4433;
+constexpr std::int32_t FIX_0_601344887 = 4926;
+constexpr std::int32_t FIX_0_720959822 = 5906;
+constexpr std::int32_t FIX_0_765366865 = 6270;
+constexpr std::int32_t FIX_0_850430095 = 6967;
+constexpr std::int32_t FIX_0_899976223 = 7373;
+constexpr std::int32_t FIX_1_061594337 = 8697;
+constexpr std::int32_t FIX_1_175875602 = 9633;
+constexpr std::int32_t FIX_1_272758580 = 10426;
+constexpr std::int32_t FIX_1_451774981 = 11893;
+constexpr std::int32_t FIX_1_501321110 = 12299;
+constexpr std::int32_t FIX_1_847759065 = 15137;
+constexpr std::int32_t FIX_1_961570560 = 16069;
+constexpr std::int32_t FIX_2_053119869 = 16819;
+constexpr std::int32_t FIX_2_172734803 = 17799;
+constexpr std::int32_t FIX_2_562915447 = 20995;
+constexpr std::int32_t FIX_3_072711026 = 25172;
+constexpr std::int32_t FIX_3_624509785 = 29692;
+
+constexpr jlong descale(jlong x, int n) noexcept {
+    return (x + (jlong{1} << (n - 1))) >> n;
+}
+
+constexpr std::uint8_t clamp_sample(jlong v) noexcept {
+    return static_cast<std::uint8_t>(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+// One 8-point islow pass: in[i * step] -> out[i * step], descaled by shift
+inline void idct8_1d(const jlong* in, jlong* out, int step, int shift) noexcept {
+    // Even part
+    jlong z2 = in[2 * step];
+    jlong z3 = in[6 * step];
+    jlong z1 = (z2 + z3) * FIX_0_541196100;
+    jlong tmp2 = z1 + z3 * -FIX_1_847759065;
+    jlong tmp3 = z1 + z2 * FIX_0_765366865;
+
+    jlong tmp0 = (in[0] + in[4 * step]) * (1 << CONST_BITS);
+    jlong tmp1 = (in[0] - in[4 * step]) * (1 << CONST_BITS);
+
+    const jlong tmp10 = tmp0 + tmp3;
+    const jlong tmp13 = tmp0 - tmp3;
+    const jlong tmp11 = tmp1 + tmp2;
+    const jlong tmp12 = tmp1 - tmp2;
+
+    // Odd part
+    tmp0 = in[7 * step];
+    tmp1 = in[5 * step];
+    tmp2 = in[3 * step];
+    tmp3 = in[1 * step];
+
+    z1 = tmp0 + tmp3;
+    z2 = tmp1 + tmp2;
+    z3 = tmp0 + tmp2;
+    jlong z4 = tmp1 + tmp3;
+    const jlong z5 = (z3 + z4) * FIX_1_175875602;
+
+    tmp0 *= FIX_0_298631336;
+    tmp1 *= FIX_2_053119869;
+    tmp2 *= FIX_3_072711026;
+    tmp3 *= FIX_1_501321110;
+    z1 *= -FIX_0_899976223;
+    z2 *= -FIX_2_562915447;
+    z3 = z3 * -FIX_1_961570560 + z5;
+    z4 = z4 * -FIX_0_390180644 + z5;
+
+    tmp0 += z1 + z3;
+    tmp1 += z2 + z4;
+    tmp2 += z2 + z3;
+    tmp3 += z1 + z4;
+
+    out[0] = descale(tmp10 + tmp3, shift);
+    out[7 * step] = descale(tmp10 - tmp3, shift);
+    out[1 * step] = descale(tmp11 + tmp2, shift);
+    out[6 * step] = descale(tmp11 - tmp2, shift);
+    out[2 * step] = descale(tmp12 + tmp1, shift);
+    out[5 * step] = descale(tmp12 - tmp1, shift);
+    out[3 * step] = descale(tmp13 + tmp0, shift);
+    out[4 * step] = descale(tmp13 - tmp0, shift);
+}
+
+inline void idct_8x8_scalar(const std::int16_t* coef, const std::uint16_t* quant,
+                            std::uint8_t* out, std::ptrdiff_t stride) noexcept {
+    jlong in[64];
+    jlong ws[64];
+    for (int i = 0; i < 64; ++i) {
+        in[i] = static_cast<jlong>(coef[i]) * quant[i];
+    }
+
+    // Columns, with the common all-zero AC column short cut
+    for (int col = 0; col < 8; ++col) {
+        const jlong* c = in + col;
+        if ((c[8] | c[16] | c[24] | c[32] | c[40] | c[48] | c[56]) == 0) {
+            const jlong dc = c[0] * (1 << PASS1_BITS);
+            for (int row = 0; row < 8; ++row) ws[row * 8 + col] = dc;
+            continue;
+        }
+        idct8_1d(c, ws + col, 8, CONST_BITS - PASS1_BITS);
+    }
+
+    // Rows
+    jlong row_out[8];
+    for (int row = 0; row < 8; ++row) {
+        idct8_1d(ws + row * 8, row_out, 1, CONST_BITS + PASS1_BITS + 3);
+        std::uint8_t* dst = out + row * stride;
+        for (int i = 0; i < 8; ++i) dst[i] = clamp_sample(row_out[i] + 128);
+    }
+}
+
+#ifdef ONYX_IMAGE_HAS_SSE2
+// 32-bit results for 8 lanes
+struct i32x8 {
+    __m128i lo;
+    __m128i hi;
+};
+
+inline i32x8 operator+(i32x8 a, i32x8 b) noexcept {
+    return {_mm_add_epi32(a.lo, b.lo), _mm_add_epi32(a.hi, b.hi)};
+}
+
+inline i32x8 operator-(i32x8 a, i32x8 b) noexcept {
+    return {_mm_sub_epi32(a.lo, b.lo), _mm_sub_epi32(a.hi, b.hi)};
+}
+
+// a * c0 + b * c1 per lane, exact in 32 bits
+inline i32x8 madd_pair(__m128i a, __m128i b, std::int16_t c0, std::int16_t c1) noexcept {
+    const __m128i c = _mm_set_epi16(c1, c0, c1, c0, c1, c0, c1, c0);
+    return {_mm_madd_epi16(_mm_unpacklo_epi16(a, b), c), _mm_madd_epi16(_mm_unpackhi_epi16(a, b), c)};
+}
+
+// a << CONST_BITS, sign-extended to 32 bits
+inline i32x8 widen_scaled(__m128i a) noexcept {
+    const __m128i zero = _mm_setzero_si128();
+    return {_mm_srai_epi32(_mm_unpacklo_epi16(zero, a), 16 - CONST_BITS),
+            _mm_srai_epi32(_mm_unpackhi_epi16(zero, a), 16 - CONST_BITS)};
+}
+
+template <int Shift>
+inline __m128i descale_pack(i32x8 x) noexcept {
+    const __m128i round = _mm_set1_epi32(1 << (Shift - 1));
+    return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(x.lo, round), Shift),
+                           _mm_srai_epi32(_mm_add_epi32(x.hi, round), Shift));
+}
+
+// idct8_1d across eight lanes. The products are regrouped into pairs so
+// each one is a single madd; the sums are the same integers.
+template <int Shift>
+inline void idct8_pass(__m128i r[8]) noexcept {
+    const auto c = [](std::int32_t v) { return static_cast<std::int16_t>(v); };
+
+    // Even part
+    const i32x8 tmp3 = madd_pair(r[2], r[6], c(FIX_0_541196100 + FIX_0_765366865), c(FIX_0_541196100));
+    const i32x8 tmp2 = madd_pair(r[2], r[6], c(FIX_0_541196100), c(FIX_0_541196100 - FIX_1_847759065));
+    const i32x8 tmp0 = widen_scaled(_mm_add_epi16(r[0], r[4]));
+    const i32x8 tmp1 = widen_scaled(_mm_sub_epi16(r[0], r[4]));
+
+    const i32x8 tmp10 = tmp0 + tmp3;
+    const i32x8 tmp13 = tmp0 - tmp3;
+    const i32x8 tmp11 = tmp1 + tmp2;
+    const i32x8 tmp12 = tmp1 - tmp2;
+
+    // Odd part
+    const __m128i z3 = _mm_add_epi16(r[7], r[3]);
+    const __m128i z4 = _mm_add_epi16(r[5], r[1]);
+    const i32x8 z3s = madd_pair(z3, z4, c(FIX_1_175875602 - FIX_1_961570560), c(FIX_1_175875602));
+    const i32x8 z4s = madd_pair(z3, z4, c(FIX_1_175875602), c(FIX_1_175875602 - FIX_0_390180644));
+
+    const i32x8 o0 = madd_pair(r[7], r[1], c(FIX_0_298631336 - FIX_0_899976223), c(-FIX_0_899976223)) + z3s;
+    const i32x8 o3 = madd_pair(r[7], r[1], c(-FIX_0_899976223), c(FIX_1_501321110 - FIX_0_899976223)) + z4s;
+    const i32x8 o1 = madd_pair(r[5], r[3], c(FIX_2_053119869 - FIX_2_562915447), c(-FIX_2_562915447)) + z4s;
+    const i32x8 o2 = madd_pair(r[5], r[3], c(-FIX_2_562915447), c(FIX_3_072711026 - FIX_2_562915447)) + z3s;
+
+    r[0] = descale_pack<Shift>(tmp10 + o3);
+    r[7] = descale_pack<Shift>(tmp10 - o3);
+    r[1] = descale_pack<Shift>(tmp11 + o2);
+    r[6] = descale_pack<Shift>(tmp11 - o2);
+    r[2] = descale_pack<Shift>(tmp12 + o1);
+    r[5] = descale_pack<Shift>(tmp12 - o1);
+    r[3] = descale_pack<Shift>(tmp13 + o0);
+    r[4] = descale_pack<Shift>(tmp13 - o0);
+}
+
+inline void transpose_8x8(__m128i r[8]) noexcept {
+    const __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    const __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    const __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    const __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    const __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    const __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    const __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    const __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+
+    const __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    const __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    const __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    const __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    const __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    const __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    const __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    const __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+#endif
+
+} // namespace detail
+
+// Full 8x8 inverse DCT
+inline void idct_8x8(const std::int16_t* coef, const std::uint16_t* quant,
+                     std::uint8_t* out, std::ptrdiff_t stride) noexcept {
+#ifdef ONYX_IMAGE_HAS_SSE2
+    using namespace detail;
+    __m128i r[8];
+    for (int i = 0; i < 8; ++i) {
+        r[i] = _mm_mullo_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(coef + i * 8)),
+                               _mm_loadu_si128(reinterpret_cast<const __m128i*>(quant + i * 8)));
+    }
+    idct8_pass<CONST_BITS - PASS1_BITS>(r);
+    transpose_8x8(r);
+    idct8_pass<CONST_BITS + PASS1_BITS + 3>(r);
+    transpose_8x8(r);
+
+    // Signed saturation to [-128, 127], then recentred
+    const __m128i center = _mm_set1_epi8(static_cast<char>(0x80));
+    for (int i = 0; i < 8; i += 2) {
+        const __m128i rows = _mm_add_epi8(_mm_packs_epi16(r[i], r[i + 1]), center);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i * stride), rows);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + (i + 1) * stride), _mm_srli_si128(rows, 8));
+    }
+#else
+    detail::idct_8x8_scalar(coef, quant, out, stride);
+#endif
+}
+
+// 4x4 output from an 8x8 block (1/2 scale)
+inline void idct_4x4(const std::int16_t* coef, const std::uint16_t* quant,
+                     std::uint8_t* out, std::ptrdiff_t stride) noexcept {
+    using namespace detail;
+    const auto deq = [&](int i) { return static_cast<jlong>(coef[i]) * quant[i]; };
+
+    jlong ws[8 * 4];
+    for (int col = 0; col < 8; ++col) {
+        // Column 4 does not contribute to the second pass
+        if (col == 4) continue;
+        if ((coef[8 + col] | coef[16 + col] | coef[24 + col] |
+             coef[40 + col] | coef[48 + col] | coef[56 + col]) == 0) {
+            const jlong dc = deq(col) * (1 << PASS1_BITS);
+            for (int row = 0; row < 4; ++row) ws[row * 8 + col] = dc;
+            continue;
+        }
+
+        const jlong tmp0 = deq(col) * (1 << (CONST_BITS + 1));
+        const jlong tmp2 = deq(16 + col) * FIX_1_847759065 + deq(48 + col) * -FIX_0_765366865;
+        const jlong tmp10 = tmp0 + tmp2;
+        const jlong tmp12 = tmp0 - tmp2;
+
+        const jlong z1 = deq(56 + col);
+        const jlong z2 = deq(40 + col);
+        const jlong z3 = deq(24 + col);
+        const jlong z4 = deq(8 + col);
+        const jlong odd0 = z1 * -FIX_0_211164243 + z2 * FIX_1_451774981 +
+                           z3 * -FIX_2_172734803 + z4 * FIX_1_061594337;
+        const jlong odd2 = z1 * -FIX_0_509795579 + z2 * -FIX_0_601344887 +
+                           z3 * FIX_0_899976223 + z4 * FIX_2_562915447;
+
+        constexpr int shift = CONST_BITS - PASS1_BITS + 1;
+        ws[0 * 8 + col] = descale(tmp10 + odd2, shift);
+        ws[3 * 8 + col] = descale(tmp10 - odd2, shift);
+        ws[1 * 8 + col] = descale(tmp12 + odd0, shift);
+        ws[2 * 8 + col] = descale(tmp12 - odd0, shift);
+    }
+
+    for (int row = 0; row < 4; ++row) {
+        const jlong* w = ws + row * 8;
+        std::uint8_t* dst = out + row * stride;
+
+        const jlong tmp0 = w[0] * (1 << (CONST_BITS + 1));
+        const jlong tmp2 = w[2] * FIX_1_847759065 + w[6] * -FIX_0_765366865;
+        const jlong tmp10 = tmp0 + tmp2;
+        const jlong tmp12 = tmp0 - tmp2;
+
+        const jlong odd0 = w[7] * -FIX_0_211164243 + w[5] * FIX_1_451774981 +
+                           w[3] * -FIX_2_172734803 + w[1] * FIX_1_061594337;
+        const jlong odd2 = w[7] * -FIX_0_509795579 + w[5] * -FIX_0_601344887 +
+                           w[3] * FIX_0_899976223 + w[1] * FIX_2_562915447;
+
+        constexpr int shift = CONST_BITS + PASS1_BITS + 3 + 1;
+        dst[0] = clamp_sample(descale(tmp10 + odd2, shift) + 128);
+        dst[3] = clamp_sample(descale(tmp10 - odd2, shift) + 128);
+        dst[1] = clamp_sample(descale(tmp12 + odd0, shift) + 128);
+        dst[2] = clamp_sample(descale(tmp12 - odd0, shift) + 128);
+    }
+}
+
+// 2x2 output from an 8x8 block (1/4 scale)
+inline void idct_2x2(const std::int16_t* coef, const std::uint16_t* quant,
+                     std::uint8_t* out, std::ptrdiff_t stride) noexcept {
+    using namespace detail;
+    const auto deq = [&](int i) { return static_cast<jlong>(coef[i]) * quant[i]; };
+
+    // Only columns 0, 1, 3, 5 and 7 contribute to the second pass
+    jlong ws[8 * 2] = {};
+    for (const int col : {0, 1, 3, 5, 7}) {
+        if ((coef[8 + col] | coef[24 + col] | coef[40 + col] | coef[56 + col]) == 0) {
+            ws[col] = ws[8 + col] = deq(col) * (1 << PASS1_BITS);
+            continue;
+        }
+        const jlong tmp10 = deq(col) * (1 << (CONST_BITS + 2));
+        const jlong tmp0 = deq(56 + col) * -FIX_0_720959822 + deq(40 + col) * FIX_0_850430095 +
+                           deq(24 + col) * -FIX_1_272758580 + deq(8 + col) * FIX_3_624509785;
+        constexpr int shift = CONST_BITS - PASS1_BITS + 2;
+        ws[col] = descale(tmp10 + tmp0, shift);
+        ws[8 + col] = descale(tmp10 - tmp0, shift);
+    }
+
+    for (int row = 0; row < 2; ++row) {
+        const jlong* w = ws + row * 8;
+        const jlong tmp10 = w[0] * (1 << (CONST_BITS + 2));
+        const jlong tmp0 = w[7] * -FIX_0_720959822 + w[5] * FIX_0_850430095 +
+                           w[3] * -FIX_1_272758580 + w[1] * FIX_3_624509785;
+        constexpr int shift = CONST_BITS + PASS1_BITS + 3 + 2;
+        out[row * stride + 0] = clamp_sample(descale(tmp10 + tmp0, shift) + 128);
+        out[row * stride + 1] = clamp_sample(descale(tmp10 - tmp0, shift) + 128);
+    }
+}
+
+// DC only (1/8 scale)
+inline void idct_1x1(const std::int16_t* coef, const std::uint16_t* quant,
+                     std::uint8_t* out, std::ptrdiff_t) noexcept {
+    out[0] = detail::clamp_sample(detail::descale(static_cast<detail::jlong>(coef[0]) * quant[0], 3) + 128);
+}
+
+// ============================================================================
+// Color Conversion
+// ============================================================================
+
+// YCbCr -> interleaved RGB with the IJG 16-bit fixed-point constants:
+//   R = Y + 1.40200 Cr,  G = Y - 0.34414 Cb - 0.71414 Cr,  B = Y + 1.77200 Cb
+// The SSE2 path splits each constant into a whole part and a 16-bit
+// fraction so every product is a single exact madd.
+inline void ycc_to_rgb_row(const std::uint8_t* y, const std::uint8_t* cb, const std::uint8_t* cr,
+                           std::uint8_t* dst, int width) noexcept {
+    int x = 0;
+#ifdef ONYX_IMAGE_HAS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i center = _mm_set1_epi16(128);
+    const __m128i half = _mm_set1_epi32(1 << 15);
+    // Fractions as (k, 0) or (k_cb, k_cr) madd pairs
+    const __m128i r_frac = _mm_set1_epi32(26345);
+    const __m128i b_frac = _mm_set1_epi32(0xFFFF & -14942);
+    const __m128i g_frac = _mm_set1_epi32(static_cast<int>((18734u << 16) | (0xFFFFu & -22554)));
+    // (a * k_a + b * k_b + 32768) >> 16 for 8 lanes
+    const auto frac = [&](__m128i a, __m128i b, __m128i k) {
+        const __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), k), half);
+        const __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), k), half);
+        return _mm_packs_epi32(_mm_srai_epi32(lo, 16), _mm_srai_epi32(hi, 16));
+    };
+
+    alignas(16) std::uint8_t rgbx[16 * 4];
+    for (; x + 16 <= width; x += 16) {
+        const __m128i y8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + x));
+        const __m128i cb8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cb + x));
+        const __m128i cr8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cr + x));
+        __m128i rgb[3][2];
+        for (int h = 0; h < 2; ++h) {
+            const __m128i yy = h == 0 ? _mm_unpacklo_epi8(y8, zero) : _mm_unpackhi_epi8(y8, zero);
+            const __m128i cbv = _mm_sub_epi16(h == 0 ? _mm_unpacklo_epi8(cb8, zero) : _mm_unpackhi_epi8(cb8, zero), center);
+            const __m128i crv = _mm_sub_epi16(h == 0 ? _mm_unpacklo_epi8(cr8, zero) : _mm_unpackhi_epi8(cr8, zero), center);
+
+            rgb[0][h] = _mm_add_epi16(_mm_add_epi16(yy, crv), frac(crv, zero, r_frac));
+            rgb[1][h] = _mm_add_epi16(_mm_sub_epi16(yy, crv), frac(cbv, crv, g_frac));
+            rgb[2][h] = _mm_add_epi16(_mm_add_epi16(yy, _mm_add_epi16(cbv, cbv)), frac(cbv, zero, b_frac));
+        }
+        const __m128i r = _mm_packus_epi16(rgb[0][0], rgb[0][1]);
+        const __m128i g = _mm_packus_epi16(rgb[1][0], rgb[1][1]);
+        const __m128i b = _mm_packus_epi16(rgb[2][0], rgb[2][1]);
+        const __m128i rg_lo = _mm_unpacklo_epi8(r, g);
+        const __m128i rg_hi = _mm_unpackhi_epi8(r, g);
+        const __m128i bx_lo = _mm_unpacklo_epi8(b, zero);
+        const __m128i bx_hi = _mm_unpackhi_epi8(b, zero);
+        auto* out = reinterpret_cast<__m128i*>(rgbx);
+        _mm_store_si128(out + 0, _mm_unpacklo_epi16(rg_lo, bx_lo));
+        _mm_store_si128(out + 1, _mm_unpackhi_epi16(rg_lo, bx_lo));
+        _mm_store_si128(out + 2, _mm_unpacklo_epi16(rg_hi, bx_hi));
+        _mm_store_si128(out + 3, _mm_unpackhi_epi16(rg_hi, bx_hi));
+
+        // Overlapping 4-byte stores drop the X bytes; the last pixel is
+        // copied exactly so nothing past the chunk is written
+        std::uint8_t* d = dst + x * 3;
+        for (int i = 0; i < 15; ++i) {
+            std::memcpy(d + i * 3, rgbx + i * 4, 4);
+        }
+        std::memcpy(d + 45, rgbx + 60, 3);
+    }
+#endif
+    for (; x < width; ++x) {
+        const std::int32_t cbv = cb[x] - 128;
+        const std::int32_t crv = cr[x] - 128;
+        const std::int32_t r_off = (91881 * crv + (1 << 15)) >> 16;
+        const std::int32_t g_off = (-22554 * cbv - 46802 * crv + (1 << 15)) >> 16;
+        const std::int32_t b_off = (116130 * cbv + (1 << 15)) >> 16;
+        dst[x * 3 + 0] = detail::clamp_sample(y[x] + r_off);
+        dst[x * 3 + 1] = detail::clamp_sample(y[x] + g_off);
+        dst[x * 3 + 2] = detail::clamp_sample(y[x] + b_off);
+    }
+}
+
+} // namespace onyx_image::jpeg
@@ -1,12 +1,11 @@
 #include <onyx_image/codecs/lbm.hpp>
-#include <formats/lbm/lbm.hh>
-
-#include <iff/parser.hh>
+#include "header_views.hpp"
+#include "iff_chunks.hpp"
 
 #include <algorithm>
 #include <cstring>
-#include <sstream>
-#include <string>
+#include <optional>
+#include <span>
 #include <vector>
 
 namespace onyx_image {
@@ -27,12 +26,20 @@ constexpr std::uint8_t COMPRESSION_BYTERUN = 1;
 // IFF signature: "FORM"
 constexpr std::uint8_t IFF_SIGNATURE[] = {'F', 'O', 'R', 'M'};
 
+constexpr std::uint32_t FORM_ILBM = iff_fourcc("ILBM");
+constexpr std::uint32_t FORM_PBM = iff_fourcc("PBM ");
+constexpr std::uint32_t CHUNK_BMHD = iff_fourcc("BMHD");
+constexpr std::uint32_t CHUNK_CMAP = iff_fourcc("CMAP");
+constexpr std::uint32_t CHUNK_CAMG = iff_fourcc("CAMG");
+constexpr std::uint32_t CHUNK_BODY = iff_fourcc("BODY");
+
+// Parsed chunk payloads. CMAP and BODY are views into the input data.
 struct lbm_parse_result {
-    std::optional<iff::fourcc> form_type;
-    std::optional<formats::lbm::bmhd> bmhd;
-    std::optional<formats::lbm::viewport_mode> camg;
-    std::vector<formats::lbm::color_register> cmap;
-    std::vector<std::uint8_t> body;
+    std::uint32_t form_type = 0;
+    std::optional<bmhd_view> bmhd;
+    std::optional<std::uint32_t> camg;
+    std::span<const std::uint8_t> cmap;  // RGB triplets
+    std::span<const std::uint8_t> body;
 };
 
 bool unpack_byterun1(const std::uint8_t*& src, const std::uint8_t* end,
@@ -63,6 +70,8 @@ bool unpack_byterun1(const std::uint8_t*& src, const std::uint8_t* end,
     return true;
 }
 
+// Consume ByteRun1 packets for `expected` output bytes without storing them.
+// Fails exactly where unpack_byterun1 would.
 bool advance_byterun1(const std::uint8_t*& src, const std::uint8_t* end,
                       std::size_t expected) {
     std::size_t produced = 0;
@@ -90,38 +99,64 @@ bool advance_byterun1(const std::uint8_t*& src, const std::uint8_t* end,
     return true;
 }
 
-bool can_decode_byterun(std::span<const std::uint8_t> body,
-                        std::size_t bytes_per_row,
-                        std::size_t stored_planes,
-                        std::size_t height,
-                        bool per_plane_rows) {
-    const std::uint8_t* src = body.data();
-    const std::uint8_t* end = body.data() + body.size();
-    for (std::size_t y = 0; y < height; ++y) {
-        if (per_plane_rows) {
-            for (std::size_t p = 0; p < stored_planes; ++p) {
-                if (!advance_byterun1(src, end, bytes_per_row)) {
-                    return false;
-                }
-            }
-        } else {
-            const std::size_t row_bytes = bytes_per_row * stored_planes;
-            if (!advance_byterun1(src, end, row_bytes)) {
-                return false;
+// Unpack ByteRun1 packets for one ILBM row of `planes` plane rows, each
+// `plane_bytes` long. `dst` may be null to consume the packets only.
+// Fails exactly where unpack_byterun1 would for the whole row, and clears
+// `aligned` if a packet crosses the end of a plane row, which encoders
+// that compress each plane row separately never write. If `starts` is
+// given, it receives where the packets of each plane row begin, or null
+// for a plane row that begins inside a packet.
+bool unpack_plane_rows(const std::uint8_t*& src, const std::uint8_t* end, std::uint8_t* dst,
+                       std::size_t plane_bytes, std::size_t planes, bool& aligned,
+                       const std::uint8_t** starts = nullptr) {
+    const std::size_t expected = plane_bytes * planes;
+    std::size_t produced = 0;
+    aligned = true;
+    if (starts) {
+        std::fill_n(starts, planes, nullptr);
+    }
+    while (produced < expected) {
+        if (src >= end) {
+            return false;
+        }
+        if (starts && produced % plane_bytes == 0 && !starts[produced / plane_bytes]) {
+            starts[produced / plane_bytes] = src;
+        }
+        const auto control = static_cast<std::int8_t>(*src++);
+        if (control == -128) {
+            continue;
+        }
+        const bool literal = control >= 0;
+        const std::size_t count = literal ? static_cast<std::size_t>(control) + 1
+                                          : static_cast<std::size_t>(-control) + 1;
+        if ((literal ? src + count > end : src >= end) || produced + count > expected) {
+            return false;
+        }
+        if (produced % plane_bytes + count > plane_bytes) {
+            aligned = false;
+        }
+        if (dst) {
+            if (literal) {
+                std::memcpy(dst + produced, src, count);
+            } else {
+                std::fill_n(dst + produced, count, *src);
             }
         }
+        src += literal ? count : 1;
+        produced += count;
     }
     return true;
 }
 
-std::vector<std::uint8_t> build_palette_rgb(const std::vector<formats::lbm::color_register>& cmap,
+std::vector<std::uint8_t> build_palette_rgb(std::span<const std::uint8_t> cmap,
                                              std::size_t count) {
+    const std::size_t cmap_colors = cmap.size() / 3;
     std::vector<std::uint8_t> palette(count * 3);
     for (std::size_t i = 0; i < count; ++i) {
-        if (i < cmap.size()) {
-            palette[i * 3 + 0] = cmap[i].red;
-            palette[i * 3 + 1] = cmap[i].green;
-            palette[i * 3 + 2] = cmap[i].blue;
+        if (i < cmap_colors) {
+            palette[i * 3 + 0] = cmap[i * 3 + 0];
+            palette[i * 3 + 1] = cmap[i * 3 + 1];
+            palette[i * 3 + 2] = cmap[i * 3 + 2];
         } else {
             const std::uint8_t value = count > 1
                 ? static_cast<std::uint8_t>((i * 255u) / (count - 1))
@@ -134,7 +169,7 @@ std::vector<std::uint8_t> build_palette_rgb(const std::vector<formats::lbm::colo
     return palette;
 }
 
-std::vector<std::uint8_t> build_ehb_palette(const std::vector<formats::lbm::color_register>& cmap) {
+std::vector<std::uint8_t> build_ehb_palette(std::span<const std::uint8_t> cmap) {
     auto base = build_palette_rgb(cmap, 32);
     std::vector<std::uint8_t> palette(64 * 3);
 
@@ -150,67 +185,35 @@ std::vector<std::uint8_t> build_ehb_palette(const std::vector<formats::lbm::colo
     return palette;
 }
 
+// Walk the FORM and collect views of the chunks we need. Nothing is copied
+// except the small fixed-size BMHD/CAMG structures.
 lbm_parse_result parse_lbm_chunks(std::span<const std::uint8_t> data) {
     lbm_parse_result result{};
 
-    std::string buffer(reinterpret_cast<const char*>(data.data()), data.size());
-    std::istringstream stream(buffer, std::ios::binary);
-
-    using iff::operator""_4cc;
-    constexpr auto form_ilbm = "ILBM"_4cc;
-    constexpr auto form_pbm = "PBM "_4cc;
-    constexpr auto chunk_bmhd = "BMHD"_4cc;
-    constexpr auto chunk_cmap = "CMAP"_4cc;
-    constexpr auto chunk_camg = "CAMG"_4cc;
-    constexpr auto chunk_body = "BODY"_4cc;
-
-    iff::handler_registry handlers;
-    auto handle_chunk = [&](const iff::chunk_event& event) {
-        if (event.type != iff::chunk_event_type::begin || !event.reader) {
-            return;
-        }
-
-        if (event.current_form) {
-            result.form_type = event.current_form;
-        }
-
-        const auto bytes = event.reader->read_all();
-        const auto* ptr = reinterpret_cast<const std::uint8_t*>(bytes.data());
-        const auto* end = ptr + bytes.size();
-
-        try {
-            if (event.header.id == chunk_bmhd) {
-                result.bmhd = formats::lbm::bmhd::read(ptr, end);
-            } else if (event.header.id == chunk_cmap) {
-                const std::size_t count = bytes.size() / 3;
-                result.cmap.reserve(result.cmap.size() + count);
-                for (std::size_t i = 0; i < count; ++i) {
-                    result.cmap.push_back(formats::lbm::color_register::read(ptr, end));
-                }
-            } else if (event.header.id == chunk_camg) {
-                result.camg = formats::lbm::viewport_mode::read(ptr, end);
-            } else if (event.header.id == chunk_body) {
-                result.body.resize(bytes.size());
-                if (!bytes.empty()) {
-                    std::memcpy(result.body.data(), bytes.data(), bytes.size());
-                }
+    iff_chunk_reader reader(data);
+    if (!reader.valid()) {
+        return result;
+    }
+    result.form_type = reader.form_type();
+
+    iff_chunk chunk;
+    while (reader.next(chunk)) {
+        // Chunks too short for their structure are ignored
+        if (chunk.id == CHUNK_BMHD) {
+            if (auto header = bmhd_view::from(chunk.data)) {
+                result.bmhd = header;
+            }
+        } else if (chunk.id == CHUNK_CMAP) {
+            result.cmap = chunk.data.first(chunk.data.size() - chunk.data.size() % 3);
+        } else if (chunk.id == CHUNK_CAMG) {
+            if (chunk.data.size() >= 4) {
+                result.camg = read_be32(chunk.data.data());
             }
-        } catch (...) {
-            // Ignore parse errors for individual chunks
+        } else if (chunk.id == CHUNK_BODY) {
+            result.body = chunk.data;
         }
-    };
-
-    auto register_chunks = [&](iff::fourcc form) {
-        handlers.on_chunk_in_form(form, chunk_bmhd, handle_chunk);
-        handlers.on_chunk_in_form(form, chunk_cmap, handle_chunk);
-        handlers.on_chunk_in_form(form, chunk_camg, handle_chunk);
-        handlers.on_chunk_in_form(form, chunk_body, handle_chunk);
-    };
-
-    register_chunks(form_ilbm);
-    register_chunks(form_pbm);
+    }
 
-    iff::parse(stream, handlers);
     return result;
 }
 
@@ -243,12 +246,7 @@ decode_result lbm_decoder::decode(std::span<const std::uint8_t> data,
         return decode_result::failure(decode_error::invalid_format, "Not a valid IFF ILBM/PBM file");
     }
 
-    lbm_parse_result parsed;
-    try {
-        parsed = parse_lbm_chunks(data);
-    } catch (const std::exception& e) {
-        return decode_result::failure(decode_error::invalid_format, e.what());
-    }
+    const lbm_parse_result parsed = parse_lbm_chunks(data);
 
     if (!parsed.bmhd) {
         return decode_result::failure(decode_error::invalid_format, "Missing BMHD chunk");
@@ -258,29 +256,28 @@ decode_result lbm_decoder::decode(std::span<const std::uint8_t> data,
         return decode_result::failure(decode_error::invalid_format, "Missing BODY chunk");
     }
 
-    using iff::operator""_4cc;
-    const bool is_pbm = parsed.form_type && *parsed.form_type == "PBM "_4cc;
-    const bool is_ilbm = parsed.form_type && *parsed.form_type == "ILBM"_4cc;
+    const bool is_pbm = parsed.form_type == FORM_PBM;
+    const bool is_ilbm = parsed.form_type == FORM_ILBM;
 
-    if (parsed.form_type && !is_ilbm && !is_pbm) {
+    if (!is_ilbm && !is_pbm) {
         return decode_result::failure(decode_error::invalid_format, "Unknown IFF form type");
     }
 
     const auto& header = *parsed.bmhd;
-    if (header.num_planes == 0) {
+    if (header.num_planes() == 0) {
         return decode_result::failure(decode_error::invalid_format, "Invalid number of planes");
     }
 
-    const std::uint8_t masking_value = static_cast<std::uint8_t>(header.masking);
-    const std::uint8_t compression_value = static_cast<std::uint8_t>(header.compression);
+    const std::uint8_t masking_value = header.masking();
+    const std::uint8_t compression_value = header.compression();
     const bool has_mask = masking_value == MASKING_HAS_MASK;
 
     if (compression_value != COMPRESSION_NONE && compression_value != COMPRESSION_BYTERUN) {
         return decode_result::failure(decode_error::unsupported_encoding, "Unsupported compression");
     }
 
-    const int width = header.width;
-    const int height = header.height;
+    const int width = header.width();
+    const int height = header.height();
 
     // Check dimension limits
     const int max_w = options.max_width > 0 ? options.max_width : 16384;
@@ -302,13 +299,30 @@ decode_result lbm_decoder::decode(std::span<const std::uint8_t> data,
             return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
         }
 
-        const std::size_t palette_size = static_cast<std::size_t>(1u) << header.num_planes;
+        const std::size_t palette_size = static_cast<std::size_t>(1u) << header.num_planes();
         auto palette = build_palette_rgb(parsed.cmap, palette_size);
         surf.set_palette_size(static_cast<int>(palette_size));
         surf.write_palette(0, palette);
 
         const std::uint8_t* src = parsed.body.data();
         const std::uint8_t* src_end = parsed.body.data() + parsed.body.size();
+
+        if (surf.discards_pixels()) {
+            // Verification: walk the BODY without expanding it
+            if (compression_value == COMPRESSION_NONE) {
+                if (bytes_per_row * static_cast<std::size_t>(height) > parsed.body.size()) {
+                    return decode_result::failure(decode_error::truncated_data, "Unexpected end of data");
+                }
+                return decode_result::success();
+            }
+            for (int y = 0; y < height; ++y) {
+                if (!advance_byterun1(src, src_end, bytes_per_row)) {
+                    return decode_result::failure(decode_error::truncated_data, "ByteRun1 decode failed");
+                }
+            }
+            return decode_result::success();
+        }
+
         std::vector<std::uint8_t> row_buffer(bytes_per_row);
 
         for (int y = 0; y < height; ++y) {
@@ -330,29 +344,36 @@ decode_result lbm_decoder::decode(std::span<const std::uint8_t> data,
     }
 
     // Handle ILBM (planar) format
-    const bool is_truecolor = header.num_planes == 24 || header.num_planes == 32;
-    if (header.num_planes > 8 && !is_truecolor) {
+    const bool is_truecolor = header.num_planes() == 24 || header.num_planes() == 32;
+    if (header.num_planes() > 8 && !is_truecolor) {
         return decode_result::failure(decode_error::unsupported_bit_depth, "Unsupported bit depth");
     }
 
     const std::size_t bytes_per_row = ((static_cast<std::size_t>(width) + 15) / 16) * 2;
-    const std::size_t plane_count = header.num_planes;
-    const std::size_t stored_planes = plane_count + (has_mask ? 1 : 0);
-
-    const bool byterun_per_plane = compression_value == COMPRESSION_BYTERUN &&
-                                   can_decode_byterun(parsed.body, bytes_per_row, stored_planes,
-                                                     static_cast<std::size_t>(height), true);
-    const bool byterun_per_scanline = compression_value == COMPRESSION_BYTERUN &&
-                                      can_decode_byterun(parsed.body, bytes_per_row, stored_planes,
-                                                        static_cast<std::size_t>(height), false);
-
-    if (compression_value == COMPRESSION_BYTERUN && !byterun_per_plane && !byterun_per_scanline) {
-        return decode_result::failure(decode_error::truncated_data, "Invalid ByteRun1 data");
+    const std::size_t plane_count = header.num_planes();
+    // Some writers declare a mask plane in BMHD without storing it. An
+    // uncompressed BODY shows this by its size. A ByteRun1 BODY too short
+    // for the rows with the mask, even with every scanline a single chain
+    // of replicate runs, cannot hold it; otherwise the layout is checked
+    // while the BODY is decoded, starting with the mask. Packets may cross
+    // plane rows, so the bound is per scanline, not per plane row.
+    const bool byterun = compression_value == COMPRESSION_BYTERUN;
+    bool mask_stored = has_mask;
+    if (has_mask) {
+        if (byterun) {
+            const std::size_t scanline_bytes = bytes_per_row * (plane_count + 1);
+            const std::size_t min_scanline = ((scanline_bytes + 127) / 128) * 2;
+            mask_stored = parsed.body.size() / min_scanline >= static_cast<std::size_t>(height);
+        } else {
+            const std::size_t plane_rows = static_cast<std::size_t>(height) * (plane_count + 1);
+            const std::size_t rows = parsed.body.size() / bytes_per_row;
+            mask_stored = rows >= plane_rows || rows < static_cast<std::size_t>(height) * plane_count;
+        }
     }
 
     // Determine output format
-    const bool ham_mode = parsed.camg && ((parsed.camg->mode & CAMG_HAM_FLAG) != 0);
-    const bool ehb_mode = parsed.camg && ((parsed.camg->mode & CAMG_EHB_FLAG) != 0);
+    const bool ham_mode = parsed.camg && ((*parsed.camg & CAMG_HAM_FLAG) != 0);
+    const bool ehb_mode = parsed.camg && ((*parsed.camg & CAMG_EHB_FLAG) != 0);
 
     pixel_format out_format;
     if (is_truecolor || ham_mode) {
@@ -379,12 +400,17 @@ decode_result lbm_decoder::decode(std::span<const std::uint8_t> data,
         surf.write_palette(0, palette);
     }
 
-    // Decode planar data
-    std::vector<std::uint8_t> row_data(bytes_per_row * stored_planes);
-    std::vector<std::uint8_t> indices(static_cast<std::size_t>(width));
     const std::uint8_t* src = parsed.body.data();
     const std::uint8_t* src_end = parsed.body.data() + parsed.body.size();
 
+    // Verification walks the BODY without expanding or converting it
+    const bool verify_only = surf.discards_pixels();
+
+    // Decode planar data
+    std::vector<std::uint8_t> row_data(verify_only ? 0 : bytes_per_row * (plane_count + (has_mask ? 1 : 0)));
+    std::uint8_t* const row = verify_only ? nullptr : row_data.data();
+    std::vector<std::uint8_t> indices(static_cast<std::size_t>(width));
+
     // For HAM mode, we need the base palette
     std::vector<std::uint8_t> ham_base_palette;
     if (ham_mode) {
@@ -392,29 +418,8 @@ decode_result lbm_decoder::decode(std::span<const std::uint8_t> data,
         ham_base_palette = build_palette_rgb(parsed.cmap, base_size);
     }
 
-    for (int y = 0; y < height; ++y) {
-        // Decode row data
-        if (compression_value == COMPRESSION_BYTERUN && !byterun_per_plane && byterun_per_scanline) {
-            if (!unpack_byterun1(src, src_end, row_data.data(), bytes_per_row * stored_planes)) {
-                return decode_result::failure(decode_error::truncated_data, "ByteRun1 decode failed");
-            }
-        } else {
-            for (std::size_t p = 0; p < stored_planes; ++p) {
-                std::uint8_t* dst = row_data.data() + p * bytes_per_row;
-                if (compression_value == COMPRESSION_NONE) {
-                    if (src + bytes_per_row > src_end) {
-                        return decode_result::failure(decode_error::truncated_data, "Unexpected end of data");
-                    }
-                    std::memcpy(dst, src, bytes_per_row);
-                    src += bytes_per_row;
-                } else {
-                    if (!unpack_byterun1(src, src_end, dst, bytes_per_row)) {
-                        return decode_result::failure(decode_error::truncated_data, "ByteRun1 decode failed");
-                    }
-                }
-            }
-        }
-
+    // Convert the planar row in row_data to pixels of surface row y
+    const auto emit_row = [&](int y) {
         // Convert planar to chunky
         if (is_truecolor) {
             std::vector<std::uint8_t> rgba_row(static_cast<std::size_t>(width) * 4);
@@ -441,7 +446,7 @@ decode_result lbm_decoder::decode(std::span<const std::uint8_t> data,
                     a = read_channel(24);
                 }
 
-                if (has_mask) {
+                if (mask_stored) {
                     const std::uint8_t mask_byte = row_data[plane_count * bytes_per_row + byte_index];
                     if ((mask_byte & bit_mask) == 0) {
                         a = 0;
@@ -521,6 +526,90 @@ decode_result lbm_decoder::decode(std::span<const std::uint8_t> data,
                 surf.write_pixels(0, y, width, indices.data());
             }
         }
+    };
+
+    // Whether a ByteRun1 BODY may still turn out to lack the declared mask,
+    // and while it may, where the packets of each plane row so far begin
+    bool layout_open = mask_stored && byterun;
+    std::vector<const std::uint8_t*> plane_starts;
+
+    for (int y = 0; y < height; ++y) {
+        const std::size_t stored_planes = plane_count + (mask_stored ? 1 : 0);
+
+        // Decode row data
+        if (byterun) {
+            // Packets never cross a row, so decoding all stored planes of the
+            // row as one run accepts both per-plane and per-scanline encoders.
+            const std::uint8_t* row_start = src;
+            bool aligned = true;
+            const std::size_t recorded = plane_starts.size();
+            if (layout_open) {
+                plane_starts.resize(recorded + stored_planes);
+            }
+            bool decoded = unpack_plane_rows(src, src_end, row, bytes_per_row, stored_planes, aligned,
+                                             layout_open ? plane_starts.data() + recorded : nullptr);
+            if (layout_open && y == 0 && !(decoded && aligned)) {
+                // The first row is decoded speculatively with the mask. If it
+                // overruns, or splits a packet across plane rows, use the
+                // layout without the mask when that fits the row better.
+                layout_open = false;
+                plane_starts.clear();
+                const std::uint8_t* retry = row_start;
+                bool retry_aligned = true;
+                if (unpack_plane_rows(retry, src_end, row, bytes_per_row, plane_count, retry_aligned) &&
+                    (retry_aligned || !decoded)) {
+                    mask_stored = false;
+                    src = retry;
+                    decoded = true;
+                } else if (decoded) {
+                    src = row_start;
+                    unpack_plane_rows(src, src_end, row, bytes_per_row, stored_planes, aligned);
+                }
+            } else if (layout_open && !decoded) {
+                // The first row fit both layouts, but the BODY runs short with
+                // the mask: it is not stored, and the rows so far hold the
+                // wrong planes. Re-split the plane rows already consumed into
+                // rows without the mask, then carry on from the first plane
+                // row that does not complete one.
+                layout_open = false;
+                mask_stored = false;
+                plane_starts.resize(recorded);
+                const std::size_t whole_rows = std::min(recorded / plane_count,
+                                                        static_cast<std::size_t>(height));
+                for (std::size_t r = 0; r < whole_rows; ++r) {
+                    const std::uint8_t* rows_src = plane_starts[r * plane_count];
+                    if (!rows_src ||
+                        !unpack_plane_rows(rows_src, src_end, row, bytes_per_row, plane_count, aligned)) {
+                        return decode_result::failure(decode_error::truncated_data, "ByteRun1 decode failed");
+                    }
+                    if (!verify_only) {
+                        emit_row(static_cast<int>(r));
+                    }
+                }
+                src = whole_rows * plane_count < recorded ? plane_starts[whole_rows * plane_count] : row_start;
+                if (!src) {
+                    return decode_result::failure(decode_error::truncated_data, "ByteRun1 decode failed");
+                }
+                y = static_cast<int>(whole_rows) - 1;
+                continue;
+            }
+            if (!decoded) {
+                return decode_result::failure(decode_error::truncated_data, "ByteRun1 decode failed");
+            }
+        } else {
+            const std::size_t row_bytes = bytes_per_row * stored_planes;
+            if (static_cast<std::size_t>(src_end - src) < row_bytes) {
+                return decode_result::failure(decode_error::truncated_data, "Unexpected end of data");
+            }
+            if (row) {
+                std::memcpy(row, src, row_bytes);
+            }
+            src += row_bytes;
+        }
+
+        if (!verify_only) {
+            emit_row(y);
+        }
     }
 
     return decode_result::success();
@@ -1,7 +1,10 @@
 #include <onyx_image/codecs/msp.hpp>
 #include <formats/msp/msp.hh>
 #include "byte_io.hpp"
+#include "decode_helpers.hpp"
+#include "header_views.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <vector>
 
@@ -80,77 +83,87 @@ decode_result msp_decoder::decode(std::span<const std::uint8_t> data,
             "MSP file too small: expected at least 32 bytes");
     }
 
-    // Parse header using DataScript
-    formats::msp::msp_header hdr;
-    try {
-        const auto* ptr = data.data();
-        const auto* end = ptr + data.size();
-        hdr = formats::msp::msp_header::read(ptr, end);
-    } catch (const std::exception& e) {
-        return decode_result::failure(decode_error::invalid_format, e.what());
+    auto hdr = msp_header_view::from(data);
+    if (!hdr) {
+        return decode_result::failure(decode_error::truncated_data,
+            "MSP file too small: expected at least 32 bytes");
     }
 
     // Validate magic
-    bool is_v1 = (hdr.key1 == formats::msp::MSP_V1_KEY1 && hdr.key2 == formats::msp::MSP_V1_KEY2);
-    bool is_v2 = (hdr.key1 == formats::msp::MSP_V2_KEY1 && hdr.key2 == formats::msp::MSP_V2_KEY2);
+    bool is_v1 = (hdr->key1() == formats::msp::MSP_V1_KEY1 && hdr->key2() == formats::msp::MSP_V1_KEY2);
+    bool is_v2 = (hdr->key1() == formats::msp::MSP_V2_KEY1 && hdr->key2() == formats::msp::MSP_V2_KEY2);
 
     if (!is_v1 && !is_v2) {
         return decode_result::failure(decode_error::invalid_format, "Invalid MSP magic");
     }
 
-    if (hdr.width == 0 || hdr.height == 0) {
+    const std::uint16_t width = hdr->width();
+    const std::uint16_t height = hdr->height();
+
+    if (width == 0 || height == 0) {
         return decode_result::failure(decode_error::invalid_format, "Invalid MSP dimensions");
     }
 
     // Check dimension limits
     const int max_w = options.max_width > 0 ? options.max_width : 16384;
     const int max_h = options.max_height > 0 ? options.max_height : 16384;
-    if (hdr.width > max_w || hdr.height > max_h) {
+    if (width > max_w || height > max_h) {
         return decode_result::failure(decode_error::dimensions_exceeded,
             "MSP image dimensions exceed limits");
     }
 
     // Bytes per row (1 bit per pixel, rounded up to byte boundary)
-    std::size_t row_bytes = (static_cast<std::size_t>(hdr.width) + 7) / 8;
+    std::size_t row_bytes = (static_cast<std::size_t>(width) + 7) / 8;
 
-    // Allocate surface as indexed8 with 2-color palette
-    if (!surf.set_size(hdr.width, hdr.height, pixel_format::indexed8)) {
+    // Allocate surface as indexed8, or indexed1 holding the stored bits
+    const pixel_format out_format = indexed_format_for(1, options);
+    const bool packed = out_format == pixel_format::indexed1;
+    if (!surf.set_size(width, height, out_format)) {
         return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
     }
 
-    // Set up black/white palette (index 0 = black, index 1 = white)
+    // Set up black/white palette (index 0 = black, index 1 = white). Packed
+    // rows keep MSP's 1 = black bits, so the palette is inverted instead.
     std::array<std::uint8_t, 6> palette = {
         0, 0, 0,       // Index 0: black (RGB)
         255, 255, 255  // Index 1: white (RGB)
     };
+    if (packed) {
+        std::swap_ranges(palette.begin(), palette.begin() + 3, palette.begin() + 3);
+    }
     surf.set_palette_size(2);
     surf.write_palette(0, std::span<const std::uint8_t>(palette.data(), palette.size()));
 
     std::vector<std::uint8_t> row_buffer(row_bytes);
-    std::vector<std::uint8_t> pixel_row(hdr.width);
+    std::vector<std::uint8_t> pixel_row(packed ? 0 : width);
+
+    // Emit one stored row
+    auto write_row = [&](std::size_t y, const std::uint8_t* row) {
+        if (packed) {
+            write_packed_row(surf, static_cast<int>(y), row, width, out_format);
+            return;
+        }
+        unpack_1bit_to_indexed8(row, row_bytes, pixel_row.data(), width);
+        surf.write_pixels(0, static_cast<int>(y), static_cast<int>(width), pixel_row.data());
+    };
 
     if (is_v1) {
         // Version 1: uncompressed data immediately follows header
         std::size_t offset = formats::msp::MSP_HEADER_SIZE;
-        std::size_t expected_size = formats::msp::MSP_HEADER_SIZE + row_bytes * hdr.height;
+        std::size_t expected_size = formats::msp::MSP_HEADER_SIZE + row_bytes * height;
 
         if (data.size() < expected_size) {
             return decode_result::failure(decode_error::truncated_data,
                 "MSP data truncated: incomplete image data");
         }
 
-        for (std::size_t y = 0; y < hdr.height; ++y) {
-            std::memcpy(row_buffer.data(), data.data() + offset, row_bytes);
+        for (std::size_t y = 0; y < height; ++y) {
+            write_row(y, data.data() + offset);
             offset += row_bytes;
-
-            unpack_1bit_to_indexed8(row_buffer.data(), row_bytes,
-                                     pixel_row.data(), hdr.width);
-            surf.write_pixels(0, static_cast<int>(y),
-                              static_cast<int>(hdr.width), pixel_row.data());
         }
     } else {
         // Version 2: RLE compressed with scan-line map after header
-        std::size_t scanline_map_size = static_cast<std::size_t>(hdr.height) * 2;
+        std::size_t scanline_map_size = static_cast<std::size_t>(height) * 2;
         std::size_t scanline_map_offset = formats::msp::MSP_HEADER_SIZE;
 
         if (data.size() < formats::msp::MSP_HEADER_SIZE + scanline_map_size) {
@@ -159,14 +172,14 @@ decode_result msp_decoder::decode(std::span<const std::uint8_t> data,
         }
 
         // Read scan-line map
-        std::vector<std::uint16_t> scanline_sizes(hdr.height);
-        for (std::size_t i = 0; i < hdr.height; ++i) {
+        std::vector<std::uint16_t> scanline_sizes(height);
+        for (std::size_t i = 0; i < height; ++i) {
             scanline_sizes[i] = read_le16(data.data() + scanline_map_offset + i * 2);
         }
 
         // Decode each scan line
         std::size_t data_offset = formats::msp::MSP_HEADER_SIZE + scanline_map_size;
-        for (std::size_t y = 0; y < hdr.height; ++y) {
+        for (std::size_t y = 0; y < height; ++y) {
             std::size_t line_size = scanline_sizes[y];
 
             if (data_offset + line_size > data.size()) {
@@ -181,10 +194,7 @@ decode_result msp_decoder::decode(std::span<const std::uint8_t> data,
             }
             data_offset += line_size;
 
-            unpack_1bit_to_indexed8(row_buffer.data(), row_bytes,
-                                     pixel_row.data(), hdr.width);
-            surf.write_pixels(0, static_cast<int>(y),
-                              static_cast<int>(hdr.width), pixel_row.data());
+            write_row(y, row_buffer.data());
         }
     }
 
@@ -1,5 +1,7 @@
 #include <onyx_image/codecs/pcx.hpp>
 #include <formats/pcx/pcx.hh>
+#include "decode_helpers.hpp"
+#include "header_views.hpp"
 
 #include <algorithm>
 #include <cstring>
@@ -13,6 +15,17 @@ constexpr std::size_t VGA_PALETTE_SIZE = 769;  // 1 marker + 768 color bytes
 constexpr std::uint8_t RLE_MASK = 0xC0;
 constexpr std::uint8_t RLE_COUNT_MASK = 0x3F;
 
+// Plane / bit depth combinations decode_rle can convert
+bool is_supported_layout(const pcx_decoder::header_info& info) noexcept {
+    switch (info.num_planes) {
+        case 1: return true;  // 1, 2, 4 and 8 bpp (validated by parse_header)
+        case 2:
+        case 4: return info.bits_per_pixel == 1;
+        case 3: return info.bits_per_pixel == 1 || info.bits_per_pixel == 8;
+        default: return false;
+    }
+}
+
 } // namespace
 
 bool pcx_decoder::sniff(std::span<const std::uint8_t> data) noexcept {
@@ -53,59 +66,54 @@ decode_result pcx_decoder::parse_header(std::span<const std::uint8_t> data,
             "PCX file too small: expected at least 128 bytes");
     }
 
-    try {
-        const auto* ptr = data.data();
-        const auto* end = ptr + data.size();
-        auto header = formats::pcx::pcx_header::read(ptr, end);
-
-        info.version = header.version;
-        info.bits_per_pixel = header.bits_per_pixel;
-        info.num_planes = header.num_planes;
-        info.bytes_per_line = header.bytes_per_line;
-        info.has_rle = (header.encoding == formats::pcx::PCX_ENCODING_RLE);
+    auto header = pcx_header_view::from(data);
+    if (!header) {
+        return decode_result::failure(decode_error::invalid_format, "Invalid PCX signature");
+    }
 
-        // Calculate dimensions
-        info.width = header.x_max - header.x_min + 1;
-        info.height = header.y_max - header.y_min + 1;
+    info.version = header->version();
+    info.bits_per_pixel = header->bits_per_pixel();
+    info.num_planes = header->num_planes();
+    info.bytes_per_line = header->bytes_per_line();
+    info.has_rle = (header->encoding() == formats::pcx::PCX_ENCODING_RLE);
 
-        // Validate dimensions
-        if (info.width <= 0 || info.height <= 0) {
-            return decode_result::failure(decode_error::invalid_format, "Invalid image dimensions");
-        }
+    // Calculate dimensions
+    info.width = header->x_max() - header->x_min() + 1;
+    info.height = header->y_max() - header->y_min() + 1;
 
-        const int max_w = options.max_width > 0 ? options.max_width : 16384;
-        const int max_h = options.max_height > 0 ? options.max_height : 16384;
+    // Validate dimensions
+    if (info.width <= 0 || info.height <= 0) {
+        return decode_result::failure(decode_error::invalid_format, "Invalid image dimensions");
+    }
 
-        if (info.width > max_w || info.height > max_h) {
-            return decode_result::failure(decode_error::dimensions_exceeded,
-                "Image dimensions exceed limits");
-        }
+    const int max_w = options.max_width > 0 ? options.max_width : 16384;
+    const int max_h = options.max_height > 0 ? options.max_height : 16384;
 
-        // Validate bits per pixel
-        if (info.bits_per_pixel != 1 && info.bits_per_pixel != 2 &&
-            info.bits_per_pixel != 4 && info.bits_per_pixel != 8) {
-            return decode_result::failure(decode_error::unsupported_bit_depth,
-                "Unsupported bits per pixel");
-        }
-
-        // Validate planes (1, 2, 3, or 4 planes are valid)
-        if (info.num_planes < 1 || info.num_planes > 4) {
-            return decode_result::failure(decode_error::unsupported_encoding,
-                "Unsupported number of color planes");
-        }
+    if (info.width > max_w || info.height > max_h) {
+        return decode_result::failure(decode_error::dimensions_exceeded,
+            "Image dimensions exceed limits");
+    }
 
-        return decode_result::success();
+    // Validate bits per pixel
+    if (info.bits_per_pixel != 1 && info.bits_per_pixel != 2 &&
+        info.bits_per_pixel != 4 && info.bits_per_pixel != 8) {
+        return decode_result::failure(decode_error::unsupported_bit_depth,
+            "Unsupported bits per pixel");
+    }
 
-    } catch (const formats::pcx::ConstraintViolation& e) {
-        return decode_result::failure(decode_error::invalid_format, e.what());
-    } catch (const std::exception& e) {
-        return decode_result::failure(decode_error::internal_error, e.what());
+    // Validate planes (1, 2, 3, or 4 planes are valid)
+    if (info.num_planes < 1 || info.num_planes > 4) {
+        return decode_result::failure(decode_error::unsupported_encoding,
+            "Unsupported number of color planes");
     }
+
+    return decode_result::success();
 }
 
 decode_result pcx_decoder::decode_rle(std::span<const std::uint8_t> data,
                                        std::size_t data_offset,
                                        const header_info& info,
+                                       pixel_format format,
                                        surface& surf) {
     const std::size_t scan_line_length = static_cast<std::size_t>(info.bytes_per_line) * info.num_planes;
     std::vector<std::uint8_t> scan_line(scan_line_length);
@@ -120,6 +128,8 @@ decode_result pcx_decoder::decode_rle(std::span<const std::uint8_t> data,
         }
     }
 
+    const bool verify_only = surf.discards_pixels();
+
     for (int y = 0; y < info.height; ++y) {
         std::size_t line_pos = 0;
 
@@ -154,8 +164,19 @@ decode_result pcx_decoder::decode_rle(std::span<const std::uint8_t> data,
                 "Truncated PCX scanline");
         }
 
+        if (verify_only) {
+            if (!is_supported_layout(info)) {
+                return decode_result::failure(decode_error::unsupported_encoding,
+                    "Unsupported PCX format combination");
+            }
+            continue;
+        }
+
         // Convert scan line to output format
-        if (info.num_planes == 1 && info.bits_per_pixel == 8) {
+        if (bytes_per_pixel(format) == 0) {
+            // Packed 1/2/4-bit single plane - stored as is
+            write_packed_row(surf, y, scan_line.data(), info.width, format);
+        } else if (info.num_planes == 1 && info.bits_per_pixel == 8) {
             // 256-color indexed - direct copy
             surf.write_pixels(0, y, info.width, scan_line.data());
         } else if (info.num_planes == 3 && info.bits_per_pixel == 8) {
@@ -366,6 +387,8 @@ decode_result pcx_decoder::decode(std::span<const std::uint8_t> data,
     pixel_format fmt;
     if (info.num_planes == 3 && info.bits_per_pixel == 8) {
         fmt = pixel_format::rgb888;
+    } else if (info.num_planes == 1) {
+        fmt = indexed_format_for(info.bits_per_pixel, options);
     } else {
         fmt = pixel_format::indexed8;
     }
@@ -376,13 +399,13 @@ decode_result pcx_decoder::decode(std::span<const std::uint8_t> data,
     }
 
     // Decode pixel data
-    result = decode_rle(data, PCX_HEADER_SIZE, info, surf);
+    result = decode_rle(data, PCX_HEADER_SIZE, info, fmt, surf);
     if (!result) {
         return result;
     }
 
     // Apply palette for indexed formats
-    if (fmt == pixel_format::indexed8) {
+    if (is_indexed(fmt)) {
         if (info.version == 5 && info.bits_per_pixel == 8 && info.num_planes == 1) {
             // VGA 256-color palette at end of file
             result = apply_vga_palette(data, surf);
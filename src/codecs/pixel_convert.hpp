@@ -0,0 +1,113 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace onyx_image {
+
+// Row converters from common little-endian packed layouts to RGBA8888.
+// Each processes `width` pixels from src into dst (4 bytes per pixel);
+// src and dst must not overlap. SSE2 handles the bulk, a scalar loop the tail.
+
+// 32-bit B,G,R,X/A bytes (masks 0x00FF0000/0x0000FF00/0x000000FF[/0xFF000000]).
+// Without keep_alpha the fourth byte is ignored and alpha is set to 0xFF.
+inline void bgra_to_rgba_row(const std::uint8_t* src, std::uint8_t* dst, int width, bool keep_alpha) {
+    int x = 0;
+#ifdef ONYX_IMAGE_HAS_SSE2
+    const __m128i rb_mask = _mm_set1_epi32(0x00FF00FF);
+    const __m128i ga_mask = _mm_set1_epi32(keep_alpha ? static_cast<int>(0xFF00FF00u) : 0x0000FF00);
+    const __m128i alpha = _mm_set1_epi32(keep_alpha ? 0 : static_cast<int>(0xFF000000u));
+    for (; x + 4 <= width; x += 4) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        const __m128i rb = _mm_and_si128(px, rb_mask);
+        const __m128i swapped = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+        const __m128i out = _mm_or_si128(_mm_or_si128(swapped, _mm_and_si128(px, ga_mask)), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), out);
+    }
+#endif
+    for (; x < width; ++x) {
+        const std::uint8_t* s = src + x * 4;
+        std::uint8_t* d = dst + x * 4;
+        d[0] = s[2];
+        d[1] = s[1];
+        d[2] = s[0];
+        d[3] = keep_alpha ? s[3] : 0xFF;
+    }
+}
+
+// 24-bit B,G,R bytes, alpha set to 0xFF
+inline void bgr_to_rgba_row(const std::uint8_t* src, std::uint8_t* dst, int width) {
+    for (int x = 0; x < width; ++x) {
+        const std::uint8_t* s = src + x * 3;
+        std::uint8_t* d = dst + x * 4;
+        d[0] = s[2];
+        d[1] = s[1];
+        d[2] = s[0];
+        d[3] = 0xFF;
+    }
+}
+
+namespace detail {
+
+#ifdef ONYX_IMAGE_HAS_SSE2
+// Interleave 8 pixels of 16-bit r, g, b lanes (values 0-255) into RGBA
+inline void store_rgb16_lanes(std::uint8_t* dst, __m128i r, __m128i g, __m128i b) {
+    const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    const __m128i ba = _mm_or_si128(b, _mm_set1_epi16(static_cast<short>(0xFF00)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi16(rg, ba));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_unpackhi_epi16(rg, ba));
+}
+#endif
+
+} // namespace detail
+
+// 16-bit X1R5G5B5, channels shifted up to 8 bits (low bits zero)
+inline void rgb555_to_rgba_row(const std::uint8_t* src, std::uint8_t* dst, int width) {
+    int x = 0;
+#ifdef ONYX_IMAGE_HAS_SSE2
+    const __m128i top5 = _mm_set1_epi16(0xF8);
+    for (; x + 8 <= width; x += 8) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+        detail::store_rgb16_lanes(dst + x * 4,
+                                  _mm_and_si128(_mm_srli_epi16(px, 7), top5),
+                                  _mm_and_si128(_mm_srli_epi16(px, 2), top5),
+                                  _mm_and_si128(_mm_slli_epi16(px, 3), top5));
+    }
+#endif
+    for (; x < width; ++x) {
+        const unsigned p = src[x * 2] | (src[x * 2 + 1] << 8);
+        std::uint8_t* d = dst + x * 4;
+        d[0] = static_cast<std::uint8_t>((p >> 7) & 0xF8);
+        d[1] = static_cast<std::uint8_t>((p >> 2) & 0xF8);
+        d[2] = static_cast<std::uint8_t>((p << 3) & 0xF8);
+        d[3] = 0xFF;
+    }
+}
+
+// 16-bit R5G6B5, channels shifted up to 8 bits (low bits zero)
+inline void rgb565_to_rgba_row(const std::uint8_t* src, std::uint8_t* dst, int width) {
+    int x = 0;
+#ifdef ONYX_IMAGE_HAS_SSE2
+    const __m128i top5 = _mm_set1_epi16(0xF8);
+    const __m128i top6 = _mm_set1_epi16(0xFC);
+    for (; x + 8 <= width; x += 8) {
+        const __m128i px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 2));
+        detail::store_rgb16_lanes(dst + x * 4,
+                                  _mm_and_si128(_mm_srli_epi16(px, 8), top5),
+                                  _mm_and_si128(_mm_srli_epi16(px, 3), top6),
+                                  _mm_and_si128(_mm_slli_epi16(px, 3), top5));
+    }
+#endif
+    for (; x < width; ++x) {
+        const unsigned p = src[x * 2] | (src[x * 2 + 1] << 8);
+        std::uint8_t* d = dst + x * 4;
+        d[0] = static_cast<std::uint8_t>((p >> 8) & 0xF8);
+        d[1] = static_cast<std::uint8_t>((p >> 3) & 0xFC);
+        d[2] = static_cast<std::uint8_t>((p << 3) & 0xF8);
+        d[3] = 0xFF;
+    }
+}
+
+} // namespace onyx_image
@@ -1,10 +1,24 @@
 #include <onyx_image/codecs/png.hpp>
+#include <onyx_image/shared_surface.hpp>
+#include "../atomic_file.hpp"
 #include "byte_io.hpp"
 #include "decode_helpers.hpp"
+#include "deflate_join.hpp"
+#include "iff_chunks.hpp"
+#include "inflate.hpp"
+#include "png_unfilter.hpp"
 #include <lodepng.h>
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
 #include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 namespace onyx_image {
 
@@ -27,6 +41,729 @@ constexpr std::size_t PNG_MIN_SIZE_FOR_DIMENSIONS = 24;  // signature + IHDR len
 constexpr std::uint32_t PNG_IHDR_TYPE = 0x49484452;  // "IHDR" in big-endian
 constexpr std::uint32_t PNG_IHDR_LENGTH = 13;  // IHDR data is always 13 bytes
 
+constexpr std::uint32_t CHUNK_IHDR = iff_fourcc("IHDR");
+constexpr std::uint32_t CHUNK_PLTE = iff_fourcc("PLTE");
+constexpr std::uint32_t CHUNK_TRNS = iff_fourcc("tRNS");
+constexpr std::uint32_t CHUNK_IDAT = iff_fourcc("IDAT");
+constexpr std::uint32_t CHUNK_IEND = iff_fourcc("IEND");
+
+// IHDR color types
+constexpr std::uint8_t COLOR_GRAY = 0;
+constexpr std::uint8_t COLOR_RGB = 2;
+constexpr std::uint8_t COLOR_PALETTE = 3;
+constexpr std::uint8_t COLOR_GRAY_ALPHA = 4;
+constexpr std::uint8_t COLOR_RGBA = 6;
+
+// ============================================================================
+// Native Decode
+// ============================================================================
+//
+// Common PNGs (8-bit or less) are decoded in-tree so they keep their
+// color type: palette -> indexed8 with the PLTE palette, gray -> indexed8
+// with a gray ramp, RGB -> rgb888, RGBA -> rgba8888. The IDAT stream is
+// pulled through zlib_reader (inflate.cpp) one scanline at a time, so only
+// the current and previous rows are held; each is unfiltered
+// (png_unfilter.hpp) and written to the surface as it arrives. Adam7
+// images are read pass by pass the same way. Anything unusual (16-bit,
+// unknown critical chunks, CRC errors, a damaged zlib stream) is left to
+// the full lodepng decode, so its results and error messages are
+// unchanged.
+
+struct png_image {
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint8_t bit_depth = 0;
+    std::uint8_t color_type = 0;
+    bool interlace = false;
+    std::span<const std::uint8_t> plte;
+    std::span<const std::uint8_t> trns;
+    std::vector<std::span<const std::uint8_t>> idat;
+};
+
+// Adam7 passes: first pixel and spacing in each direction
+constexpr std::uint8_t ADAM7_X0[7] = {0, 4, 0, 2, 0, 1, 0};
+constexpr std::uint8_t ADAM7_Y0[7] = {0, 0, 4, 0, 2, 0, 1};
+constexpr std::uint8_t ADAM7_DX[7] = {8, 8, 4, 4, 2, 2, 1};
+constexpr std::uint8_t ADAM7_DY[7] = {8, 8, 8, 4, 4, 2, 2};
+
+// How scanlines reach the surface
+enum class png_row_path {
+    copy,        // Stored bytes are the surface row (optionally packed)
+    unpack,      // 1/2/4-bit indices expanded to indexed8
+    lut,         // Indices or gray samples looked up in an RGBA table (tRNS)
+    rgb_key,     // RGB with a tRNS color key
+    gray_alpha   // Gray + alpha to RGBA
+};
+
+std::size_t png_channels(std::uint8_t color_type) noexcept {
+    switch (color_type) {
+        case COLOR_RGB: return 3;
+        case COLOR_GRAY_ALPHA: return 2;
+        case COLOR_RGBA: return 4;
+        default: return 1;
+    }
+}
+
+// Walk the chunk list and collect what the native path needs. Returns
+// false if the file needs the full lodepng decoder.
+bool read_png_image(std::span<const std::uint8_t> data, png_image& img) {
+    std::size_t pos = PNG_SIGNATURE_SIZE;
+    bool have_ihdr = false;
+    bool have_iend = false;
+
+    while (pos + 12 <= data.size()) {
+        const std::size_t length = read_be32(data.data() + pos);
+        const std::uint32_t type = read_be32(data.data() + pos + 4);
+        if (length > data.size() - pos - 12) {
+            return false;
+        }
+
+        const std::uint8_t* chunk = data.data() + pos;
+        const auto payload = data.subspan(pos + 8, length);
+        pos += length + 12;
+
+        if (lodepng_chunk_check_crc(chunk) != 0) {
+            return false;
+        }
+        const bool critical = (type & 0x20000000u) == 0;
+
+        if (type == CHUNK_IHDR) {
+            if (have_ihdr || length != PNG_IHDR_LENGTH) return false;
+            img.width = read_be32(payload.data());
+            img.height = read_be32(payload.data() + 4);
+            img.bit_depth = payload[8];
+            img.color_type = payload[9];
+            // Compression and filter method 0; no interlace or Adam7
+            if (payload[10] != 0 || payload[11] != 0 || payload[12] > 1) return false;
+            img.interlace = payload[12] == 1;
+            have_ihdr = true;
+        } else if (!have_ihdr) {
+            return false;
+        } else if (type == CHUNK_PLTE) {
+            if (length == 0 || length % 3 != 0 || length > 256 * 3) return false;
+            img.plte = payload;
+        } else if (type == CHUNK_TRNS) {
+            // Palette transparency must follow the palette
+            if (img.color_type == COLOR_PALETTE && img.plte.empty()) return false;
+            img.trns = payload;
+        } else if (type == CHUNK_IDAT) {
+            img.idat.push_back(payload);
+        } else if (type == CHUNK_IEND) {
+            have_iend = true;
+            break;
+        } else if (critical) {
+            return false;  // Unknown critical chunk
+        }
+    }
+
+    if (!have_ihdr || !have_iend || img.idat.empty() || img.width == 0 || img.height == 0) {
+        return false;
+    }
+
+    // Only 8-bit and smaller samples
+    switch (img.color_type) {
+        case COLOR_GRAY:
+            if (img.bit_depth != 1 && img.bit_depth != 2 && img.bit_depth != 4 && img.bit_depth != 8) return false;
+            return img.trns.empty() || img.trns.size() == 2;
+        case COLOR_PALETTE:
+            if (img.bit_depth != 1 && img.bit_depth != 2 && img.bit_depth != 4 && img.bit_depth != 8) return false;
+            return !img.plte.empty() && img.trns.size() <= img.plte.size() / 3;
+        case COLOR_RGB:
+            return img.bit_depth == 8 && (img.trns.empty() || img.trns.size() == 6);
+        case COLOR_GRAY_ALPHA:
+        case COLOR_RGBA:
+            return img.bit_depth == 8 && img.trns.empty();
+        default:
+            return false;
+    }
+}
+
+// Packed index format for a sub-byte bit depth
+pixel_format packed_format(std::uint8_t bit_depth) noexcept {
+    switch (bit_depth) {
+        case 1: return pixel_format::indexed1;
+        case 2: return pixel_format::indexed2;
+        default: return pixel_format::indexed4;
+    }
+}
+
+// Decode natively, or return std::nullopt to fall back to lodepng
+std::optional<decode_result> decode_native(std::span<const std::uint8_t> data, surface& surf,
+                                           const decode_options& options) {
+    png_image img;
+    if (!read_png_image(data, img)) {
+        return std::nullopt;
+    }
+
+    const std::size_t width = img.width;
+    const std::size_t height = img.height;
+    const std::size_t channels = png_channels(img.color_type);
+    const std::size_t row_len = (width * channels * img.bit_depth + 7) / 8;
+    const std::size_t bpp = std::max<std::size_t>(1, channels * img.bit_depth / 8);
+    if (height > std::numeric_limits<std::size_t>::max() / (row_len + 1)) {
+        return std::nullopt;
+    }
+
+    // Palette entries with alpha, or a transparent gray / RGB key
+    std::array<std::uint8_t, 256 * 4> lut{};
+    bool has_alpha = false;
+    if (img.color_type == COLOR_PALETTE) {
+        const std::size_t count = img.plte.size() / 3;
+        for (std::size_t i = 0; i < 256; ++i) {
+            if (i < count) {
+                std::memcpy(&lut[i * 4], img.plte.data() + i * 3, 3);
+            }
+            lut[i * 4 + 3] = i < img.trns.size() ? img.trns[i] : 0xFF;
+            has_alpha |= i < count && lut[i * 4 + 3] != 0xFF;
+        }
+    } else if (img.color_type == COLOR_GRAY) {
+        const unsigned max_value = (1u << img.bit_depth) - 1;
+        const unsigned key = img.trns.empty() ? 0x10000u : read_be16(img.trns.data());
+        for (unsigned i = 0; i <= max_value; ++i) {
+            const auto value = static_cast<std::uint8_t>(i * 255 / max_value);
+            lut[i * 4 + 0] = lut[i * 4 + 1] = lut[i * 4 + 2] = value;
+            lut[i * 4 + 3] = i == key ? 0 : 0xFF;
+        }
+        has_alpha = !img.trns.empty();
+    } else if (img.color_type == COLOR_RGB) {
+        has_alpha = !img.trns.empty();
+    }
+
+    pixel_format format = pixel_format::rgba8888;
+    png_row_path path = png_row_path::copy;
+    switch (img.color_type) {
+        case COLOR_PALETTE:
+        case COLOR_GRAY:
+            if (has_alpha) {
+                path = png_row_path::lut;
+            } else if (img.bit_depth == 8) {
+                format = pixel_format::indexed8;
+            } else if (options.packed_indexed) {
+                format = packed_format(img.bit_depth);
+            } else {
+                format = pixel_format::indexed8;
+                path = png_row_path::unpack;
+            }
+            break;
+        case COLOR_RGB:
+            if (has_alpha) {
+                path = png_row_path::rgb_key;
+            } else {
+                format = pixel_format::rgb888;
+            }
+            break;
+        case COLOR_GRAY_ALPHA:
+            path = png_row_path::gray_alpha;
+            break;
+        default:
+            break;
+    }
+
+    // The IDAT payloads form one zlib stream
+    std::vector<std::uint8_t> compressed;
+    std::span<const std::uint8_t> zlib_data = img.idat.front();
+    if (img.idat.size() > 1) {
+        for (const auto& part : img.idat) {
+            compressed.insert(compressed.end(), part.begin(), part.end());
+        }
+        zlib_data = compressed;
+    }
+
+    if (!surf.set_size(static_cast<int>(width), static_cast<int>(height), format)) {
+        return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+    }
+
+    if (is_indexed(format)) {
+        const std::size_t count = img.color_type == COLOR_PALETTE ? img.plte.size() / 3
+                                                                  : (std::size_t{1} << img.bit_depth);
+        std::vector<std::uint8_t> palette(count * 3);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::memcpy(&palette[i * 3], &lut[i * 4], 3);
+        }
+        surf.set_palette_size(static_cast<int>(count));
+        surf.write_palette(0, palette);
+    }
+
+    const unsigned key_r = path == png_row_path::rgb_key ? read_be16(img.trns.data()) : 0;
+    const unsigned key_g = path == png_row_path::rgb_key ? read_be16(img.trns.data() + 2) : 0;
+    const unsigned key_b = path == png_row_path::rgb_key ? read_be16(img.trns.data() + 4) : 0;
+    const pixel_format stored = img.bit_depth < 8 ? packed_format(img.bit_depth) : pixel_format::indexed8;
+    const bool packed = bytes_per_pixel(format) == 0;
+    std::vector<std::uint8_t> out_row(path == png_row_path::copy && !packed ? 0 : width * 4);
+
+    // Surface pixels for `count` stored pixels: the row itself, or out_row
+    // (one index per byte for the indexed formats)
+    auto convert = [&](const std::uint8_t* row, std::size_t count) -> const std::uint8_t* {
+        switch (path) {
+            case png_row_path::copy:
+                if (!packed) return row;
+                [[fallthrough]];
+            case png_row_path::unpack:
+                unpack_indexed_row(stored, row, out_row.data(), static_cast<int>(count));
+                break;
+            case png_row_path::lut:
+                unpack_indexed_row(stored, row, out_row.data() + width * 3, static_cast<int>(count));
+                for (std::size_t x = 0; x < count; ++x) {
+                    std::memcpy(&out_row[x * 4], &lut[out_row[width * 3 + x] * 4u], 4);
+                }
+                break;
+            case png_row_path::rgb_key:
+                for (std::size_t x = 0; x < count; ++x) {
+                    const std::uint8_t* px = row + x * 3;
+                    std::memcpy(&out_row[x * 4], px, 3);
+                    const bool keyed = key_r == px[0] && key_g == px[1] && key_b == px[2];
+                    out_row[x * 4 + 3] = keyed ? 0 : 0xFF;
+                }
+                break;
+            case png_row_path::gray_alpha:
+                for (std::size_t x = 0; x < count; ++x) {
+                    out_row[x * 4 + 0] = out_row[x * 4 + 1] = out_row[x * 4 + 2] = row[x * 2];
+                    out_row[x * 4 + 3] = row[x * 2 + 1];
+                }
+                break;
+        }
+        return out_row.data();
+    };
+
+    // Scanlines are pulled from the zlib stream one at a time into `line`
+    // (filter byte + row) and unfiltered against `prev`; an interlaced
+    // image is read one pass at a time, each pass a small image of its own
+    zlib_reader reader(zlib_data);
+    std::vector<std::uint8_t> line(row_len + 1);
+    std::vector<std::uint8_t> prev(row_len + 1);
+    const int passes = img.interlace ? 7 : 1;
+
+    for (int pass = 0; pass < passes; ++pass) {
+        const std::size_t x0 = img.interlace ? ADAM7_X0[pass] : 0;
+        const std::size_t y0 = img.interlace ? ADAM7_Y0[pass] : 0;
+        const std::size_t dx = img.interlace ? ADAM7_DX[pass] : 1;
+        const std::size_t dy = img.interlace ? ADAM7_DY[pass] : 1;
+        if (x0 >= width || y0 >= height) {
+            continue;  // Empty passes store no scanlines at all
+        }
+        const std::size_t pass_width = (width - x0 + dx - 1) / dx;
+        const std::size_t pass_len = (pass_width * channels * img.bit_depth + 7) / 8;
+
+        for (std::size_t y = y0; y < height; y += dy) {
+            line.swap(prev);
+            std::uint8_t* row = line.data() + 1;
+            if (!reader.read(line.data(), pass_len + 1) ||
+                !unfilter_row(line[0], row, y == y0 ? nullptr : prev.data() + 1, pass_len, bpp)) {
+                return std::nullopt;
+            }
+
+            const int yi = static_cast<int>(y);
+            if (dx == 1) {
+                // Whole surface rows
+                if (path == png_row_path::copy && packed) {
+                    write_packed_row(surf, yi, row, static_cast<int>(width), format);
+                } else {
+                    const std::size_t size = path == png_row_path::copy ? row_len
+                                           : is_indexed(format)          ? width
+                                                                         : width * 4;
+                    surf.write_pixels(0, yi, static_cast<int>(size), convert(row, width));
+                }
+                continue;
+            }
+
+            // Earlier passes land on every dx-th pixel
+            const std::uint8_t* pixels = convert(row, pass_width);
+            const std::size_t pixel_size = is_indexed(format) ? 1 : bytes_per_pixel(format);
+            for (std::size_t i = 0; i < pass_width; ++i) {
+                const std::size_t x = x0 + i * dx;
+                if (is_indexed(format)) {
+                    surf.write_pixel(static_cast<int>(x), yi, pixels[i]);
+                } else {
+                    surf.write_pixels(static_cast<int>(x * pixel_size), yi, static_cast<int>(pixel_size),
+                                      pixels + i * pixel_size);
+                }
+            }
+        }
+    }
+
+    if (!reader.finish()) {
+        return std::nullopt;
+    }
+    return decode_result::success();
+}
+
+// ============================================================================
+// Native Encode
+// ============================================================================
+//
+// Surfaces are written in their own color type: indexed -> palette PNG at
+// the smallest bit depth that holds every index used, rgb888 -> RGB,
+// rgba8888 -> RGBA. Rows are filtered here; lodepng only deflates.
+//
+// The image is cut into bands of rows that are filtered and deflated
+// independently, several at a time on worker threads started once per
+// image (png_band_pool). Every band but the last ends in a sync flush so
+// the pieces join into one zlib stream, and their Adler-32s are combined.
+// Bands go to the sink as IDAT chunks in order, so memory stays at a few
+// bands per thread.
+
+// Largest IDAT payload written in one chunk
+constexpr std::size_t PNG_MAX_IDAT_SIZE = std::size_t{1} << 30;
+
+// Scanline bytes per band; large enough that restarting the deflate
+// window at each band costs little
+constexpr std::size_t PNG_BAND_BYTES = std::size_t{1} << 20;
+
+// zlib header: deflate, 32K window, FCHECK for no preset dictionary
+constexpr std::uint8_t ZLIB_HEADER[] = {0x78, 0x01};
+
+// Filter one scanline into out. prev is the previous unfiltered scanline
+// (nullptr for the first); bpp is bytes per pixel, at least 1.
+void filter_row(png_filter filter, const std::uint8_t* row, const std::uint8_t* prev,
+                std::uint8_t* out, std::size_t length, std::size_t bpp) noexcept {
+    switch (filter) {
+        case png_filter::sub:
+            for (std::size_t i = 0; i < length; ++i) {
+                out[i] = static_cast<std::uint8_t>(row[i] - (i >= bpp ? row[i - bpp] : 0));
+            }
+            return;
+        case png_filter::up:
+            for (std::size_t i = 0; i < length; ++i) {
+                out[i] = static_cast<std::uint8_t>(row[i] - (prev ? prev[i] : 0));
+            }
+            return;
+        case png_filter::average:
+            for (std::size_t i = 0; i < length; ++i) {
+                const unsigned left = i >= bpp ? row[i - bpp] : 0u;
+                const unsigned up = prev ? prev[i] : 0u;
+                out[i] = static_cast<std::uint8_t>(row[i] - ((left + up) >> 1));
+            }
+            return;
+        case png_filter::paeth:
+            for (std::size_t i = 0; i < length; ++i) {
+                const int a = i >= bpp ? row[i - bpp] : 0;
+                const int b = prev ? prev[i] : 0;
+                const int c = (i >= bpp && prev) ? prev[i - bpp] : 0;
+                out[i] = static_cast<std::uint8_t>(row[i] - paeth_predictor(a, b, c));
+            }
+            return;
+        default:
+            std::memcpy(out, row, length);
+            return;
+    }
+}
+
+// Sum of the filtered bytes taken as signed values (lower compresses better)
+std::size_t filtered_cost(const std::uint8_t* bytes, std::size_t length) noexcept {
+    std::size_t sum = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+        sum += bytes[i] < 128 ? bytes[i] : 256u - bytes[i];
+    }
+    return sum;
+}
+
+// Filter a scanline into line (filter type byte + row). scratch holds
+// length bytes for trying the adaptive candidates.
+void write_scanline(png_filter filter, const std::uint8_t* row, const std::uint8_t* prev,
+                    std::uint8_t* line, std::uint8_t* scratch,
+                    std::size_t length, std::size_t bpp) noexcept {
+    if (filter != png_filter::adaptive) {
+        line[0] = static_cast<std::uint8_t>(filter);
+        filter_row(filter, row, prev, line + 1, length, bpp);
+        return;
+    }
+
+    line[0] = 0;
+    std::memcpy(line + 1, row, length);
+    std::size_t best = filtered_cost(row, length);
+    for (const auto candidate : {png_filter::sub, png_filter::up, png_filter::average, png_filter::paeth}) {
+        filter_row(candidate, row, prev, scratch, length, bpp);
+        const std::size_t cost = filtered_cost(scratch, length);
+        if (cost < best) {
+            best = cost;
+            line[0] = static_cast<std::uint8_t>(candidate);
+            std::memcpy(line + 1, scratch, length);
+        }
+    }
+}
+
+// Deflate effort for a compression level; 0 writes stored blocks
+LodePNGCompressSettings compress_settings(int level) noexcept {
+    struct effort {
+        unsigned windowsize;
+        unsigned nicematch;
+        unsigned lazymatching;
+    };
+    static constexpr effort EFFORT[] = {
+        {0, 0, 0},
+        {256, 16, 0}, {512, 32, 0}, {1024, 64, 0},
+        {2048, 128, 1}, {2048, 128, 1}, {2048, 128, 1},
+        {8192, 258, 1}, {16384, 258, 1}, {32768, 258, 1},
+    };
+
+    LodePNGCompressSettings settings = lodepng_default_compress_settings;
+    level = std::clamp(level, 0, 9);
+    if (level == 0) {
+        settings.btype = 0;
+        settings.use_lz77 = 0;
+        return settings;
+    }
+    settings.btype = 2;
+    settings.use_lz77 = 1;
+    settings.windowsize = EFFORT[level].windowsize;
+    settings.nicematch = EFFORT[level].nicematch;
+    settings.lazymatching = EFFORT[level].lazymatching;
+    return settings;
+}
+
+void append_be32(std::vector<std::uint8_t>& out, std::uint32_t value) {
+    out.push_back(static_cast<std::uint8_t>(value >> 24));
+    out.push_back(static_cast<std::uint8_t>(value >> 16));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+void append_chunk(std::vector<std::uint8_t>& out, std::uint32_t type,
+                  const std::uint8_t* payload, std::size_t length) {
+    const std::size_t start = out.size();
+    append_be32(out, static_cast<std::uint32_t>(length));
+    append_be32(out, type);
+    out.insert(out.end(), payload, payload + length);
+    append_be32(out, lodepng_crc32(out.data() + start + 4, length + 4));
+}
+
+// Smallest PNG palette bit depth for a number of entries
+std::uint8_t palette_bit_depth(std::size_t entries) noexcept {
+    if (entries <= 2) return 1;
+    if (entries <= 4) return 2;
+    if (entries <= 16) return 4;
+    return 8;
+}
+
+// Color type, depth and palette a surface is written with
+struct png_layout {
+    std::uint8_t color_type = COLOR_RGBA;
+    std::uint8_t bit_depth = 8;
+    std::size_t row_len = 0;
+    std::size_t bpp = 4;
+    std::vector<std::uint8_t> plte;
+};
+
+// Image is memory_surface or shared_surface; both expose rows pitch() apart
+template <typename Image>
+png_layout plan_layout(const Image& surf) {
+    const auto width = static_cast<std::size_t>(surf.width());
+    png_layout layout;
+
+    if (surf.format() == pixel_format::rgb888) {
+        layout.color_type = COLOR_RGB;
+    } else if (is_indexed(surf.format())) {
+        // PLTE covers every index in use; missing palette entries are black
+        std::vector<std::uint8_t> indices(width);
+        std::uint8_t max_index = 0;
+        for (int y = 0; y < surf.height(); ++y) {
+            unpack_indexed_row(surf.format(), surf.pixels().data() + y * surf.pitch(),
+                               indices.data(), surf.width());
+            max_index = std::max(max_index, *std::max_element(indices.begin(), indices.end()));
+        }
+
+        const std::size_t entries = std::size_t{max_index} + 1;
+        const auto palette = surf.palette();
+        layout.plte.assign(entries * 3, 0);
+        std::copy_n(palette.begin(), std::min(palette.size(), layout.plte.size()), layout.plte.begin());
+        layout.color_type = COLOR_PALETTE;
+        layout.bit_depth = palette_bit_depth(entries);
+    }
+
+    const std::size_t channels = png_channels(layout.color_type);
+    layout.row_len = (width * channels * layout.bit_depth + 7) / 8;
+    layout.bpp = std::max<std::size_t>(1, channels * layout.bit_depth / 8);
+    return layout;
+}
+
+// Stored bytes of surface row y; indices is scratch of width bytes
+template <typename Image>
+void pack_row(const Image& surf, const png_layout& layout, int y,
+              std::uint8_t* dst, std::uint8_t* indices) {
+    const std::uint8_t* src = surf.pixels().data() + static_cast<std::size_t>(y) * surf.pitch();
+    if (layout.color_type != COLOR_PALETTE) {
+        std::memcpy(dst, src, layout.row_len);
+        return;
+    }
+
+    unpack_indexed_row(surf.format(), src, indices, surf.width());
+    const std::size_t depth = layout.bit_depth;
+    std::memset(dst, 0, layout.row_len);
+    for (std::size_t x = 0; x < static_cast<std::size_t>(surf.width()); ++x) {
+        const std::size_t bit = x * depth;
+        dst[bit / 8] |= static_cast<std::uint8_t>(indices[x] << (8 - depth - bit % 8));
+    }
+}
+
+// Rows [y0, y1) filtered and deflated on their own
+struct png_band {
+    int y0 = 0;
+    int y1 = 0;
+    std::vector<std::uint8_t> deflated;
+    std::uint32_t adler = 1;
+    std::size_t length = 0;  // Scanline bytes before compression
+    bool ok = false;
+};
+
+template <typename Image>
+void encode_band(const Image& surf, const png_layout& layout, png_filter filter,
+                 const LodePNGCompressSettings& settings, bool last, png_band& band) {
+    const std::size_t row_len = layout.row_len;
+    const auto rows = static_cast<std::size_t>(band.y1 - band.y0);
+
+    // Rows are packed one at a time into `row`, filtered against `prev`
+    // (the row above, which for the first row belongs to the band before)
+    std::vector<std::uint8_t> row(row_len);
+    std::vector<std::uint8_t> prev(row_len);
+    std::vector<std::uint8_t> indices(layout.color_type == COLOR_PALETTE ? surf.width() : 0);
+    if (band.y0 > 0) {
+        pack_row(surf, layout, band.y0 - 1, prev.data(), indices.data());
+    }
+
+    std::vector<std::uint8_t> scanlines(rows * (row_len + 1));
+    std::vector<std::uint8_t> scratch(filter == png_filter::adaptive ? row_len : 0);
+    for (std::size_t i = 0; i < rows; ++i) {
+        pack_row(surf, layout, band.y0 + static_cast<int>(i), row.data(), indices.data());
+        write_scanline(filter, row.data(), (band.y0 > 0 || i > 0) ? prev.data() : nullptr,
+                       scanlines.data() + i * (row_len + 1), scratch.data(), row_len, layout.bpp);
+        row.swap(prev);
+    }
+    band.length = scanlines.size();
+    band.adler = adler32(1, scanlines.data(), scanlines.size());
+
+    unsigned char* out = nullptr;
+    std::size_t out_size = 0;
+    const unsigned error = lodepng_deflate(&out, &out_size, scanlines.data(), scanlines.size(), &settings);
+    if (!error) {
+        band.deflated.assign(out, out + out_size);
+    }
+    std::free(out);
+    band.ok = !error && (last || deflate_sync_flush(band.deflated));
+}
+
+// Encodes the bands of one image. Worker threads start once and pull band
+// numbers from an atomic counter; the calling thread takes finished bands
+// in order and encodes one itself whenever the band it needs has not been
+// started. At most `window_` bands run ahead of the last one taken, so
+// memory stays at a few bands per thread.
+template <typename Image>
+class png_band_pool {
+public:
+    png_band_pool(const Image& surf, const png_layout& layout, png_filter filter,
+                  const LodePNGCompressSettings& settings, int band_rows, int band_count, int threads)
+        : surf_(surf), layout_(layout), filter_(filter), settings_(settings), band_rows_(band_rows),
+          band_count_(band_count), window_(2 * threads),
+          slots_(static_cast<std::size_t>(window_)), ready_(static_cast<std::size_t>(window_)) {
+        try {
+            workers_.reserve(static_cast<std::size_t>(threads - 1));
+            for (int i = 1; i < threads; ++i) {
+                workers_.emplace_back([this] { work(); });
+            }
+        } catch (...) {
+            // Fewer workers; the calling thread picks up the rest
+        }
+    }
+
+    ~png_band_pool() {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        changed_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    png_band_pool(const png_band_pool&) = delete;
+    png_band_pool& operator=(const png_band_pool&) = delete;
+
+    // Band i; bands must be taken in order
+    png_band take(int i) {
+        std::unique_lock lock(mutex_);
+        while (!ready_[slot(i)]) {
+            int next = next_.load();
+            if (next < band_count_ && next < taken_ + window_ && next_.compare_exchange_strong(next, next + 1)) {
+                lock.unlock();
+                encode(next);
+                lock.lock();
+            } else {
+                changed_.wait(lock);
+            }
+        }
+        ready_[slot(i)] = false;
+        taken_ = i + 1;
+        png_band band = std::move(slots_[slot(i)]);
+        lock.unlock();
+        changed_.notify_all();
+        return band;
+    }
+
+private:
+    [[nodiscard]] std::size_t slot(int i) const noexcept {
+        return static_cast<std::size_t>(i % window_);
+    }
+
+    void work() {
+        for (;;) {
+            const int i = next_.fetch_add(1);
+            if (i >= band_count_) {
+                return;
+            }
+            {
+                std::unique_lock lock(mutex_);
+                changed_.wait(lock, [&] { return stop_ || i < taken_ + window_; });
+                if (stop_) {
+                    return;
+                }
+            }
+            encode(i);
+        }
+    }
+
+    void encode(int i) {
+        png_band band;
+        band.y0 = i * band_rows_;
+        band.y1 = std::min(band.y0 + band_rows_, surf_.height());
+        try {
+            encode_band(surf_, layout_, filter_, settings_, i == band_count_ - 1, band);
+        } catch (...) {
+            band.ok = false;
+        }
+        {
+            std::lock_guard lock(mutex_);
+            slots_[slot(i)] = std::move(band);
+            ready_[slot(i)] = true;
+        }
+        changed_.notify_all();
+    }
+
+    const Image& surf_;
+    const png_layout& layout_;
+    const png_filter filter_;
+    const LodePNGCompressSettings& settings_;
+    const int band_rows_;
+    const int band_count_;
+    const int window_;
+
+    std::atomic<int> next_{0};
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<png_band> slots_;
+    std::vector<bool> ready_;
+    int taken_ = 0;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+};
+
+// Emit one chunk through the sink, reusing buffer
+bool emit_chunk(const png_sink& sink, std::vector<std::uint8_t>& buffer, std::uint32_t type,
+                const std::uint8_t* payload, std::size_t length) {
+    buffer.clear();
+    append_chunk(buffer, type, payload, length);
+    return sink(buffer);
+}
+
 } // namespace
 
 // ============================================================================
@@ -79,6 +816,10 @@ decode_result png_decoder::decode(std::span<const std::uint8_t> data,
         // If IHDR validation fails, skip pre-check and let lodepng handle it
     }
 
+    if (auto native = decode_native(data, surf, options)) {
+        return *native;
+    }
+
     unsigned width = 0;
     unsigned height = 0;
     std::vector<std::uint8_t> pixels;
@@ -116,98 +857,141 @@ decode_result png_decoder::decode(std::span<const std::uint8_t> data,
 // PNG Encoder
 // ============================================================================
 
-std::vector<std::uint8_t> encode_png(const memory_surface& surf) {
-    if (surf.width() <= 0 || surf.height() <= 0) {
-        return {};
+namespace {
+
+template <typename Image>
+bool write_image(const Image& surf, const png_sink& sink, const png_encode_options& options) {
+    if (surf.width() <= 0 || surf.height() <= 0 || !sink) {
+        return false;
     }
 
-    std::vector<std::uint8_t> rgba_pixels;
-    const auto w = static_cast<unsigned>(surf.width());
-    const auto h = static_cast<unsigned>(surf.height());
+    const png_layout layout = plan_layout(surf);
 
-    // Convert to RGBA format for lodepng
-    switch (surf.format()) {
-        case pixel_format::rgba8888: {
-            // Direct copy
-            rgba_pixels.assign(surf.pixels().begin(), surf.pixels().end());
-            break;
+    // Filtering rarely pays off for palette and sub-byte images
+    png_filter filter = options.filter;
+    if (filter == png_filter::adaptive && (layout.color_type == COLOR_PALETTE || layout.bit_depth < 8)) {
+        filter = png_filter::none;
+    }
+
+    std::uint8_t ihdr[PNG_IHDR_LENGTH] = {};
+    for (int i = 0; i < 4; ++i) {
+        ihdr[i] = static_cast<std::uint8_t>(surf.width() >> (24 - 8 * i));
+        ihdr[4 + i] = static_cast<std::uint8_t>(surf.height() >> (24 - 8 * i));
+    }
+    ihdr[8] = layout.bit_depth;
+    ihdr[9] = layout.color_type;
+
+    std::vector<std::uint8_t> buffer(PNG_SIGNATURE, PNG_SIGNATURE + PNG_SIGNATURE_SIZE);
+    append_chunk(buffer, CHUNK_IHDR, ihdr, sizeof(ihdr));
+    if (!layout.plte.empty()) {
+        append_chunk(buffer, CHUNK_PLTE, layout.plte.data(), layout.plte.size());
+    }
+    if (!sink(buffer)) {
+        return false;
+    }
+
+    const int band_rows = static_cast<int>(std::clamp<std::size_t>(
+        PNG_BAND_BYTES / (layout.row_len + 1), 1, static_cast<std::size_t>(surf.height())));
+    const int band_count = (surf.height() + band_rows - 1) / band_rows;
+    int threads = options.threads > 0 ? options.threads
+                                      : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::clamp(threads, 1, band_count);
+
+    const LodePNGCompressSettings settings = compress_settings(options.compression_level);
+    png_band_pool<Image> pool(surf, layout, filter, settings, band_rows, band_count, threads);
+    std::uint32_t adler = 1;
+
+    for (int i = 0; i < band_count; ++i) {
+        png_band band = pool.take(i);
+        if (!band.ok) {
+            return false;
         }
-        case pixel_format::rgb888: {
-            // Add alpha channel
-            rgba_pixels.resize(w * h * 4);
-            const auto* src = surf.pixels().data();
-            auto* dst = rgba_pixels.data();
-            for (unsigned i = 0; i < w * h; ++i) {
-                dst[i * 4 + 0] = src[i * 3 + 0];
-                dst[i * 4 + 1] = src[i * 3 + 1];
-                dst[i * 4 + 2] = src[i * 3 + 2];
-                dst[i * 4 + 3] = 255;
-            }
-            break;
+        adler = adler32_combine(adler, band.adler, band.length);
+        if (i == 0) {
+            band.deflated.insert(band.deflated.begin(), std::begin(ZLIB_HEADER), std::end(ZLIB_HEADER));
         }
-        case pixel_format::indexed8: {
-            // Convert indexed to RGBA using palette
-            rgba_pixels.resize(w * h * 4);
-            const auto* indices = surf.pixels().data();
-            const auto palette = surf.palette();
-            auto* dst = rgba_pixels.data();
-
-            for (unsigned i = 0; i < w * h; ++i) {
-                const std::size_t idx = indices[i];
-                const std::size_t pal_offset = idx * 3;
-
-                if (pal_offset + 2 < palette.size()) {
-                    dst[i * 4 + 0] = palette[pal_offset + 0];
-                    dst[i * 4 + 1] = palette[pal_offset + 1];
-                    dst[i * 4 + 2] = palette[pal_offset + 2];
-                } else {
-                    // Missing palette entry - use black
-                    dst[i * 4 + 0] = 0;
-                    dst[i * 4 + 1] = 0;
-                    dst[i * 4 + 2] = 0;
-                }
-                dst[i * 4 + 3] = 255;
+        if (i == band_count - 1) {
+            append_be32(band.deflated, adler);
+        }
+
+        for (std::size_t pos = 0; pos < band.deflated.size(); pos += PNG_MAX_IDAT_SIZE) {
+            if (!emit_chunk(sink, buffer, CHUNK_IDAT, band.deflated.data() + pos,
+                            std::min(PNG_MAX_IDAT_SIZE, band.deflated.size() - pos))) {
+                return false;
             }
-            break;
         }
     }
 
-    std::vector<std::uint8_t> png_data;
-    unsigned error = lodepng::encode(png_data, rgba_pixels, w, h);
-    if (error) {
-        return {};
-    }
+    return emit_chunk(sink, buffer, CHUNK_IEND, nullptr, 0);
+}
 
-    return png_data;
+template <typename Image>
+std::vector<std::uint8_t> encode_image(const Image& surf, const png_encode_options& options) {
+    std::vector<std::uint8_t> png_data;
+    const bool ok = write_image(surf, [&](std::span<const std::uint8_t> bytes) {
+        png_data.insert(png_data.end(), bytes.begin(), bytes.end());
+        return true;
+    }, options);
+    return ok ? png_data : std::vector<std::uint8_t>{};
 }
 
-bool save_png(const memory_surface& surf, const std::filesystem::path& path) {
-    auto png_data = encode_png(surf);
-    if (png_data.empty()) {
+template <typename Image>
+bool save_image(const Image& surf, const std::filesystem::path& path, const png_encode_options& options) {
+    if (surf.width() <= 0 || surf.height() <= 0) {
         return false;
     }
 
-    std::ofstream file(path, std::ios::binary);
-    if (!file) {
+    // Written under a temporary name, so a failed encode leaves no
+    // truncated file and an existing one untouched
+    atomic_file file(path);
+    if (!file.is_open()) {
         return false;
     }
 
-    file.write(reinterpret_cast<const char*>(png_data.data()),
-               static_cast<std::streamsize>(png_data.size()));
+    // Chunks are written as bands finish
+    return write_image(surf, [&](std::span<const std::uint8_t> bytes) {
+        return file.write(bytes.data(), bytes.size());
+    }, options) && file.commit();
+}
+
+} // namespace
+
+bool write_png(const memory_surface& surf, const png_sink& sink, const png_encode_options& options) {
+    return write_image(surf, sink, options);
+}
+
+bool write_png(const shared_surface& surf, const png_sink& sink, const png_encode_options& options) {
+    return write_image(surf, sink, options);
+}
+
+std::vector<std::uint8_t> encode_png(const memory_surface& surf, const png_encode_options& options) {
+    return encode_image(surf, options);
+}
+
+std::vector<std::uint8_t> encode_png(const shared_surface& surf, const png_encode_options& options) {
+    return encode_image(surf, options);
+}
+
+bool save_png(const memory_surface& surf, const std::filesystem::path& path,
+              const png_encode_options& options) {
+    return save_image(surf, path, options);
+}
 
-    return file.good();
+bool save_png(const shared_surface& surf, const std::filesystem::path& path,
+              const png_encode_options& options) {
+    return save_image(surf, path, options);
 }
 
 // ============================================================================
 // PNG Surface
 // ============================================================================
 
-std::vector<std::uint8_t> png_surface::encode() const {
-    return encode_png(*this);
+std::vector<std::uint8_t> png_surface::encode(const png_encode_options& options) const {
+    return encode_png(*this, options);
 }
 
-bool png_surface::save(const std::filesystem::path& path) const {
-    return save_png(*this, path);
+bool png_surface::save(const std::filesystem::path& path, const png_encode_options& options) const {
+    return save_png(*this, path, options);
 }
 
 } // namespace onyx_image
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "simd.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace onyx_image {
+
+// PNG scanline filter reconstruction (filter method 0).
+// SSE2 kernels cover Up for any pixel size and Sub, Average and Paeth for
+// 3- and 4-byte pixels (8-bit RGB/RGBA), following libpng's
+// filter_sse2_intrinsics.c; everything else uses the scalar loops.
+
+// Paeth predictor from the left (a), upper (b) and upper-left (c) bytes
+constexpr int paeth_predictor(int a, int b, int c) noexcept {
+    const int pa = b > c ? b - c : c - b;
+    const int pb = a > c ? a - c : c - a;
+    const int pc = (a + b > 2 * c) ? a + b - 2 * c : 2 * c - a - b;
+    return (pa <= pb && pa <= pc) ? a : (pb <= pc ? b : c);
+}
+
+namespace detail {
+
+#ifdef ONYX_IMAGE_HAS_SSE2
+// Load/store one pixel of 3 or 4 bytes in the low lane
+inline __m128i load_pixel(const std::uint8_t* p, std::size_t bpp) noexcept {
+    std::uint32_t v = 0;
+    std::memcpy(&v, p, bpp);
+    return _mm_cvtsi32_si128(static_cast<int>(v));
+}
+
+inline void store_pixel(std::uint8_t* p, __m128i v, std::size_t bpp) noexcept {
+    const auto bits = static_cast<std::uint32_t>(_mm_cvtsi128_si32(v));
+    std::memcpy(p, &bits, bpp);
+}
+
+inline __m128i abs_epi16(__m128i x) noexcept {
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+inline __m128i select(__m128i mask, __m128i a, __m128i b) noexcept {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline void unfilter_sub_simd(std::uint8_t* row, std::size_t length, std::size_t bpp) noexcept {
+    __m128i a = _mm_setzero_si128();
+    for (std::size_t i = 0; i < length; i += bpp) {
+        a = _mm_add_epi8(a, load_pixel(row + i, bpp));
+        store_pixel(row + i, a, bpp);
+    }
+}
+
+inline void unfilter_avg_simd(std::uint8_t* row, const std::uint8_t* prev,
+                              std::size_t length, std::size_t bpp) noexcept {
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i a = _mm_setzero_si128();
+    for (std::size_t i = 0; i < length; i += bpp) {
+        const __m128i b = load_pixel(prev + i, bpp);
+        // _mm_avg_epu8 rounds up; the PNG average rounds down
+        __m128i avg = _mm_avg_epu8(a, b);
+        avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), one));
+        a = _mm_add_epi8(load_pixel(row + i, bpp), avg);
+        store_pixel(row + i, a, bpp);
+    }
+}
+
+inline void unfilter_paeth_simd(std::uint8_t* row, const std::uint8_t* prev,
+                                std::size_t length, std::size_t bpp) noexcept {
+    // Work on 16-bit lanes so the predictor differences cannot overflow
+    const __m128i zero = _mm_setzero_si128();
+    __m128i a = zero;
+    __m128i c = zero;
+    for (std::size_t i = 0; i < length; i += bpp) {
+        const __m128i b = _mm_unpacklo_epi8(load_pixel(prev + i, bpp), zero);
+        const __m128i d = _mm_unpacklo_epi8(load_pixel(row + i, bpp), zero);
+
+        const __m128i pa_signed = _mm_sub_epi16(b, c);
+        const __m128i pb_signed = _mm_sub_epi16(a, c);
+        const __m128i pa = abs_epi16(pa_signed);
+        const __m128i pb = abs_epi16(pb_signed);
+        const __m128i pc = abs_epi16(_mm_add_epi16(pa_signed, pb_signed));
+
+        const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+        const __m128i nearest = select(_mm_cmpeq_epi16(smallest, pa), a,
+                                       select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+        a = _mm_and_si128(_mm_add_epi16(d, nearest), _mm_set1_epi16(0xFF));
+        store_pixel(row + i, _mm_packus_epi16(a, a), bpp);
+        c = b;
+    }
+}
+#endif
+
+} // namespace detail
+
+// Undo the filter of one scanline in place. prev is the unfiltered previous
+// scanline (nullptr for the first); bpp is bytes per pixel, at least 1.
+// Returns false for an unknown filter type.
+inline bool unfilter_row(std::uint8_t filter, std::uint8_t* row, const std::uint8_t* prev,
+                         std::size_t length, std::size_t bpp) noexcept {
+#ifdef ONYX_IMAGE_HAS_SSE2
+    const bool simd_pixels = (bpp == 3 || bpp == 4) && length % bpp == 0;
+#endif
+    switch (filter) {
+        case 0:  // None
+            return true;
+        case 1:  // Sub
+#ifdef ONYX_IMAGE_HAS_SSE2
+            if (simd_pixels) {
+                detail::unfilter_sub_simd(row, length, bpp);
+                return true;
+            }
+#endif
+            for (std::size_t i = bpp; i < length; ++i) {
+                row[i] = static_cast<std::uint8_t>(row[i] + row[i - bpp]);
+            }
+            return true;
+        case 2:  // Up
+            if (prev) {
+                std::size_t i = 0;
+#ifdef ONYX_IMAGE_HAS_SSE2
+                for (; i + 16 <= length; i += 16) {
+                    const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+                    const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(row + i), _mm_add_epi8(r, p));
+                }
+#endif
+                for (; i < length; ++i) {
+                    row[i] = static_cast<std::uint8_t>(row[i] + prev[i]);
+                }
+            }
+            return true;
+        case 3:  // Average
+#ifdef ONYX_IMAGE_HAS_SSE2
+            if (simd_pixels && prev) {
+                detail::unfilter_avg_simd(row, prev, length, bpp);
+                return true;
+            }
+#endif
+            for (std::size_t i = 0; i < length; ++i) {
+                const unsigned left = i >= bpp ? row[i - bpp] : 0u;
+                const unsigned up = prev ? prev[i] : 0u;
+                row[i] = static_cast<std::uint8_t>(row[i] + ((left + up) >> 1));
+            }
+            return true;
+        case 4:  // Paeth
+#ifdef ONYX_IMAGE_HAS_SSE2
+            if (simd_pixels && prev) {
+                detail::unfilter_paeth_simd(row, prev, length, bpp);
+                return true;
+            }
+#endif
+            for (std::size_t i = 0; i < length; ++i) {
+                const int a = i >= bpp ? row[i - bpp] : 0;
+                const int b = prev ? prev[i] : 0;
+                const int c = (i >= bpp && prev) ? prev[i - bpp] : 0;
+                row[i] = static_cast<std::uint8_t>(row[i] + paeth_predictor(a, b, c));
+            }
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace onyx_image
@@ -1,9 +1,13 @@
 #include <onyx_image/codecs/pnm.hpp>
+#include "frame_dedup.hpp"
+#include "simd.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <cctype>
 #include <charconv>
 #include <cstring>
+#include <limits>
 #include <vector>
 
 namespace onyx_image {
@@ -120,39 +124,196 @@ private:
     std::size_t pos_;
 };
 
+// Whitespace as accepted by std::isspace in the "C" locale
+constexpr bool is_pnm_space(std::uint8_t c) noexcept {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Reads the samples of a plain (ASCII) PNM raster.
+//
+// With SSE2 the input is classified 16 bytes at a time into digit and
+// whitespace masks; every digit run fully inside the block is one sample,
+// so several samples are parsed per block without per-byte class checks.
+// A run touching the end of the block is left for the next load. Blocks
+// containing anything else (signs, comments, garbage) and the final
+// partial block go through the scalar std::from_chars path, which keeps
+// the exact semantics of the original tokenizer.
+class ascii_sample_scanner {
+public:
+    ascii_sample_scanner(const std::uint8_t* begin, const std::uint8_t* end) noexcept
+        : p_(begin), end_(end) {}
+
+    [[nodiscard]] const std::uint8_t* position() const noexcept { return p_; }
+
+    // Parse `count` decimal samples. Returns false on malformed or truncated data.
+    bool read_numbers(int* out, std::size_t count) {
+        std::size_t n = 0;
+#ifdef ONYX_IMAGE_HAS_SSE2
+        while (n < count && end_ - p_ >= 16) {
+            unsigned digits = 0;
+            const unsigned spaces = classify(digits);
+
+            if ((digits | spaces) != 0xFFFFu) {
+                if (!read_number(out[n++])) return false;
+                continue;
+            }
+
+            unsigned usable = 16;
+            if (digits & 0x8000u) {
+                // Leave a number running into the next block for the next load
+                const unsigned gaps = ~digits & 0x7FFFu;
+                if (gaps == 0) {
+                    if (!read_number(out[n++])) return false;
+                    continue;
+                }
+                usable = static_cast<unsigned>(std::bit_width(gaps));
+                digits &= (1u << usable) - 1u;
+            }
+
+            const std::uint8_t* last_end = p_;
+            while (digits != 0 && n < count) {
+                const int start = std::countr_zero(digits);
+                const int len = std::countr_one(digits >> start);
+                if (!parse_digits(p_ + start, len, out[n++])) return false;
+                digits &= ~(((1u << len) - 1u) << start);
+                last_end = p_ + start + len;
+            }
+            p_ = n == count ? last_end : p_ + usable;
+        }
+#endif
+        for (; n < count; ++n) {
+            if (!read_number(out[n])) return false;
+        }
+        return true;
+    }
+
+    // Read `count` single-character PBM samples (no separator required)
+    bool read_chars(std::uint8_t* out, std::size_t count) {
+        std::size_t n = 0;
+#ifdef ONYX_IMAGE_HAS_SSE2
+        while (n < count && end_ - p_ >= 16) {
+            unsigned digits = 0;
+            unsigned samples = ~classify(digits) & 0xFFFFu;
+
+            const std::uint8_t* last_end = p_;
+            while (samples != 0 && n < count) {
+                const int i = std::countr_zero(samples);
+                out[n++] = p_[i];
+                samples &= samples - 1u;
+                last_end = p_ + i + 1;
+            }
+            p_ = n == count ? last_end : p_ + 16;
+        }
+#endif
+        for (; n < count; ++n) {
+            while (p_ < end_ && is_pnm_space(*p_)) ++p_;
+            if (p_ >= end_) return false;
+            out[n] = *p_++;
+        }
+        return true;
+    }
+
+private:
+#ifdef ONYX_IMAGE_HAS_SSE2
+    // Bit masks of the digit and whitespace bytes in the next 16 bytes
+    unsigned classify(unsigned& digits) const noexcept {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_));
+        const __m128i d = _mm_sub_epi8(block, _mm_set1_epi8('0'));
+        const __m128i w = _mm_sub_epi8(block, _mm_set1_epi8('\t'));
+        digits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d)));
+        const __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+                                        _mm_cmpeq_epi8(_mm_min_epu8(w, _mm_set1_epi8(4)), w));
+        return static_cast<unsigned>(_mm_movemask_epi8(ws));
+    }
+#endif
+
+    // Digit run of at most 15 characters (leading zeros allowed)
+    static bool parse_digits(const std::uint8_t* p, int len, int& value) noexcept {
+        std::uint64_t v = 0;
+        for (int i = 0; i < len; ++i) {
+            v = v * 10 + static_cast<std::uint64_t>(p[i] - '0');
+        }
+        if (v > static_cast<std::uint64_t>(std::numeric_limits<int>::max())) return false;
+        value = static_cast<int>(v);
+        return true;
+    }
+
+    bool read_number(int& value) {
+        while (p_ < end_ && is_pnm_space(*p_)) ++p_;
+        if (p_ >= end_) return false;
+
+        const char* start = reinterpret_cast<const char*>(p_);
+        auto result = std::from_chars(start, reinterpret_cast<const char*>(end_), value);
+        if (result.ec != std::errc{}) return false;
+        p_ += result.ptr - start;
+        return true;
+    }
+
+    const std::uint8_t* p_;
+    const std::uint8_t* end_;
+};
+
+// Maps samples to 0-255 (value * 255 / maxval) through a table
+class maxval_scaler {
+public:
+    explicit maxval_scaler(int maxval) : maxval_(maxval), lut_(static_cast<std::size_t>(maxval) + 1) {
+        for (int v = 0; v <= maxval; ++v) {
+            lut_[static_cast<std::size_t>(v)] = static_cast<std::uint8_t>(v * 255 / maxval);
+        }
+    }
+
+    [[nodiscard]] std::uint8_t operator()(int v) const noexcept {
+        if (static_cast<unsigned>(v) <= static_cast<unsigned>(maxval_)) {
+            return lut_[static_cast<std::size_t>(v)];
+        }
+        // Out of range samples wrap like the arithmetic they replace
+        return static_cast<std::uint8_t>(static_cast<long long>(v) * 255 / maxval_);
+    }
+
+private:
+    int maxval_;
+    std::vector<std::uint8_t> lut_;
+};
+
+// Destination of one image in the stream: rows start at y_offset
+struct frame_target {
+    surface& surf;
+    int y_offset = 0;
+
+    void write_row(std::size_t y, const std::vector<std::uint8_t>& row) const {
+        surf.write_pixels(0, y_offset + static_cast<int>(y), static_cast<int>(row.size()), row.data());
+    }
+};
+
 // Decode ASCII PBM (P1)
-bool decode_pbm_ascii(std::span<const std::uint8_t> data, std::size_t offset,
+bool decode_pbm_ascii(std::span<const std::uint8_t> data, std::size_t& pos,
                       std::size_t width, std::size_t height,
-                      std::vector<std::uint8_t>& row_buffer, surface& surf) {
-    std::size_t pos = offset;
-    const std::size_t size = data.size();
+                      std::vector<std::uint8_t>& row_buffer, const frame_target& target) {
+    ascii_sample_scanner scanner(data.data() + pos, data.data() + data.size());
+    std::vector<std::uint8_t> samples(width);
 
     for (std::size_t y = 0; y < height; y++) {
-        for (std::size_t x = 0; x < width; x++) {
-            // Skip whitespace
-            while (pos < size && std::isspace(data[pos])) pos++;
-            if (pos >= size) return false;
+        if (!scanner.read_chars(samples.data(), width)) return false;
 
-            // Read single digit (0 or 1)
+        for (std::size_t x = 0; x < width; x++) {
             // In PBM: 1 = black, 0 = white
-            std::uint8_t val = (data[pos] == '0') ? 255 : 0;
-            pos++;
-
+            std::uint8_t val = (samples[x] == '0') ? 255 : 0;
             row_buffer[x * 3 + 0] = val;
             row_buffer[x * 3 + 1] = val;
             row_buffer[x * 3 + 2] = val;
         }
-        surf.write_pixels(0, static_cast<int>(y), static_cast<int>(row_buffer.size()), row_buffer.data());
+        target.write_row(y, row_buffer);
     }
+
+    pos = static_cast<std::size_t>(scanner.position() - data.data());
     return true;
 }
 
 // Decode binary PBM (P4)
-bool decode_pbm_binary(std::span<const std::uint8_t> data, std::size_t offset,
+bool decode_pbm_binary(std::span<const std::uint8_t> data, std::size_t& pos,
                        std::size_t width, std::size_t height,
-                       std::vector<std::uint8_t>& row_buffer, surface& surf) {
+                       std::vector<std::uint8_t>& row_buffer, const frame_target& target) {
     const std::size_t row_bytes = (width + 7) / 8;
-    std::size_t pos = offset;
 
     for (std::size_t y = 0; y < height; y++) {
         if (pos + row_bytes > data.size()) return false;
@@ -167,49 +328,50 @@ bool decode_pbm_binary(std::span<const std::uint8_t> data, std::size_t offset,
             row_buffer[x * 3 + 1] = val;
             row_buffer[x * 3 + 2] = val;
         }
-        surf.write_pixels(0, static_cast<int>(y), static_cast<int>(row_buffer.size()), row_buffer.data());
+        target.write_row(y, row_buffer);
         pos += row_bytes;
     }
     return true;
 }
 
-// Decode ASCII PGM (P2)
-bool decode_pgm_ascii(std::span<const std::uint8_t> data, std::size_t offset,
-                      std::size_t width, std::size_t height, int maxval,
-                      std::vector<std::uint8_t>& row_buffer, surface& surf) {
-    const char* ptr = reinterpret_cast<const char*>(data.data()) + offset;
-    const char* end = reinterpret_cast<const char*>(data.data()) + data.size();
+// Decode ASCII PGM (P2) and PPM (P3)
+bool decode_ascii_samples(std::span<const std::uint8_t> data, std::size_t& pos,
+                          std::size_t width, std::size_t height, std::size_t channels,
+                          const maxval_scaler& scale,
+                          std::vector<std::uint8_t>& row_buffer, const frame_target& target) {
+    ascii_sample_scanner scanner(data.data() + pos, data.data() + data.size());
+    std::vector<int> samples(width * channels);
 
     for (std::size_t y = 0; y < height; y++) {
-        for (std::size_t x = 0; x < width; x++) {
-            // Skip whitespace
-            while (ptr < end && std::isspace(*ptr)) ptr++;
-            if (ptr >= end) return false;
-
-            int val = 0;
-            auto result = std::from_chars(ptr, end, val);
-            if (result.ec != std::errc{}) return false;
-            ptr = result.ptr;
-
-            // Scale to 0-255
-            std::uint8_t pixel = static_cast<std::uint8_t>(val * 255 / maxval);
-            row_buffer[x * 3 + 0] = pixel;
-            row_buffer[x * 3 + 1] = pixel;
-            row_buffer[x * 3 + 2] = pixel;
+        if (!scanner.read_numbers(samples.data(), samples.size())) return false;
+
+        if (channels == 1) {
+            for (std::size_t x = 0; x < width; x++) {
+                std::uint8_t pixel = scale(samples[x]);
+                row_buffer[x * 3 + 0] = pixel;
+                row_buffer[x * 3 + 1] = pixel;
+                row_buffer[x * 3 + 2] = pixel;
+            }
+        } else {
+            for (std::size_t i = 0; i < samples.size(); i++) {
+                row_buffer[i] = scale(samples[i]);
+            }
         }
-        surf.write_pixels(0, static_cast<int>(y), static_cast<int>(row_buffer.size()), row_buffer.data());
+        target.write_row(y, row_buffer);
     }
+
+    pos = static_cast<std::size_t>(scanner.position() - data.data());
     return true;
 }
 
 // Decode binary PGM (P5)
-bool decode_pgm_binary(std::span<const std::uint8_t> data, std::size_t offset,
+bool decode_pgm_binary(std::span<const std::uint8_t> data, std::size_t& pos,
                        std::size_t width, std::size_t height, int maxval,
-                       std::vector<std::uint8_t>& row_buffer, surface& surf) {
+                       const maxval_scaler& scale,
+                       std::vector<std::uint8_t>& row_buffer, const frame_target& target) {
     const bool is_16bit = maxval > 255;
     const std::size_t bytes_per_pixel = is_16bit ? 2 : 1;
     const std::size_t row_bytes = width * bytes_per_pixel;
-    std::size_t pos = offset;
 
     for (std::size_t y = 0; y < height; y++) {
         if (pos + row_bytes > data.size()) return false;
@@ -223,76 +385,128 @@ bool decode_pgm_binary(std::span<const std::uint8_t> data, std::size_t offset,
                 val = data[pos + x];
             }
 
-            // Scale to 0-255
-            std::uint8_t pixel = static_cast<std::uint8_t>(val * 255 / maxval);
+            std::uint8_t pixel = scale(val);
             row_buffer[x * 3 + 0] = pixel;
             row_buffer[x * 3 + 1] = pixel;
             row_buffer[x * 3 + 2] = pixel;
         }
-        surf.write_pixels(0, static_cast<int>(y), static_cast<int>(row_buffer.size()), row_buffer.data());
+        target.write_row(y, row_buffer);
         pos += row_bytes;
     }
     return true;
 }
 
-// Decode ASCII PPM (P3)
-bool decode_ppm_ascii(std::span<const std::uint8_t> data, std::size_t offset,
-                      std::size_t width, std::size_t height, int maxval,
-                      std::vector<std::uint8_t>& row_buffer, surface& surf) {
-    const char* ptr = reinterpret_cast<const char*>(data.data()) + offset;
-    const char* end = reinterpret_cast<const char*>(data.data()) + data.size();
+// Decode binary PPM (P6)
+bool decode_ppm_binary(std::span<const std::uint8_t> data, std::size_t& pos,
+                       std::size_t width, std::size_t height, int maxval,
+                       const maxval_scaler& scale,
+                       std::vector<std::uint8_t>& row_buffer, const frame_target& target) {
+    const bool is_16bit = maxval > 255;
+    const std::size_t bytes_per_pixel = is_16bit ? 6 : 3;
+    const std::size_t row_bytes = width * bytes_per_pixel;
 
     for (std::size_t y = 0; y < height; y++) {
-        for (std::size_t x = 0; x < width; x++) {
-            for (std::size_t c = 0; c < 3; c++) {
-                // Skip whitespace
-                while (ptr < end && std::isspace(*ptr)) ptr++;
-                if (ptr >= end) return false;
-
-                int val = 0;
-                auto result = std::from_chars(ptr, end, val);
-                if (result.ec != std::errc{}) return false;
-                ptr = result.ptr;
-
-                // Scale to 0-255
-                row_buffer[x * 3 + c] = static_cast<std::uint8_t>(val * 255 / maxval);
+        if (pos + row_bytes > data.size()) return false;
+
+        const std::uint8_t* src = data.data() + pos;
+        if (maxval == 255) {
+            // Already 8-bit RGB
+            target.surf.write_pixels(0, target.y_offset + static_cast<int>(y),
+                                     static_cast<int>(row_bytes), src);
+        } else {
+            for (std::size_t i = 0; i < width * 3; i++) {
+                // Big-endian 16-bit or 8-bit samples
+                int val = is_16bit ? ((src[i * 2] << 8) | src[i * 2 + 1]) : src[i];
+                row_buffer[i] = scale(val);
             }
+            target.write_row(y, row_buffer);
         }
-        surf.write_pixels(0, static_cast<int>(y), static_cast<int>(row_buffer.size()), row_buffer.data());
+        pos += row_bytes;
     }
     return true;
 }
 
-// Decode binary PPM (P6)
-bool decode_ppm_binary(std::span<const std::uint8_t> data, std::size_t offset,
-                       std::size_t width, std::size_t height, int maxval,
-                       std::vector<std::uint8_t>& row_buffer, surface& surf) {
-    const bool is_16bit = maxval > 255;
-    const std::size_t bytes_per_pixel = is_16bit ? 6 : 3;
-    const std::size_t row_bytes = width * bytes_per_pixel;
-    std::size_t pos = offset;
+// Bytes per row of a binary (P4-P6) raster, 0 for the ASCII types
+std::size_t binary_row_bytes(const pnm_info& info) noexcept {
+    const auto width = static_cast<std::size_t>(info.width);
+    const std::size_t sample_bytes = info.maxval > 255 ? 2 : 1;
+    switch (info.type) {
+        case PNM_TYPE_PBM_BINARY: return (width + 7) / 8;
+        case PNM_TYPE_PGM_BINARY: return width * sample_bytes;
+        case PNM_TYPE_PPM_BINARY: return width * sample_bytes * 3;
+        default: return 0;
+    }
+}
 
-    for (std::size_t y = 0; y < height; y++) {
-        if (pos + row_bytes > data.size()) return false;
+// Decode one image whose header is in info. On success pos is just past
+// the image's raster data.
+decode_result decode_frame(std::span<const std::uint8_t> data, const pnm_info& info,
+                           const frame_target& target, std::size_t& pos) {
+    const auto width = static_cast<std::size_t>(info.width);
+    const auto height = static_cast<std::size_t>(info.height);
 
-        for (std::size_t x = 0; x < width; x++) {
-            for (std::size_t c = 0; c < 3; c++) {
-                int val;
-                if (is_16bit) {
-                    // Big-endian 16-bit
-                    std::size_t idx = pos + x * 6 + c * 2;
-                    val = (data[idx] << 8) | data[idx + 1];
-                } else {
-                    val = data[pos + x * 3 + c];
-                }
+    pos = info.data_offset;
 
-                // Scale to 0-255
-                row_buffer[x * 3 + c] = static_cast<std::uint8_t>(val * 255 / maxval);
+    // Binary rasters have a fixed extent; when the pixels are discarded
+    // checking that it is present is all a decode would do
+    if (target.surf.discards_pixels()) {
+        if (const std::size_t row_bytes = binary_row_bytes(info); row_bytes != 0) {
+            if (pos > data.size() || row_bytes * height > data.size() - pos) {
+                return decode_result::failure(decode_error::truncated_data, "Failed to decode PNM pixel data");
             }
+            pos += row_bytes * height;
+            return decode_result::success();
         }
-        surf.write_pixels(0, static_cast<int>(y), static_cast<int>(row_buffer.size()), row_buffer.data());
-        pos += row_bytes;
     }
+
+    std::vector<std::uint8_t> row_buffer(width * 3);
+    const maxval_scaler scale(info.maxval);
+    bool success = false;
+
+    switch (info.type) {
+        case PNM_TYPE_PBM_ASCII:
+            success = decode_pbm_ascii(data, pos, width, height, row_buffer, target);
+            break;
+        case PNM_TYPE_PGM_ASCII:
+            success = decode_ascii_samples(data, pos, width, height, 1, scale, row_buffer, target);
+            break;
+        case PNM_TYPE_PPM_ASCII:
+            success = decode_ascii_samples(data, pos, width, height, 3, scale, row_buffer, target);
+            break;
+        case PNM_TYPE_PBM_BINARY:
+            success = decode_pbm_binary(data, pos, width, height, row_buffer, target);
+            break;
+        case PNM_TYPE_PGM_BINARY:
+            success = decode_pgm_binary(data, pos, width, height, info.maxval, scale, row_buffer, target);
+            break;
+        case PNM_TYPE_PPM_BINARY:
+            success = decode_ppm_binary(data, pos, width, height, info.maxval, scale, row_buffer, target);
+            break;
+        default:
+            return decode_result::failure(decode_error::unsupported_encoding,
+                "Unsupported PNM type: P" + std::to_string(info.type));
+    }
+
+    if (!success) {
+        return decode_result::failure(decode_error::truncated_data, "Failed to decode PNM pixel data");
+    }
+    return decode_result::success();
+}
+
+// Parse the header of another image following `pos`, if there is one
+bool next_frame_header(std::span<const std::uint8_t> data, std::size_t pos, pnm_info& info) {
+    while (pos < data.size() && is_pnm_space(data[pos])) {
+        pos++;
+    }
+    if (pos >= data.size() || !pnm_decoder::sniff(data.subspan(pos))) {
+        return false;
+    }
+
+    pnm_parser parser(data.subspan(pos));
+    if (!parser.parse_header(info)) {
+        return false;
+    }
+    info.data_offset += pos;
     return true;
 }
 
@@ -327,49 +541,129 @@ decode_result pnm_decoder::decode(std::span<const std::uint8_t> data,
         return decode_result::failure(decode_error::dimensions_exceeded, "Image dimensions exceed limits");
     }
 
-    const auto width = static_cast<std::size_t>(info.width);
-    const auto height = static_cast<std::size_t>(info.height);
-
-    // All PNM formats are output as RGB
-    if (!surf.set_size(info.width, info.height, pixel_format::rgb888)) {
-        return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+    // Netpbm streams may hold several images back to back. A lone image is
+    // decoded straight into surf. Binary rasters have a fixed extent, so
+    // whether another image follows is known without decoding; an ASCII
+    // raster is decoded first, and only when another image follows it is
+    // it decoded again below as the first frame of the stack.
+    pnm_info next;
+    const std::size_t raster_bytes = binary_row_bytes(info) * static_cast<std::size_t>(info.height);
+    const bool followed = raster_bytes != 0 && info.data_offset <= data.size() &&
+                          raster_bytes <= data.size() - info.data_offset &&
+                          next_frame_header(data, info.data_offset + raster_bytes, next);
+    if (!followed) {
+        // All PNM formats are output as RGB
+        if (!surf.set_size(info.width, info.height, pixel_format::rgb888)) {
+            return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+        }
+        std::size_t end = 0;
+        decode_result lone = decode_frame(data, info, frame_target{surf, 0}, end);
+        if (!lone || raster_bytes != 0 || !next_frame_header(data, end, next)) {
+            return lone;
+        }
     }
 
-    std::vector<std::uint8_t> row_buffer(width * 3);
-    bool success = false;
+    // Otherwise decode every image to learn the extents, then copy them
+    // into the stack. When verifying, the frames are only checked and
+    // nothing is kept, unless they are needed to find repeated frames.
+    struct frame {
+        pnm_info info;
+        memory_surface pixels;
+    };
+    std::vector<frame> frames;
+    const bool verify_only = surf.discards_pixels();
+    const bool keep_frames = !verify_only || options.dedup_frames;
+
+    // Decode one frame; false if its pixels are missing or corrupt
+    std::size_t end = 0;
+    decode_result result = decode_result::success();
+    const auto decode_next = [&](const pnm_info& frame_info) {
+        frame f{frame_info, {}};
+        null_surface check;
+        surface& frame_surf = keep_frames ? static_cast<surface&>(f.pixels) : check;
+        if (!frame_surf.set_size(frame_info.width, frame_info.height, pixel_format::rgb888)) {
+            result = decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+            return false;
+        }
+        result = decode_frame(data, frame_info, frame_target{frame_surf, 0}, end);
+        if (!result) {
+            return false;
+        }
+        frames.push_back(std::move(f));
+        return true;
+    };
+    if (!decode_next(info)) {
+        return result;
+    }
 
-    switch (info.type) {
-        case PNM_TYPE_PBM_ASCII:
-            success = decode_pbm_ascii(data, info.data_offset, width, height,
-                                       row_buffer, surf);
-            break;
-        case PNM_TYPE_PGM_ASCII:
-            success = decode_pgm_ascii(data, info.data_offset, width, height,
-                                       info.maxval, row_buffer, surf);
-            break;
-        case PNM_TYPE_PPM_ASCII:
-            success = decode_ppm_ascii(data, info.data_offset, width, height,
-                                       info.maxval, row_buffer, surf);
+    std::size_t stack_width = static_cast<std::size_t>(info.width);
+    std::size_t stack_height = static_cast<std::size_t>(info.height);
+    while (next_frame_header(data, end, next)) {
+        // A frame that does not fit or does not decode ends the stack; the
+        // frames decoded so far are kept
+        const std::size_t width = std::max(stack_width, static_cast<std::size_t>(next.width));
+        const std::size_t height = stack_height + static_cast<std::size_t>(next.height);
+        if (width > static_cast<std::size_t>(max_w) || height > static_cast<std::size_t>(max_h) ||
+            !decode_next(next)) {
             break;
-        case PNM_TYPE_PBM_BINARY:
-            success = decode_pbm_binary(data, info.data_offset, width, height,
-                                        row_buffer, surf);
-            break;
-        case PNM_TYPE_PGM_BINARY:
-            success = decode_pgm_binary(data, info.data_offset, width, height,
-                                        info.maxval, row_buffer, surf);
-            break;
-        case PNM_TYPE_PPM_BINARY:
-            success = decode_ppm_binary(data, info.data_offset, width, height,
-                                        info.maxval, row_buffer, surf);
-            break;
-        default:
-            return decode_result::failure(decode_error::unsupported_encoding,
-                "Unsupported PNM type: P" + std::to_string(info.type));
+        }
+        stack_width = width;
+        stack_height = height;
     }
 
-    if (!success) {
-        return decode_result::failure(decode_error::truncated_data, "Failed to decode PNM pixel data");
+    if (frames.size() == 1) {
+        const auto& f = frames[0];
+        if (!surf.set_size(f.info.width, f.info.height, pixel_format::rgb888)) {
+            return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+        }
+        for (int y = 0; y < f.info.height && !verify_only; ++y) {
+            surf.write_pixels(0, y, f.info.width * 3, f.pixels.pixels().data() + static_cast<std::size_t>(y) * f.pixels.pitch());
+        }
+        return decode_result::success();
+    }
+
+    // Rows of each frame in the stack. With dedup_frames, frames equal to
+    // an earlier one share its rows.
+    std::vector<int> frame_y(frames.size());
+    frame_dedup dedup;
+    stack_height = 0;
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        const auto& f = frames[i];
+        const std::size_t copy = options.dedup_frames
+            ? dedup.find_or_add(i, {f.pixels.pixels().data(), f.pixels.pitch(), f.info.width, f.info.height,
+                                    pixel_format::rgb888})
+            : i;
+        if (copy != i) {
+            frame_y[i] = frame_y[copy];
+            continue;
+        }
+        frame_y[i] = static_cast<int>(stack_height);
+        stack_height += static_cast<std::size_t>(f.info.height);
+    }
+
+    // Stack all frames vertically
+    if (!surf.set_size(static_cast<int>(stack_width), static_cast<int>(stack_height), pixel_format::rgb888)) {
+        return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+    }
+
+    int next_y = 0;
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        const auto& f = frames[i];
+        if (frame_y[i] == next_y) {
+            const std::size_t row_bytes = static_cast<std::size_t>(f.info.width) * 3;
+            auto pixels = f.pixels.pixels();
+            for (int y = 0; y < f.info.height && !verify_only; ++y) {
+                surf.write_pixels(0, frame_y[i] + y, static_cast<int>(row_bytes),
+                                  pixels.data() + static_cast<std::size_t>(y) * f.pixels.pitch());
+            }
+            next_y += f.info.height;
+        }
+
+        subrect sr;
+        sr.rect = {0, frame_y[i], f.info.width, f.info.height};
+        sr.kind = subrect_kind::frame;
+        sr.user_tag = static_cast<std::uint32_t>(i);
+        surf.set_subrect(static_cast<int>(i), sr);
     }
 
     return decode_result::success();
@@ -0,0 +1,10 @@
+#pragma once
+
+// SIMD availability for codec kernels.
+//
+// SSE2 is part of the x86-64 baseline, so it is enabled whenever the
+// compiler targets it. Every kernel keeps a scalar path for other targets.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ONYX_IMAGE_HAS_SSE2 1
+#include <emmintrin.h>
+#endif
@@ -1,6 +1,8 @@
-// stb_image-based decoders for JPEG, TGA, GIF
+// stb_image-based decoder for GIF
 
 #define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_JPEG  // Native decoder in jpeg.cpp
+#define STBI_NO_TGA  // Native decoder in tga.cpp
 #define STBI_NO_PNG  // We use lodepng for PNG
 #define STBI_NO_BMP  // Custom BMP support planned
 #define STBI_NO_PSD
@@ -10,35 +12,152 @@
 
 #include <stb_image.h>
 
-#include <onyx_image/codecs/jpeg.hpp>
-#include <onyx_image/codecs/tga.hpp>
 #include <onyx_image/codecs/gif.hpp>
 #include "decode_helpers.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <limits>
 #include <memory>
+#include <vector>
 
 namespace onyx_image {
 
 namespace {
 
-// Common stb_image decode helper
-decode_result stb_decode_common(std::span<const std::uint8_t> data,
-                                 surface& surf,
-                                 const decode_options& options) {
-    // Guard against data size exceeding INT_MAX (stb uses int for length)
-    if (data.size() > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
-        return decode_result::failure(decode_error::truncated_data,
-            "Input data exceeds maximum supported size");
+// stb_image callbacks over a byte_source. The info pass is recorded so the
+// load pass can replay it: a pipe cannot be rewound, and stb starts each
+// pass from the first byte. Only the header bytes the info pass consumed
+// are kept.
+class stb_stream {
+public:
+    explicit stb_stream(byte_source& src) noexcept : src_(src) {}
+
+    static const stbi_io_callbacks* callbacks() noexcept {
+        static constexpr stbi_io_callbacks io = {&stb_stream::read_cb, &stb_stream::skip_cb, &stb_stream::eof_cb};
+        return &io;
+    }
+
+    // Stop recording; the next pass starts over from the first byte
+    void rewind() noexcept {
+        recording_ = false;
+        replay_pos_ = 0;
+    }
+
+private:
+    std::size_t read(std::uint8_t* dst, std::size_t size) {
+        std::size_t got = 0;
+        if (!recording_ && replay_pos_ < recorded_.size()) {
+            got = std::min(size, recorded_.size() - replay_pos_);
+            std::memcpy(dst, recorded_.data() + replay_pos_, got);
+            replay_pos_ += got;
+        }
+        if (got < size) {
+            const std::size_t n = src_.read(dst + got, size - got);
+            if (recording_) {
+                recorded_.insert(recorded_.end(), dst + got, dst + got + n);
+            }
+            got += n;
+        }
+        return got;
+    }
+
+    void skip(std::size_t count) {
+        if (recording_) {
+            // Skipped bytes must still be replayed
+            std::uint8_t buffer[256];
+            while (count > 0) {
+                const std::size_t n = read(buffer, std::min(sizeof(buffer), count));
+                if (n == 0) return;
+                count -= n;
+            }
+            return;
+        }
+        const std::size_t replayed = std::min(count, recorded_.size() - std::min(replay_pos_, recorded_.size()));
+        replay_pos_ += replayed;
+        (void)src_.skip(count - replayed);
+    }
+
+    [[nodiscard]] bool at_end() const {
+        return (recording_ || replay_pos_ >= recorded_.size()) && src_.at_end();
+    }
+
+    static int read_cb(void* user, char* data, int size) {
+        if (size <= 0) return 0;
+        auto* self = static_cast<stb_stream*>(user);
+        return static_cast<int>(self->read(reinterpret_cast<std::uint8_t*>(data), static_cast<std::size_t>(size)));
+    }
+
+    static void skip_cb(void* user, int n) {
+        if (n > 0) static_cast<stb_stream*>(user)->skip(static_cast<std::size_t>(n));
+    }
+
+    static int eof_cb(void* user) {
+        return static_cast<stb_stream*>(user)->at_end() ? 1 : 0;
     }
 
+    byte_source& src_;
+    std::vector<std::uint8_t> recorded_;
+    std::size_t replay_pos_ = 0;
+    bool recording_ = true;
+};
+
+// Move stb output into the surface in its native channel count: gray ->
+// indexed8 with a gray ramp, RGB -> rgb888, RGBA -> rgba8888. Gray + alpha
+// has no surface format and is expanded to RGBA.
+decode_result store_stb_pixels(const stbi_uc* pixels, int width, int height, int channels,
+                               surface& surf) {
+    const auto w = static_cast<std::size_t>(width);
+    switch (channels) {
+        case 1: {
+            if (!surf.set_size(width, height, pixel_format::indexed8)) break;
+            std::uint8_t ramp[256 * 3];
+            for (int i = 0; i < 256; ++i) {
+                ramp[i * 3 + 0] = ramp[i * 3 + 1] = ramp[i * 3 + 2] = static_cast<std::uint8_t>(i);
+            }
+            surf.set_palette_size(256);
+            surf.write_palette(0, ramp);
+            write_rows(surf, pixels, w, height);
+            return decode_result::success();
+        }
+        case 2: {
+            if (!surf.set_size(width, height, pixel_format::rgba8888)) break;
+            std::vector<std::uint8_t> row(w * 4);
+            for (int y = 0; y < height; ++y) {
+                const stbi_uc* src = pixels + static_cast<std::size_t>(y) * w * 2;
+                for (std::size_t x = 0; x < w; ++x) {
+                    row[x * 4 + 0] = row[x * 4 + 1] = row[x * 4 + 2] = src[x * 2];
+                    row[x * 4 + 3] = src[x * 2 + 1];
+                }
+                surf.write_pixels(0, y, static_cast<int>(row.size()), row.data());
+            }
+            return decode_result::success();
+        }
+        case 3:
+            if (!surf.set_size(width, height, pixel_format::rgb888)) break;
+            write_rows(surf, pixels, w * 3, height);
+            return decode_result::success();
+        case 4:
+            if (!surf.set_size(width, height, pixel_format::rgba8888)) break;
+            write_rows(surf, pixels, w * 4, height);
+            return decode_result::success();
+        default:
+            return decode_result::failure(decode_error::unsupported_bit_depth, "Unsupported channel count");
+    }
+    return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+}
+
+// Common stb_image decode helper. info and load wrap the stbi_*_from_memory
+// or stbi_*_from_callbacks pair; load is asked for the native channel count.
+template <typename Info, typename Load>
+decode_result stb_decode_common(Info&& info, Load&& load,
+                                surface& surf,
+                                const decode_options& options) {
     // Pre-decode dimension check to avoid loading huge images
     int info_width = 0;
     int info_height = 0;
     int info_channels = 0;
-    if (stbi_info_from_memory(data.data(), static_cast<int>(data.size()),
-                              &info_width, &info_height, &info_channels)) {
+    if (info(&info_width, &info_height, &info_channels)) {
         auto result = validate_dimensions(info_width, info_height, options);
         if (!result) return result;
     }
@@ -46,19 +165,7 @@ decode_result stb_decode_common(std::span<const std::uint8_t> data,
     int width = 0;
     int height = 0;
     int channels = 0;
-
-    // Request RGBA output
-    constexpr int desired_channels = 4;
-
-    stbi_uc* pixels = stbi_load_from_memory(
-        data.data(),
-        static_cast<int>(data.size()),
-        &width,
-        &height,
-        &channels,
-        desired_channels
-    );
-
+    stbi_uc* pixels = load(&width, &height, &channels);
     if (!pixels) {
         return decode_result::failure(decode_error::invalid_format, stbi_failure_reason());
     }
@@ -66,90 +173,87 @@ decode_result stb_decode_common(std::span<const std::uint8_t> data,
     // Use unique_ptr for automatic cleanup
     std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> pixel_guard(pixels, stbi_image_free);
 
-    // Post-decode dimension check (fallback if stbi_info_from_memory failed)
+    // Post-decode dimension check (fallback if the info pass failed)
     auto result = validate_dimensions(width, height, options);
     if (!result) return result;
 
-    if (!surf.set_size(width, height, pixel_format::rgba8888)) {
-        return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
-    }
-
-    // Copy pixel data to surface
-    write_rows(surf, pixels, static_cast<std::size_t>(width) * 4, height);
-
-    return decode_result::success();
+    return store_stb_pixels(pixels, width, height, channels, surf);
 }
 
-} // namespace
-
-// ============================================================================
-// JPEG Decoder
-// ============================================================================
-
-bool jpeg_decoder::sniff(std::span<const std::uint8_t> data) noexcept {
-    // JPEG starts with FFD8FF
-    if (data.size() < 3) {
-        return false;
+decode_result stb_decode_memory(std::span<const std::uint8_t> data,
+                                surface& surf,
+                                const decode_options& options) {
+    // stb takes an int length; larger buffers go through the callbacks
+    if (data.size() > static_cast<std::size_t>(std::numeric_limits<int>::max())) {
+        memory_source src(data);
+        stb_stream stream(src);
+        return stb_decode_common(
+            [&](int* w, int* h, int* c) { return stbi_info_from_callbacks(stb_stream::callbacks(), &stream, w, h, c); },
+            [&](int* w, int* h, int* c) {
+                stream.rewind();
+                return stbi_load_from_callbacks(stb_stream::callbacks(), &stream, w, h, c, 0);
+            },
+            surf, options);
     }
-    return data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
-}
 
-decode_result jpeg_decoder::decode(std::span<const std::uint8_t> data,
-                                    surface& surf,
-                                    const decode_options& options) {
-    if (!sniff(data)) {
-        return decode_result::failure(decode_error::invalid_format, "Not a valid JPEG file");
-    }
-    return stb_decode_common(data, surf, options);
+    const auto size = static_cast<int>(data.size());
+    return stb_decode_common(
+        [&](int* w, int* h, int* c) { return stbi_info_from_memory(data.data(), size, w, h, c); },
+        [&](int* w, int* h, int* c) { return stbi_load_from_memory(data.data(), size, w, h, c, 0); },
+        surf, options);
 }
 
-// ============================================================================
-// TGA Decoder
-// ============================================================================
+decode_result stb_decode_stream(byte_source& src,
+                                surface& surf,
+                                const decode_options& options) {
+    stb_stream stream(src);
+    return stb_decode_common(
+        [&](int* w, int* h, int* c) { return stbi_info_from_callbacks(stb_stream::callbacks(), &stream, w, h, c); },
+        [&](int* w, int* h, int* c) {
+            stream.rewind();
+            return stbi_load_from_callbacks(stb_stream::callbacks(), &stream, w, h, c, 0);
+        },
+        surf, options);
+}
 
-bool tga_decoder::sniff(std::span<const std::uint8_t> data) noexcept {
-    // TGA has no magic number, but we can check for valid header fields
-    // Minimum TGA header is 18 bytes
-    if (data.size() < 18) {
-        return false;
+// Read the first bytes of a stream for sniffing; they are replayed to the
+// decoder through a prefix_source
+class prefix_source : public byte_source {
+public:
+    prefix_source(byte_source& src, std::size_t size) : src_(src), prefix_(size) {
+        // A source over a pipe may return fewer bytes than asked before its end
+        std::size_t got = 0;
+        while (got < size) {
+            const std::size_t n = src_.read(prefix_.data() + got, size - got);
+            if (n == 0) break;
+            got += n;
+        }
+        prefix_.resize(got);
     }
 
-    // Check image type (byte 2): valid values are 0-3, 9-11
-    const std::uint8_t image_type = data[2];
-    if (image_type > 11 || (image_type > 3 && image_type < 9)) {
-        return false;
-    }
+    [[nodiscard]] std::span<const std::uint8_t> prefix() const noexcept { return prefix_; }
 
-    // Check color map type (byte 1): must be 0 or 1
-    const std::uint8_t colormap_type = data[1];
-    if (colormap_type > 1) {
-        return false;
+    [[nodiscard]] std::size_t read(std::uint8_t* dst, std::size_t size) override {
+        std::size_t got = 0;
+        if (pos_ < prefix_.size()) {
+            got = std::min(size, prefix_.size() - pos_);
+            std::memcpy(dst, prefix_.data() + pos_, got);
+            pos_ += got;
+        }
+        return got + (got < size ? src_.read(dst + got, size - got) : 0);
     }
 
-    // Check bits per pixel (byte 16): valid values are 8, 15, 16, 24, 32
-    const std::uint8_t bpp = data[16];
-    if (bpp != 8 && bpp != 15 && bpp != 16 && bpp != 24 && bpp != 32) {
-        return false;
+    [[nodiscard]] bool at_end() const override {
+        return pos_ >= prefix_.size() && src_.at_end();
     }
 
-    // Check if dimensions are reasonable
-    const int width = data[12] | (data[13] << 8);
-    const int height = data[14] | (data[15] << 8);
-    if (width == 0 || height == 0 || width > 32768 || height > 32768) {
-        return false;
-    }
+private:
+    byte_source& src_;
+    std::vector<std::uint8_t> prefix_;
+    std::size_t pos_ = 0;
+};
 
-    return true;
-}
-
-decode_result tga_decoder::decode(std::span<const std::uint8_t> data,
-                                   surface& surf,
-                                   const decode_options& options) {
-    if (!sniff(data)) {
-        return decode_result::failure(decode_error::invalid_format, "Not a valid TGA file");
-    }
-    return stb_decode_common(data, surf, options);
-}
+} // namespace
 
 // ============================================================================
 // GIF Decoder
@@ -170,7 +274,17 @@ decode_result gif_decoder::decode(std::span<const std::uint8_t> data,
     if (!sniff(data)) {
         return decode_result::failure(decode_error::invalid_format, "Not a valid GIF file");
     }
-    return stb_decode_common(data, surf, options);
+    return stb_decode_memory(data, surf, options);
+}
+
+decode_result gif_decoder::decode(byte_source& src,
+                                   surface& surf,
+                                   const decode_options& options) {
+    prefix_source stream(src, 6);
+    if (!sniff(stream.prefix())) {
+        return decode_result::failure(decode_error::invalid_format, "Not a valid GIF file");
+    }
+    return stb_decode_stream(stream, surf, options);
 }
 
 } // namespace onyx_image
@@ -1,5 +1,6 @@
 #include <onyx_image/codecs/sunrast.hpp>
 #include "byte_io.hpp"
+#include "decode_helpers.hpp"
 
 #include <algorithm>
 #include <cstring>
@@ -61,47 +62,66 @@ bool parse_header(std::span<const std::uint8_t> data, ras_info& info) {
     return true;
 }
 
-// Returns true if decompression succeeded fully, false if truncated
-bool decode_rle(const std::uint8_t* src, std::size_t src_size,
-                std::vector<std::uint8_t>& dest, std::size_t dest_size) {
-    dest.clear();
-    dest.reserve(dest_size);
-
-    const std::uint8_t* end = src + src_size;
-
-    while (src < end && dest.size() < dest_size) {
-        std::uint8_t byte = *src++;
+// Expands an RT_BYTE_ENCODED stream on demand. A run that does not fit
+// in the requested span is remembered and continued by the next read,
+// so rows can be produced one at a time.
+class rle_reader {
+public:
+    rle_reader(const std::uint8_t* src, std::size_t src_size) noexcept
+        : src_(src), end_(src + src_size) {}
+
+    // Fill dest with the next dest_size bytes. Returns false if the
+    // stream is truncated.
+    bool read(std::uint8_t* dest, std::size_t dest_size) noexcept {
+        std::size_t pos = 0;
+
+        while (pos < dest_size) {
+            if (run_length_ > 0) {
+                const std::size_t n = std::min(run_length_, dest_size - pos);
+                std::memset(dest + pos, run_value_, n);
+                pos += n;
+                run_length_ -= n;
+                continue;
+            }
 
-        if (byte == RLE_FLAG) {
-            if (src >= end) {
+            if (src_ >= end_) {
                 return false;  // Truncated
             }
-            std::uint8_t count = *src++;
 
-            if (count == 0) {
-                // Literal 0x80 byte
-                dest.push_back(RLE_FLAG);
-            } else {
-                // Run of (count + 1) bytes
-                if (src >= end) {
+            std::uint8_t byte = *src_++;
+
+            if (byte == RLE_FLAG) {
+                if (src_ >= end_) {
                     return false;  // Truncated
                 }
-                std::uint8_t value = *src++;
-                std::size_t run_length = static_cast<std::size_t>(count) + 1;
-                std::size_t remaining = dest_size - dest.size();
-                std::size_t to_write = std::min(run_length, remaining);
-                for (std::size_t i = 0; i < to_write; i++) {
-                    dest.push_back(value);
+                std::uint8_t count = *src_++;
+
+                if (count == 0) {
+                    // Literal 0x80 byte
+                    dest[pos++] = RLE_FLAG;
+                } else {
+                    // Run of (count + 1) bytes
+                    if (src_ >= end_) {
+                        return false;  // Truncated
+                    }
+                    run_value_ = *src_++;
+                    run_length_ = static_cast<std::size_t>(count) + 1;
                 }
+            } else {
+                // Literal byte
+                dest[pos++] = byte;
             }
-        } else {
-            // Literal byte
-            dest.push_back(byte);
         }
+
+        return true;
     }
 
-    return dest.size() == dest_size;
-}
+private:
+    const std::uint8_t* src_;
+    const std::uint8_t* end_;
+    std::size_t run_length_ = 0;
+    std::uint8_t run_value_ = 0;
+};
 
 } // namespace
 
@@ -121,12 +141,8 @@ decode_result sunrast_decoder::decode(std::span<const std::uint8_t> data,
     }
 
     ras_info info;
-    try {
-        if (!parse_header(data, info)) {
-            return decode_result::failure(decode_error::invalid_format, "Failed to parse Sun Raster header");
-        }
-    } catch (const std::exception& e) {
-        return decode_result::failure(decode_error::invalid_format, e.what());
+    if (!parse_header(data, info)) {
+        return decode_result::failure(decode_error::invalid_format, "Failed to parse Sun Raster header");
     }
 
     if (info.width <= 0 || info.height <= 0) {
@@ -180,29 +196,16 @@ decode_result sunrast_decoder::decode(std::span<const std::uint8_t> data,
 
     // Get pixel data
     const std::uint8_t* pixel_data = data.data() + pixel_offset;
-    std::size_t pixel_data_size = data.size() - pixel_offset;
+    const std::size_t pixel_data_size = data.size() - pixel_offset;
 
-    // Calculate expected uncompressed size
     const std::size_t stride = row_stride(info.width, info.depth);
-    const std::size_t expected_size = stride * static_cast<std::size_t>(info.height);
-
-    // Decompress if RLE
-    std::vector<std::uint8_t> decompressed;
-    if (info.type == RT_BYTE_ENCODED) {
-        if (!decode_rle(pixel_data, pixel_data_size, decompressed, expected_size)) {
-            return decode_result::failure(decode_error::truncated_data,
-                "RLE decompression failed - truncated data");
-        }
-        pixel_data = decompressed.data();
-        pixel_data_size = decompressed.size();
-    }
 
     // Determine output format
     pixel_format out_format;
     if ((info.depth == 8 || info.depth == 4 || info.depth == 1) && !palette.empty()) {
-        out_format = pixel_format::indexed8;
+        out_format = indexed_format_for(info.depth, options);
     } else if (info.depth == 1) {
-        out_format = pixel_format::indexed8;
+        out_format = indexed_format_for(1, options);
         // Create default black/white palette
         palette = {0, 0, 0, 255, 255, 255};
     } else {
@@ -214,22 +217,44 @@ decode_result sunrast_decoder::decode(std::span<const std::uint8_t> data,
     }
 
     // Set palette if indexed
-    if (out_format == pixel_format::indexed8 && !palette.empty()) {
+    if (is_indexed(out_format) && !palette.empty()) {
         surf.set_palette_size(static_cast<int>(palette.size() / 3));
         surf.write_palette(0, palette);
     }
 
-    // Decode pixel data
+    // Decode pixel data. RLE data is expanded one row at a time.
     std::vector<std::uint8_t> row_buffer(static_cast<std::size_t>(info.width) * 4);
+    std::vector<std::uint8_t> rle_row;
+    rle_reader rle(pixel_data, pixel_data_size);
+    if (info.type == RT_BYTE_ENCODED) {
+        rle_row.resize(stride);
+    }
+    const bool verify_only = surf.discards_pixels();
 
     for (int y = 0; y < info.height; y++) {
-        const std::uint8_t* src_row = pixel_data + static_cast<std::size_t>(y) * stride;
+        const std::uint8_t* src_row = nullptr;
+
+        if (info.type == RT_BYTE_ENCODED) {
+            if (!rle.read(rle_row.data(), stride)) {
+                return decode_result::failure(decode_error::truncated_data,
+                    "RLE decompression failed - truncated data");
+            }
+            src_row = rle_row.data();
+        } else {
+            if (static_cast<std::size_t>(y + 1) * stride > pixel_data_size) {
+                return decode_result::failure(decode_error::truncated_data, "Unexpected end of data");
+            }
+            src_row = pixel_data + static_cast<std::size_t>(y) * stride;
+        }
 
-        if (src_row + stride > pixel_data + pixel_data_size) {
-            return decode_result::failure(decode_error::truncated_data, "Unexpected end of data");
+        if (verify_only) {
+            continue;  // Data checked, nothing to convert
         }
 
-        if (info.depth == 1) {
+        if (bytes_per_pixel(out_format) == 0) {
+            // Packed 1/4-bit, rows copied as stored
+            write_packed_row(surf, y, src_row, info.width, out_format);
+        } else if (info.depth == 1) {
             // 1-bit: MSB first
             for (std::size_t x = 0; x < static_cast<std::size_t>(info.width); x++) {
                 std::size_t byte_idx = x / 8;
@@ -0,0 +1,470 @@
+#include <onyx_image/codecs/tga.hpp>
+#include "byte_io.hpp"
+#include "decode_helpers.hpp"
+#include "pixel_convert.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+namespace onyx_image {
+
+namespace {
+
+// ============================================================================
+// Native Decode
+// ============================================================================
+//
+// Colormapped (types 1/9), truecolor (2/10) and grayscale (3/11) images,
+// raw or run-length encoded. Output stays as close to the stored pixels as
+// the surface formats allow:
+//
+//   8-bit colormapped   -> indexed8 with the color map as palette
+//   8-bit grayscale     -> indexed8 with a gray ramp
+//   15/16/24-bit        -> rgb888
+//   32-bit, gray+alpha  -> rgba8888
+//
+// Color maps that do not fit an 8-bit index, or whose 32-bit entries carry
+// real alpha, are expanded to rgb888/rgba8888 instead.
+//
+// Rows are decoded in file order and written straight to their final
+// surface row, so bottom-up images need no flip pass. Run-length packets
+// may span rows; the packet state carries over from one row to the next.
+
+constexpr std::size_t HEADER_SIZE = 18;
+constexpr std::size_t INPUT_CHUNK_SIZE = 64 * 1024;
+
+// TGA 2.0 footer: extension area offset, developer area offset, signature
+constexpr std::size_t FOOTER_SIZE = 26;
+constexpr char FOOTER_SIGNATURE[] = "TRUEVISION-XFILE.";  // Including the NUL
+
+// Image types; bit 3 marks run-length encoding
+constexpr int TYPE_COLORMAPPED = 1;
+constexpr int TYPE_TRUECOLOR = 2;
+constexpr int TYPE_GRAYSCALE = 3;
+constexpr int TYPE_RLE = 8;
+
+// Image descriptor bits
+constexpr std::uint8_t DESC_ALPHA_BITS = 0x0F;
+constexpr std::uint8_t DESC_RIGHT_TO_LEFT = 0x10;
+constexpr std::uint8_t DESC_TOP_DOWN = 0x20;
+constexpr std::uint8_t DESC_INTERLEAVE = 0xC0;
+
+struct tga_header {
+    std::uint8_t id_length = 0;
+    std::uint8_t colormap_type = 0;
+    std::uint8_t image_type = 0;
+    int colormap_first = 0;
+    int colormap_length = 0;
+    int colormap_bits = 0;
+    int width = 0;
+    int height = 0;
+    int bits_per_pixel = 0;
+    std::uint8_t descriptor = 0;
+
+    [[nodiscard]] int base_type() const noexcept { return image_type & ~TYPE_RLE; }
+    [[nodiscard]] bool rle() const noexcept { return (image_type & TYPE_RLE) != 0; }
+    [[nodiscard]] std::size_t pixel_size() const noexcept { return static_cast<std::size_t>(bits_per_pixel + 7) / 8; }
+    [[nodiscard]] std::size_t colormap_entry_size() const noexcept { return static_cast<std::size_t>(colormap_bits + 7) / 8; }
+};
+
+tga_header parse_header(const std::uint8_t* p) noexcept {
+    tga_header h;
+    h.id_length = p[0];
+    h.colormap_type = p[1];
+    h.image_type = p[2];
+    h.colormap_first = read_le16(p + 3);
+    h.colormap_length = read_le16(p + 5);
+    h.colormap_bits = p[7];
+    h.width = read_le16(p + 12);
+    h.height = read_le16(p + 14);
+    h.bits_per_pixel = p[16];
+    h.descriptor = p[17];
+    return h;
+}
+
+bool valid_colormap_bits(int bits) noexcept {
+    return bits == 15 || bits == 16 || bits == 24 || bits == 32;
+}
+
+// Header consistency shared by sniff() and decode()
+bool header_is_valid(const tga_header& h) noexcept {
+    if (h.width == 0 || h.height == 0 || h.colormap_type > 1) {
+        return false;
+    }
+    if ((h.descriptor & DESC_INTERLEAVE) != 0 || (h.descriptor & DESC_ALPHA_BITS) > 8) {
+        return false;
+    }
+    if (h.colormap_type == 1 && (h.colormap_length == 0 || !valid_colormap_bits(h.colormap_bits))) {
+        return false;
+    }
+    switch (h.base_type()) {
+        case TYPE_COLORMAPPED:
+            return h.colormap_type == 1 && (h.bits_per_pixel == 8 || h.bits_per_pixel == 16);
+        case TYPE_TRUECOLOR:
+            return h.bits_per_pixel == 15 || h.bits_per_pixel == 16 ||
+                   h.bits_per_pixel == 24 || h.bits_per_pixel == 32;
+        case TYPE_GRAYSCALE:
+            return h.bits_per_pixel == 8 || h.bits_per_pixel == 16;
+        default:
+            return false;
+    }
+}
+
+// 5-bit channel to 8 bits, rounding as (v * 255) / 31
+constexpr std::uint8_t expand5(unsigned v) noexcept {
+    return static_cast<std::uint8_t>((v * 255) / 31);
+}
+
+// One stored A1R5G5B5 / B,G,R / B,G,R,A value as R, G, B, A
+void decode_color(const std::uint8_t* src, int bits, std::uint8_t* rgba) noexcept {
+    if (bits <= 16) {
+        const unsigned p = read_le16(src);
+        rgba[0] = expand5((p >> 10) & 0x1F);
+        rgba[1] = expand5((p >> 5) & 0x1F);
+        rgba[2] = expand5(p & 0x1F);
+        rgba[3] = 0xFF;
+    } else {
+        rgba[0] = src[2];
+        rgba[1] = src[1];
+        rgba[2] = src[0];
+        rgba[3] = bits == 32 ? src[3] : 0xFF;
+    }
+}
+
+// Reverse the pixel order of a row (right-to-left images)
+void mirror_row(std::uint8_t* row, int width, std::size_t pixel_size) {
+    if (pixel_size == 1) {
+        std::reverse(row, row + width);
+        return;
+    }
+    std::uint8_t* left = row;
+    std::uint8_t* right = row + static_cast<std::size_t>(width - 1) * pixel_size;
+    std::uint8_t tmp[4];
+    while (left < right) {
+        std::memcpy(tmp, left, pixel_size);
+        std::memcpy(left, right, pixel_size);
+        std::memcpy(right, tmp, pixel_size);
+        left += pixel_size;
+        right -= pixel_size;
+    }
+}
+
+// Fill count pixels with the one at dst, doubling the copied span each
+// step so long runs cost a handful of memcpy calls
+void fill_run(std::uint8_t* dst, std::size_t count, std::size_t pixel_size) {
+    if (pixel_size == 1) {
+        std::memset(dst + 1, dst[0], count - 1);
+        return;
+    }
+    const std::size_t total = count * pixel_size;
+    std::size_t filled = pixel_size;
+    while (filled < total) {
+        const std::size_t n = std::min(filled, total - filled);
+        std::memcpy(dst + filled, dst, n);
+        filled += n;
+    }
+}
+
+// Input over a memory span or, in chunks, a byte_source
+class tga_input {
+public:
+    explicit tga_input(std::span<const std::uint8_t> data) noexcept
+        : pos_(data.data()), end_(data.data() + data.size()) {}
+
+    explicit tga_input(byte_source& src) : src_(&src), chunk_(INPUT_CHUNK_SIZE) {}
+
+    // Next byte, or -1 at the end of the input
+    int get() {
+        if (pos_ == end_ && !refill()) {
+            return -1;
+        }
+        return *pos_++;
+    }
+
+    bool read(std::uint8_t* dst, std::size_t size) {
+        while (size > 0) {
+            if (pos_ == end_ && !refill()) {
+                return false;
+            }
+            const std::size_t n = std::min(size, static_cast<std::size_t>(end_ - pos_));
+            std::memcpy(dst, pos_, n);
+            pos_ += n;
+            dst += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool skip(std::size_t size) {
+        const std::size_t buffered = static_cast<std::size_t>(end_ - pos_);
+        if (size <= buffered) {
+            pos_ += size;
+            return true;
+        }
+        pos_ = end_;
+        size -= buffered;
+        return src_ && src_->skip(size) == size;
+    }
+
+private:
+    bool refill() {
+        if (!src_) {
+            return false;
+        }
+        const std::size_t n = src_->read(chunk_.data(), chunk_.size());
+        pos_ = chunk_.data();
+        end_ = pos_ + n;
+        return n > 0;
+    }
+
+    const std::uint8_t* pos_ = nullptr;
+    const std::uint8_t* end_ = nullptr;
+    byte_source* src_ = nullptr;
+    std::vector<std::uint8_t> chunk_;
+};
+
+// Produces stored pixel rows, raw or expanded from run-length packets
+class tga_row_reader {
+public:
+    tga_row_reader(tga_input& input, bool rle, int width, std::size_t pixel_size) noexcept
+        : input_(input), rle_(rle), width_(width), pixel_size_(pixel_size) {}
+
+    // Fill dst with the next row of width * pixel_size bytes
+    bool read(std::uint8_t* dst) {
+        if (!rle_) {
+            return input_.read(dst, static_cast<std::size_t>(width_) * pixel_size_);
+        }
+        int x = 0;
+        while (x < width_) {
+            if (remaining_ == 0) {
+                const int packet = input_.get();
+                if (packet < 0) {
+                    return false;
+                }
+                remaining_ = (packet & 0x7F) + 1;
+                run_ = (packet & 0x80) != 0;
+                if (run_ && !input_.read(run_pixel_.data(), pixel_size_)) {
+                    return false;
+                }
+            }
+            const int n = std::min(remaining_, width_ - x);
+            std::uint8_t* out = dst + static_cast<std::size_t>(x) * pixel_size_;
+            if (run_) {
+                std::memcpy(out, run_pixel_.data(), pixel_size_);
+                fill_run(out, static_cast<std::size_t>(n), pixel_size_);
+            } else if (!input_.read(out, static_cast<std::size_t>(n) * pixel_size_)) {
+                return false;
+            }
+            x += n;
+            remaining_ -= n;
+        }
+        return true;
+    }
+
+private:
+    tga_input& input_;
+    bool rle_;
+    int width_;
+    std::size_t pixel_size_;
+    int remaining_ = 0;  // Pixels left in the current packet
+    bool run_ = false;
+    std::array<std::uint8_t, 4> run_pixel_{};
+};
+
+decode_result decode_tga(const tga_header& h, tga_input& input,
+                         surface& surf, const decode_options& options) {
+    if (!header_is_valid(h)) {
+        return decode_result::failure(decode_error::invalid_format, "Not a valid TGA file");
+    }
+    auto result = validate_dimensions(h.width, h.height, options);
+    if (!result) return result;
+
+    if (!input.skip(h.id_length)) {
+        return decode_result::failure(decode_error::truncated_data, "TGA image ID truncated");
+    }
+
+    // Color map entries as RGBA, placed at their index (first entry + n)
+    std::vector<std::uint8_t> colormap;
+    bool colormap_alpha = false;
+    if (h.colormap_type == 1) {
+        const std::size_t entry_size = h.colormap_entry_size();
+        std::vector<std::uint8_t> stored(static_cast<std::size_t>(h.colormap_length) * entry_size);
+        if (!input.read(stored.data(), stored.size())) {
+            return decode_result::failure(decode_error::truncated_data, "TGA color map truncated");
+        }
+        if (h.base_type() == TYPE_COLORMAPPED) {
+            const std::size_t first = static_cast<std::size_t>(h.colormap_first);
+            colormap.assign((first + static_cast<std::size_t>(h.colormap_length)) * 4, 0);
+            bool all_opaque = true;
+            bool all_clear = true;
+            for (int i = 0; i < h.colormap_length; ++i) {
+                std::uint8_t* entry = colormap.data() + (first + static_cast<std::size_t>(i)) * 4;
+                decode_color(stored.data() + static_cast<std::size_t>(i) * entry_size, h.colormap_bits, entry);
+                all_opaque = all_opaque && entry[3] == 0xFF;
+                all_clear = all_clear && entry[3] == 0;
+            }
+            // An alpha byte that is zero throughout is padding, not alpha
+            colormap_alpha = !all_opaque && !all_clear;
+        }
+    }
+    const std::size_t colormap_entries = colormap.size() / 4;
+
+    // Output format
+    const int type = h.base_type();
+    const bool indexed_out = (type == TYPE_COLORMAPPED && h.bits_per_pixel == 8 &&
+                              colormap_entries <= 256 && !colormap_alpha) ||
+                             (type == TYPE_GRAYSCALE && h.bits_per_pixel == 8);
+    pixel_format format = pixel_format::rgb888;
+    if (indexed_out) {
+        format = pixel_format::indexed8;
+    } else if ((type == TYPE_TRUECOLOR && h.bits_per_pixel == 32) ||
+               (type == TYPE_GRAYSCALE && h.bits_per_pixel == 16) ||
+               (type == TYPE_COLORMAPPED && colormap_alpha)) {
+        format = pixel_format::rgba8888;
+    }
+
+    if (!surf.set_size(h.width, h.height, format)) {
+        return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+    }
+    if (type == TYPE_COLORMAPPED && indexed_out) {
+        std::vector<std::uint8_t> palette(colormap_entries * 3);
+        for (std::size_t i = 0; i < colormap_entries; ++i) {
+            std::memcpy(palette.data() + i * 3, colormap.data() + i * 4, 3);
+        }
+        surf.set_palette_size(static_cast<int>(colormap_entries));
+        surf.write_palette(0, palette);
+    } else if (indexed_out) {
+        std::uint8_t ramp[256 * 3];
+        for (int i = 0; i < 256; ++i) {
+            ramp[i * 3 + 0] = ramp[i * 3 + 1] = ramp[i * 3 + 2] = static_cast<std::uint8_t>(i);
+        }
+        surf.set_palette_size(256);
+        surf.write_palette(0, ramp);
+    }
+
+    const std::size_t width = static_cast<std::size_t>(h.width);
+    const std::size_t pixel_size = h.pixel_size();
+    const std::size_t out_pixel_size = bytes_per_pixel(format);
+    const bool verify_only = surf.discards_pixels();
+    const bool top_down = (h.descriptor & DESC_TOP_DOWN) != 0;
+    const bool right_to_left = (h.descriptor & DESC_RIGHT_TO_LEFT) != 0;
+
+    std::vector<std::uint8_t> stored_row(width * pixel_size);
+    std::vector<std::uint8_t> out_row(indexed_out ? 0 : width * out_pixel_size);
+    tga_row_reader rows(input, h.rle(), h.width, pixel_size);
+
+    for (int row = 0; row < h.height; ++row) {
+        if (!rows.read(stored_row.data())) {
+            return decode_result::failure(decode_error::truncated_data, "TGA pixel data truncated");
+        }
+        if (verify_only) {
+            continue;
+        }
+
+        std::uint8_t* out = out_row.data();
+        if (indexed_out) {
+            out = stored_row.data();
+        } else if (type == TYPE_COLORMAPPED) {
+            for (std::size_t x = 0; x < width; ++x) {
+                const std::size_t index = h.bits_per_pixel == 8
+                    ? stored_row[x]
+                    : read_le16(stored_row.data() + x * 2);
+                std::uint8_t* d = out + x * out_pixel_size;
+                if (index < colormap_entries) {
+                    std::memcpy(d, colormap.data() + index * 4, out_pixel_size);
+                } else {
+                    std::memset(d, 0, out_pixel_size);
+                }
+            }
+        } else if (type == TYPE_GRAYSCALE) {
+            for (std::size_t x = 0; x < width; ++x) {
+                std::uint8_t* d = out + x * 4;
+                d[0] = d[1] = d[2] = stored_row[x * 2];
+                d[3] = stored_row[x * 2 + 1];
+            }
+        } else if (h.bits_per_pixel == 32) {
+            bgra_to_rgba_row(stored_row.data(), out, h.width, true);
+        } else if (h.bits_per_pixel == 24) {
+            for (std::size_t x = 0; x < width * 3; x += 3) {
+                out[x + 0] = stored_row[x + 2];
+                out[x + 1] = stored_row[x + 1];
+                out[x + 2] = stored_row[x + 0];
+            }
+        } else {
+            std::uint8_t rgba[4];
+            for (std::size_t x = 0; x < width; ++x) {
+                decode_color(stored_row.data() + x * 2, 16, rgba);
+                std::memcpy(out + x * 3, rgba, 3);
+            }
+        }
+
+        if (right_to_left) {
+            mirror_row(out, h.width, indexed_out ? 1 : out_pixel_size);
+        }
+        const int y = top_down ? row : h.height - 1 - row;
+        surf.write_pixels(0, y, static_cast<int>(width * (indexed_out ? 1 : out_pixel_size)), out);
+    }
+
+    return decode_result::success();
+}
+
+// End of the image data: the TGA 2.0 footer, extension area and developer
+// area follow it and are never read as pixels
+std::size_t image_data_end(std::span<const std::uint8_t> data) noexcept {
+    if (data.size() < HEADER_SIZE + FOOTER_SIZE) {
+        return data.size();
+    }
+    const std::uint8_t* footer = data.data() + data.size() - FOOTER_SIZE;
+    if (std::memcmp(footer + 8, FOOTER_SIGNATURE, sizeof(FOOTER_SIGNATURE)) != 0) {
+        return data.size();
+    }
+    std::size_t end = data.size() - FOOTER_SIZE;
+    for (const std::uint32_t offset : {read_le32(footer), read_le32(footer + 4)}) {
+        if (offset >= HEADER_SIZE && offset < end) {
+            end = offset;
+        }
+    }
+    return end;
+}
+
+} // namespace
+
+// ============================================================================
+// TGA Decoder
+// ============================================================================
+
+bool tga_decoder::sniff(std::span<const std::uint8_t> data) noexcept {
+    // TGA has no magic number; accept only headers whose fields agree with
+    // each other (see header_is_valid)
+    if (data.size() < HEADER_SIZE) {
+        return false;
+    }
+    return header_is_valid(parse_header(data.data()));
+}
+
+decode_result tga_decoder::decode(std::span<const std::uint8_t> data,
+                                   surface& surf,
+                                   const decode_options& options) {
+    if (!sniff(data)) {
+        return decode_result::failure(decode_error::invalid_format, "Not a valid TGA file");
+    }
+    tga_input input(data.subspan(HEADER_SIZE, image_data_end(data) - HEADER_SIZE));
+    return decode_tga(parse_header(data.data()), input, surf, options);
+}
+
+decode_result tga_decoder::decode(byte_source& src,
+                                   surface& surf,
+                                   const decode_options& options) {
+    // The footer is at the end of the file, but nothing past the pixel
+    // data is needed, so the stream is simply not read any further
+    tga_input input(src);
+    std::uint8_t header[HEADER_SIZE];
+    if (!input.read(header, HEADER_SIZE)) {
+        return decode_result::failure(decode_error::invalid_format, "Not a valid TGA file");
+    }
+    return decode_tga(parse_header(header), input, surf, options);
+}
+
+} // namespace onyx_image
@@ -0,0 +1,212 @@
+#include <onyx_image/decode_cache.hpp>
+#include <onyx_image/codec.hpp>
+#include "cache_key.hpp"
+
+#include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace onyx_image {
+
+namespace {
+
+// Bytes an entry is charged against the budget
+std::size_t image_bytes(const memory_surface& image) noexcept {
+    return sizeof(memory_surface) + image.pixels().size() + image.palette().size() +
+           image.subrects().size() * sizeof(subrect);
+}
+
+// Replay a decoded image into another surface as a decoder would write it
+decode_result copy_image(const memory_surface& image, surface& surf) {
+    if (!surf.set_size(image.width(), image.height(), image.format())) {
+        return decode_result::failure(decode_error::internal_error, "Failed to allocate surface");
+    }
+    const auto palette = image.palette();
+    if (!palette.empty()) {
+        surf.set_palette_size(static_cast<int>(palette.size() / 3));
+        surf.write_palette(0, palette);
+    }
+    const auto pixels = image.pixels();
+    const std::size_t pitch = image.pitch();
+    const std::size_t row_size = row_bytes(image.format(), static_cast<std::size_t>(image.width()));
+    for (int y = 0; y < image.height(); ++y) {
+        surf.write_pixels(0, y, static_cast<int>(row_size), pixels.data() + static_cast<std::size_t>(y) * pitch);
+    }
+    const auto& subrects = image.subrects();
+    for (std::size_t i = 0; i < subrects.size(); ++i) {
+        surf.set_subrect(static_cast<int>(i), subrects[i]);
+    }
+    return decode_result::success();
+}
+
+} // namespace
+
+// One LRU list per shard, most recently used first. last_use orders
+// entries across shards for eviction.
+struct decode_cache::shard {
+    struct entry {
+        decode_key key;
+        std::shared_ptr<const memory_surface> image;
+        std::size_t bytes = 0;
+        std::uint64_t last_use = 0;
+    };
+
+    struct key_hash {
+        std::size_t operator()(const decode_key& key) const noexcept {
+            return static_cast<std::size_t>(key.content.lo ^ key.options);
+        }
+    };
+
+    mutable std::mutex mutex;
+    std::list<entry> lru;
+    std::unordered_map<decode_key, std::list<entry>::iterator, key_hash> index;
+};
+
+decode_cache::decode_cache(std::size_t budget, int shard_count)
+    : budget_(budget) {
+    shards_.resize(static_cast<std::size_t>(std::max(shard_count, 1)));
+    for (auto& s : shards_) {
+        s = std::make_unique<shard>();
+    }
+}
+
+decode_cache::~decode_cache() = default;
+
+decode_result decode_cache::decode(std::span<const std::uint8_t> data,
+                                   std::shared_ptr<const memory_surface>& image,
+                                   const decode_options& options) {
+    return lookup(data, image, {}, options);
+}
+
+decode_result decode_cache::decode(std::span<const std::uint8_t> data,
+                                   std::shared_ptr<const memory_surface>& image,
+                                   std::string_view codec_name,
+                                   const decode_options& options) {
+    return lookup(data, image, codec_name, options);
+}
+
+decode_result decode_cache::decode(std::span<const std::uint8_t> data,
+                                   surface& surf,
+                                   std::string_view codec_name,
+                                   const decode_options& options) {
+    std::shared_ptr<const memory_surface> image;
+    auto result = lookup(data, image, codec_name, options);
+    if (!result) return result;
+    return copy_image(*image, surf);
+}
+
+decode_result decode_cache::lookup(std::span<const std::uint8_t> data,
+                                   std::shared_ptr<const memory_surface>& image,
+                                   std::string_view codec_name,
+                                   const decode_options& options) {
+    const decode_key key = make_decode_key(data, options, codec_name);
+    if (auto cached = find(key)) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        image = std::move(cached);
+        return decode_result::success();
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    decode_options uncached = options;
+    uncached.cache = nullptr;
+    auto decoded = std::make_shared<memory_surface>();
+    auto result = codec_name.empty()
+        ? onyx_image::decode(data, *decoded, uncached)
+        : onyx_image::decode(data, *decoded, codec_name, uncached);
+    if (!result) return result;
+
+    image = decoded;
+    insert(key, std::move(decoded));
+    return result;
+}
+
+std::shared_ptr<const memory_surface> decode_cache::find(const decode_key& key) {
+    shard& s = *shards_[key.content.hi % shards_.size()];
+    std::lock_guard lock(s.mutex);
+    const auto it = s.index.find(key);
+    if (it == s.index.end()) {
+        return nullptr;
+    }
+    s.lru.splice(s.lru.begin(), s.lru, it->second);
+    it->second->last_use = clock_.fetch_add(1, std::memory_order_relaxed);
+    return it->second->image;
+}
+
+void decode_cache::insert(const decode_key& key, std::shared_ptr<const memory_surface> image) {
+    const std::size_t bytes = image_bytes(*image);
+    if (bytes > budget_) {
+        return;
+    }
+
+    {
+        shard& s = *shards_[key.content.hi % shards_.size()];
+        std::lock_guard lock(s.mutex);
+        if (s.index.contains(key)) {
+            return;  // Decoded concurrently by another thread
+        }
+        s.lru.push_front({key, std::move(image), bytes, clock_.fetch_add(1, std::memory_order_relaxed)});
+        s.index.emplace(key, s.lru.begin());
+        bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    evict_over_budget();
+}
+
+// Evict the least recently used entry of all shards until the cache fits
+// its budget. The oldest entry of each shard is the back of its list, so
+// finding the victim takes one look per shard; only one shard lock is held
+// at a time.
+void decode_cache::evict_over_budget() {
+    while (bytes_.load(std::memory_order_relaxed) > budget_) {
+        shard* oldest = nullptr;
+        std::uint64_t oldest_use = 0;
+        for (auto& s : shards_) {
+            std::lock_guard lock(s->mutex);
+            if (!s->lru.empty() && (!oldest || s->lru.back().last_use < oldest_use)) {
+                oldest = s.get();
+                oldest_use = s->lru.back().last_use;
+            }
+        }
+        if (!oldest) {
+            return;
+        }
+
+        std::lock_guard lock(oldest->mutex);
+        if (oldest->lru.empty()) {
+            continue;  // Emptied meanwhile by another thread
+        }
+        const auto& victim = oldest->lru.back();
+        bytes_.fetch_sub(victim.bytes, std::memory_order_relaxed);
+        oldest->index.erase(victim.key);
+        oldest->lru.pop_back();
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void decode_cache::clear() {
+    for (auto& s : shards_) {
+        std::lock_guard lock(s->mutex);
+        for (const auto& e : s->lru) {
+            bytes_.fetch_sub(e.bytes, std::memory_order_relaxed);
+        }
+        s->lru.clear();
+        s->index.clear();
+    }
+}
+
+std::size_t decode_cache::entry_count() const {
+    std::size_t count = 0;
+    for (const auto& s : shards_) {
+        std::lock_guard lock(s->mutex);
+        count += s->lru.size();
+    }
+    return count;
+}
+
+decode_cache::statistics decode_cache::stats() const noexcept {
+    return {hits_.load(std::memory_order_relaxed),
+            misses_.load(std::memory_order_relaxed),
+            evictions_.load(std::memory_order_relaxed)};
+}
+
+} // namespace onyx_image
@@ -0,0 +1,205 @@
+#include <onyx_image/disk_cache.hpp>
+#include <onyx_image/codec.hpp>
+#include "cache_key.hpp"
+#include "raw_container.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#ifndef ONYX_IMAGE_VERSION_STRING
+#define ONYX_IMAGE_VERSION_STRING "unknown"
+#endif
+
+namespace onyx_image {
+
+namespace {
+
+constexpr const char* ENTRY_EXTENSION = ".oxr";
+constexpr const char* TEMPORARY_EXTENSION = ".tmp";
+
+// Temporary files older than this were left behind by a writer that died
+constexpr auto STALE_TEMPORARY_AGE = std::chrono::hours(1);
+
+// Part of every entry name, so that a library or container version change
+// starts from an empty cache instead of misreading old entries
+std::uint64_t version_key() noexcept {
+    static const std::uint64_t key = [] {
+        const std::string version = std::string("onyx_image ") + ONYX_IMAGE_VERSION_STRING + " raw " +
+                                    std::to_string(raw_container::VERSION);
+        return content_hash(reinterpret_cast<const std::uint8_t*>(version.data()), version.size()).lo;
+    }();
+    return key;
+}
+
+struct entry_file {
+    std::filesystem::path path;
+    std::uintmax_t size = 0;
+    std::filesystem::file_time_type time;
+};
+
+// Entry files in the directory; removes stale temporaries on the way
+std::vector<entry_file> scan_entries(const std::filesystem::path& directory) {
+    std::vector<entry_file> entries;
+    std::error_code ec;
+    const auto now = std::filesystem::file_time_type::clock::now();
+    for (std::filesystem::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code entry_ec;
+        if (!it->is_regular_file(entry_ec)) {
+            continue;
+        }
+        const auto& path = it->path();
+        const auto time = it->last_write_time(entry_ec);
+        if (entry_ec) {
+            continue;
+        }
+        if (path.extension() == ENTRY_EXTENSION) {
+            const auto size = it->file_size(entry_ec);
+            if (!entry_ec) {
+                entries.push_back({path, size, time});
+            }
+        } else if (path.extension() == TEMPORARY_EXTENSION && now - time > STALE_TEMPORARY_AGE) {
+            std::filesystem::remove(path, entry_ec);
+        }
+    }
+    return entries;
+}
+
+} // namespace
+
+disk_cache::disk_cache(std::filesystem::path directory, std::uintmax_t budget)
+    : directory_(std::move(directory)),
+      budget_(budget) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    open_ = std::filesystem::is_directory(directory_, ec);
+    if (open_) {
+        std::uintmax_t total = 0;
+        for (const auto& e : scan_entries(directory_)) {
+            total += e.size;
+        }
+        bytes_.store(total, std::memory_order_relaxed);
+    }
+}
+
+disk_cache::~disk_cache() = default;
+
+decode_result disk_cache::decode(std::span<const std::uint8_t> data,
+                                 std::shared_ptr<const mapped_image>& image,
+                                 const decode_options& options) {
+    return lookup(data, image, {}, options);
+}
+
+decode_result disk_cache::decode(std::span<const std::uint8_t> data,
+                                 std::shared_ptr<const mapped_image>& image,
+                                 std::string_view codec_name,
+                                 const decode_options& options) {
+    return lookup(data, image, codec_name, options);
+}
+
+std::filesystem::path disk_cache::entry_path(const decode_key& key) const {
+    char name[80];
+    std::snprintf(name, sizeof(name), "%016llx%016llx-%016llx-%016llx%s",
+                  static_cast<unsigned long long>(key.content.hi),
+                  static_cast<unsigned long long>(key.content.lo),
+                  static_cast<unsigned long long>(key.size),
+                  static_cast<unsigned long long>(key.options ^ version_key()),
+                  ENTRY_EXTENSION);
+    return directory_ / name;
+}
+
+decode_result disk_cache::lookup(std::span<const std::uint8_t> data,
+                                 std::shared_ptr<const mapped_image>& image,
+                                 std::string_view codec_name,
+                                 const decode_options& options) {
+    if (!open_) {
+        return decode_result::failure(decode_error::io_error, "Cache directory is not available");
+    }
+
+    const auto path = entry_path(make_decode_key(data, options, codec_name));
+    std::error_code ec;
+    if (auto cached = mapped_image::open(path)) {
+        // The modification time doubles as the last use for trim()
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        image = std::move(cached);
+        return decode_result::success();
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+
+    decode_options uncached = options;
+    uncached.cache = nullptr;
+    memory_surface decoded;
+    auto result = codec_name.empty()
+        ? onyx_image::decode(data, decoded, uncached)
+        : onyx_image::decode(data, decoded, codec_name, uncached);
+    if (!result) return result;
+
+    // Replaces a damaged entry as well
+    if (!save_raw_image(decoded, path)) {
+        return decode_result::failure(decode_error::io_error, "Failed to write cache entry");
+    }
+    auto stored = mapped_image::open(path);
+    if (!stored) {
+        return decode_result::failure(decode_error::io_error, "Failed to map cache entry");
+    }
+    image = std::move(stored);
+
+    const auto size = std::filesystem::file_size(path, ec);
+    if (!ec && bytes_.fetch_add(size, std::memory_order_relaxed) + size > budget_) {
+        trim();
+    }
+    return result;
+}
+
+// Other processes may share the directory, so the sizes and times are
+// always taken from the directory itself rather than from bookkeeping
+void disk_cache::trim() {
+    if (!open_) {
+        return;
+    }
+    auto entries = scan_entries(directory_);
+    std::uintmax_t total = 0;
+    for (const auto& e : entries) {
+        total += e.size;
+    }
+    std::sort(entries.begin(), entries.end(), [](const entry_file& a, const entry_file& b) {
+        return a.time < b.time;
+    });
+    for (const auto& e : entries) {
+        if (total <= budget_) {
+            break;
+        }
+        std::error_code ec;
+        if (std::filesystem::remove(e.path, ec)) {
+            total -= e.size;
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    bytes_.store(total, std::memory_order_relaxed);
+}
+
+void disk_cache::clear() {
+    if (!open_) {
+        return;
+    }
+    std::uintmax_t total = 0;
+    for (const auto& e : scan_entries(directory_)) {
+        std::error_code ec;
+        if (!std::filesystem::remove(e.path, ec)) {
+            total += e.size;  // Still mapped elsewhere (Windows)
+        }
+    }
+    bytes_.store(total, std::memory_order_relaxed);
+}
+
+disk_cache::statistics disk_cache::stats() const noexcept {
+    return {hits_.load(std::memory_order_relaxed),
+            misses_.load(std::memory_order_relaxed),
+            evictions_.load(std::memory_order_relaxed)};
+}
+
+} // namespace onyx_image
@@ -0,0 +1,193 @@
+#include "file_mapping.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <winioctl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace onyx_image {
+
+file_mapping::~file_mapping() {
+    close();
+}
+
+file_mapping::file_mapping(file_mapping&& other) noexcept
+    : base_(std::exchange(other.base_, nullptr)),
+      size_(std::exchange(other.size_, 0)),
+      writable_(std::exchange(other.writable_, false)) {}
+
+file_mapping& file_mapping::operator=(file_mapping&& other) noexcept {
+    if (this != &other) {
+        close();
+        base_ = std::exchange(other.base_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        writable_ = std::exchange(other.writable_, false);
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool file_mapping::open(const std::filesystem::path& path) {
+    close();
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return false;
+    }
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!base) {
+        return false;
+    }
+    base_ = base;
+    size_ = static_cast<std::size_t>(size.QuadPart);
+    return true;
+}
+
+bool file_mapping::create(const std::filesystem::path& path, std::size_t size) {
+    close();
+    if (size == 0) {
+        return false;
+    }
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    // Without the sparse flag NTFS allocates (and zeroes) the whole size
+    DWORD returned = 0;
+    DeviceIoControl(file, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &returned, nullptr);
+
+    const auto size64 = static_cast<std::uint64_t>(size);
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(size64 >> 32),
+                                        static_cast<DWORD>(size64 & 0xFFFFFFFFu), nullptr);
+    CloseHandle(file);
+    if (!mapping) {
+        return false;
+    }
+    void* base = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!base) {
+        return false;
+    }
+    base_ = base;
+    size_ = size;
+    writable_ = true;
+    return true;
+}
+
+void file_mapping::close() noexcept {
+    if (base_) {
+        UnmapViewOfFile(base_);
+        base_ = nullptr;
+        size_ = 0;
+        writable_ = false;
+    }
+}
+
+void file_mapping::release(std::size_t offset, std::size_t length) noexcept {
+    if (!base_ || offset >= size_) {
+        return;
+    }
+    // Unlocking pages that are not locked removes them from the working set
+    VirtualUnlock(static_cast<std::uint8_t*>(base_) + offset, std::min(length, size_ - offset));
+}
+
+#else
+
+bool file_mapping::open(const std::filesystem::path& path) {
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    const auto size = static_cast<std::size_t>(st.st_size);
+    void* base = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    base_ = base;
+    size_ = size;
+    return true;
+}
+
+bool file_mapping::create(const std::filesystem::path& path, std::size_t size) {
+    close();
+    if (size == 0) {
+        return false;
+    }
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) {
+        return false;
+    }
+    // Extending with ftruncate leaves a hole; blocks are allocated on write
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        return false;
+    }
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        return false;
+    }
+    base_ = base;
+    size_ = size;
+    writable_ = true;
+    return true;
+}
+
+void file_mapping::close() noexcept {
+    if (base_) {
+        ::munmap(base_, size_);
+        base_ = nullptr;
+        size_ = 0;
+        writable_ = false;
+    }
+}
+
+void file_mapping::release(std::size_t offset, std::size_t length) noexcept {
+    if (!base_ || offset >= size_) {
+        return;
+    }
+    static const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    const std::size_t end = offset + std::min(length, size_ - offset);
+    const std::size_t first = (offset + page - 1) / page * page;
+    const std::size_t last = end / page * page;
+    if (first < last) {
+        // Dirty pages of a shared file mapping are written back, not discarded
+        ::madvise(static_cast<std::uint8_t*>(base_) + first, last - first, MADV_DONTNEED);
+    }
+}
+
+#endif
+
+} // namespace onyx_image
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace onyx_image {
+
+// Memory mapping of a whole file, read-only (open) or read-write (create).
+// The file itself is closed once mapped; the mapping stays valid until
+// the object is closed or destroyed, also if the file is removed meanwhile
+// (on Windows removal fails while mapped).
+class file_mapping {
+public:
+    file_mapping() noexcept = default;
+    ~file_mapping();
+
+    file_mapping(file_mapping&& other) noexcept;
+    file_mapping& operator=(file_mapping&& other) noexcept;
+    file_mapping(const file_mapping&) = delete;
+    file_mapping& operator=(const file_mapping&) = delete;
+
+    // Map a file; false if it cannot be opened, is empty or cannot be mapped
+    [[nodiscard]] bool open(const std::filesystem::path& path);
+
+    // Create or truncate a file of size bytes, sparse where the file system
+    // supports it, and map it read-write. Unwritten bytes read as zero.
+    [[nodiscard]] bool create(const std::filesystem::path& path, std::size_t size);
+
+    // Unmap; writes through a created mapping stay in the file
+    void close() noexcept;
+
+    // Drop the pages of [offset, offset + length) from the resident set.
+    // Written data is kept (the pages are file-backed) and is read back on
+    // the next access. Only whole pages inside the range are released.
+    void release(std::size_t offset, std::size_t length) noexcept;
+
+    [[nodiscard]] bool is_open() const noexcept { return base_ != nullptr; }
+    [[nodiscard]] std::span<const std::uint8_t> data() const noexcept {
+        return {static_cast<const std::uint8_t*>(base_), size_};
+    }
+
+    // Empty unless created read-write
+    [[nodiscard]] std::span<std::uint8_t> writable_data() const noexcept {
+        return writable_ ? std::span<std::uint8_t>(static_cast<std::uint8_t*>(base_), size_)
+                         : std::span<std::uint8_t>();
+    }
+
+private:
+    void* base_ = nullptr;
+    std::size_t size_ = 0;
+    bool writable_ = false;
+};
+
+} // namespace onyx_image
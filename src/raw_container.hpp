@@ -0,0 +1,198 @@
+#pragma once
+
+#include <onyx_image/types.hpp>
+#include "codecs/byte_io.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+
+namespace onyx_image::raw_container {
+
+// Layout of a raw image container (all values little-endian):
+//
+//   0   magic "ONYXRAW\0"
+//   8   u32 container version
+//   12  u32 pixel_format
+//   16  u32 width, u32 height
+//   24  u32 palette entries, u32 subrect count
+//   32  u64 pitch
+//   40  u64 palette offset, u64 subrect offset, u64 pixel offset
+//   64  u64 pixel bytes, u64 file size
+//   80  reserved (zero) up to HEADER_SIZE
+//
+// followed by the palette (RGB triplets), the subrects (SUBRECT_SIZE
+// bytes each: x, y, w, h, kind, user_tag as 32-bit values) and, at a
+// PIXEL_ALIGNMENT boundary, height rows of pitch bytes. Readers go by the
+// offsets in the header rather than by this order.
+
+constexpr char MAGIC[8] = {'O', 'N', 'Y', 'X', 'R', 'A', 'W', '\0'};
+constexpr std::uint32_t VERSION = 1;
+constexpr std::size_t HEADER_SIZE = 128;
+constexpr std::size_t SUBRECT_SIZE = 24;
+constexpr std::size_t PIXEL_ALIGNMENT = 64;
+
+struct layout {
+    pixel_format format = pixel_format::rgba8888;
+    int width = 0;
+    int height = 0;
+    int palette_entries = 0;
+    int subrect_count = 0;
+    std::uint64_t pitch = 0;
+    std::uint64_t palette_offset = 0;
+    std::uint64_t subrect_offset = 0;
+    std::uint64_t pixel_offset = 0;
+    std::uint64_t pixel_bytes = 0;
+    std::uint64_t file_size = 0;
+};
+
+[[nodiscard]] constexpr std::uint64_t align_up(std::uint64_t value, std::uint64_t alignment) noexcept {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Offsets and sizes for an image of the given shape
+[[nodiscard]] inline layout plan(int width, int height, pixel_format format, std::uint64_t pitch,
+                                 int palette_entries, int subrect_count) noexcept {
+    layout l;
+    l.format = format;
+    l.width = width;
+    l.height = height;
+    l.palette_entries = palette_entries;
+    l.subrect_count = subrect_count;
+    l.pitch = pitch;
+    l.palette_offset = HEADER_SIZE;
+    l.subrect_offset = l.palette_offset + static_cast<std::uint64_t>(palette_entries) * 3;
+    l.pixel_offset = align_up(l.subrect_offset + static_cast<std::uint64_t>(subrect_count) * SUBRECT_SIZE,
+                              PIXEL_ALIGNMENT);
+    l.pixel_bytes = pitch * static_cast<std::uint64_t>(height);
+    l.file_size = l.pixel_offset + l.pixel_bytes;
+    return l;
+}
+
+inline void encode_header(const layout& l, std::uint8_t* out) noexcept {
+    std::memset(out, 0, HEADER_SIZE);
+    std::memcpy(out, MAGIC, sizeof(MAGIC));
+    write_le32(out + 8, VERSION);
+    write_le32(out + 12, static_cast<std::uint32_t>(l.format));
+    write_le32(out + 16, static_cast<std::uint32_t>(l.width));
+    write_le32(out + 20, static_cast<std::uint32_t>(l.height));
+    write_le32(out + 24, static_cast<std::uint32_t>(l.palette_entries));
+    write_le32(out + 28, static_cast<std::uint32_t>(l.subrect_count));
+    write_le64(out + 32, l.pitch);
+    write_le64(out + 40, l.palette_offset);
+    write_le64(out + 48, l.subrect_offset);
+    write_le64(out + 56, l.pixel_offset);
+    write_le64(out + 64, l.pixel_bytes);
+    write_le64(out + 72, l.file_size);
+}
+
+// Fields of one stored image as read from a file, before any checks
+struct stored_image {
+    std::uint32_t format = 0;
+    std::uint32_t width = 0;
+    std::uint32_t height = 0;
+    std::uint32_t palette_entries = 0;
+    std::uint32_t subrect_count = 0;
+    std::uint64_t pitch = 0;
+    std::uint64_t palette_offset = 0;
+    std::uint64_t subrect_offset = 0;
+    std::uint64_t pixel_offset = 0;
+};
+
+// Check a stored image against the `available` bytes of its file: the
+// shape must be valid, the pitch must hold a row, the pixels must be
+// aligned, and every section must lie inside the file, no earlier than
+// `first_offset`. The sections may otherwise be anywhere (save_raw_image()
+// uses plan(), mapped_surface puts the subrects last). Returns the layout
+// with file_size left zero. Raw containers and asset packs share this.
+[[nodiscard]] inline std::optional<layout> check_image(const stored_image& s, std::uint64_t available,
+                                                       std::uint64_t first_offset) noexcept {
+    if (s.format > static_cast<std::uint32_t>(pixel_format::indexed4) ||
+        s.width == 0 || s.height == 0 || s.width > 0x7FFFFFFF || s.height > 0x7FFFFFFF ||
+        s.palette_entries > 256 || s.subrect_count > 0x7FFFFFFF) {
+        return std::nullopt;
+    }
+
+    // Section [offset, offset + size) lies after first_offset and inside the file
+    const auto fits = [&](std::uint64_t offset, std::uint64_t size) {
+        return offset >= first_offset && offset <= available && size <= available - offset;
+    };
+    const auto format = static_cast<pixel_format>(s.format);
+    if (s.pitch < row_bytes(format, s.width) ||
+        s.pitch > (~std::uint64_t{0}) / s.height ||
+        s.pixel_offset % PIXEL_ALIGNMENT != 0 ||
+        !fits(s.palette_offset, std::uint64_t{s.palette_entries} * 3) ||
+        !fits(s.subrect_offset, std::uint64_t{s.subrect_count} * SUBRECT_SIZE) ||
+        !fits(s.pixel_offset, s.pitch * s.height)) {
+        return std::nullopt;
+    }
+
+    layout l;
+    l.format = format;
+    l.width = static_cast<int>(s.width);
+    l.height = static_cast<int>(s.height);
+    l.palette_entries = static_cast<int>(s.palette_entries);
+    l.subrect_count = static_cast<int>(s.subrect_count);
+    l.pitch = s.pitch;
+    l.palette_offset = s.palette_offset;
+    l.subrect_offset = s.subrect_offset;
+    l.pixel_offset = s.pixel_offset;
+    l.pixel_bytes = s.pitch * s.height;
+    return l;
+}
+
+// Parse and check a header against the bytes actually present (see
+// check_image); the recorded pixel and file sizes must agree with it.
+[[nodiscard]] inline std::optional<layout> decode_header(std::span<const std::uint8_t> file) noexcept {
+    if (file.size() < HEADER_SIZE || std::memcmp(file.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        return std::nullopt;
+    }
+    const std::uint8_t* p = file.data();
+    if (read_le32(p + 8) != VERSION) {
+        return std::nullopt;
+    }
+
+    stored_image s;
+    s.format = read_le32(p + 12);
+    s.width = read_le32(p + 16);
+    s.height = read_le32(p + 20);
+    s.palette_entries = read_le32(p + 24);
+    s.subrect_count = read_le32(p + 28);
+    s.pitch = read_le64(p + 32);
+    s.palette_offset = read_le64(p + 40);
+    s.subrect_offset = read_le64(p + 48);
+    s.pixel_offset = read_le64(p + 56);
+    auto l = check_image(s, file.size(), HEADER_SIZE);
+    if (!l || read_le64(p + 64) != l->pixel_bytes) {
+        return std::nullopt;
+    }
+    l->file_size = read_le64(p + 72);
+    if (l->file_size > file.size()) {
+        return std::nullopt;
+    }
+    return l;
+}
+
+inline void encode_subrect(const subrect& sr, std::uint8_t* out) noexcept {
+    write_le32(out + 0, static_cast<std::uint32_t>(sr.rect.x));
+    write_le32(out + 4, static_cast<std::uint32_t>(sr.rect.y));
+    write_le32(out + 8, static_cast<std::uint32_t>(sr.rect.w));
+    write_le32(out + 12, static_cast<std::uint32_t>(sr.rect.h));
+    write_le32(out + 16, static_cast<std::uint32_t>(sr.kind));
+    write_le32(out + 20, sr.user_tag);
+}
+
+[[nodiscard]] inline subrect decode_subrect(const std::uint8_t* in) noexcept {
+    subrect sr;
+    sr.rect.x = read_le32_signed(in + 0);
+    sr.rect.y = read_le32_signed(in + 4);
+    sr.rect.w = read_le32_signed(in + 8);
+    sr.rect.h = read_le32_signed(in + 12);
+    sr.kind = static_cast<subrect_kind>(read_le32(in + 16));
+    sr.user_tag = read_le32(in + 20);
+    return sr;
+}
+
+} // namespace onyx_image::raw_container
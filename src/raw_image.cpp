@@ -0,0 +1,278 @@
+#include <onyx_image/raw_image.hpp>
+#include "atomic_file.hpp"
+#include "file_mapping.hpp"
+#include "raw_container.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <system_error>
+
+namespace onyx_image {
+
+namespace {
+
+void write_container(const memory_surface& image, atomic_file& file) {
+    const auto palette = image.palette();
+    const auto& subrects = image.subrects();
+    const auto l = raw_container::plan(image.width(), image.height(), image.format(), image.pitch(),
+                                       static_cast<int>(palette.size() / 3), static_cast<int>(subrects.size()));
+
+    std::vector<std::uint8_t> head(static_cast<std::size_t>(l.pixel_offset), 0);
+    raw_container::encode_header(l, head.data());
+    std::copy(palette.begin(), palette.end(), head.begin() + static_cast<std::ptrdiff_t>(l.palette_offset));
+    for (std::size_t i = 0; i < subrects.size(); ++i) {
+        raw_container::encode_subrect(subrects[i], head.data() + l.subrect_offset + i * raw_container::SUBRECT_SIZE);
+    }
+
+    const auto pixels = image.pixels();
+    file.write(head.data(), head.size());
+    file.write(pixels.data(), pixels.size());
+}
+
+} // namespace
+
+bool save_raw_image(const memory_surface& image, const std::filesystem::path& path) {
+    if (image.width() <= 0 || image.height() <= 0) {
+        return false;
+    }
+
+    atomic_file file(path);
+    write_container(image, file);
+    return file.commit();
+}
+
+// ============================================================================
+// mapped_image
+// ============================================================================
+
+mapped_image::mapped_image() = default;
+mapped_image::~mapped_image() = default;
+
+std::shared_ptr<const mapped_image> mapped_image::open(const std::filesystem::path& path) {
+    auto mapping = std::make_unique<file_mapping>();
+    if (!mapping->open(path)) {
+        return nullptr;
+    }
+    const auto data = mapping->data();
+    const auto l = raw_container::decode_header(data);
+    if (!l) {
+        return nullptr;
+    }
+
+    std::shared_ptr<mapped_image> image(new mapped_image());
+    image->width_ = l->width;
+    image->height_ = l->height;
+    image->format_ = l->format;
+    image->pitch_ = static_cast<std::size_t>(l->pitch);
+    image->palette_ = data.subspan(static_cast<std::size_t>(l->palette_offset),
+                                   static_cast<std::size_t>(l->palette_entries) * 3);
+    image->pixels_ = data.subspan(static_cast<std::size_t>(l->pixel_offset),
+                                  static_cast<std::size_t>(l->pixel_bytes));
+    image->subrects_.reserve(static_cast<std::size_t>(l->subrect_count));
+    for (int i = 0; i < l->subrect_count; ++i) {
+        image->subrects_.push_back(raw_container::decode_subrect(
+            data.data() + l->subrect_offset + static_cast<std::size_t>(i) * raw_container::SUBRECT_SIZE));
+    }
+    image->mapping_ = std::move(mapping);
+    return image;
+}
+
+// ============================================================================
+// mapped_surface
+// ============================================================================
+
+namespace {
+
+// Pixels start on a page after the header and room for a full palette;
+// the subrects follow the pixels since their number is not known upfront
+constexpr std::size_t MAPPED_PIXEL_OFFSET = 4096;
+static_assert(MAPPED_PIXEL_OFFSET >= raw_container::HEADER_SIZE + 256 * 3);
+static_assert(MAPPED_PIXEL_OFFSET % raw_container::PIXEL_ALIGNMENT == 0);
+
+// Every RELEASE_INTERVAL bytes written, pages further than RELEASE_WINDOW
+// from the latest write are released. Decoders emit rows top-down or
+// bottom-up, so those rows are finished; a decoder returning to them
+// only costs a page fault.
+constexpr std::size_t RELEASE_INTERVAL = 16 * 1024 * 1024;
+constexpr std::size_t RELEASE_WINDOW = 4 * 1024 * 1024;
+
+} // namespace
+
+mapped_surface::mapped_surface(std::filesystem::path path, std::uint64_t max_bytes)
+    : path_(std::move(path)),
+      temp_path_(temporary_path(path_)),
+      mapping_(std::make_unique<file_mapping>()),
+      max_bytes_(max_bytes) {}
+
+mapped_surface::~mapped_surface() {
+    discard();
+}
+
+void mapped_surface::discard() noexcept {
+    if (mapping_->is_open()) {
+        mapping_->close();
+        std::error_code ec;
+        std::filesystem::remove(temp_path_, ec);
+    }
+}
+
+bool mapped_surface::set_size(int width, int height, pixel_format format) {
+    discard();
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    const auto w = static_cast<std::uint64_t>(width);
+    const auto h = static_cast<std::uint64_t>(height);
+    const std::uint64_t pitch = row_bytes(format, static_cast<std::size_t>(w));
+    if (pitch > max_bytes_ / h ||
+        pitch * h > std::numeric_limits<std::size_t>::max() - MAPPED_PIXEL_OFFSET) {
+        return false;
+    }
+    if (!mapping_->create(temp_path_, MAPPED_PIXEL_OFFSET + static_cast<std::size_t>(pitch * h))) {
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    format_ = format;
+    pitch_ = static_cast<std::size_t>(pitch);
+    palette_.clear();
+    subrects_.clear();
+    resident_begin_ = resident_end_ = written_ = 0;
+    return true;
+}
+
+void mapped_surface::note_write(std::size_t offset, std::size_t length) noexcept {
+    if (resident_begin_ == resident_end_) {
+        resident_begin_ = offset;
+        resident_end_ = offset + length;
+    } else {
+        resident_begin_ = std::min(resident_begin_, offset);
+        resident_end_ = std::max(resident_end_, offset + length);
+    }
+    written_ += length;
+    if (written_ < RELEASE_INTERVAL) {
+        return;
+    }
+    written_ = 0;
+
+    const std::size_t keep_begin = std::max(resident_begin_, offset > RELEASE_WINDOW ? offset - RELEASE_WINDOW : 0);
+    const std::size_t keep_end = std::min(resident_end_, offset + length + RELEASE_WINDOW);
+    if (resident_begin_ < keep_begin) {
+        mapping_->release(resident_begin_, keep_begin - resident_begin_);
+    }
+    if (keep_end < resident_end_) {
+        mapping_->release(keep_end, resident_end_ - keep_end);
+    }
+    resident_begin_ = keep_begin;
+    resident_end_ = keep_end;
+}
+
+void mapped_surface::write_pixels(int x, int y, int count, const std::uint8_t* pixels) {
+    if (!mapping_->is_open() || y < 0 || y >= height_ || x < 0 || count <= 0 || !pixels) {
+        return;
+    }
+    const auto x_offset = static_cast<std::size_t>(x);
+    if (x_offset >= pitch_) {
+        return;
+    }
+
+    const std::size_t offset = MAPPED_PIXEL_OFFSET + static_cast<std::size_t>(y) * pitch_ + x_offset;
+    const std::size_t bytes = std::min(static_cast<std::size_t>(count), pitch_ - x_offset);
+    std::memcpy(mapping_->writable_data().data() + offset, pixels, bytes);
+    note_write(offset, bytes);
+}
+
+void mapped_surface::write_pixel(int x, int y, std::uint8_t pixel) {
+    if (!mapping_->is_open() || x < 0 || x >= width_ || y < 0 || y >= height_ || !is_indexed(format_)) {
+        return;
+    }
+
+    const std::size_t row_offset = MAPPED_PIXEL_OFFSET + static_cast<std::size_t>(y) * pitch_;
+    put_indexed_pixel(mapping_->writable_data().data() + row_offset, static_cast<std::size_t>(x), format_, pixel);
+    note_write(row_offset + static_cast<std::size_t>(x) * bits_per_pixel(format_) / 8, 1);
+}
+
+void mapped_surface::set_palette_size(int count) {
+    if (count <= 0 || count > 256) {
+        return;
+    }
+    palette_.assign(static_cast<std::size_t>(count) * 3, 0);
+}
+
+void mapped_surface::write_palette(int start, std::span<const std::uint8_t> colors) {
+    if (start < 0 || colors.empty()) {
+        return;
+    }
+    const std::size_t start_offset = static_cast<std::size_t>(start) * 3;
+    if (start_offset >= palette_.size()) {
+        return;
+    }
+    const std::size_t bytes_to_copy = std::min(colors.size(), palette_.size() - start_offset);
+    std::memcpy(palette_.data() + start_offset, colors.data(), bytes_to_copy);
+}
+
+void mapped_surface::set_subrect(int index, const subrect& sr) {
+    if (index < 0) {
+        return;
+    }
+    if (static_cast<std::size_t>(index) >= subrects_.size()) {
+        subrects_.resize(static_cast<std::size_t>(index) + 1);
+    }
+    subrects_[static_cast<std::size_t>(index)] = sr;
+}
+
+bool mapped_surface::finish() {
+    if (!mapping_->is_open()) {
+        return false;
+    }
+
+    raw_container::layout l;
+    l.format = format_;
+    l.width = width_;
+    l.height = height_;
+    l.palette_entries = static_cast<int>(palette_.size() / 3);
+    l.subrect_count = static_cast<int>(subrects_.size());
+    l.pitch = pitch_;
+    l.palette_offset = raw_container::HEADER_SIZE;
+    l.pixel_offset = MAPPED_PIXEL_OFFSET;
+    l.pixel_bytes = static_cast<std::uint64_t>(pitch_) * static_cast<std::uint64_t>(height_);
+    l.subrect_offset = l.pixel_offset + l.pixel_bytes;
+    l.file_size = l.subrect_offset + subrects_.size() * raw_container::SUBRECT_SIZE;
+
+    // Header and palette go into the space reserved in front of the pixels
+    std::uint8_t* base = mapping_->writable_data().data();
+    raw_container::encode_header(l, base);
+    std::memcpy(base + l.palette_offset, palette_.data(), palette_.size());
+    mapping_->close();
+
+    // The file ends with the pixels; the subrects are appended
+    bool ok = true;
+    if (!subrects_.empty()) {
+        std::vector<std::uint8_t> table(subrects_.size() * raw_container::SUBRECT_SIZE);
+        for (std::size_t i = 0; i < subrects_.size(); ++i) {
+            raw_container::encode_subrect(subrects_[i], table.data() + i * raw_container::SUBRECT_SIZE);
+        }
+        std::FILE* file = open_file(temp_path_, "ab");
+        ok = file && std::fwrite(table.data(), 1, table.size(), file) == table.size();
+        if (file) {
+            ok = std::fclose(file) == 0 && ok;
+        }
+    }
+
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(temp_path_, path_, ec);
+    }
+    if (!ok || ec) {
+        std::filesystem::remove(temp_path_, ec);
+        return false;
+    }
+    return true;
+}
+
+} // namespace onyx_image
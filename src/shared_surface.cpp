@@ -0,0 +1,96 @@
+#include <onyx_image/shared_surface.hpp>
+
+namespace onyx_image {
+
+shared_surface::shared_surface(std::shared_ptr<const memory_surface> image) {
+    if (!image || image->width() <= 0 || image->height() <= 0) {
+        return;
+    }
+    pixels_ = image->pixels().data();
+    palette_ = image->palette();
+    subrects_ = image->subrects();
+    width_ = image->width();
+    height_ = image->height();
+    pitch_ = image->pitch();
+    format_ = image->format();
+    owner_ = std::move(image);
+}
+
+shared_surface::shared_surface(std::shared_ptr<const mapped_image> image) {
+    if (!image || image->width() <= 0 || image->height() <= 0) {
+        return;
+    }
+    pixels_ = image->pixels().data();
+    palette_ = image->palette();
+    subrects_ = image->subrects();
+    width_ = image->width();
+    height_ = image->height();
+    pitch_ = image->pitch();
+    format_ = image->format();
+    owner_ = std::move(image);
+}
+
+shared_surface::shared_surface(std::shared_ptr<const void> owner, int width, int height, pixel_format format,
+                               std::size_t pitch, const std::uint8_t* pixels,
+                               std::span<const std::uint8_t> palette, std::span<const subrect> subrects) {
+    if (!pixels || width <= 0 || height <= 0) {
+        return;
+    }
+    owner_ = std::move(owner);
+    pixels_ = pixels;
+    palette_ = palette;
+    subrects_ = subrects;
+    width_ = width;
+    height_ = height;
+    pitch_ = pitch;
+    format_ = format;
+}
+
+std::span<const std::uint8_t> shared_surface::pixels() const noexcept {
+    if (empty()) {
+        return {};
+    }
+    return {pixels_, static_cast<std::size_t>(height_ - 1) * pitch_ +
+                     row_bytes(format_, static_cast<std::size_t>(width_))};
+}
+
+std::span<const std::uint8_t> shared_surface::row(int y) const noexcept {
+    if (y < 0 || y >= height_) {
+        return {};
+    }
+    return {pixels_ + static_cast<std::size_t>(y) * pitch_, row_bytes(format_, static_cast<std::size_t>(width_))};
+}
+
+shared_surface shared_surface::crop(const image_rect& rect) const {
+    if (rect.x < 0 || rect.y < 0 || rect.w <= 0 || rect.h <= 0 ||
+        rect.w > width_ - rect.x || rect.h > height_ - rect.y) {
+        return {};
+    }
+    const std::size_t bit_offset = static_cast<std::size_t>(rect.x) * bits_per_pixel(format_);
+    if (bit_offset % 8 != 0) {
+        return {};  // Packed pixel in the middle of a byte
+    }
+
+    shared_surface view;
+    view.owner_ = owner_;
+    view.pixels_ = pixels_ + static_cast<std::size_t>(rect.y) * pitch_ + bit_offset / 8;
+    view.palette_ = palette_;
+    view.width_ = rect.w;
+    view.height_ = rect.h;
+    view.pitch_ = pitch_;
+    view.format_ = format_;
+    return view;
+}
+
+shared_surface shared_surface::subrect_view(std::size_t index) const {
+    if (index >= subrects_.size()) {
+        return {};
+    }
+    return crop(subrects_[index].rect);
+}
+
+shared_surface freeze(memory_surface&& surf) {
+    return shared_surface(std::make_shared<const memory_surface>(std::move(surf)));
+}
+
+} // namespace onyx_image
@@ -1,42 +1,105 @@
 #include <onyx_image/surface.hpp>
+#include <onyx_image/shared_surface.hpp>
 
 #include <algorithm>
+#include <array>
 #include <cstring>
 #include <limits>
+#include <tuple>
 
 namespace onyx_image {
 
-bool memory_surface::set_size(int width, int height, pixel_format format) {
+namespace {
+
+// Row pitch for the given layout, or 0 if the dimensions or the layout
+// are invalid or the buffer would exceed the size limit
+std::size_t checked_pitch(int width, int height, pixel_format format, const row_layout& layout = {}) noexcept {
     if (width <= 0 || height <= 0) {
-        return false;
+        return 0;
+    }
+    if (layout.alignment == 0 || (layout.alignment & (layout.alignment - 1)) != 0) {
+        return 0;
     }
 
     const std::size_t w = static_cast<std::size_t>(width);
     const std::size_t h = static_cast<std::size_t>(height);
-    const std::size_t bpp = bytes_per_pixel(format);
+    const std::size_t bits = bits_per_pixel(format);
 
-    // Check for overflow in pitch calculation (width * bpp)
-    if (w > std::numeric_limits<std::size_t>::max() / bpp) {
-        return false;
+    // Check for overflow in pitch calculation (width * bits)
+    if (w > (std::numeric_limits<std::size_t>::max() - 7) / bits) {
+        return 0;
+    }
+    const std::size_t row_size = row_bytes(format, w);
+
+    std::size_t pitch = layout.pitch;
+    if (pitch == 0) {
+        if (row_size > std::numeric_limits<std::size_t>::max() - (layout.alignment - 1)) {
+            return 0;
+        }
+        pitch = (row_size + layout.alignment - 1) & ~(layout.alignment - 1);
+    } else if (pitch < row_size) {
+        return 0;
     }
-    const std::size_t pitch = w * bpp;
 
     // Check for overflow in total size calculation (pitch * height)
     if (pitch > std::numeric_limits<std::size_t>::max() / h) {
-        return false;
+        return 0;
     }
-    const std::size_t total_size = pitch * h;
 
     // Additional sanity check - limit to reasonable maximum (1GB)
     constexpr std::size_t MAX_BUFFER_SIZE = 1024ULL * 1024ULL * 1024ULL;
-    if (total_size > MAX_BUFFER_SIZE) {
+    if (pitch * h > MAX_BUFFER_SIZE) {
+        return 0;
+    }
+
+    return pitch;
+}
+
+// Byte expansion tables for the packed formats: entry b holds the indices
+// of the 8 / 4 / 2 pixels in byte b, leftmost first
+template <unsigned Bits>
+constexpr auto make_unpack_table() noexcept {
+    constexpr unsigned per_byte = 8 / Bits;
+    std::array<std::array<std::uint8_t, per_byte>, 256> table{};
+    for (unsigned b = 0; b < 256; ++b) {
+        for (unsigned i = 0; i < per_byte; ++i) {
+            const unsigned shift = 8 - Bits * (i + 1);
+            table[b][i] = static_cast<std::uint8_t>((b >> shift) & ((1u << Bits) - 1));
+        }
+    }
+    return table;
+}
+
+constexpr auto UNPACK1 = make_unpack_table<1>();
+constexpr auto UNPACK2 = make_unpack_table<2>();
+constexpr auto UNPACK4 = make_unpack_table<4>();
+
+template <typename Table>
+void unpack_with(const Table& table, const std::uint8_t* src, std::uint8_t* dst, std::size_t width) noexcept {
+    constexpr std::size_t per_byte = std::tuple_size_v<typename Table::value_type>;
+    const std::size_t whole = width / per_byte;
+    for (std::size_t i = 0; i < whole; ++i) {
+        std::memcpy(dst + i * per_byte, table[src[i]].data(), per_byte);
+    }
+    if (const std::size_t rest = width % per_byte; rest != 0) {
+        std::memcpy(dst + whole * per_byte, table[src[whole]].data(), rest);
+    }
+}
+
+} // namespace
+
+bool memory_surface::set_size(int width, int height, pixel_format format) {
+    const std::size_t pitch = checked_pitch(width, height, format, layout_);
+    if (pitch == 0) {
         return false;
     }
+    const std::size_t total_size = pitch * static_cast<std::size_t>(height);
 
     width_ = width;
     height_ = height;
     format_ = format;
     pitch_ = pitch;
+    row_size_ = row_bytes(format, static_cast<std::size_t>(width));
 
     try {
         pixels_.resize(total_size);
@@ -58,13 +121,14 @@ void memory_surface::write_pixels(int x, int y, int count, const std::uint8_t* p
 
     const std::size_t x_offset = static_cast<std::size_t>(x);
 
-    // Guard against x >= pitch_ to prevent underflow in max_bytes calculation
-    if (x_offset >= pitch_) {
+    // Guard against x >= row_size_ to prevent underflow in max_bytes
+    // calculation; the row padding is never written
+    if (x_offset >= row_size_) {
         return;
     }
 
     const std::size_t offset = static_cast<std::size_t>(y) * pitch_ + x_offset;
-    const std::size_t max_bytes = pitch_ - x_offset;
+    const std::size_t max_bytes = row_size_ - x_offset;
     const std::size_t bytes_to_copy = std::min(static_cast<std::size_t>(count), max_bytes);
 
     // Final bounds check before memcpy
@@ -78,14 +142,16 @@ void memory_surface::write_pixel(int x, int y, std::uint8_t pixel) {
         return;
     }
 
-    if (format_ != pixel_format::indexed8) {
-        return;  // write_pixel only works for indexed8
+    if (!is_indexed(format_)) {
+        return;  // write_pixel only works for indexed formats
     }
 
-    const std::size_t offset = static_cast<std::size_t>(y) * pitch_ + static_cast<std::size_t>(x);
-    if (offset < pixels_.size()) {
-        pixels_[offset] = pixel;
+    const std::size_t row_offset = static_cast<std::size_t>(y) * pitch_;
+    if (row_offset + static_cast<std::size_t>(x) * bits_per_pixel(format_) / 8 >= pixels_.size()) {
+        return;
     }
+
+    put_indexed_pixel(pixels_.data() + row_offset, static_cast<std::size_t>(x), format_, pixel);
 }
 
 void memory_surface::set_palette_size(int count) {
@@ -121,4 +187,123 @@ void memory_surface::set_subrect(int index, const subrect& sr) {
     subrects_[static_cast<std::size_t>(index)] = sr;
 }
 
+// ============================================================================
+// Packed format expansion
+// ============================================================================
+
+void unpack_indexed_row(pixel_format format, const std::uint8_t* src, std::uint8_t* dst, int width) noexcept {
+    if (width <= 0) {
+        return;
+    }
+
+    const auto w = static_cast<std::size_t>(width);
+    switch (format) {
+        case pixel_format::indexed1: unpack_with(UNPACK1, src, dst, w); break;
+        case pixel_format::indexed2: unpack_with(UNPACK2, src, dst, w); break;
+        case pixel_format::indexed4: unpack_with(UNPACK4, src, dst, w); break;
+        case pixel_format::indexed8: std::memcpy(dst, src, w); break;
+        default: break;
+    }
+}
+
+namespace {
+
+// Shared by the memory_surface and shared_surface overloads; rows of src
+// are pitch() apart and may be longer than the image
+template <typename Image>
+bool expand_image(const Image& src, memory_surface& dst) {
+    const bool packed = bytes_per_pixel(src.format()) == 0;
+    if (!dst.set_size(src.width(), src.height(), packed ? pixel_format::indexed8 : src.format())) {
+        return false;
+    }
+
+    const auto pixels = src.pixels();
+    if (packed) {
+        std::vector<std::uint8_t> row(static_cast<std::size_t>(src.width()));
+        for (int y = 0; y < src.height(); ++y) {
+            unpack_indexed_row(src.format(), pixels.data() + static_cast<std::size_t>(y) * src.pitch(),
+                               row.data(), src.width());
+            dst.write_pixels(0, y, src.width(), row.data());
+        }
+    } else if (const std::size_t row_size = row_bytes(src.format(), static_cast<std::size_t>(src.width()));
+               src.pitch() == row_size && dst.pitch() == row_size) {
+        // Rows without padding on either side are one block
+        std::memcpy(dst.mutable_pixels().data(), pixels.data(), row_size * static_cast<std::size_t>(src.height()));
+    } else {
+        // Copy only the pixels so the destination padding stays zero
+        for (int y = 0; y < src.height(); ++y) {
+            std::memcpy(dst.mutable_pixels().data() + static_cast<std::size_t>(y) * dst.pitch(),
+                        pixels.data() + static_cast<std::size_t>(y) * src.pitch(), row_size);
+        }
+    }
+
+    const auto palette = src.palette();
+    if (!palette.empty()) {
+        dst.set_palette_size(static_cast<int>(palette.size() / 3));
+        dst.write_palette(0, palette);
+    }
+    const auto& subrects = src.subrects();
+    for (std::size_t i = 0; i < subrects.size(); ++i) {
+        dst.set_subrect(static_cast<int>(i), subrects[i]);
+    }
+
+    return true;
+}
+
+} // namespace
+
+bool expand_packed(const memory_surface& src, memory_surface& dst) {
+    return expand_image(src, dst);
+}
+
+bool expand_packed(const shared_surface& src, memory_surface& dst) {
+    return !src.empty() && expand_image(src, dst);
+}
+
+// ============================================================================
+// null_surface
+// ============================================================================
+
+bool null_surface::set_size(int width, int height, pixel_format format) {
+    // Fail exactly where a memory_surface would, minus the allocation
+    if (checked_pitch(width, height, format) == 0) {
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    format_ = format;
+    palette_size_ = 0;
+    subrect_count_ = 0;
+    return true;
+}
+
+void null_surface::write_pixels(int x, int y, int count, const std::uint8_t* pixels) {
+    (void)x;
+    (void)y;
+    (void)count;
+    (void)pixels;
+}
+
+void null_surface::write_pixel(int x, int y, std::uint8_t pixel) {
+    (void)x;
+    (void)y;
+    (void)pixel;
+}
+
+void null_surface::set_palette_size(int count) {
+    if (count <= 0 || count > 256) {
+        return;
+    }
+    palette_size_ = count;
+}
+
+void null_surface::set_subrect(int index, const subrect& sr) {
+    (void)sr;
+    if (index < 0) {
+        return;
+    }
+    subrect_count_ = std::max(subrect_count_, index + 1);
+}
+
 } // namespace onyx_image
@@ -0,0 +1,216 @@
+#include <onyx_image/tiled_surface.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
+
+namespace onyx_image {
+
+tiled_surface::tiled_surface(int tile_width, int tile_height, std::uint64_t max_bytes)
+    : max_bytes_(max_bytes),
+      tile_width_((std::max(tile_width, 1) + 7) / 8 * 8),
+      tile_height_(std::max(tile_height, 1)) {}
+
+bool tiled_surface::set_size(int width, int height, pixel_format format) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    const int tiles_x = (width - 1) / tile_width_ + 1;
+    const int tiles_y = (height - 1) / tile_height_ + 1;
+    const std::size_t tile_pitch = row_bytes(format, static_cast<std::size_t>(tile_width_));
+    const std::size_t tile_count = static_cast<std::size_t>(tiles_x) * static_cast<std::size_t>(tiles_y);
+    const std::size_t tile_bytes = tile_pitch * static_cast<std::size_t>(tile_height_);
+    if (tile_bytes > std::numeric_limits<std::size_t>::max() / tile_count) {
+        return false;
+    }
+    // The grid and at least one tile must fit the limit
+    if (tile_count > tiles_.max_size() ||
+        tile_count > max_bytes_ / sizeof(tile_storage) ||
+        tile_bytes > max_bytes_ - tile_count * sizeof(tile_storage)) {
+        return false;
+    }
+
+    try {
+        tiles_.clear();
+        tiles_.resize(tile_count);
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+
+    width_ = width;
+    height_ = height;
+    format_ = format;
+    tiles_x_ = tiles_x;
+    tiles_y_ = tiles_y;
+    tile_pitch_ = tile_pitch;
+    row_size_ = row_bytes(format, static_cast<std::size_t>(width));
+    allocated_ = 0;
+    failed_ = false;
+    palette_.clear();
+    subrects_.clear();
+    return true;
+}
+
+std::uint8_t* tiled_surface::tile_for_write(int tx, int ty) {
+    auto& t = tiles_[static_cast<std::size_t>(ty) * static_cast<std::size_t>(tiles_x_) + static_cast<std::size_t>(tx)];
+    if (t.empty()) {
+        const std::size_t tile_bytes = tile_pitch_ * static_cast<std::size_t>(tile_height_);
+        const std::uint64_t grid_bytes = static_cast<std::uint64_t>(tiles_.size()) * sizeof(tile_storage);
+        if (allocated_ >= (max_bytes_ - grid_bytes) / tile_bytes) {
+            failed_ = true;
+            return nullptr;
+        }
+        try {
+            t.resize(tile_pitch_ * static_cast<std::size_t>(tile_height_));
+        } catch (const std::bad_alloc&) {
+            failed_ = true;
+            return nullptr;
+        }
+        ++allocated_;
+    }
+    return t.data();
+}
+
+void tiled_surface::write_pixels(int x, int y, int count, const std::uint8_t* pixels) {
+    if (y < 0 || y >= height_ || x < 0 || count <= 0 || !pixels) {
+        return;
+    }
+    std::size_t pos = static_cast<std::size_t>(x);
+    if (pos >= row_size_) {
+        return;
+    }
+    const std::size_t end = pos + std::min(static_cast<std::size_t>(count), row_size_ - pos);
+
+    // Split the run at tile boundaries
+    const int ty = y / tile_height_;
+    const std::size_t row_in_tile = static_cast<std::size_t>(y % tile_height_) * tile_pitch_;
+    while (pos < end) {
+        const std::size_t tx = pos / tile_pitch_;
+        const std::size_t in_tile = pos % tile_pitch_;
+        const std::size_t bytes = std::min(end - pos, tile_pitch_ - in_tile);
+        if (std::uint8_t* t = tile_for_write(static_cast<int>(tx), ty)) {
+            std::memcpy(t + row_in_tile + in_tile, pixels, bytes);
+        }
+        pixels += bytes;
+        pos += bytes;
+    }
+}
+
+void tiled_surface::write_pixel(int x, int y, std::uint8_t pixel) {
+    if (x < 0 || x >= width_ || y < 0 || y >= height_ || !is_indexed(format_)) {
+        return;
+    }
+
+    std::uint8_t* t = tile_for_write(x / tile_width_, y / tile_height_);
+    if (!t) {
+        return;
+    }
+    put_indexed_pixel(t + static_cast<std::size_t>(y % tile_height_) * tile_pitch_,
+                      static_cast<std::size_t>(x % tile_width_), format_, pixel);
+}
+
+void tiled_surface::set_palette_size(int count) {
+    if (count <= 0 || count > 256) {
+        return;
+    }
+    palette_.assign(static_cast<std::size_t>(count) * 3, 0);
+}
+
+void tiled_surface::write_palette(int start, std::span<const std::uint8_t> colors) {
+    if (start < 0 || colors.empty()) {
+        return;
+    }
+    const std::size_t start_offset = static_cast<std::size_t>(start) * 3;
+    if (start_offset >= palette_.size()) {
+        return;
+    }
+    const std::size_t bytes_to_copy = std::min(colors.size(), palette_.size() - start_offset);
+    std::memcpy(palette_.data() + start_offset, colors.data(), bytes_to_copy);
+}
+
+void tiled_surface::set_subrect(int index, const subrect& sr) {
+    if (index < 0) {
+        return;
+    }
+    if (static_cast<std::size_t>(index) >= subrects_.size()) {
+        subrects_.resize(static_cast<std::size_t>(index) + 1);
+    }
+    subrects_[static_cast<std::size_t>(index)] = sr;
+}
+
+std::span<const std::uint8_t> tiled_surface::tile(int tx, int ty) const noexcept {
+    if (tx < 0 || tx >= tiles_x_ || ty < 0 || ty >= tiles_y_) {
+        return {};
+    }
+    return tiles_[static_cast<std::size_t>(ty) * static_cast<std::size_t>(tiles_x_) + static_cast<std::size_t>(tx)];
+}
+
+image_rect tiled_surface::tile_rect(int tx, int ty) const noexcept {
+    if (tx < 0 || tx >= tiles_x_ || ty < 0 || ty >= tiles_y_) {
+        return {};
+    }
+    const int x = tx * tile_width_;
+    const int y = ty * tile_height_;
+    return {x, y, std::min(tile_width_, width_ - x), std::min(tile_height_, height_ - y)};
+}
+
+bool tiled_surface::read_region(const image_rect& rect, std::uint8_t* dst, std::size_t dst_pitch) const {
+    if (!dst || rect.x < 0 || rect.y < 0 || rect.w <= 0 || rect.h <= 0 ||
+        rect.w > width_ - rect.x || rect.h > height_ - rect.y) {
+        return false;
+    }
+    const std::size_t bits = bits_per_pixel(format_);
+    const std::size_t bit_offset = static_cast<std::size_t>(rect.x) * bits;
+    const std::size_t length = row_bytes(format_, static_cast<std::size_t>(rect.w));
+    if (bit_offset % 8 != 0 || dst_pitch < length) {
+        return false;
+    }
+
+    const std::size_t begin = bit_offset / 8;
+    const std::size_t end = begin + length;
+    const unsigned tail_bits = static_cast<unsigned>(static_cast<std::size_t>(rect.w) * bits % 8);
+    for (int y = rect.y; y < rect.y + rect.h; ++y, dst += dst_pitch) {
+        const std::size_t ty = static_cast<std::size_t>(y / tile_height_);
+        const std::size_t row_in_tile = static_cast<std::size_t>(y % tile_height_) * tile_pitch_;
+        std::uint8_t* out = dst;
+        for (std::size_t pos = begin; pos < end;) {
+            const std::size_t tx = pos / tile_pitch_;
+            const std::size_t in_tile = pos % tile_pitch_;
+            const std::size_t bytes = std::min(end - pos, tile_pitch_ - in_tile);
+            const auto& t = tiles_[ty * static_cast<std::size_t>(tiles_x_) + tx];
+            if (t.empty()) {
+                std::memset(out, 0, bytes);
+            } else {
+                std::memcpy(out, t.data() + row_in_tile + in_tile, bytes);
+            }
+            out += bytes;
+            pos += bytes;
+        }
+        // Bits after the last pixel of a packed row must be zero
+        if (tail_bits != 0) {
+            dst[length - 1] &= static_cast<std::uint8_t>(0xFF << (8 - tail_bits));
+        }
+    }
+    return true;
+}
+
+bool tiled_surface::to_linear(memory_surface& dst) const {
+    if (width_ <= 0 || !dst.set_size(width_, height_, format_)) {
+        return false;
+    }
+    if (!read_region({0, 0, width_, height_}, dst.mutable_pixels().data(), dst.pitch())) {
+        return false;
+    }
+    if (!palette_.empty()) {
+        dst.set_palette_size(static_cast<int>(palette_.size() / 3));
+        dst.write_palette(0, palette_);
+    }
+    for (std::size_t i = 0; i < subrects_.size(); ++i) {
+        dst.set_subrect(static_cast<int>(i), subrects_[i]);
+    }
+    return true;
+}
+
+} // namespace onyx_image
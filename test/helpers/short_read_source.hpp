@@ -0,0 +1,37 @@
+#ifndef ONYX_IMAGE_TEST_SHORT_READ_SOURCE_HPP_
+#define ONYX_IMAGE_TEST_SHORT_READ_SOURCE_HPP_
+
+#include <onyx_image/byte_source.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// Delivers at most a few bytes per read, like a pipe, and uses the
+// default read-and-discard skip
+class short_read_source : public onyx_image::byte_source {
+public:
+    short_read_source(std::span<const std::uint8_t> data, std::size_t max_read) noexcept
+        : data_(data), max_read_(max_read) {}
+
+    [[nodiscard]] std::size_t read(std::uint8_t* dst, std::size_t size) override {
+        // Cycle through 1..max_read bytes per call
+        const std::size_t limit = reads_++ % max_read_ + 1;
+        const std::size_t n = std::min({size, limit, data_.size() - pos_});
+        std::memcpy(dst, data_.data() + pos_, n);
+        pos_ += n;
+        return n;
+    }
+
+    [[nodiscard]] bool at_end() const override { return pos_ == data_.size(); }
+
+private:
+    std::span<const std::uint8_t> data_;
+    std::size_t max_read_;
+    std::size_t pos_ = 0;
+    std::size_t reads_ = 0;
+};
+
+#endif // ONYX_IMAGE_TEST_SHORT_READ_SOURCE_HPP_
@@ -89,6 +89,47 @@ void test_bmp_decode_md5(
     CHECK(actual_md5 == expected_md5);
 }
 
+// Decode with packed_indexed and check the result renders exactly like the
+// default indexed8 decode once expanded
+void test_packed_decode(const std::filesystem::path& path, onyx_image::pixel_format expected_format) {
+    INFO("Testing: ", path.string());
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    onyx_image::memory_surface reference;
+    REQUIRE(onyx_image::decode(data, reference).ok);
+
+    onyx_image::decode_options options;
+    options.packed_indexed = true;
+    onyx_image::memory_surface packed;
+    REQUIRE(onyx_image::decode(data, packed, options).ok);
+    REQUIRE(packed.format() == expected_format);
+    CHECK(packed.pitch() == onyx_image::row_bytes(expected_format, static_cast<std::size_t>(packed.width())));
+    CHECK(packed.pixels().size() == packed.pitch() * static_cast<std::size_t>(packed.height()));
+
+    onyx_image::memory_surface expanded;
+    REQUIRE(onyx_image::expand_packed(packed, expanded));
+    REQUIRE(expanded.format() == onyx_image::pixel_format::indexed8);
+    REQUIRE(expanded.width() == reference.width());
+    REQUIRE(expanded.height() == reference.height());
+
+    const auto ref_pixels = reference.pixels();
+    const auto ref_palette = reference.palette();
+    const auto pixels = expanded.pixels();
+    const auto palette = expanded.palette();
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        const std::size_t a = static_cast<std::size_t>(ref_pixels[i]) * 3;
+        const std::size_t b = static_cast<std::size_t>(pixels[i]) * 3;
+        if (a + 2 >= ref_palette.size() || b + 2 >= palette.size() ||
+            ref_palette[a] != palette[b] || ref_palette[a + 1] != palette[b + 1] ||
+            ref_palette[a + 2] != palette[b + 2]) {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
 } // namespace
 
 TEST_CASE("BMP decoder: sniff") {
@@ -169,3 +210,64 @@ TEST_CASE("BMP decoder: MD5 verification") {
         test_bmp_decode_md5("test32v5.bmp", "914d5d4f8f352dbca443a2ba0058c488", "Windows V5 24-bit");
     }
 }
+
+TEST_CASE("BMP decoder: RLE8 delta and early end of bitmap") {
+    // 4x3, 8-bit RLE with a two-entry palette
+    std::vector<std::uint8_t> data = {
+        'B', 'M', 0, 0, 0, 0, 0, 0, 0, 0, 62, 0, 0, 0,
+        40, 0, 0, 0, 4, 0, 0, 0, 3, 0, 0, 0, 1, 0, 8, 0,
+        1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        2, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 255, 255, 255, 0,
+        // Run of two 1s, delta (+1, +1), run of one 1, end of bitmap
+        2, 1, 0, 2, 1, 1, 1, 1, 0, 1
+    };
+
+    onyx_image::memory_surface surface;
+    auto result = onyx_image::bmp_decoder::decode(data, surface);
+
+    REQUIRE(result.ok);
+    REQUIRE(surface.format() == onyx_image::pixel_format::indexed8);
+    REQUIRE(surface.width() == 4);
+    REQUIRE(surface.height() == 3);
+
+    // Bottom-up: stream row 0 is the last surface row
+    const std::vector<std::uint8_t> expected = {
+        0, 0, 0, 0,
+        0, 0, 0, 1,
+        1, 1, 0, 0
+    };
+    auto pixels = surface.pixels();
+    CHECK(std::vector<std::uint8_t>(pixels.begin(), pixels.end()) == expected);
+}
+
+TEST_CASE("BMP decoder: malformed headers") {
+    SUBCASE("Truncated info header") {
+        // Declares a 40-byte BITMAPINFOHEADER but only 16 bytes follow
+        std::vector<std::uint8_t> data = {
+            'B', 'M', 0, 0, 0, 0, 0, 0, 0, 0, 54, 0, 0, 0,
+            40, 0, 0, 0, 4, 0, 0, 0, 4, 0, 0, 0, 1, 0, 8, 0
+        };
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::bmp_decoder::decode(data, surface);
+        CHECK_FALSE(result.ok);
+        CHECK(result.error == onyx_image::decode_error::invalid_format);
+    }
+
+    SUBCASE("Unknown info header size") {
+        std::vector<std::uint8_t> data(64, 0);
+        data[0] = 'B';
+        data[1] = 'M';
+        data[14] = 20;
+        onyx_image::memory_surface surface;
+        CHECK_FALSE(onyx_image::bmp_decoder::decode(data, surface).ok);
+    }
+}
+
+TEST_CASE("BMP decoder: packed output") {
+    const auto dir = std::filesystem::path(TEST_DATA_DIR) / "bmp";
+    test_packed_decode(dir / "test1.bmp", onyx_image::pixel_format::indexed1);
+    test_packed_decode(dir / "test4.bmp", onyx_image::pixel_format::indexed4);
+    // RLE4 is expanded while decoding
+    test_packed_decode(dir / "testcompress4.bmp", onyx_image::pixel_format::indexed8);
+}
@@ -3,6 +3,7 @@
 
 #include "helpers/md5.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
@@ -163,3 +164,63 @@ TEST_CASE("DCX decoder: multi-page atlas") {
     CHECK(subrects[2].kind == onyx_image::subrect_kind::frame);
     CHECK(subrects[2].user_tag == 2);
 }
+
+TEST_CASE("DCX decoder: repeated pages share atlas rows") {
+    // multipage.dcx repeats one page; a second page differs in the
+    // first pixel (a literal byte right after the PCX header)
+    const auto multipage = read_file(std::filesystem::path(TEST_DATA_DIR) / "dcx/multipage.dcx");
+    REQUIRE(multipage.size() > 16);
+    const std::uint32_t start = multipage[4] | multipage[5] << 8 | multipage[6] << 16 | multipage[7] << 24;
+    const std::uint32_t end = multipage[8] | multipage[9] << 8 | multipage[10] << 16 | multipage[11] << 24;
+    REQUIRE(end > start + 129);
+    const std::vector<std::uint8_t> page(multipage.begin() + start, multipage.begin() + end);
+    REQUIRE(page[128] < 0xC0);
+    std::vector<std::uint8_t> other = page;
+    other[128] ^= 0x01;
+    const std::vector<std::uint8_t>* pages[] = {&page, &other};
+
+    // Pages 0, 1, 0, 0
+    const std::size_t order[] = {0, 1, 0, 0};
+    std::vector<std::uint8_t> data(4 + 4 * 5, 0);
+    std::copy_n(multipage.begin(), 4, data.begin());
+    for (std::size_t i = 0; i < 4; ++i) {
+        const auto offset = static_cast<std::uint32_t>(data.size());
+        for (int b = 0; b < 4; ++b) {
+            data[4 + i * 4 + b] = static_cast<std::uint8_t>(offset >> (8 * b));
+        }
+        data.insert(data.end(), pages[order[i]]->begin(), pages[order[i]]->end());
+    }
+
+    onyx_image::memory_surface full;
+    REQUIRE(onyx_image::dcx_decoder::decode(data, full, {}));
+    CHECK(full.height() == 512);
+
+    onyx_image::decode_options options;
+    options.dedup_frames = true;
+    onyx_image::memory_surface atlas;
+    REQUIRE(onyx_image::dcx_decoder::decode(data, atlas, options));
+    CHECK(atlas.width() == 128);
+    CHECK(atlas.height() == 256);
+
+    const auto& subrects = atlas.subrects();
+    REQUIRE(subrects.size() == 4);
+    CHECK(subrects[0].rect.y == 0);
+    CHECK(subrects[1].rect.y == 128);
+    CHECK(subrects[2].rect.y == 0);
+    CHECK(subrects[3].rect.y == 0);
+    CHECK(subrects[3].user_tag == 3);
+
+    // Every subrect shows the same pixels as in the full atlas
+    const std::size_t page_bytes = 128 * full.pitch();
+    for (std::size_t i = 0; i < subrects.size(); ++i) {
+        const auto* expected = full.pixels().data() + i * page_bytes;
+        const auto* actual = atlas.pixels().data() + static_cast<std::size_t>(subrects[i].rect.y) * atlas.pitch();
+        CHECK(std::equal(expected, expected + page_bytes, actual));
+    }
+
+    // Verifying reports the deduplicated shape
+    onyx_image::null_surface check;
+    REQUIRE(onyx_image::dcx_decoder::decode(data, check, options));
+    CHECK(check.height() == 256);
+    CHECK(check.subrect_count() == 4);
+}
@@ -0,0 +1,126 @@
+#include <doctest/doctest.h>
+#include <onyx_image/onyx_image.hpp>
+
+#include "helpers/md5.h"
+#include "helpers/short_read_source.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::uint8_t> read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return {};
+    }
+
+    const auto size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<std::uint8_t> data(static_cast<std::size_t>(size));
+    file.read(reinterpret_cast<char*>(data.data()), size);
+
+    return data;
+}
+
+std::string md5_to_string(const unsigned char* digest) {
+    std::string result;
+    result.reserve(32);
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        char buf[3];
+        std::snprintf(buf, sizeof(buf), "%02x", digest[i]);
+        result += buf;
+    }
+    return result;
+}
+
+std::string compute_surface_md5(const onyx_image::memory_surface& surf) {
+    MD5_CTX ctx;
+    MD5_Init(&ctx);
+
+    // Hash dimensions and format
+    const int width = surf.width();
+    const int height = surf.height();
+    const auto format = static_cast<int>(surf.format());
+    MD5_Update(&ctx, &width, sizeof(width));
+    MD5_Update(&ctx, &height, sizeof(height));
+    MD5_Update(&ctx, &format, sizeof(format));
+
+    // Hash pixel data
+    const auto pixels = surf.pixels();
+    MD5_Update(&ctx, pixels.data(), pixels.size());
+
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    MD5_Final(digest, &ctx);
+
+    return md5_to_string(digest);
+}
+
+// 37x23, 16-color global palette, with comment and graphic control
+// extensions ahead of the image
+constexpr const char* PATTERN_MD5 = "67bb593e2ccd74a7c0a87bfb9e79bfae";
+
+} // namespace
+
+TEST_CASE("GIF decoder: sniff") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "gif" / "pattern16.gif");
+    REQUIRE(!data.empty());
+    CHECK(onyx_image::gif_decoder::sniff(data));
+
+    SUBCASE("Too short") {
+        CHECK_FALSE(onyx_image::gif_decoder::sniff(std::span(data).first(5)));
+    }
+
+    SUBCASE("Unknown version") {
+        auto patched = data;
+        patched[4] = '8';
+        CHECK_FALSE(onyx_image::gif_decoder::sniff(patched));
+    }
+}
+
+TEST_CASE("GIF decoder: buffer input") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "gif" / "pattern16.gif");
+    REQUIRE(!data.empty());
+
+    onyx_image::memory_surface surface;
+    REQUIRE(onyx_image::decode(data, surface).ok);
+    CHECK(surface.width() == 37);
+    CHECK(surface.height() == 23);
+    CHECK(surface.format() == onyx_image::pixel_format::rgba8888);
+    CHECK(compute_surface_md5(surface) == PATTERN_MD5);
+}
+
+TEST_CASE("GIF decoder: stream input matches buffer input") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "gif" / "pattern16.gif");
+    REQUIRE(!data.empty());
+
+    SUBCASE("Memory source") {
+        onyx_image::memory_source src(data);
+        onyx_image::memory_surface streamed;
+        REQUIRE(onyx_image::decode(src, streamed, "gif").ok);
+        CHECK(compute_surface_md5(streamed) == PATTERN_MD5);
+    }
+
+    SUBCASE("Short reads") {
+        // The sniffed prefix, the header bytes recorded by the info pass
+        // and the rest of the stream are each split across reads
+        for (const std::size_t max_read : {1, 3, 7, 64}) {
+            INFO("Max read ", max_read);
+            short_read_source src(data, max_read);
+            onyx_image::memory_surface streamed;
+            REQUIRE(onyx_image::decode(src, streamed, "gif").ok);
+            CHECK(compute_surface_md5(streamed) == PATTERN_MD5);
+        }
+    }
+
+    SUBCASE("Source shorter than the signature") {
+        const auto head = std::span(data).first(4);
+        short_read_source src(head, 2);
+        onyx_image::memory_surface streamed;
+        CHECK_FALSE(onyx_image::decode(src, streamed, "gif").ok);
+    }
+}
@@ -3,6 +3,7 @@
 
 #include "helpers/md5.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
@@ -194,6 +195,146 @@ TEST_CASE("ICO decoder: multi-size icon atlas") {
     CHECK(subrects[2].user_tag == 2);
 }
 
+TEST_CASE("ICO decoder: atlas tags skip a corrupt entry") {
+    auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "Pillow/Tests/images/python.ico");
+    REQUIRE(data.size() > 6 + 3 * 16);
+    REQUIRE(data[4] == 3);
+
+    // Wipe the header of the 32x32 image; its directory entry stays
+    const std::size_t entry = 6 + 16;
+    std::size_t offset = 0;
+    for (int b = 0; b < 4; ++b) {
+        offset |= static_cast<std::size_t>(data[entry + 12 + b]) << (8 * b);
+    }
+    REQUIRE(offset + 16 <= data.size());
+    std::fill_n(data.begin() + static_cast<std::ptrdiff_t>(offset), 16, std::uint8_t{0});
+
+    onyx_image::memory_surface atlas;
+    REQUIRE(onyx_image::ico_decoder::decode(data, atlas, {}));
+    CHECK(atlas.height() == 64);
+
+    // user_tag stays the directory index of each icon
+    const auto& subrects = atlas.subrects();
+    REQUIRE(subrects.size() == 2);
+    CHECK(subrects[0].user_tag == 0);
+    CHECK(subrects[1].user_tag == 2);
+    CHECK(subrects[1].rect.w == 48);
+
+    const auto entries = onyx_image::ico_decoder::entries(data);
+    REQUIRE(entries.size() == 3);
+    CHECK(entries[2].index == static_cast<int>(subrects[1].user_tag));
+    CHECK(entries[2].width == 48);
+}
+
+TEST_CASE("ICO decoder: repeated icons share atlas rows") {
+    const auto source = read_file(std::filesystem::path(TEST_DATA_DIR) / "Pillow/Tests/images/python.ico");
+    REQUIRE(source.size() > 6 + 3 * 16);
+    REQUIRE(source[4] == 3);
+
+    // Append a fourth directory entry repeating the 32x32 one; the image
+    // data moves back by one entry
+    std::vector<std::uint8_t> data(source.begin(), source.begin() + 6 + 3 * 16);
+    data.insert(data.end(), source.begin() + 6 + 16, source.begin() + 6 + 2 * 16);
+    data.insert(data.end(), source.begin() + 6 + 3 * 16, source.end());
+    data[4] = 4;
+    for (std::size_t entry = 6; entry < 6 + 4 * 16; entry += 16) {
+        std::uint32_t offset = 0;
+        for (int b = 0; b < 4; ++b) {
+            offset |= static_cast<std::uint32_t>(data[entry + 12 + b]) << (8 * b);
+        }
+        offset += 16;
+        for (int b = 0; b < 4; ++b) {
+            data[entry + 12 + b] = static_cast<std::uint8_t>(offset >> (8 * b));
+        }
+    }
+
+    onyx_image::memory_surface full;
+    REQUIRE(onyx_image::ico_decoder::decode(data, full, {}));
+    CHECK(full.height() == 128);
+
+    onyx_image::decode_options options;
+    options.dedup_frames = true;
+    onyx_image::memory_surface atlas;
+    REQUIRE(onyx_image::ico_decoder::decode(data, atlas, options));
+    CHECK(atlas.width() == 48);
+    CHECK(atlas.height() == 96);
+
+    const auto& subrects = atlas.subrects();
+    REQUIRE(subrects.size() == 4);
+    CHECK(subrects[3].rect.y == subrects[1].rect.y);
+    CHECK(subrects[3].rect.w == 32);
+    CHECK(subrects[3].user_tag == 3);
+    CHECK(subrects[2].rect.y == 48);
+
+    // The atlas holds exactly the distinct icons of the full one
+    const auto pixels = full.pixels();
+    CHECK(std::equal(atlas.pixels().begin(), atlas.pixels().end(), pixels.begin()));
+
+    // The height limit applies to every icon stacked, with or without dedup
+    options.max_height = 100;
+    onyx_image::memory_surface limited;
+    const auto limited_result = onyx_image::ico_decoder::decode(data, limited, options);
+    CHECK_FALSE(limited_result.ok);
+    CHECK(limited_result.error == onyx_image::decode_error::dimensions_exceeded);
+}
+
+TEST_CASE("ICO decoder: icon selection") {
+    const std::filesystem::path path = std::filesystem::path(TEST_DATA_DIR) /
+                                        "Pillow/Tests/images/python.ico";
+
+    REQUIRE(std::filesystem::exists(path));
+
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    SUBCASE("directory listing") {
+        auto entries = onyx_image::ico_decoder::entries(data);
+        REQUIRE(entries.size() == 3);
+        CHECK(entries[0].index == 0);
+        CHECK(entries[0].width == 16);
+        CHECK(entries[1].width == 32);
+        CHECK(entries[2].width == 48);
+        CHECK(entries[2].height == 48);
+    }
+
+    SUBCASE("preferred size decodes a single entry") {
+        onyx_image::decode_options options;
+        options.icon_size = 32;
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::ico_decoder::decode(data, surface, options);
+
+        REQUIRE(result.ok);
+        CHECK(surface.width() == 32);
+        CHECK(surface.height() == 32);
+        REQUIRE(surface.subrects().size() == 1);
+        CHECK(surface.subrects()[0].user_tag == 1);
+    }
+
+    SUBCASE("preferred size falls back to the nearest larger entry") {
+        onyx_image::decode_options options;
+        options.icon_size = 24;
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::ico_decoder::decode(data, surface, options);
+
+        REQUIRE(result.ok);
+        CHECK(surface.width() == 32);
+    }
+
+    SUBCASE("decode by directory index") {
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::ico_decoder::decode_entry(data, 2, surface);
+
+        REQUIRE(result.ok);
+        CHECK(surface.width() == 48);
+        CHECK(surface.height() == 48);
+
+        onyx_image::memory_surface missing;
+        CHECK_FALSE(onyx_image::ico_decoder::decode_entry(data, 7, missing).ok);
+    }
+}
+
 TEST_CASE("ICO decoder: PNG-compressed icon") {
     // hopper_256x256.ico uses PNG compression (Vista+ format)
     test_ico_decode_md5("Pillow/Tests/images/hopper_256x256.ico",
@@ -275,3 +416,62 @@ TEST_CASE("EXE icon decoder: NE executable") {
         CHECK(subrects[91].user_tag == 91);
     }
 }
+
+TEST_CASE("EXE icon decoder: icon catalog") {
+    const std::filesystem::path path = std::filesystem::path(TEST_DATA_DIR) / "PROGMAN.EXE";
+
+    REQUIRE(std::filesystem::exists(path));
+
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    onyx_image::exe_icon_directory directory(data);
+    REQUIRE(directory.valid());
+
+    SUBCASE("catalog without decoding") {
+        const auto& entries = directory.entries();
+        REQUIRE(entries.size() == 92);
+        CHECK(entries[0].index == 0);
+        CHECK(entries[0].width == 32);
+        CHECK(entries[0].height == 32);
+        CHECK(entries[0].bit_depth == 1);
+        CHECK(entries[91].index == 91);
+        CHECK(onyx_image::exe_icon_decoder::entries(data).size() == 92);
+    }
+
+    SUBCASE("single entry matches the atlas") {
+        onyx_image::memory_surface atlas;
+        REQUIRE(directory.decode(atlas).ok);
+
+        onyx_image::memory_surface single;
+        auto result = directory.decode_entry(5, single);
+
+        REQUIRE(result.ok);
+        CHECK(single.width() == 32);
+        CHECK(single.height() == 32);
+        REQUIRE(single.subrects().size() == 1);
+        CHECK(single.subrects()[0].user_tag == 5);
+
+        auto pixels = single.pixels();
+        auto atlas_pixels = atlas.pixels();
+        const std::size_t icon_bytes = 32 * 32 * 4;
+        CHECK(std::equal(pixels.begin(), pixels.end(), atlas_pixels.begin() + 5 * icon_bytes));
+    }
+
+    SUBCASE("preferred size decodes one icon") {
+        onyx_image::decode_options options;
+        options.icon_size = 32;
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::exe_icon_decoder::decode(data, surface, options);
+
+        REQUIRE(result.ok);
+        CHECK(surface.height() == 32);
+        CHECK(surface.subrects().size() == 1);
+    }
+
+    SUBCASE("out of range index") {
+        onyx_image::memory_surface surface;
+        CHECK_FALSE(directory.decode_entry(92, surface).ok);
+    }
+}
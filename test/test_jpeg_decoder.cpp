@@ -0,0 +1,266 @@
+#include <doctest/doctest.h>
+#include <onyx_image/onyx_image.hpp>
+
+#include "helpers/md5.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::uint8_t> read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return {};
+    }
+
+    const auto size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<std::uint8_t> data(static_cast<std::size_t>(size));
+    file.read(reinterpret_cast<char*>(data.data()), size);
+
+    return data;
+}
+
+std::string md5_to_string(const unsigned char* digest) {
+    std::string result;
+    result.reserve(32);
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        char buf[3];
+        std::snprintf(buf, sizeof(buf), "%02x", digest[i]);
+        result += buf;
+    }
+    return result;
+}
+
+std::string compute_surface_md5(const onyx_image::memory_surface& surf) {
+    MD5_CTX ctx;
+    MD5_Init(&ctx);
+
+    // Hash dimensions and format
+    const int width = surf.width();
+    const int height = surf.height();
+    const auto format = static_cast<int>(surf.format());
+    MD5_Update(&ctx, &width, sizeof(width));
+    MD5_Update(&ctx, &height, sizeof(height));
+    MD5_Update(&ctx, &format, sizeof(format));
+
+    // Hash pixel data
+    const auto pixels = surf.pixels();
+    MD5_Update(&ctx, pixels.data(), pixels.size());
+
+    // Hash palette if indexed
+    if (surf.format() == onyx_image::pixel_format::indexed8) {
+        const auto palette = surf.palette();
+        MD5_Update(&ctx, palette.data(), palette.size());
+    }
+
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    MD5_Final(digest, &ctx);
+
+    return md5_to_string(digest);
+}
+
+void test_jpeg_decode_md5(
+    const char* filename,
+    const char* expected_md5,
+    int expected_width,
+    int expected_height,
+    onyx_image::pixel_format expected_format,
+    int scale_denom = 1)
+{
+    const std::filesystem::path path = std::filesystem::path(TEST_DATA_DIR) / "jpeg" / filename;
+
+    INFO("Testing: ", filename, " at 1/", scale_denom);
+    REQUIRE(std::filesystem::exists(path));
+
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    onyx_image::decode_options options;
+    options.scale_denom = scale_denom;
+    onyx_image::memory_surface surface;
+    auto result = onyx_image::decode(data, surface, options);
+
+    REQUIRE(result.ok);
+    CHECK(surface.width() == expected_width);
+    CHECK(surface.height() == expected_height);
+    CHECK(surface.format() == expected_format);
+
+    std::string actual_md5 = compute_surface_md5(surface);
+    CHECK(actual_md5 == expected_md5);
+}
+
+} // namespace
+
+TEST_CASE("JPEG decoder: sniff") {
+    SUBCASE("Valid SOI marker") {
+        std::vector<std::uint8_t> data = {0xFF, 0xD8, 0xFF, 0xE0};
+        CHECK(onyx_image::jpeg_decoder::sniff(data));
+    }
+
+    SUBCASE("Invalid - too short") {
+        std::vector<std::uint8_t> data = {0xFF, 0xD8};
+        CHECK_FALSE(onyx_image::jpeg_decoder::sniff(data));
+    }
+}
+
+// Test files were written by libjpeg; the expected pixels match its
+// default (islow IDCT, fancy upsampling) decode exactly, scaled or not
+TEST_CASE("JPEG decoder: MD5 verification") {
+    using onyx_image::pixel_format;
+
+    SUBCASE("Baseline 4:2:0") {
+        test_jpeg_decode_md5("baseline_420.jpg", "e6ec04ba2251ded92255fd0cab33fd71", 61, 43, pixel_format::rgb888);
+    }
+
+    SUBCASE("Baseline 4:2:2, restart interval of 2 MCUs") {
+        test_jpeg_decode_md5("baseline_422_restart.jpg", "b9ed005a458a9854f39f505701faf6c9", 53, 37, pixel_format::rgb888);
+    }
+
+    SUBCASE("Baseline 4:4:4") {
+        test_jpeg_decode_md5("baseline_444.jpg", "9c7f1dce08fcfda1e6155087ebd6e1ac", 37, 29, pixel_format::rgb888);
+    }
+
+    SUBCASE("Progressive 4:2:0, same coefficients as the baseline file") {
+        test_jpeg_decode_md5("progressive_420.jpg", "e6ec04ba2251ded92255fd0cab33fd71", 61, 43, pixel_format::rgb888);
+    }
+
+    SUBCASE("Grayscale as a gray ramp palette") {
+        test_jpeg_decode_md5("gray.jpg", "8dbc2ab4fa3d9edaa798640e62f7b750", 45, 31, pixel_format::indexed8);
+    }
+
+    SUBCASE("Adobe CMYK") {
+        test_jpeg_decode_md5("cmyk.jpg", "c8659e332d6d6659bdb6c626254c52ac", 33, 21, pixel_format::rgb888);
+    }
+}
+
+TEST_CASE("JPEG decoder: DCT-domain scaling") {
+    using onyx_image::pixel_format;
+
+    SUBCASE("4:2:0 at 1/2, 1/4 and 1/8 (DC only)") {
+        test_jpeg_decode_md5("baseline_420.jpg", "2dd77197b463a5cc58d70124b786773b", 31, 22, pixel_format::rgb888, 2);
+        test_jpeg_decode_md5("baseline_420.jpg", "822239813bf6c5d5236b0910f01acd25", 16, 11, pixel_format::rgb888, 4);
+        test_jpeg_decode_md5("baseline_420.jpg", "d54017d783f4918ca616f7b911a0f34c", 8, 6, pixel_format::rgb888, 8);
+    }
+
+    SUBCASE("Progressive at 1/8 skips the AC scans") {
+        test_jpeg_decode_md5("progressive_420.jpg", "d54017d783f4918ca616f7b911a0f34c", 8, 6, pixel_format::rgb888, 8);
+    }
+
+    SUBCASE("4:2:2 keeps upsampling chroma horizontally") {
+        test_jpeg_decode_md5("baseline_422_restart.jpg", "898cda29c9bc6efd4c16e91ec5f83e96", 27, 19, pixel_format::rgb888, 2);
+        test_jpeg_decode_md5("baseline_422_restart.jpg", "eb9e0447fd305a40aa89750fd4f2f5aa", 7, 5, pixel_format::rgb888, 8);
+    }
+
+    SUBCASE("Grayscale at 1/4") {
+        test_jpeg_decode_md5("gray.jpg", "690c799de3a8b48778828fc2d3702101", 12, 8, pixel_format::indexed8, 4);
+    }
+
+    SUBCASE("Unsupported factors round down") {
+        test_jpeg_decode_md5("baseline_444.jpg", "ac7b8392d058b3abf9435a2ee7cd5bd2", 19, 15, pixel_format::rgb888, 3);
+        test_jpeg_decode_md5("baseline_444.jpg", "9431030881401ded91549c8af351c432", 5, 4, pixel_format::rgb888, 16);
+    }
+}
+
+TEST_CASE("JPEG decoder: stream input matches buffer input") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "jpeg" / "progressive_420.jpg");
+    REQUIRE(!data.empty());
+
+    onyx_image::memory_surface expected;
+    REQUIRE(onyx_image::decode(data, expected).ok);
+
+    onyx_image::memory_source src(data);
+    onyx_image::memory_surface streamed;
+    REQUIRE(onyx_image::decode(src, streamed, "jpeg").ok);
+    CHECK(compute_surface_md5(streamed) == compute_surface_md5(expected));
+}
+
+TEST_CASE("JPEG decoder: unsupported variants are rejected") {
+    auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "jpeg" / "baseline_444.jpg");
+    REQUIRE(!data.empty());
+
+    // Locate the SOF0 marker
+    std::size_t sof = 2;
+    while (sof + 4 < data.size() && !(data[sof] == 0xFF && data[sof + 1] == 0xC0)) {
+        ++sof;
+    }
+    REQUIRE(sof + 4 < data.size());
+
+    SUBCASE("Arithmetic coding") {
+        auto patched = data;
+        patched[sof + 1] = 0xC9;
+        onyx_image::memory_surface surface;
+        const auto result = onyx_image::decode(patched, surface);
+        CHECK_FALSE(result.ok);
+        CHECK(result.error == onyx_image::decode_error::unsupported_encoding);
+    }
+
+    SUBCASE("12-bit samples") {
+        auto patched = data;
+        patched[sof + 4] = 12;
+        onyx_image::memory_surface surface;
+        const auto result = onyx_image::decode(patched, surface);
+        CHECK_FALSE(result.ok);
+        CHECK(result.error == onyx_image::decode_error::unsupported_bit_depth);
+    }
+}
+
+TEST_CASE("JPEG decoder: corrupt tables") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "jpeg" / "baseline_444.jpg");
+    REQUIRE(!data.empty());
+
+    // Offset of the first segment with the given marker
+    const auto find_marker = [&](std::uint8_t marker) {
+        std::size_t pos = 2;
+        while (pos + 4 < data.size() && !(data[pos] == 0xFF && data[pos + 1] == marker)) {
+            ++pos;
+        }
+        REQUIRE(pos + 4 < data.size());
+        return pos;
+    };
+
+    SUBCASE("Over-subscribed Huffman table") {
+        // All codes of the first table moved to length 2, which holds
+        // only four; they would overrun the fast lookup table
+        auto patched = data;
+        const std::size_t counts = find_marker(0xC4) + 5;
+        int total = 0;
+        for (int i = 0; i < 16; ++i) {
+            total += patched[counts + i];
+            patched[counts + i] = 0;
+        }
+        REQUIRE(total > 4);
+        patched[counts + 1] = static_cast<std::uint8_t>(total);
+
+        onyx_image::memory_surface surface;
+        const auto result = onyx_image::decode(patched, surface);
+        CHECK_FALSE(result.ok);
+        CHECK(result.error == onyx_image::decode_error::invalid_format);
+    }
+
+    SUBCASE("Extreme quantization values") {
+        // Dequantized coefficients far outside the range of real images
+        // must not overflow the transforms
+        auto patched = data;
+        const std::size_t dqt = find_marker(0xDB);
+        const std::size_t length = static_cast<std::size_t>(data[dqt + 2] << 8 | data[dqt + 3]);
+        for (std::size_t pos = dqt + 4; pos + 65 <= dqt + 2 + length; pos += 65) {
+            REQUIRE((patched[pos] >> 4) == 0);  // 8-bit entries
+            std::fill_n(patched.begin() + static_cast<std::ptrdiff_t>(pos) + 1, 64, std::uint8_t{255});
+        }
+
+        for (const int scale : {1, 2, 4, 8}) {
+            INFO("1/", scale);
+            onyx_image::decode_options options;
+            options.scale_denom = scale;
+            onyx_image::memory_surface surface;
+            CHECK(onyx_image::decode(patched, surface, options).ok);
+        }
+    }
+}
@@ -3,6 +3,7 @@
 
 #include "helpers/md5.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
@@ -89,6 +90,47 @@ void test_lbm_decode_md5(
     CHECK(actual_md5 == expected_md5);
 }
 
+void append_chunk(std::vector<std::uint8_t>& out, const char* id,
+                  const std::vector<std::uint8_t>& payload) {
+    out.insert(out.end(), id, id + 4);
+    const auto size = static_cast<std::uint32_t>(payload.size());
+    out.push_back(static_cast<std::uint8_t>(size >> 24));
+    out.push_back(static_cast<std::uint8_t>(size >> 16));
+    out.push_back(static_cast<std::uint8_t>(size >> 8));
+    out.push_back(static_cast<std::uint8_t>(size));
+    out.insert(out.end(), payload.begin(), payload.end());
+    if (payload.size() % 2 != 0) {
+        out.push_back(0);
+    }
+}
+
+std::vector<std::uint8_t> make_bmhd(int width, int height, int planes,
+                                    int masking, int compression) {
+    return {
+        static_cast<std::uint8_t>(width >> 8), static_cast<std::uint8_t>(width),
+        static_cast<std::uint8_t>(height >> 8), static_cast<std::uint8_t>(height),
+        0x00, 0x00, 0x00, 0x00,
+        static_cast<std::uint8_t>(planes), static_cast<std::uint8_t>(masking),
+        static_cast<std::uint8_t>(compression), 0x00,
+        0x00, 0x00, 0x01, 0x01,
+        static_cast<std::uint8_t>(width >> 8), static_cast<std::uint8_t>(width),
+        static_cast<std::uint8_t>(height >> 8), static_cast<std::uint8_t>(height)
+    };
+}
+
+// Wrap already-encoded chunks in a FORM of the given type
+std::vector<std::uint8_t> make_form(const char* type, const std::vector<std::uint8_t>& chunks) {
+    std::vector<std::uint8_t> out = {'F', 'O', 'R', 'M'};
+    const auto size = static_cast<std::uint32_t>(chunks.size() + 4);
+    out.push_back(static_cast<std::uint8_t>(size >> 24));
+    out.push_back(static_cast<std::uint8_t>(size >> 16));
+    out.push_back(static_cast<std::uint8_t>(size >> 8));
+    out.push_back(static_cast<std::uint8_t>(size));
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), chunks.begin(), chunks.end());
+    return out;
+}
+
 } // namespace
 
 TEST_CASE("LBM decoder: sniff") {
@@ -155,3 +197,212 @@ TEST_CASE("LBM decoder: MD5 verification") {
         test_lbm_decode_md5("rt32.iff", "38fad3937a2448b019b1452b7ec90433", "ILBM uncompressed");
     }
 }
+
+TEST_CASE("LBM decoder: chunk walking") {
+    // Uncompressed 2x1 PBM with an odd-sized unknown chunk (padded) ahead of
+    // BMHD, and BODY as the last chunk in the FORM.
+    std::vector<std::uint8_t> chunks;
+    append_chunk(chunks, "ANNO", {'a', 'b', 'c'});
+    append_chunk(chunks, "BMHD", make_bmhd(2, 1, 1, 0, 0));
+    append_chunk(chunks, "CMAP", {0x10, 0x20, 0x30, 0x40, 0x50, 0x60});
+    append_chunk(chunks, "BODY", {0x01, 0x00});
+    auto data = make_form("PBM ", chunks);
+
+    SUBCASE("Chunks are found through padding") {
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::lbm_decoder::decode(data, surface);
+        REQUIRE(result.ok);
+        CHECK(surface.width() == 2);
+        CHECK(surface.height() == 1);
+        CHECK(surface.format() == onyx_image::pixel_format::indexed8);
+        REQUIRE(surface.pixels().size() == 2);
+        CHECK(surface.pixels()[0] == 1);
+        CHECK(surface.pixels()[1] == 0);
+        REQUIRE(surface.palette().size() >= 6);
+        CHECK(surface.palette()[3] == 0x40);
+    }
+
+    SUBCASE("Truncated BODY is reported") {
+        data.pop_back();
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::lbm_decoder::decode(data, surface);
+        CHECK_FALSE(result.ok);
+        CHECK(result.error == onyx_image::decode_error::truncated_data);
+    }
+}
+
+TEST_CASE("LBM decoder: ByteRun1 layout") {
+    SUBCASE("Declared mask plane missing from BODY") {
+        // 16 pixels wide, 1 plane, masking = 1, but BODY only holds the
+        // bitplane rows
+        for (const int height : {1, 2, 4}) {
+            INFO("height ", height);
+            std::vector<std::uint8_t> body;
+            for (int y = 0; y < height; ++y) {
+                body.insert(body.end(), {0x01, static_cast<std::uint8_t>(0xF0 >> y), 0x0F});
+            }
+            std::vector<std::uint8_t> chunks;
+            append_chunk(chunks, "BMHD", make_bmhd(16, height, 1, 1, 1));
+            append_chunk(chunks, "BODY", body);
+            auto data = make_form("ILBM", chunks);
+
+            onyx_image::memory_surface surface;
+            auto result = onyx_image::lbm_decoder::decode(data, surface);
+            REQUIRE(result.ok);
+            REQUIRE(surface.pixels().size() == static_cast<std::size_t>(16 * height));
+            CHECK(surface.pixels()[0] == 1);
+            CHECK(surface.pixels()[4] == 0);
+            CHECK(surface.pixels()[15] == 1);
+            if (height > 1) {
+                CHECK(surface.pixels()[16] == 0);
+                CHECK(surface.pixels()[17] == 1);
+                CHECK(surface.pixels()[21] == 0);
+            }
+
+            onyx_image::null_surface check;
+            CHECK(onyx_image::lbm_decoder::decode(data, check).ok);
+        }
+    }
+
+    SUBCASE("Declared mask plane missing from a large BODY") {
+        // 32x4096, 2 planes, masking = 1, each row one literal packet over
+        // both plane rows. The first row overruns with the mask, so it
+        // settles the layout and the BODY is read once.
+        constexpr int height = 4096;
+        std::vector<std::uint8_t> body;
+        for (int y = 0; y < height; ++y) {
+            const std::uint8_t odd = (y & 1) ? 0xFF : 0x00;
+            body.insert(body.end(), {0x07, 0xFF, 0x00, 0xFF, 0x00, odd, odd, odd, odd});
+        }
+        std::vector<std::uint8_t> chunks;
+        append_chunk(chunks, "BMHD", make_bmhd(32, height, 2, 1, 1));
+        append_chunk(chunks, "BODY", body);
+        auto data = make_form("ILBM", chunks);
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::lbm_decoder::decode(data, surface);
+        REQUIRE(result.ok);
+        REQUIRE(surface.pixels().size() == static_cast<std::size_t>(32 * height));
+        for (const int y : {0, 1, height - 2, height - 1}) {
+            INFO("row ", y);
+            const std::size_t row = static_cast<std::size_t>(y) * 32;
+            CHECK(surface.pixels()[row + 0] == 1 + 2 * (y & 1));
+            CHECK(surface.pixels()[row + 8] == 2 * (y & 1));
+        }
+
+        onyx_image::null_surface check;
+        CHECK(onyx_image::lbm_decoder::decode(data, check).ok);
+    }
+
+    SUBCASE("Declared mask plane missing, found after the first row") {
+        // 32x8, 1 plane, masking = 1, one literal packet per plane row: the
+        // first row fits both layouts, and the BODY runs short halfway
+        std::vector<std::uint8_t> body;
+        for (int y = 0; y < 8; ++y) {
+            body.insert(body.end(), {0x03, static_cast<std::uint8_t>(0x80 >> y), 0x00, 0x00, 0x01});
+        }
+        std::vector<std::uint8_t> chunks;
+        append_chunk(chunks, "BMHD", make_bmhd(32, 8, 1, 1, 1));
+        append_chunk(chunks, "BODY", body);
+        auto data = make_form("ILBM", chunks);
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::lbm_decoder::decode(data, surface);
+        REQUIRE(result.ok);
+        REQUIRE(surface.pixels().size() == 32 * 8);
+        for (int y = 0; y < 8; ++y) {
+            INFO("row ", y);
+            const std::size_t row = static_cast<std::size_t>(y) * 32;
+            CHECK(surface.pixels()[row + static_cast<std::size_t>(y)] == 1);
+            CHECK(surface.pixels()[row + static_cast<std::size_t>(y + 1) % 8] == 0);
+            CHECK(surface.pixels()[row + 31] == 1);
+        }
+
+        onyx_image::null_surface check;
+        CHECK(onyx_image::lbm_decoder::decode(data, check).ok);
+    }
+
+    SUBCASE("Declared mask plane missing, rows re-split without it") {
+        // 16 pixels wide, 2 planes, one literal packet per plane row. The
+        // masked layout fits the first rows and overruns later, at a point
+        // that may fall inside a row without the mask; the result must
+        // match the BODY decoded as unmasked.
+        for (const int height : {5, 7, 9}) {
+            INFO("height ", height);
+            std::vector<std::uint8_t> body;
+            for (int i = 0; i < height * 2; ++i) {
+                body.insert(body.end(), {0x01, static_cast<std::uint8_t>(i * 37 + 5),
+                                         static_cast<std::uint8_t>(0xA5 ^ (i * 11))});
+            }
+            std::vector<std::uint8_t> masked_chunks;
+            append_chunk(masked_chunks, "BMHD", make_bmhd(16, height, 2, 1, 1));
+            append_chunk(masked_chunks, "BODY", body);
+            std::vector<std::uint8_t> plain_chunks;
+            append_chunk(plain_chunks, "BMHD", make_bmhd(16, height, 2, 0, 1));
+            append_chunk(plain_chunks, "BODY", body);
+
+            onyx_image::memory_surface expected;
+            REQUIRE(onyx_image::lbm_decoder::decode(make_form("ILBM", plain_chunks), expected).ok);
+
+            const auto data = make_form("ILBM", masked_chunks);
+            onyx_image::memory_surface surface;
+            REQUIRE(onyx_image::lbm_decoder::decode(data, surface).ok);
+            CHECK(std::equal(surface.pixels().begin(), surface.pixels().end(),
+                             expected.pixels().begin(), expected.pixels().end()));
+
+            onyx_image::null_surface check;
+            CHECK(onyx_image::lbm_decoder::decode(data, check).ok);
+        }
+    }
+
+    SUBCASE("Stored mask plane, one run per scanline") {
+        // 320x10, 1 plane, masking = 1: each scanline is a single replicate
+        // run over the bitplane and mask rows, so the BODY is smaller than
+        // one packet per plane row would need
+        std::vector<std::uint8_t> body;
+        for (int y = 0; y < 10; ++y) {
+            body.insert(body.end(), {0xB1, 0xFF});
+        }
+        std::vector<std::uint8_t> chunks;
+        append_chunk(chunks, "BMHD", make_bmhd(320, 10, 1, 1, 1));
+        append_chunk(chunks, "BODY", body);
+        auto data = make_form("ILBM", chunks);
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::lbm_decoder::decode(data, surface);
+        REQUIRE(result.ok);
+        REQUIRE(surface.pixels().size() == 320 * 10);
+        CHECK(surface.pixels()[0] == 1);
+        CHECK(surface.pixels()[320 * 10 - 1] == 1);
+
+        onyx_image::null_surface check;
+        CHECK(onyx_image::lbm_decoder::decode(data, check).ok);
+    }
+
+    SUBCASE("Run spanning planes (per-scanline encoder)") {
+        // 16x1, 2 planes: one replicate run covers both plane rows
+        std::vector<std::uint8_t> chunks;
+        append_chunk(chunks, "BMHD", make_bmhd(16, 1, 2, 0, 1));
+        append_chunk(chunks, "BODY", {0xFD, 0xFF});
+        auto data = make_form("ILBM", chunks);
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::lbm_decoder::decode(data, surface);
+        REQUIRE(result.ok);
+        REQUIRE(surface.pixels().size() == 16);
+        CHECK(surface.pixels()[0] == 3);
+        CHECK(surface.pixels()[15] == 3);
+    }
+
+    SUBCASE("Corrupt stream") {
+        std::vector<std::uint8_t> chunks;
+        append_chunk(chunks, "BMHD", make_bmhd(16, 2, 1, 0, 1));
+        append_chunk(chunks, "BODY", {0xFF, 0xAA});
+        auto data = make_form("ILBM", chunks);
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::lbm_decoder::decode(data, surface);
+        CHECK_FALSE(result.ok);
+        CHECK(result.error == onyx_image::decode_error::truncated_data);
+    }
+}
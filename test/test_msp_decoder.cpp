@@ -91,6 +91,47 @@ void test_msp_decode_md5(
     CHECK(actual_md5 == expected_md5);
 }
 
+// Decode with packed_indexed and check the result renders exactly like the
+// default indexed8 decode once expanded
+void test_packed_decode(const std::filesystem::path& path, onyx_image::pixel_format expected_format) {
+    INFO("Testing: ", path.string());
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    onyx_image::memory_surface reference;
+    REQUIRE(onyx_image::decode(data, reference).ok);
+
+    onyx_image::decode_options options;
+    options.packed_indexed = true;
+    onyx_image::memory_surface packed;
+    REQUIRE(onyx_image::decode(data, packed, options).ok);
+    REQUIRE(packed.format() == expected_format);
+    CHECK(packed.pitch() == onyx_image::row_bytes(expected_format, static_cast<std::size_t>(packed.width())));
+    CHECK(packed.pixels().size() == packed.pitch() * static_cast<std::size_t>(packed.height()));
+
+    onyx_image::memory_surface expanded;
+    REQUIRE(onyx_image::expand_packed(packed, expanded));
+    REQUIRE(expanded.format() == onyx_image::pixel_format::indexed8);
+    REQUIRE(expanded.width() == reference.width());
+    REQUIRE(expanded.height() == reference.height());
+
+    const auto ref_pixels = reference.pixels();
+    const auto ref_palette = reference.palette();
+    const auto pixels = expanded.pixels();
+    const auto palette = expanded.palette();
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        const std::size_t a = static_cast<std::size_t>(ref_pixels[i]) * 3;
+        const std::size_t b = static_cast<std::size_t>(pixels[i]) * 3;
+        if (a + 2 >= ref_palette.size() || b + 2 >= palette.size() ||
+            ref_palette[a] != palette[b] || ref_palette[a + 1] != palette[b + 1] ||
+            ref_palette[a + 2] != palette[b + 2]) {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
 } // namespace
 
 TEST_CASE("MSP decoder: sniff") {
@@ -127,3 +168,9 @@ TEST_CASE("MSP decoder: MD5 verification") {
     // hopper.msp is a 128x128 1-bit monochrome image (version 1, uncompressed)
     test_msp_decode_md5("msp/hopper.msp", "860202c427401ef526bbf8b8ae7be22e", 128, 128);
 }
+
+TEST_CASE("MSP decoder: packed output") {
+    // Stored bits are kept; the palette is inverted instead
+    test_packed_decode(std::filesystem::path(TEST_DATA_DIR) / "msp/hopper.msp",
+                       onyx_image::pixel_format::indexed1);
+}
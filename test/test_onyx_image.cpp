@@ -1,6 +1,1099 @@
 #include <doctest/doctest.h>
 #include <onyx_image/onyx_image.hpp>
 
+#include "helpers/short_read_source.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::vector<std::uint8_t> read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return {};
+    }
+
+    const auto size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<std::uint8_t> data(static_cast<std::size_t>(size));
+    file.read(reinterpret_cast<char*>(data.data()), size);
+
+    return data;
+}
+
+// Verify must report exactly what a full decode reports
+void check_verify_matches_decode(std::span<const std::uint8_t> data, const std::string& label) {
+    onyx_image::memory_surface surf;
+    const auto decoded = onyx_image::decode(data, surf);
+
+    onyx_image::null_surface null_surf;
+    const auto verified = onyx_image::decode(data, null_surf);
+
+    INFO(label);
+    CHECK(verified.ok == decoded.ok);
+    CHECK(verified.error == decoded.error);
+    CHECK(verified.message == decoded.message);
+
+    if (decoded.ok) {
+        CHECK(null_surf.width() == surf.width());
+        CHECK(null_surf.height() == surf.height());
+        CHECK(null_surf.format() == surf.format());
+        CHECK(null_surf.subrect_count() == static_cast<int>(surf.subrects().size()));
+    }
+
+    CHECK(onyx_image::verify(data).ok == decoded.ok);
+}
+
+} // namespace
+
 TEST_CASE("onyx_image basic test") {
     CHECK(true);
 }
+
+TEST_CASE("null_surface: geometry without storage") {
+    onyx_image::null_surface surf;
+    CHECK(surf.discards_pixels());
+    CHECK_FALSE(onyx_image::memory_surface{}.discards_pixels());
+
+    CHECK(surf.set_size(640, 480, onyx_image::pixel_format::indexed8));
+    CHECK(surf.width() == 640);
+    CHECK(surf.height() == 480);
+
+    surf.set_palette_size(16);
+    CHECK(surf.palette_size() == 16);
+
+    // Same limits as memory_surface
+    CHECK_FALSE(surf.set_size(0, 10, onyx_image::pixel_format::rgb888));
+    CHECK_FALSE(surf.set_size(20000, 20000, onyx_image::pixel_format::rgba8888));
+}
+
+TEST_CASE("verify: matches decode on test files") {
+    const std::filesystem::path root(TEST_DATA_DIR);
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+
+        const auto data = read_file(entry.path());
+        if (data.empty()) {
+            continue;
+        }
+        const std::string name = entry.path().lexically_relative(root).string();
+        const std::span<const std::uint8_t> all(data);
+
+        check_verify_matches_decode(all, name);
+
+        // Truncated copies exercise the error paths
+        check_verify_matches_decode(all.first(data.size() / 2), name + " (half)");
+        check_verify_matches_decode(all.first(data.size() - 1), name + " (short by one)");
+    }
+}
+
+TEST_CASE("memory_surface: packed indexed formats") {
+    using onyx_image::pixel_format;
+
+    CHECK(onyx_image::row_bytes(pixel_format::indexed1, 9) == 2);
+    CHECK(onyx_image::row_bytes(pixel_format::indexed2, 5) == 2);
+    CHECK(onyx_image::row_bytes(pixel_format::indexed4, 3) == 2);
+    CHECK(onyx_image::bytes_per_pixel(pixel_format::indexed4) == 0);
+
+    onyx_image::memory_surface surf;
+    REQUIRE(surf.set_size(5, 2, pixel_format::indexed2));
+    CHECK(surf.pitch() == 2);
+    CHECK(surf.pixels().size() == 4);
+
+    // Leftmost pixel in the high bits
+    surf.write_pixel(0, 1, 3);
+    surf.write_pixel(1, 1, 1);
+    surf.write_pixel(4, 1, 2);
+    CHECK(surf.pixels()[2] == 0xD0);
+    CHECK(surf.pixels()[3] == 0x80);
+
+    std::uint8_t row[5] = {};
+    onyx_image::unpack_indexed_row(pixel_format::indexed2, surf.pixels().data() + 2, row, 5);
+    CHECK(row[0] == 3);
+    CHECK(row[1] == 1);
+    CHECK(row[2] == 0);
+    CHECK(row[3] == 0);
+    CHECK(row[4] == 2);
+}
+
+TEST_CASE("memory_surface: row alignment and explicit pitch") {
+    using onyx_image::pixel_format;
+
+    onyx_image::memory_surface aligned(onyx_image::row_layout{256, 0});
+    REQUIRE(aligned.set_size(70, 3, pixel_format::rgb888));
+    CHECK(aligned.pitch() == 256);
+    CHECK(aligned.pixels().size() == 3 * 256);
+    CHECK(reinterpret_cast<std::uintptr_t>(aligned.pixels().data()) % onyx_image::memory_surface::BASE_ALIGNMENT == 0);
+
+    // Writes stop at the end of the row; the padding stays zero
+    const std::vector<std::uint8_t> fill(300, 0xAB);
+    for (int y = 0; y < 3; ++y) {
+        aligned.write_pixels(0, y, static_cast<int>(fill.size()), fill.data());
+    }
+    aligned.write_pixels(210, 1, 1, fill.data());
+    for (int y = 0; y < 3; ++y) {
+        const auto row = aligned.pixels().subspan(static_cast<std::size_t>(y) * 256, 256);
+        CHECK(std::count(row.begin(), row.begin() + 210, 0xAB) == 210);
+        CHECK(std::count(row.begin() + 210, row.end(), 0) == 46);
+    }
+
+    onyx_image::memory_surface explicit_pitch(onyx_image::row_layout{1, 100});
+    REQUIRE(explicit_pitch.set_size(33, 2, pixel_format::rgb888));
+    CHECK(explicit_pitch.pitch() == 100);
+    CHECK_FALSE(explicit_pitch.set_size(34, 2, pixel_format::rgb888));
+
+    onyx_image::memory_surface invalid(onyx_image::row_layout{3, 0});
+    CHECK_FALSE(invalid.set_size(4, 4, pixel_format::indexed8));
+    invalid.set_row_layout({16, 0});
+    REQUIRE(invalid.set_size(4, 4, pixel_format::indexed8));
+    CHECK(invalid.pitch() == 16);
+}
+
+TEST_CASE("memory_surface: padded rows decode and encode like tight rows") {
+    const std::filesystem::path root(TEST_DATA_DIR);
+    for (const auto& file : {root / "png" / "rgba8.png", root / "png" / "palette4.png",
+                             root / "jpeg" / "baseline_420.jpg", root / "pcx" / "CGA_TST1.PCX"}) {
+        INFO(file.string());
+        const auto data = read_file(file);
+        REQUIRE(!data.empty());
+
+        onyx_image::memory_surface tight;
+        REQUIRE(onyx_image::decode(data, tight).ok);
+        onyx_image::memory_surface padded(onyx_image::row_layout{64, 0});
+        REQUIRE(onyx_image::decode(data, padded).ok);
+
+        REQUIRE(padded.width() == tight.width());
+        REQUIRE(padded.format() == tight.format());
+        CHECK(padded.pitch() % 64 == 0);
+        const std::size_t row_size = onyx_image::row_bytes(tight.format(), static_cast<std::size_t>(tight.width()));
+        for (int y = 0; y < tight.height(); ++y) {
+            const auto a = tight.pixels().subspan(static_cast<std::size_t>(y) * tight.pitch(), row_size);
+            const auto b = padded.pixels().subspan(static_cast<std::size_t>(y) * padded.pitch(), row_size);
+            CHECK(std::ranges::equal(a, b));
+        }
+        CHECK(onyx_image::encode_png(padded) == onyx_image::encode_png(tight));
+
+        onyx_image::memory_surface expanded_tight;
+        onyx_image::memory_surface expanded_padded;
+        REQUIRE(onyx_image::expand_packed(tight, expanded_tight));
+        REQUIRE(onyx_image::expand_packed(padded, expanded_padded));
+        CHECK(std::ranges::equal(expanded_padded.pixels(), expanded_tight.pixels()));
+    }
+}
+
+TEST_CASE("byte_source: memory and file sources") {
+    const std::filesystem::path path = std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_BW.PCX";
+    const auto expected = read_file(path);
+    REQUIRE(expected.size() > 200);
+
+    SUBCASE("memory_source reads and skips") {
+        onyx_image::memory_source src(expected);
+        std::uint8_t head[16];
+        CHECK(src.read(head, sizeof(head)) == sizeof(head));
+        CHECK(std::equal(head, head + 16, expected.begin()));
+        CHECK(src.skip(100) == 100);
+        const auto rest = onyx_image::read_all(src);
+        CHECK(rest.size() == expected.size() - 116);
+        CHECK(std::equal(rest.begin(), rest.end(), expected.begin() + 116));
+        CHECK(src.at_end());
+        CHECK(src.skip(10) == 0);
+    }
+
+    SUBCASE("file_source matches the file") {
+        onyx_image::file_source src(path);
+        REQUIRE(src.is_open());
+        CHECK_FALSE(src.at_end());
+        CHECK(src.skip(50) == 50);
+        const auto rest = onyx_image::read_all(src);
+        CHECK(rest.size() == expected.size() - 50);
+        CHECK(std::equal(rest.begin(), rest.end(), expected.begin() + 50));
+        CHECK(src.at_end());
+    }
+
+    SUBCASE("missing file") {
+        onyx_image::file_source src(std::filesystem::path(TEST_DATA_DIR) / "does_not_exist.bin");
+        CHECK_FALSE(src.is_open());
+        CHECK(src.at_end());
+    }
+}
+
+TEST_CASE("decode: stream input matches buffer input") {
+    const std::filesystem::path path = std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_BW.PCX";
+    const auto data = read_file(path);
+
+    onyx_image::memory_surface expected;
+    REQUIRE(onyx_image::decode(data, expected).ok);
+
+    // Codecs without a streaming path read the source to the end first
+    onyx_image::file_source src(path);
+    onyx_image::memory_surface streamed;
+    REQUIRE(onyx_image::decode(src, streamed, "pcx").ok);
+    CHECK(streamed.width() == expected.width());
+    CHECK(streamed.height() == expected.height());
+    CHECK(std::equal(streamed.pixels().begin(), streamed.pixels().end(), expected.pixels().begin()));
+
+    onyx_image::memory_source unknown(data);
+    CHECK_FALSE(onyx_image::decode(unknown, streamed, "no-such-codec").ok);
+}
+
+TEST_CASE("decode: short reads do not end a stream") {
+    const std::filesystem::path path = std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_BW.PCX";
+    const auto data = read_file(path);
+    REQUIRE(data.size() > 200);
+
+    onyx_image::memory_surface expected;
+    REQUIRE(onyx_image::decode(data, expected).ok);
+
+    // A source that returns fewer bytes than asked, like a pipe, is read
+    // until it returns nothing
+    for (const std::size_t max_read : {1, 7, 4096}) {
+        INFO("Max read ", max_read);
+        short_read_source src(data, max_read);
+        CHECK(onyx_image::read_all(src) == data);
+
+        short_read_source stream(data, max_read);
+        onyx_image::memory_surface streamed;
+        REQUIRE(onyx_image::decode(stream, streamed, "pcx").ok);
+        CHECK(std::ranges::equal(streamed.pixels(), expected.pixels()));
+    }
+}
+
+TEST_CASE("decode_cache: hits share the decoded image") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_BW.PCX");
+    REQUIRE(!data.empty());
+
+    onyx_image::decode_cache cache;
+    std::shared_ptr<const onyx_image::memory_surface> first;
+    std::shared_ptr<const onyx_image::memory_surface> second;
+    REQUIRE(cache.decode(data, first).ok);
+    REQUIRE(cache.decode(data, second).ok);
+    CHECK(first == second);
+    CHECK(cache.entry_count() == 1);
+    CHECK(cache.size_bytes() >= first->pixels().size());
+    CHECK(cache.stats().hits == 1);
+    CHECK(cache.stats().misses == 1);
+
+    SUBCASE("options and codec name are part of the key") {
+        onyx_image::decode_options options;
+        options.max_width = 1000;
+        std::shared_ptr<const onyx_image::memory_surface> other;
+        REQUIRE(cache.decode(data, other, options).ok);
+        CHECK(other != first);
+        REQUIRE(cache.decode(data, other, "pcx").ok);
+        CHECK(cache.entry_count() == 3);
+    }
+
+    SUBCASE("failures are not cached") {
+        const std::size_t entries = cache.entry_count();
+        std::shared_ptr<const onyx_image::memory_surface> image;
+        const std::span<const std::uint8_t> truncated(data.data(), 4);
+        CHECK_FALSE(cache.decode(truncated, image).ok);
+        CHECK_FALSE(cache.decode(truncated, image).ok);
+        CHECK(cache.entry_count() == entries);
+    }
+
+    SUBCASE("decode() routes through decode_options::cache") {
+        onyx_image::memory_surface plain;
+        REQUIRE(onyx_image::decode(data, plain).ok);
+
+        const auto hits = cache.stats().hits;
+        onyx_image::decode_options options;
+        options.cache = &cache;
+        onyx_image::memory_surface cached;
+        REQUIRE(onyx_image::decode(data, cached, options).ok);
+        CHECK(cache.stats().hits == hits + 1);
+        CHECK(cached.width() == plain.width());
+        CHECK(cached.format() == plain.format());
+        CHECK(std::equal(cached.pixels().begin(), cached.pixels().end(), plain.pixels().begin(), plain.pixels().end()));
+        CHECK(std::equal(cached.palette().begin(), cached.palette().end(), plain.palette().begin(), plain.palette().end()));
+
+        // verify() never allocates, so it bypasses the cache
+        CHECK(onyx_image::verify(data, options).ok);
+        CHECK(cache.stats().hits == hits + 1);
+    }
+
+    SUBCASE("clear keeps handed out images alive") {
+        cache.clear();
+        CHECK(cache.entry_count() == 0);
+        CHECK(cache.size_bytes() == 0);
+        CHECK(first->width() > 0);
+    }
+}
+
+TEST_CASE("decode_cache: least recently used entries are evicted") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_BW.PCX");
+    REQUIRE(!data.empty());
+
+    std::size_t entry_size = 0;
+    {
+        onyx_image::decode_cache probe;
+        std::shared_ptr<const onyx_image::memory_surface> image;
+        REQUIRE(probe.decode(data, image).ok);
+        entry_size = probe.size_bytes();
+    }
+
+    // Room for two entries; distinct limits give the same image distinct keys
+    onyx_image::decode_cache cache(entry_size * 2 + entry_size / 2, 4);
+    onyx_image::decode_options a, b, c;
+    a.max_width = 1000;
+    b.max_width = 1001;
+    c.max_width = 1002;
+
+    std::shared_ptr<const onyx_image::memory_surface> image;
+    REQUIRE(cache.decode(data, image, a).ok);
+    REQUIRE(cache.decode(data, image, b).ok);
+    REQUIRE(cache.decode(data, image, a).ok);  // a is now more recent than b
+    REQUIRE(cache.decode(data, image, c).ok);
+    CHECK(cache.entry_count() == 2);
+    CHECK(cache.stats().evictions == 1);
+
+    REQUIRE(cache.decode(data, image, a).ok);
+    CHECK(cache.stats().hits == 2);
+    REQUIRE(cache.decode(data, image, b).ok);
+    CHECK(cache.stats().misses == 4);
+
+    // Larger than the whole budget: decoded, not kept
+    onyx_image::decode_cache tiny(entry_size / 2);
+    REQUIRE(tiny.decode(data, image).ok);
+    CHECK(tiny.entry_count() == 0);
+}
+
+TEST_CASE("decode_cache: concurrent decodes") {
+    const std::filesystem::path root(TEST_DATA_DIR);
+    const std::vector<std::vector<std::uint8_t>> files = {
+        read_file(root / "pcx" / "CGA_BW.PCX"),
+        read_file(root / "pcx" / "CGA_TST1.PCX"),
+        read_file(root / "jpeg" / "baseline_420.jpg"),
+        read_file(root / "tga" / "colormapped_rle.tga"),
+    };
+
+    onyx_image::decode_cache cache(onyx_image::decode_cache::DEFAULT_BUDGET, 2);
+    std::vector<std::thread> threads;
+    std::vector<int> failures(8, 0);
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&, t] {
+            for (int i = 0; i < 40; ++i) {
+                const auto& data = files[static_cast<std::size_t>(i + t) % files.size()];
+                std::shared_ptr<const onyx_image::memory_surface> image;
+                if (!cache.decode(data, image).ok || !image || image->pixels().empty()) {
+                    ++failures[static_cast<std::size_t>(t)];
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    CHECK(std::count(failures.begin(), failures.end(), 0) == 8);
+    CHECK(cache.entry_count() == files.size());
+    CHECK(cache.stats().hits + cache.stats().misses == 8 * 40);
+}
+
+namespace {
+
+// Fresh directory under the system temp directory, removed on destruction
+struct temp_directory {
+    std::filesystem::path path;
+
+    explicit temp_directory(const char* name)
+        : path(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~temp_directory() {
+        std::error_code ec;
+        std::filesystem::remove_all(path, ec);
+    }
+};
+
+void check_same_image(const onyx_image::mapped_image& mapped, const onyx_image::memory_surface& surf) {
+    CHECK(mapped.width() == surf.width());
+    CHECK(mapped.height() == surf.height());
+    CHECK(mapped.format() == surf.format());
+    CHECK(mapped.pitch() == surf.pitch());
+    CHECK(std::ranges::equal(mapped.pixels(), surf.pixels()));
+    CHECK(std::ranges::equal(mapped.palette(), surf.palette()));
+    REQUIRE(mapped.subrects().size() == surf.subrects().size());
+    for (std::size_t i = 0; i < surf.subrects().size(); ++i) {
+        const auto& a = mapped.subrects()[i];
+        const auto& b = surf.subrects()[i];
+        CHECK(a.rect.x == b.rect.x);
+        CHECK(a.rect.y == b.rect.y);
+        CHECK(a.rect.w == b.rect.w);
+        CHECK(a.rect.h == b.rect.h);
+        CHECK(a.kind == b.kind);
+        CHECK(a.user_tag == b.user_tag);
+    }
+}
+
+} // namespace
+
+TEST_CASE("raw_image: save and map round trip") {
+    const temp_directory dir("onyx_image_raw_image_test");
+    const std::filesystem::path root(TEST_DATA_DIR);
+
+    // Indexed with palette, truecolor, and an atlas with subrects
+    onyx_image::decode_options packed;
+    packed.enable_packing = true;
+    const std::pair<std::filesystem::path, onyx_image::decode_options> inputs[] = {
+        {root / "pcx" / "CGA_TST1.PCX", {}},
+        {root / "jpeg" / "baseline_420.jpg", {}},
+        {root / "dcx" / "multipage.dcx", packed},
+    };
+    for (const auto& [file, options] : inputs) {
+        INFO(file.string());
+        const auto data = read_file(file);
+        REQUIRE(!data.empty());
+        onyx_image::memory_surface surf;
+        REQUIRE(onyx_image::decode(data, surf, options).ok);
+
+        const auto path = dir.path / "image.oxr";
+        REQUIRE(onyx_image::save_raw_image(surf, path));
+        const auto mapped = onyx_image::mapped_image::open(path);
+        REQUIRE(mapped);
+        CHECK(reinterpret_cast<std::uintptr_t>(mapped->pixels().data()) % 64 == 0);
+        check_same_image(*mapped, surf);
+    }
+
+    CHECK_FALSE(onyx_image::mapped_image::open(dir.path / "missing.oxr"));
+
+    // Truncated container
+    const auto data = read_file(root / "pcx" / "CGA_BW.PCX");
+    onyx_image::memory_surface surf;
+    REQUIRE(onyx_image::decode(data, surf).ok);
+    const auto path = dir.path / "truncated.oxr";
+    REQUIRE(onyx_image::save_raw_image(surf, path));
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    CHECK_FALSE(onyx_image::mapped_image::open(path));
+}
+
+TEST_CASE("disk_cache: entries persist across instances") {
+    const temp_directory dir("onyx_image_disk_cache_test");
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_TST1.PCX");
+    REQUIRE(!data.empty());
+    onyx_image::memory_surface reference;
+    REQUIRE(onyx_image::decode(data, reference).ok);
+
+    {
+        onyx_image::disk_cache cache(dir.path);
+        REQUIRE(cache.is_open());
+        std::shared_ptr<const onyx_image::mapped_image> image;
+        REQUIRE(cache.decode(data, image).ok);
+        REQUIRE(image);
+        check_same_image(*image, reference);
+        CHECK(cache.stats().misses == 1);
+        CHECK(cache.size_bytes() > 0);
+    }
+
+    // A new instance (as in a later run) finds the entry without decoding
+    onyx_image::disk_cache cache(dir.path);
+    CHECK(cache.size_bytes() > 0);
+    std::shared_ptr<const onyx_image::mapped_image> image;
+    REQUIRE(cache.decode(data, image).ok);
+    REQUIRE(image);
+    check_same_image(*image, reference);
+    CHECK(cache.stats().hits == 1);
+    CHECK(cache.stats().misses == 0);
+
+    // Different options are a different entry
+    onyx_image::decode_options options;
+    options.max_width = 1000;
+    REQUIRE(cache.decode(data, image, "pcx", options).ok);
+    CHECK(cache.stats().misses == 1);
+
+    // Failed decodes are not stored
+    const std::vector<std::uint8_t> garbage(100, 0x5A);
+    CHECK_FALSE(cache.decode(garbage, image).ok);
+
+    std::size_t files = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(dir.path)) {
+        CHECK(entry.path().extension() == ".oxr");
+        ++files;
+    }
+    CHECK(files == 2);
+
+    cache.clear();
+    CHECK(cache.size_bytes() == 0);
+    CHECK(std::filesystem::is_empty(dir.path));
+}
+
+TEST_CASE("disk_cache: damaged entries are decoded again") {
+    const temp_directory dir("onyx_image_disk_cache_damaged_test");
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_BW.PCX");
+    REQUIRE(!data.empty());
+
+    onyx_image::disk_cache cache(dir.path);
+    std::shared_ptr<const onyx_image::mapped_image> image;
+    REQUIRE(cache.decode(data, image).ok);
+    image.reset();
+
+    const auto entry = std::filesystem::directory_iterator(dir.path)->path();
+    {
+        std::ofstream out(entry, std::ios::binary | std::ios::in);
+        out.write("JUNK", 4);
+    }
+
+    REQUIRE(cache.decode(data, image).ok);
+    REQUIRE(image);
+    CHECK(cache.stats().misses == 2);
+    CHECK(cache.stats().hits == 0);
+    CHECK(onyx_image::mapped_image::open(entry));
+}
+
+TEST_CASE("disk_cache: least recently used entries are evicted") {
+    const temp_directory dir("onyx_image_disk_cache_evict_test");
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_BW.PCX");
+    REQUIRE(!data.empty());
+
+    std::uintmax_t entry_size = 0;
+    {
+        const temp_directory probe_dir("onyx_image_disk_cache_probe_test");
+        onyx_image::disk_cache probe(probe_dir.path);
+        std::shared_ptr<const onyx_image::mapped_image> image;
+        REQUIRE(probe.decode(data, image).ok);
+        entry_size = probe.size_bytes();
+        REQUIRE(entry_size > 0);
+    }
+
+    onyx_image::disk_cache cache(dir.path, entry_size * 2 + entry_size / 2);
+    onyx_image::decode_options a, b, c;
+    a.max_width = 1000;
+    b.max_width = 1001;
+    c.max_width = 1002;
+
+    // Modification times are the use order; space them explicitly since
+    // file times may be coarse
+    const auto stamp_all = [&](std::filesystem::file_time_type::duration age) {
+        for (const auto& entry : std::filesystem::directory_iterator(dir.path)) {
+            std::filesystem::last_write_time(entry.path(), std::filesystem::file_time_type::clock::now() - age);
+        }
+    };
+
+    std::shared_ptr<const onyx_image::mapped_image> image;
+    REQUIRE(cache.decode(data, image, a).ok);
+    stamp_all(std::chrono::minutes(10));
+    REQUIRE(cache.decode(data, image, b).ok);
+    // Age both equally; the hit on a then leaves b the oldest
+    stamp_all(std::chrono::minutes(5));
+    REQUIRE(cache.decode(data, image, a).ok);
+    CHECK(cache.stats().hits == 1);
+
+    REQUIRE(cache.decode(data, image, c).ok);
+    CHECK(cache.stats().evictions == 1);
+    CHECK(cache.size_bytes() == entry_size * 2);
+
+    const auto misses = cache.stats().misses;
+    REQUIRE(cache.decode(data, image, a).ok);
+    REQUIRE(cache.decode(data, image, c).ok);
+    CHECK(cache.stats().misses == misses);
+    REQUIRE(cache.decode(data, image, b).ok);
+    CHECK(cache.stats().misses == misses + 1);
+}
+
+TEST_CASE("shared_surface: freeze and share without copying") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "pcx" / "CGA_TST1.PCX");
+    REQUIRE(!data.empty());
+    onyx_image::memory_surface reference;
+    REQUIRE(onyx_image::decode(data, reference).ok);
+
+    onyx_image::memory_surface surf;
+    REQUIRE(onyx_image::decode(data, surf).ok);
+    const auto* storage = surf.pixels().data();
+    const auto image = onyx_image::freeze(std::move(surf));
+    REQUIRE(image);
+    CHECK(image.pixels().data() == storage);
+    CHECK(image.use_count() == 1);
+    CHECK(image.width() == reference.width());
+    CHECK(image.height() == reference.height());
+    CHECK(image.format() == reference.format());
+    CHECK(image.pitch() == reference.pitch());
+    CHECK(std::ranges::equal(image.pixels(), reference.pixels()));
+    CHECK(std::ranges::equal(image.palette(), reference.palette()));
+
+    // Copies and crops share the storage; it outlives the original handle
+    onyx_image::shared_surface crop;
+    {
+        const onyx_image::shared_surface copy = image;
+        CHECK(copy.pixels().data() == storage);
+        CHECK(image.use_count() == 2);
+        crop = copy.crop({8, 4, 16, 10});
+        CHECK(image.use_count() == 3);
+    }
+    CHECK(image.use_count() == 2);
+    REQUIRE(crop);
+    CHECK(crop.width() == 16);
+    CHECK(crop.height() == 10);
+    CHECK(crop.pitch() == image.pitch());
+    CHECK(crop.subrects().empty());
+    CHECK(std::ranges::equal(crop.palette(), image.palette()));
+    for (int y = 0; y < crop.height(); ++y) {
+        CHECK(crop.row(y).data() == storage + static_cast<std::size_t>(y + 4) * image.pitch() + 8);
+        CHECK(crop.row(y).size() == 16);
+    }
+
+    CHECK_FALSE(image.crop({-1, 0, 4, 4}));
+    CHECK_FALSE(image.crop({0, 0, image.width() + 1, 1}));
+    CHECK_FALSE(image.crop({0, image.height(), 1, 1}));
+    CHECK_FALSE(image.crop({0, 0, 0, 1}));
+
+    // Images from decode_cache become shared surfaces without a copy
+    onyx_image::decode_cache cache;
+    std::shared_ptr<const onyx_image::memory_surface> cached;
+    REQUIRE(cache.decode(data, cached).ok);
+    const onyx_image::shared_surface from_cache(cached);
+    CHECK(from_cache.pixels().data() == cached->pixels().data());
+    CHECK(std::ranges::equal(from_cache.pixels(), reference.pixels()));
+    CHECK_FALSE(onyx_image::shared_surface(std::shared_ptr<const onyx_image::memory_surface>{}));
+}
+
+TEST_CASE("shared_surface: crops convert and encode like copies") {
+    onyx_image::decode_options options;
+    options.enable_packing = true;
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "dcx" / "multipage.dcx");
+    REQUIRE(!data.empty());
+    onyx_image::memory_surface surf;
+    REQUIRE(onyx_image::decode(data, surf, options).ok);
+    const auto atlas = onyx_image::freeze(std::move(surf));
+    REQUIRE(atlas.subrects().size() == 3);
+
+    for (std::size_t i = 0; i < atlas.subrects().size(); ++i) {
+        const auto frame = atlas.subrect_view(i);
+        REQUIRE(frame);
+        const auto& rect = atlas.subrects()[i].rect;
+        CHECK(frame.width() == rect.w);
+        CHECK(frame.height() == rect.h);
+
+        // Copy of the same frame made by hand
+        onyx_image::memory_surface copy;
+        REQUIRE(copy.set_size(rect.w, rect.h, atlas.format()));
+        const std::size_t bpp = onyx_image::bytes_per_pixel(atlas.format());
+        for (int y = 0; y < rect.h; ++y) {
+            copy.write_pixels(0, y, static_cast<int>(rect.w * bpp),
+                              atlas.row(rect.y + y).data() + static_cast<std::size_t>(rect.x) * bpp);
+        }
+        copy.set_palette_size(static_cast<int>(atlas.palette().size() / 3));
+        copy.write_palette(0, atlas.palette());
+
+        onyx_image::memory_surface expanded;
+        REQUIRE(onyx_image::expand_packed(frame, expanded));
+        CHECK(expanded.pitch() == copy.pitch());
+        CHECK(std::ranges::equal(expanded.pixels(), copy.pixels()));
+        CHECK(std::ranges::equal(expanded.palette(), copy.palette()));
+
+        const auto png = onyx_image::encode_png(frame);
+        CHECK(!png.empty());
+        CHECK(png == onyx_image::encode_png(copy));
+    }
+    CHECK_FALSE(atlas.subrect_view(3));
+
+    onyx_image::memory_surface out;
+    CHECK_FALSE(onyx_image::expand_packed(onyx_image::shared_surface{}, out));
+    CHECK(onyx_image::encode_png(onyx_image::shared_surface{}).empty());
+}
+
+TEST_CASE("shared_surface: packed crops start on byte boundaries") {
+    onyx_image::memory_surface surf;
+    REQUIRE(surf.set_size(20, 2, onyx_image::pixel_format::indexed1));
+    for (int x = 0; x < 20; x += 3) {
+        surf.write_pixel(x, 1, 1);
+    }
+    const auto image = onyx_image::freeze(std::move(surf));
+
+    CHECK_FALSE(image.crop({4, 0, 8, 2}));
+    const auto crop = image.crop({8, 1, 12, 1});
+    REQUIRE(crop);
+    CHECK(crop.row(0).size() == 2);
+
+    onyx_image::memory_surface expanded;
+    REQUIRE(onyx_image::expand_packed(crop, expanded));
+    CHECK(expanded.format() == onyx_image::pixel_format::indexed8);
+    for (int x = 0; x < 12; ++x) {
+        CHECK(expanded.pixels()[static_cast<std::size_t>(x)] == ((x + 8) % 3 == 0 ? 1 : 0));
+    }
+}
+
+TEST_CASE("shared_surface: crops copied with the parent pitch keep padding zero") {
+    using onyx_image::pixel_format;
+    onyx_image::memory_surface surf;
+    REQUIRE(surf.set_size(32, 4, pixel_format::rgba8888));
+    const std::vector<std::uint8_t> row(32 * 4, 0x5A);
+    for (int y = 0; y < 4; ++y) {
+        surf.write_pixels(0, y, static_cast<int>(row.size()), row.data());
+    }
+    const auto image = onyx_image::freeze(std::move(surf));
+    const auto crop = image.crop({4, 0, 16, 4});
+    REQUIRE(crop);
+
+    // Same pitch as the parent, but the crop's rows are shorter
+    onyx_image::memory_surface padded(onyx_image::row_layout{1, image.pitch()});
+    REQUIRE(onyx_image::expand_packed(crop, padded));
+    REQUIRE(padded.pitch() == crop.pitch());
+    for (int y = 0; y < 4; ++y) {
+        const auto line = padded.pixels().subspan(static_cast<std::size_t>(y) * padded.pitch(), padded.pitch());
+        CHECK(std::all_of(line.begin(), line.begin() + 16 * 4, [](std::uint8_t b) { return b == 0x5A; }));
+        CHECK(std::all_of(line.begin() + 16 * 4, line.end(), [](std::uint8_t b) { return b == 0; }));
+    }
+}
+
+TEST_CASE("mapped_surface: decodes into a raw container") {
+    const temp_directory dir("onyx_image_mapped_surface_test");
+    const std::filesystem::path root(TEST_DATA_DIR);
+
+    onyx_image::decode_options packed;
+    packed.enable_packing = true;
+    const std::pair<std::filesystem::path, onyx_image::decode_options> inputs[] = {
+        {root / "pcx" / "CGA_TST1.PCX", {}},
+        {root / "bmp" / "test24.bmp", {}},
+        {root / "jpeg" / "baseline_420.jpg", {}},
+        {root / "dcx" / "multipage.dcx", packed},
+    };
+    for (const auto& [file, options] : inputs) {
+        INFO(file.string());
+        const auto data = read_file(file);
+        REQUIRE(!data.empty());
+        onyx_image::memory_surface reference;
+        REQUIRE(onyx_image::decode(data, reference, options).ok);
+
+        const auto path = dir.path / file.filename().replace_extension(".oxr");
+        {
+            onyx_image::mapped_surface surf(path);
+            REQUIRE(onyx_image::decode(data, surf, options).ok);
+            CHECK_FALSE(std::filesystem::exists(path));
+            REQUIRE(surf.finish());
+            CHECK_FALSE(surf.finish());
+        }
+        const auto mapped = onyx_image::mapped_image::open(path);
+        REQUIRE(mapped);
+        check_same_image(*mapped, reference);
+    }
+}
+
+TEST_CASE("mapped_surface: large images and unfinished files") {
+    const temp_directory dir("onyx_image_mapped_surface_large_test");
+    using onyx_image::pixel_format;
+
+    // Past the point where rows are released, with rows written bottom-up
+    const auto path = dir.path / "large.oxr";
+    {
+        onyx_image::mapped_surface surf(path);
+        REQUIRE(surf.set_size(2048, 3000, pixel_format::rgba8888));
+        std::vector<std::uint8_t> row(2048 * 4);
+        for (int y = 2999; y >= 0; --y) {
+            std::fill(row.begin(), row.end(), static_cast<std::uint8_t>(y * 7));
+            surf.write_pixels(0, y, static_cast<int>(row.size()), row.data());
+        }
+        REQUIRE(surf.finish());
+    }
+    const auto mapped = onyx_image::mapped_image::open(path);
+    REQUIRE(mapped);
+    CHECK(mapped->width() == 2048);
+    CHECK(mapped->height() == 3000);
+    CHECK(mapped->pitch() == 2048 * 4);
+    int mismatched_rows = 0;
+    for (int y = 0; y < 3000; ++y) {
+        const auto row = mapped->pixels().subspan(static_cast<std::size_t>(y) * mapped->pitch(), mapped->pitch());
+        if (std::count(row.begin(), row.end(), static_cast<std::uint8_t>(y * 7)) != 2048 * 4) {
+            ++mismatched_rows;
+        }
+    }
+    CHECK(mismatched_rows == 0);
+
+    // More than a memory_surface may hold; the file is sparse and removed
+    // again since the surface is never finished
+    const auto huge = dir.path / "huge.oxr";
+    {
+        onyx_image::memory_surface memory;
+        CHECK_FALSE(memory.set_size(16385, 16384, pixel_format::rgba8888));
+        onyx_image::mapped_surface surf(huge);
+        REQUIRE(surf.set_size(16385, 16384, pixel_format::rgba8888));
+        const std::uint8_t red[4] = {255, 0, 0, 255};
+        surf.write_pixels(16384 * 4, 16383, 4, red);
+    }
+    CHECK_FALSE(std::filesystem::exists(huge));
+    CHECK(std::filesystem::exists(path));
+
+    onyx_image::mapped_surface limited(dir.path / "limited.oxr", 1024);
+    CHECK_FALSE(limited.set_size(32, 32, pixel_format::rgb888));
+    CHECK(limited.set_size(16, 16, pixel_format::rgba8888));
+    CHECK_FALSE(onyx_image::mapped_surface(dir.path / "unused.oxr").finish());
+}
+
+TEST_CASE("tiled_surface: decodes match the linear layout") {
+    const std::filesystem::path root(TEST_DATA_DIR);
+    onyx_image::decode_options packed;
+    packed.packed_indexed = true;
+    const std::pair<std::filesystem::path, onyx_image::decode_options> inputs[] = {
+        {root / "pcx" / "CGA_TST1.PCX", {}},
+        {root / "bmp" / "test24.bmp", {}},
+        {root / "bmp" / "test1.bmp", packed},
+        {root / "bmp" / "test4.bmp", packed},
+        {root / "jpeg" / "baseline_420.jpg", {}},
+    };
+    for (const auto& [file, options] : inputs) {
+        INFO(file.string());
+        const auto data = read_file(file);
+        REQUIRE(!data.empty());
+        onyx_image::memory_surface decoded;
+        REQUIRE(onyx_image::decode(data, decoded, options).ok);
+        const auto reference = onyx_image::freeze(std::move(decoded));
+
+        for (const auto& [tw, th] : {std::pair{64, 64}, std::pair{20, 13}}) {
+            onyx_image::tiled_surface tiled(tw, th);
+            REQUIRE(onyx_image::decode(data, tiled, options).ok);
+            CHECK(tiled.tile_width() % 8 == 0);
+            CHECK(tiled.tiles_x() * tiled.tile_width() >= tiled.width());
+            CHECK(tiled.tiles_y() * tiled.tile_height() >= tiled.height());
+
+            onyx_image::memory_surface linear;
+            REQUIRE(tiled.to_linear(linear));
+            CHECK(linear.width() == reference.width());
+            CHECK(linear.height() == reference.height());
+            CHECK(linear.format() == reference.format());
+            CHECK(std::ranges::equal(linear.pixels(), reference.pixels()));
+            CHECK(std::ranges::equal(linear.palette(), reference.palette()));
+
+            // A window crossing tile borders, at a byte boundary for packed formats
+            const onyx_image::image_rect rect{8 * (reference.width() / 24), reference.height() / 3,
+                                              reference.width() / 2, reference.height() / 2};
+            onyx_image::memory_surface window;
+            REQUIRE(window.set_size(rect.w, rect.h, tiled.format()));
+            REQUIRE(tiled.read_region(rect, window.mutable_pixels().data(), window.pitch()));
+
+            onyx_image::memory_surface actual;
+            onyx_image::memory_surface expected;
+            REQUIRE(onyx_image::expand_packed(window, actual));
+            REQUIRE(onyx_image::expand_packed(reference.crop(rect), expected));
+            CHECK(std::ranges::equal(actual.pixels(), expected.pixels()));
+        }
+    }
+}
+
+TEST_CASE("tiled_surface: tiles are allocated on first write") {
+    using onyx_image::pixel_format;
+    onyx_image::tiled_surface tiled;
+    REQUIRE(tiled.set_size(1000, 700, pixel_format::rgba8888));
+    CHECK(tiled.tiles_x() == 16);
+    CHECK(tiled.tiles_y() == 11);
+    CHECK(tiled.tile_pitch() == 64 * 4);
+    CHECK(tiled.allocated_tiles() == 0);
+    CHECK(tiled.tile(3, 3).empty());
+
+    // A run crossing one tile border allocates both tiles
+    const std::vector<std::uint8_t> run(8 * 4, 0x11);
+    tiled.write_pixels(60 * 4, 130, static_cast<int>(run.size()), run.data());
+    CHECK(tiled.allocated_tiles() == 2);
+    REQUIRE(tiled.tile(0, 2).size() == 64 * 64 * 4);
+    REQUIRE(tiled.tile(1, 2).size() == 64 * 64 * 4);
+    CHECK(tiled.tile(0, 2)[2 * 256 + 60 * 4] == 0x11);
+    CHECK(tiled.tile(1, 2)[2 * 256 + 3 * 4 + 3] == 0x11);
+    CHECK(tiled.tile(1, 2)[2 * 256 + 4 * 4] == 0);
+
+    const auto edge = tiled.tile_rect(15, 10);
+    CHECK(edge.x == 960);
+    CHECK(edge.y == 640);
+    CHECK(edge.w == 40);
+    CHECK(edge.h == 60);
+    CHECK(tiled.tile_rect(16, 0).w == 0);
+
+    // Unwritten tiles read as zero
+    std::vector<std::uint8_t> window(16 * 4 * 4, 0xFF);
+    REQUIRE(tiled.read_region({56, 128, 16, 4}, window.data(), 16 * 4));
+    CHECK(std::count(window.begin(), window.end(), 0x11) == 32);
+    CHECK(std::count(window.begin(), window.end(), 0) == static_cast<long>(window.size()) - 32);
+    CHECK_FALSE(tiled.read_region({990, 0, 11, 1}, window.data(), 64));
+    CHECK_FALSE(tiled.read_region({0, 0, 16, 1}, window.data(), 60));
+
+    onyx_image::tiled_surface packed;
+    REQUIRE(packed.set_size(100, 10, pixel_format::indexed1));
+    packed.write_pixel(99, 9, 1);
+    packed.write_pixel(3, 0, 1);
+    CHECK(packed.allocated_tiles() == 2);
+    std::uint8_t bits[2] = {};
+    REQUIRE(packed.read_region({0, 0, 12, 1}, bits, 2));
+    CHECK(bits[0] == 0x10);
+    CHECK(bits[1] == 0x00);
+    CHECK_FALSE(packed.read_region({4, 0, 8, 1}, bits, 2));
+}
+
+TEST_CASE("tiled_surface: a tile that cannot be allocated fails the decode") {
+    using onyx_image::pixel_format;
+    // Room for a small grid and one 64x8 RGBA tile
+    constexpr std::uint64_t limit = 1024 + 64 * 8 * 4;
+    onyx_image::tiled_surface huge(64, 8, limit);
+    REQUIRE(huge.set_size(128, 8, pixel_format::rgba8888));
+    CHECK_FALSE(huge.failed());
+    const std::vector<std::uint8_t> run(128 * 4, 0x22);
+    huge.write_pixels(0, 0, static_cast<int>(run.size()), run.data());
+    CHECK(huge.failed());
+    CHECK(huge.allocated_tiles() == 1);
+
+    // A tile larger than the limit, or a grid beyond it, is refused up front
+    onyx_image::tiled_surface one_tile(64, 64, limit);
+    CHECK_FALSE(one_tile.set_size(16, 16, pixel_format::rgba8888));
+    onyx_image::tiled_surface small_tiles(8, 1);
+    CHECK_FALSE(small_tiles.set_size(std::numeric_limits<int>::max(), std::numeric_limits<int>::max(),
+                                     pixel_format::indexed8));
+
+    // set_size starts over
+    REQUIRE(huge.set_size(8, 8, pixel_format::rgba8888));
+    CHECK_FALSE(huge.failed());
+
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "bmp" / "test24.bmp");
+    REQUIRE(!data.empty());
+    const auto result = onyx_image::decode(data, huge);
+    CHECK_FALSE(result.ok);
+    CHECK(result.error == onyx_image::decode_error::internal_error);
+    CHECK(huge.failed());
+}
+
+namespace {
+
+// Same pixels row by row, whatever the pitches
+void check_same_rows(const onyx_image::shared_surface& actual, const onyx_image::shared_surface& expected) {
+    REQUIRE(actual.width() == expected.width());
+    REQUIRE(actual.height() == expected.height());
+    REQUIRE(actual.format() == expected.format());
+    CHECK(std::ranges::equal(actual.palette(), expected.palette()));
+    bool rows_equal = true;
+    for (int y = 0; y < actual.height(); ++y) {
+        rows_equal = rows_equal && std::ranges::equal(actual.row(y), expected.row(y));
+    }
+    CHECK(rows_equal);
+}
+
+} // namespace
+
+TEST_CASE("asset_pack: images round trip without copies") {
+    const temp_directory dir("onyx_image_asset_pack_test");
+    const std::filesystem::path root(TEST_DATA_DIR);
+    onyx_image::decode_options packed;
+    packed.enable_packing = true;
+
+    const auto decode_file = [](const std::filesystem::path& file, const onyx_image::decode_options& options = {}) {
+        onyx_image::memory_surface surf;
+        REQUIRE(onyx_image::decode(read_file(file), surf, options).ok);
+        return onyx_image::freeze(std::move(surf));
+    };
+    const auto pcx = decode_file(root / "pcx" / "CGA_TST1.PCX");
+    const auto jpeg = decode_file(root / "jpeg" / "baseline_420.jpg");
+    const auto dcx = decode_file(root / "dcx" / "multipage.dcx", packed);
+    const auto crop = jpeg.crop({10, 20, jpeg.width() / 2, jpeg.height() / 3});
+    REQUIRE(dcx.subrects().size() == 3);
+
+    onyx_image::asset_pack_writer writer;
+    CHECK(writer.add("ui/title", pcx));
+    CHECK(writer.add("photo", jpeg));
+    CHECK(writer.add("pages", dcx));
+    CHECK(writer.add("photo/crop", crop));
+    CHECK_FALSE(writer.add("photo", pcx));
+    CHECK_FALSE(writer.add("empty", onyx_image::shared_surface()));
+    CHECK(writer.size() == 4);
+    const auto path = dir.path / "assets.oxp";
+    REQUIRE(writer.save(path));
+
+    onyx_image::shared_surface title;
+    {
+        const auto pack = onyx_image::asset_pack::open(path);
+        REQUIRE(pack);
+        REQUIRE(pack->size() == 4);
+        CHECK(pack->name(0) == "pages");
+        CHECK(pack->name(3) == "ui/title");
+        CHECK(pack->name(4).empty());
+        CHECK_FALSE(pack->find("missing"));
+        CHECK(pack->image("missing").empty());
+        CHECK(pack->image(std::size_t{4}).empty());
+
+        check_same_rows(pack->image("photo"), jpeg);
+        check_same_rows(pack->image("photo/crop"), crop);
+        CHECK(pack->image("photo/crop").pitch() == crop.row(0).size());
+
+        const auto pages = pack->image("pages");
+        check_same_rows(pages, dcx);
+        REQUIRE(pages.subrects().size() == dcx.subrects().size());
+        for (std::size_t i = 0; i < pages.subrects().size(); ++i) {
+            CHECK(pages.subrects()[i].rect.x == dcx.subrects()[i].rect.x);
+            CHECK(pages.subrects()[i].rect.y == dcx.subrects()[i].rect.y);
+            CHECK(pages.subrects()[i].rect.w == dcx.subrects()[i].rect.w);
+            CHECK(pages.subrects()[i].rect.h == dcx.subrects()[i].rect.h);
+        }
+
+        // Consecutive lookups view the same mapped bytes
+        title = pack->image(*pack->find("ui/title"));
+        CHECK(title.pixels().data() == pack->image("ui/title").pixels().data());
+        CHECK(reinterpret_cast<std::uintptr_t>(title.pixels().data()) % 64 == 0);
+    }
+    // The image keeps the pack mapped
+    check_same_rows(title, pcx);
+}
+
+TEST_CASE("asset_pack: packed crops store zero trailing bits") {
+    const temp_directory dir("onyx_image_asset_pack_packed_test");
+    using onyx_image::pixel_format;
+
+    // All pixels set; a 12-pixel crop ends inside the parent's second byte
+    onyx_image::memory_surface parent;
+    REQUIRE(parent.set_size(20, 2, pixel_format::indexed1));
+    onyx_image::memory_surface fresh;
+    REQUIRE(fresh.set_size(12, 2, pixel_format::indexed1));
+    for (int y = 0; y < 2; ++y) {
+        for (int x = 0; x < 20; ++x) {
+            parent.write_pixel(x, y, 1);
+            fresh.write_pixel(x, y, 1);
+        }
+    }
+    const auto crop = onyx_image::freeze(std::move(parent)).crop({0, 0, 12, 2});
+    REQUIRE(crop);
+    CHECK(crop.row(0)[1] == 0xFF);
+
+    onyx_image::asset_pack_writer writer;
+    REQUIRE(writer.add("crop", crop));
+    const auto path = dir.path / "assets.oxp";
+    REQUIRE(writer.save(path));
+    const auto pack = onyx_image::asset_pack::open(path);
+    REQUIRE(pack);
+    const auto stored = pack->image("crop");
+    REQUIRE(stored.pitch() == 2);
+    CHECK(stored.row(0)[1] == 0xF0);
+    check_same_rows(stored, onyx_image::freeze(std::move(fresh)));
+}
+
+TEST_CASE("asset_pack: damaged packs are rejected") {
+    const temp_directory dir("onyx_image_asset_pack_damaged_test");
+    const auto path = dir.path / "assets.oxp";
+    CHECK_FALSE(onyx_image::asset_pack::open(path));
+
+    onyx_image::memory_surface image;
+    REQUIRE(image.set_size(16, 16, onyx_image::pixel_format::rgba8888));
+    onyx_image::asset_pack_writer writer;
+    REQUIRE(writer.add("image", std::move(image)));
+    REQUIRE(writer.save(path));
+    REQUIRE(onyx_image::asset_pack::open(path));
+
+    const auto bytes = read_file(path);
+    const auto write_bytes = [&](std::span<const std::uint8_t> data) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    };
+    write_bytes(std::span(bytes).first(bytes.size() - 1));
+    CHECK_FALSE(onyx_image::asset_pack::open(path));
+
+    auto corrupt = bytes;
+    corrupt[64 + 42] = 0x01;  // Pixel offset of the first entry, past the end
+    write_bytes(corrupt);
+    CHECK_FALSE(onyx_image::asset_pack::open(path));
+
+    corrupt = bytes;
+    corrupt[0] = 'X';
+    write_bytes(corrupt);
+    CHECK_FALSE(onyx_image::asset_pack::open(path));
+}
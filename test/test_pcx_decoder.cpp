@@ -89,6 +89,47 @@ void test_pcx_decode_md5(
     CHECK(actual_md5 == expected_md5);
 }
 
+// Decode with packed_indexed and check the result renders exactly like the
+// default indexed8 decode once expanded
+void test_packed_decode(const std::filesystem::path& path, onyx_image::pixel_format expected_format) {
+    INFO("Testing: ", path.string());
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    onyx_image::memory_surface reference;
+    REQUIRE(onyx_image::decode(data, reference).ok);
+
+    onyx_image::decode_options options;
+    options.packed_indexed = true;
+    onyx_image::memory_surface packed;
+    REQUIRE(onyx_image::decode(data, packed, options).ok);
+    REQUIRE(packed.format() == expected_format);
+    CHECK(packed.pitch() == onyx_image::row_bytes(expected_format, static_cast<std::size_t>(packed.width())));
+    CHECK(packed.pixels().size() == packed.pitch() * static_cast<std::size_t>(packed.height()));
+
+    onyx_image::memory_surface expanded;
+    REQUIRE(onyx_image::expand_packed(packed, expanded));
+    REQUIRE(expanded.format() == onyx_image::pixel_format::indexed8);
+    REQUIRE(expanded.width() == reference.width());
+    REQUIRE(expanded.height() == reference.height());
+
+    const auto ref_pixels = reference.pixels();
+    const auto ref_palette = reference.palette();
+    const auto pixels = expanded.pixels();
+    const auto palette = expanded.palette();
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        const std::size_t a = static_cast<std::size_t>(ref_pixels[i]) * 3;
+        const std::size_t b = static_cast<std::size_t>(pixels[i]) * 3;
+        if (a + 2 >= ref_palette.size() || b + 2 >= palette.size() ||
+            ref_palette[a] != palette[b] || ref_palette[a + 1] != palette[b + 1] ||
+            ref_palette[a + 2] != palette[b + 2]) {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
 } // namespace
 
 TEST_CASE("PCX decoder: MD5 verification") {
@@ -124,3 +165,58 @@ TEST_CASE("PCX decoder: MD5 verification") {
         test_pcx_decode_md5("lena.pcx", "de01b43e0efbc4280aaf44b70dfc3f0e", "RGB 24-bit");
     }
 }
+
+TEST_CASE("PCX decoder: header probing") {
+    onyx_image::pcx_decoder::header_info info{};
+
+    SUBCASE("Valid header") {
+        std::vector<std::uint8_t> header(128, 0);
+        header[0] = 0x0A;  // Signature
+        header[1] = 5;     // Version 3.0
+        header[2] = 1;     // RLE
+        header[3] = 8;     // Bits per pixel
+        header[8] = 31;    // x_max
+        header[10] = 15;   // y_max
+        header[65] = 1;    // Planes
+        header[66] = 32;   // Bytes per line
+
+        auto result = onyx_image::pcx_decoder::parse_header(header, info, {});
+        REQUIRE(result.ok);
+        CHECK(info.width == 32);
+        CHECK(info.height == 16);
+        CHECK(info.has_rle);
+    }
+
+    SUBCASE("Bad signature is rejected without throwing") {
+        std::vector<std::uint8_t> junk(128, 0xFF);
+        auto result = onyx_image::pcx_decoder::parse_header(junk, info, {});
+        CHECK_FALSE(result.ok);
+        CHECK(result.error == onyx_image::decode_error::invalid_format);
+    }
+
+    SUBCASE("Short header") {
+        std::vector<std::uint8_t> junk(64, 0x0A);
+        CHECK(onyx_image::pcx_decoder::parse_header(junk, info, {}).error ==
+              onyx_image::decode_error::truncated_data);
+    }
+}
+
+TEST_CASE("PCX decoder: packed output") {
+    const auto dir = std::filesystem::path(TEST_DATA_DIR) / "pcx";
+
+    SUBCASE("Monochrome") {
+        test_packed_decode(dir / "CGA_BW.PCX", onyx_image::pixel_format::indexed1);
+    }
+
+    SUBCASE("CGA 4-color") {
+        test_packed_decode(dir / "CGA_TST1.PCX", onyx_image::pixel_format::indexed2);
+    }
+
+    SUBCASE("16-color packed") {
+        test_packed_decode(dir / "lena10.pcx", onyx_image::pixel_format::indexed4);
+    }
+
+    SUBCASE("Planar EGA is still expanded") {
+        test_packed_decode(dir / "lena4.pcx", onyx_image::pixel_format::indexed8);
+    }
+}
@@ -0,0 +1,395 @@
+#include <doctest/doctest.h>
+#include <onyx_image/onyx_image.hpp>
+
+#include "helpers/md5.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::uint8_t> read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return {};
+    }
+
+    const auto size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<std::uint8_t> data(static_cast<std::size_t>(size));
+    file.read(reinterpret_cast<char*>(data.data()), size);
+
+    return data;
+}
+
+std::string md5_to_string(const unsigned char* digest) {
+    std::string result;
+    result.reserve(32);
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        char buf[3];
+        std::snprintf(buf, sizeof(buf), "%02x", digest[i]);
+        result += buf;
+    }
+    return result;
+}
+
+std::string compute_surface_md5(const onyx_image::memory_surface& surf) {
+    MD5_CTX ctx;
+    MD5_Init(&ctx);
+
+    // Hash dimensions and format
+    const int width = surf.width();
+    const int height = surf.height();
+    const auto format = static_cast<int>(surf.format());
+    MD5_Update(&ctx, &width, sizeof(width));
+    MD5_Update(&ctx, &height, sizeof(height));
+    MD5_Update(&ctx, &format, sizeof(format));
+
+    // Hash pixel data
+    const auto pixels = surf.pixels();
+    MD5_Update(&ctx, pixels.data(), pixels.size());
+
+    // Hash palette if indexed
+    if (surf.format() == onyx_image::pixel_format::indexed8) {
+        const auto palette = surf.palette();
+        MD5_Update(&ctx, palette.data(), palette.size());
+    }
+
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    MD5_Final(digest, &ctx);
+
+    return md5_to_string(digest);
+}
+
+void test_png_decode_md5(
+    const char* filename,
+    const char* expected_md5,
+    int expected_width,
+    int expected_height,
+    onyx_image::pixel_format expected_format,
+    const onyx_image::decode_options& options = {})
+{
+    const std::filesystem::path path = std::filesystem::path(TEST_DATA_DIR) / "png" / filename;
+
+    INFO("Testing: ", filename);
+    REQUIRE(std::filesystem::exists(path));
+
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    onyx_image::memory_surface surface;
+    auto result = onyx_image::decode(data, surface, options);
+
+    REQUIRE(result.ok);
+    CHECK(surface.width() == expected_width);
+    CHECK(surface.height() == expected_height);
+    CHECK(surface.format() == expected_format);
+
+    std::string actual_md5 = compute_surface_md5(surface);
+    CHECK(actual_md5 == expected_md5);
+}
+
+} // namespace
+
+TEST_CASE("PNG decoder: sniff") {
+    SUBCASE("Valid PNG signature") {
+        std::vector<std::uint8_t> data = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+        CHECK(onyx_image::png_decoder::sniff(data));
+    }
+
+    SUBCASE("Invalid - truncated signature") {
+        std::vector<std::uint8_t> data = {0x89, 'P', 'N', 'G'};
+        CHECK_FALSE(onyx_image::png_decoder::sniff(data));
+    }
+}
+
+TEST_CASE("PNG decoder: native color types") {
+    using onyx_image::pixel_format;
+
+    // Every file cycles through all five row filters
+    SUBCASE("4-bit palette, IDAT split in two") {
+        test_png_decode_md5("palette4.png", "1f08f64eec90c2e3bc25b8dea69bb1fe", 13, 7, pixel_format::indexed8);
+    }
+
+    SUBCASE("1-bit palette") {
+        test_png_decode_md5("palette1.png", "fb746aef931e911cfc98ece96958ff2b", 21, 3, pixel_format::indexed8);
+    }
+
+    SUBCASE("2-bit grayscale as a gray ramp palette") {
+        test_png_decode_md5("gray2.png", "620a29c4bfacd1f74cfeee9c80c19acb", 9, 5, pixel_format::indexed8);
+    }
+
+    SUBCASE("8-bit RGB") {
+        test_png_decode_md5("rgb8.png", "861cc401bd76fee883b3d15da66954a6", 11, 6, pixel_format::rgb888);
+    }
+
+    SUBCASE("8-bit RGB, fixed Huffman codes") {
+        test_png_decode_md5("rgb8_fixed.png", "8eb209baaf1c8a9d652733680906cc05", 16, 16, pixel_format::rgb888);
+    }
+
+    SUBCASE("Palette with tRNS") {
+        test_png_decode_md5("palette8_trns.png", "eefddfe53c1b6bbe56b4c54c1744e0ff", 10, 5, pixel_format::rgba8888);
+    }
+
+    SUBCASE("Grayscale with alpha") {
+        test_png_decode_md5("gray_alpha.png", "9161d69c2824e92d0d307883753515f1", 7, 4, pixel_format::rgba8888);
+    }
+
+    SUBCASE("8-bit RGBA") {
+        test_png_decode_md5("rgba8.png", "2efe6520cbb22b28d1ba6b8089abe250", 6, 6, pixel_format::rgba8888);
+    }
+}
+
+TEST_CASE("PNG decoder: packed output") {
+    onyx_image::decode_options options;
+    options.packed_indexed = true;
+    test_png_decode_md5("palette1.png", "588b5612640801c1a816647d449a1a6b", 21, 3,
+                        onyx_image::pixel_format::indexed1, options);
+}
+
+TEST_CASE("PNG decoder: Adam7 matches the non-interlaced image") {
+    using onyx_image::pixel_format;
+
+    // Each pair holds the same pixels; every pass cycles through the filters
+    struct interlace_case {
+        const char* plain;
+        const char* interlaced;
+        pixel_format format;
+        bool packed;
+    };
+    const interlace_case cases[] = {
+        {"palette2.png", "palette2_adam7.png", pixel_format::indexed8, false},
+        {"palette2.png", "palette2_adam7.png", pixel_format::indexed2, true},
+        {"rgb8_11x10.png", "rgb8_11x10_adam7.png", pixel_format::rgb888, false},
+        {"gray4_trns.png", "gray4_trns_adam7.png", pixel_format::rgba8888, false},
+    };
+
+    for (const auto& c : cases) {
+        INFO("Testing: ", c.interlaced, ", packed ", c.packed);
+        onyx_image::decode_options options;
+        options.packed_indexed = c.packed;
+
+        const auto plain = read_file(std::filesystem::path(TEST_DATA_DIR) / "png" / c.plain);
+        onyx_image::memory_surface expected;
+        REQUIRE(onyx_image::decode(plain, expected, options).ok);
+
+        const auto interlaced = read_file(std::filesystem::path(TEST_DATA_DIR) / "png" / c.interlaced);
+        onyx_image::memory_surface actual;
+        REQUIRE(onyx_image::decode(interlaced, actual, options).ok);
+
+        // Native decodes keep the color type; lodepng would give RGBA
+        CHECK(actual.format() == c.format);
+        CHECK(compute_surface_md5(actual) == compute_surface_md5(expected));
+        CHECK(actual.palette().size() == expected.palette().size());
+    }
+}
+
+TEST_CASE("PNG decoder: corrupt chunk is rejected") {
+    auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "png" / "rgb8.png");
+    REQUIRE(data.size() > 40);
+
+    // Flip a bit inside IHDR so its CRC no longer matches
+    data[20] ^= 0x01;
+    onyx_image::memory_surface surface;
+    CHECK_FALSE(onyx_image::decode(data, surface).ok);
+}
+
+TEST_CASE("PNG decoder: damaged zlib checksum is rejected") {
+    auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "png" / "rgb8_fixed.png");
+    REQUIRE(data.size() == 401);
+
+    // Last byte of the Adler-32 trailer, with the IDAT CRC recomputed so
+    // only the zlib stream is at fault
+    constexpr std::size_t idat_start = 33;
+    const std::size_t idat_length = (std::size_t{data[idat_start]} << 24) | (std::size_t{data[idat_start + 1]} << 16) |
+                                    (std::size_t{data[idat_start + 2]} << 8) | data[idat_start + 3];
+    data[idat_start + 8 + idat_length - 1] ^= 0x01;
+
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = idat_start + 4; i < idat_start + 8 + idat_length; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    crc ^= 0xFFFFFFFFu;
+    for (int i = 0; i < 4; ++i) {
+        data[idat_start + 8 + idat_length + static_cast<std::size_t>(i)] = static_cast<std::uint8_t>(crc >> (24 - 8 * i));
+    }
+
+    onyx_image::memory_surface surface;
+    CHECK_FALSE(onyx_image::decode(data, surface).ok);
+}
+
+TEST_CASE("PNG encoder: round trip keeps the color type") {
+    using onyx_image::pixel_format;
+    using onyx_image::png_filter;
+
+    // IHDR bit depth and color type sit at fixed offsets after the signature
+    constexpr std::size_t bit_depth_offset = 24;
+    constexpr std::size_t color_type_offset = 25;
+
+    struct round_trip {
+        const char* filename;
+        std::uint8_t bit_depth;
+        std::uint8_t color_type;
+    };
+    const round_trip files[] = {
+        {"palette4.png", 4, 3},
+        {"palette1.png", 1, 3},
+        {"gray2.png", 2, 3},
+        {"rgb8.png", 8, 2},
+        {"rgba8.png", 8, 6},
+    };
+
+    const png_filter filters[] = {png_filter::none, png_filter::sub, png_filter::up,
+                                  png_filter::average, png_filter::paeth, png_filter::adaptive};
+
+    for (const auto& file : files) {
+        INFO("Testing: ", file.filename);
+        const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "png" / file.filename);
+        onyx_image::memory_surface original;
+        REQUIRE(onyx_image::decode(data, original).ok);
+        const std::string expected_md5 = compute_surface_md5(original);
+
+        for (const auto filter : filters) {
+            for (const int level : {0, 1, 6, 9}) {
+                INFO("Filter ", static_cast<int>(filter), ", level ", level);
+                onyx_image::png_encode_options options;
+                options.filter = filter;
+                options.compression_level = level;
+
+                const auto encoded = onyx_image::encode_png(original, options);
+                REQUIRE(encoded.size() > color_type_offset);
+                CHECK(encoded[bit_depth_offset] == file.bit_depth);
+                CHECK(encoded[color_type_offset] == file.color_type);
+
+                onyx_image::memory_surface decoded;
+                REQUIRE(onyx_image::decode(encoded, decoded).ok);
+                CHECK(compute_surface_md5(decoded) == expected_md5);
+            }
+        }
+    }
+}
+
+TEST_CASE("PNG encoder: packed surfaces and fast mode") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "png" / "palette1.png");
+    onyx_image::decode_options decode_options;
+    decode_options.packed_indexed = true;
+    onyx_image::memory_surface packed;
+    REQUIRE(onyx_image::decode(data, packed, decode_options).ok);
+    REQUIRE(packed.format() == onyx_image::pixel_format::indexed1);
+
+    const auto encoded = onyx_image::encode_png(packed, onyx_image::png_encode_options::fast());
+    REQUIRE(!encoded.empty());
+    CHECK(encoded[24] == 1);
+
+    onyx_image::memory_surface decoded;
+    REQUIRE(onyx_image::decode(encoded, decoded).ok);
+    onyx_image::memory_surface reference;
+    REQUIRE(onyx_image::decode(data, reference).ok);
+    CHECK(compute_surface_md5(decoded) == compute_surface_md5(reference));
+}
+
+TEST_CASE("PNG encoder: parallel row bands join into one stream") {
+    using onyx_image::pixel_format;
+
+    // Large enough to be cut into several bands
+    struct band_case {
+        pixel_format format;
+        int width;
+        int height;
+    };
+    const band_case cases[] = {
+        {pixel_format::rgba8888, 1024, 1200},
+        {pixel_format::rgb888, 700, 1100},
+        {pixel_format::indexed8, 4000, 900},
+    };
+
+    for (const auto& c : cases) {
+        onyx_image::memory_surface surf;
+        REQUIRE(surf.set_size(c.width, c.height, c.format));
+        if (c.format == pixel_format::indexed8) {
+            // Every entry is in use, so the PLTE written back is identical
+            surf.set_palette_size(200);
+            std::vector<std::uint8_t> palette(200 * 3);
+            for (std::size_t i = 0; i < palette.size(); ++i) {
+                palette[i] = static_cast<std::uint8_t>(i * 7);
+            }
+            surf.write_palette(0, palette);
+        }
+        std::vector<std::uint8_t> row(surf.pitch());
+        for (int y = 0; y < c.height; ++y) {
+            for (std::size_t x = 0; x < row.size(); ++x) {
+                row[x] = static_cast<std::uint8_t>((x * x + static_cast<std::size_t>(y) * 3) % 200);
+            }
+            surf.write_pixels(0, y, static_cast<int>(row.size()), row.data());
+        }
+        const std::string expected_md5 = compute_surface_md5(surf);
+
+        for (const int level : {0, 6}) {
+            INFO("Format ", static_cast<int>(c.format), ", level ", level);
+            onyx_image::png_encode_options options;
+            options.compression_level = level;
+
+            options.threads = 1;
+            const auto serial = onyx_image::encode_png(surf, options);
+            REQUIRE(!serial.empty());
+
+            // Chunks arrive through the sink one by one
+            options.threads = 4;
+            std::vector<std::uint8_t> streamed;
+            int writes = 0;
+            CHECK(onyx_image::write_png(surf, [&](std::span<const std::uint8_t> bytes) {
+                streamed.insert(streamed.end(), bytes.begin(), bytes.end());
+                ++writes;
+                return true;
+            }, options));
+            CHECK(writes > 3);
+            CHECK(streamed == serial);
+
+            onyx_image::memory_surface decoded;
+            REQUIRE(onyx_image::decode(streamed, decoded).ok);
+            CHECK(compute_surface_md5(decoded) == expected_md5);
+        }
+    }
+}
+
+TEST_CASE("PNG encoder: sink can abort") {
+    onyx_image::memory_surface surf;
+    REQUIRE(surf.set_size(4, 4, onyx_image::pixel_format::rgb888));
+    CHECK_FALSE(onyx_image::write_png(surf, [](std::span<const std::uint8_t>) { return false; }));
+}
+
+TEST_CASE("PNG encoder: save_png replaces the file whole") {
+    const auto dir = std::filesystem::temp_directory_path() / "onyx_image_save_png";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const auto path = dir / "out.png";
+    {
+        std::ofstream old(path, std::ios::binary);
+        old << "previous contents";
+    }
+
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "png" / "rgb8.png");
+    onyx_image::memory_surface original;
+    REQUIRE(onyx_image::decode(data, original).ok);
+    REQUIRE(onyx_image::save_png(original, path));
+
+    // The temporary file was renamed over the old one
+    CHECK(std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator()) == 1);
+    onyx_image::memory_surface saved;
+    REQUIRE(onyx_image::decode(read_file(path), saved).ok);
+    CHECK(compute_surface_md5(saved) == compute_surface_md5(original));
+
+    // Nothing is left behind when the file cannot be written
+    CHECK_FALSE(onyx_image::save_png(original, dir / "missing" / "out.png"));
+    CHECK_FALSE(std::filesystem::exists(dir / "missing"));
+
+    std::filesystem::remove_all(dir);
+}
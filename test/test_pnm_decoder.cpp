@@ -3,6 +3,7 @@
 
 #include "helpers/md5.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
@@ -152,3 +153,132 @@ TEST_CASE("PNM decoder: MD5 verification") {
         test_pnm_decode_md5("pnm/hopper.ppm", "963993a4bde036e6ad97ed553d45b359", "Binary PPM");
     }
 }
+
+TEST_CASE("PNM decoder: ASCII sample parsing") {
+    SUBCASE("Long rows with mixed separators and leading zeros") {
+        // 20x1 P2 with maxval 100; samples cross 16-byte block boundaries
+        std::string text = "P2\n20 1\n100\n";
+        std::vector<std::uint8_t> expected;
+        for (int i = 0; i < 20; ++i) {
+            const int v = (i * 37) % 101;
+            text += (i % 3 == 0 ? "000" : "") + std::to_string(v) + (i % 2 ? "\t" : " \n");
+            const auto px = static_cast<std::uint8_t>(v * 255 / 100);
+            expected.insert(expected.end(), {px, px, px});
+        }
+        std::vector<std::uint8_t> data(text.begin(), text.end());
+
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::pnm_decoder::decode(data, surface);
+
+        REQUIRE(result.ok);
+        auto pixels = surface.pixels();
+        CHECK(std::vector<std::uint8_t>(pixels.begin(), pixels.end()) == expected);
+    }
+
+    SUBCASE("Garbage in the raster fails") {
+        std::string text = "P3\n2 1\n255\n1 2 3 4 x 6 7 8 9 10 11 12 13\n";
+        std::vector<std::uint8_t> data(text.begin(), text.end());
+
+        onyx_image::memory_surface surface;
+        CHECK_FALSE(onyx_image::pnm_decoder::decode(data, surface).ok);
+    }
+}
+
+TEST_CASE("PNM decoder: multi-image stream") {
+    // Two concatenated images of different types and sizes
+    std::string text = "P1\n2 2\n1 0\n0 1\n"
+                       "P2\n3 1\n2\n0 1 2\n";
+    std::vector<std::uint8_t> data(text.begin(), text.end());
+
+    onyx_image::memory_surface surface;
+    auto result = onyx_image::pnm_decoder::decode(data, surface);
+
+    REQUIRE(result.ok);
+    CHECK(surface.width() == 3);
+    CHECK(surface.height() == 3);
+
+    const auto& subrects = surface.subrects();
+    REQUIRE(subrects.size() == 2);
+    CHECK(subrects[0].rect.y == 0);
+    CHECK(subrects[0].rect.w == 2);
+    CHECK(subrects[0].rect.h == 2);
+    CHECK(subrects[0].kind == onyx_image::subrect_kind::frame);
+    CHECK(subrects[1].rect.y == 2);
+    CHECK(subrects[1].rect.w == 3);
+    CHECK(subrects[1].rect.h == 1);
+    CHECK(subrects[1].user_tag == 1);
+
+    auto pixels = surface.pixels();
+    // First frame: black, white / white, black (third column unused)
+    CHECK(pixels[0] == 0);
+    CHECK(pixels[3] == 255);
+    CHECK(pixels[9] == 255);
+    CHECK(pixels[12] == 0);
+    // Second frame: 0, 127, 255
+    CHECK(pixels[18] == 0);
+    CHECK(pixels[21] == 127);
+    CHECK(pixels[24] == 255);
+}
+
+TEST_CASE("PNM decoder: repeated frames share atlas rows") {
+    std::string text = "P1\n2 2\n1 0\n0 1\n"
+                       "P2\n3 1\n2\n0 1 2\n"
+                       "P1\n2 2\n1 0\n0 1\n"
+                       "P2\n3 1\n2\n0 1 2\n";
+    std::vector<std::uint8_t> data(text.begin(), text.end());
+
+    onyx_image::decode_options options;
+    options.dedup_frames = true;
+    onyx_image::memory_surface surface;
+    REQUIRE(onyx_image::pnm_decoder::decode(data, surface, options));
+    CHECK(surface.width() == 3);
+    CHECK(surface.height() == 3);
+
+    const auto& subrects = surface.subrects();
+    REQUIRE(subrects.size() == 4);
+    CHECK(subrects[2].rect.y == 0);
+    CHECK(subrects[2].rect.h == 2);
+    CHECK(subrects[3].rect.y == 2);
+    CHECK(subrects[3].user_tag == 3);
+
+    onyx_image::memory_surface full;
+    REQUIRE(onyx_image::pnm_decoder::decode(data, full));
+    CHECK(full.height() == 6);
+    CHECK(std::ranges::equal(surface.pixels(), full.pixels().first(surface.pixels().size())));
+}
+
+TEST_CASE("PNM decoder: frames beyond the size limit end the stack") {
+    std::string text = "P1\n2 2\n1 0\n0 1\n"
+                       "P2\n3 1\n2\n0 1 2\n"
+                       "P2\n3 2\n2\n0 1 2 2 1 0\n";
+    std::vector<std::uint8_t> data(text.begin(), text.end());
+
+    // The third frame would make the stack 5 rows high
+    onyx_image::decode_options options;
+    options.max_height = 4;
+    onyx_image::memory_surface surface;
+    REQUIRE(onyx_image::pnm_decoder::decode(data, surface, options));
+    CHECK(surface.width() == 3);
+    CHECK(surface.height() == 3);
+    CHECK(surface.subrects().size() == 2);
+
+    // A lone frame within the limit decodes without a stack
+    options.max_height = 2;
+    REQUIRE(onyx_image::pnm_decoder::decode(data, surface, options));
+    CHECK(surface.width() == 2);
+    CHECK(surface.height() == 2);
+    CHECK(surface.subrects().empty());
+
+    onyx_image::null_surface check;
+    REQUIRE(onyx_image::pnm_decoder::decode(data, check, options));
+    CHECK(check.height() == 2);
+
+    // Binary frames are stacked the same way
+    const std::string binary = std::string("P5\n2 1\n255\n\x10\x20", 13) + std::string("P5\n2 1\n255\n\x30\x40", 13);
+    data.assign(binary.begin(), binary.end());
+    REQUIRE(onyx_image::pnm_decoder::decode(data, surface));
+    CHECK(surface.height() == 2);
+    REQUIRE(surface.subrects().size() == 2);
+    CHECK(surface.pixels()[0] == 0x10);
+    CHECK(surface.pixels()[6] == 0x30);
+}
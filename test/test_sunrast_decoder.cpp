@@ -89,6 +89,47 @@ void test_sunrast_decode_md5(
     CHECK(actual_md5 == expected_md5);
 }
 
+// Decode with packed_indexed and check the result renders exactly like the
+// default indexed8 decode once expanded
+void test_packed_decode(const std::filesystem::path& path, onyx_image::pixel_format expected_format) {
+    INFO("Testing: ", path.string());
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    onyx_image::memory_surface reference;
+    REQUIRE(onyx_image::decode(data, reference).ok);
+
+    onyx_image::decode_options options;
+    options.packed_indexed = true;
+    onyx_image::memory_surface packed;
+    REQUIRE(onyx_image::decode(data, packed, options).ok);
+    REQUIRE(packed.format() == expected_format);
+    CHECK(packed.pitch() == onyx_image::row_bytes(expected_format, static_cast<std::size_t>(packed.width())));
+    CHECK(packed.pixels().size() == packed.pitch() * static_cast<std::size_t>(packed.height()));
+
+    onyx_image::memory_surface expanded;
+    REQUIRE(onyx_image::expand_packed(packed, expanded));
+    REQUIRE(expanded.format() == onyx_image::pixel_format::indexed8);
+    REQUIRE(expanded.width() == reference.width());
+    REQUIRE(expanded.height() == reference.height());
+
+    const auto ref_pixels = reference.pixels();
+    const auto ref_palette = reference.palette();
+    const auto pixels = expanded.pixels();
+    const auto palette = expanded.palette();
+    std::size_t mismatches = 0;
+    for (std::size_t i = 0; i < pixels.size(); ++i) {
+        const std::size_t a = static_cast<std::size_t>(ref_pixels[i]) * 3;
+        const std::size_t b = static_cast<std::size_t>(pixels[i]) * 3;
+        if (a + 2 >= ref_palette.size() || b + 2 >= palette.size() ||
+            ref_palette[a] != palette[b] || ref_palette[a + 1] != palette[b + 1] ||
+            ref_palette[a + 2] != palette[b + 2]) {
+            ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
 } // namespace
 
 TEST_CASE("Sun Raster decoder: sniff") {
@@ -141,3 +182,42 @@ TEST_CASE("Sun Raster decoder: MD5 verification") {
         test_sunrast_decode_md5("32bpp.ras", "c69dbe173cabb2aa858aaa8aa83451a7", "32-bit");
     }
 }
+
+TEST_CASE("Sun Raster decoder: RLE runs across rows") {
+    // 3x2 8-bit RT_BYTE_ENCODED with a 2-color map; stride is 4 bytes
+    std::vector<std::uint8_t> data = {
+        0x59, 0xa6, 0x6a, 0x95,
+        0, 0, 0, 3,  0, 0, 0, 2,  0, 0, 0, 8,  0, 0, 0, 0,
+        0, 0, 0, 2,  0, 0, 0, 1,  0, 0, 0, 6,
+        0, 255, 0, 255, 0, 255,
+        // Run of six 1s covers row 0 (with pad) and two pixels of row 1
+        0x80, 5, 1, 0, 0
+    };
+
+    SUBCASE("Run state carries into the next row") {
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::sunrast_decoder::decode(data, surface);
+
+        REQUIRE(result.ok);
+        REQUIRE(surface.format() == onyx_image::pixel_format::indexed8);
+        auto pixels = surface.pixels();
+        CHECK(std::vector<std::uint8_t>(pixels.begin(), pixels.end()) ==
+              std::vector<std::uint8_t>{1, 1, 1, 1, 1, 0});
+    }
+
+    SUBCASE("Truncated stream fails") {
+        data.pop_back();
+        onyx_image::memory_surface surface;
+        auto result = onyx_image::sunrast_decoder::decode(data, surface);
+
+        CHECK_FALSE(result.ok);
+        CHECK(result.error == onyx_image::decode_error::truncated_data);
+    }
+}
+
+TEST_CASE("Sun Raster decoder: packed output") {
+    const auto dir = std::filesystem::path(TEST_DATA_DIR) / "sunrast";
+    test_packed_decode(dir / "lena-1bit-raw.sun", onyx_image::pixel_format::indexed1);
+    test_packed_decode(dir / "lena-1bit-rle.sun", onyx_image::pixel_format::indexed1);
+    test_packed_decode(dir / "4bpp.ras", onyx_image::pixel_format::indexed4);
+}
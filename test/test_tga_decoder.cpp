@@ -0,0 +1,179 @@
+#include <doctest/doctest.h>
+#include <onyx_image/onyx_image.hpp>
+
+#include "helpers/md5.h"
+#include "helpers/short_read_source.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<std::uint8_t> read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return {};
+    }
+
+    const auto size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    std::vector<std::uint8_t> data(static_cast<std::size_t>(size));
+    file.read(reinterpret_cast<char*>(data.data()), size);
+
+    return data;
+}
+
+std::string md5_to_string(const unsigned char* digest) {
+    std::string result;
+    result.reserve(32);
+    for (int i = 0; i < MD5_DIGEST_LENGTH; i++) {
+        char buf[3];
+        std::snprintf(buf, sizeof(buf), "%02x", digest[i]);
+        result += buf;
+    }
+    return result;
+}
+
+std::string compute_surface_md5(const onyx_image::memory_surface& surf) {
+    MD5_CTX ctx;
+    MD5_Init(&ctx);
+
+    // Hash dimensions and format
+    const int width = surf.width();
+    const int height = surf.height();
+    const auto format = static_cast<int>(surf.format());
+    MD5_Update(&ctx, &width, sizeof(width));
+    MD5_Update(&ctx, &height, sizeof(height));
+    MD5_Update(&ctx, &format, sizeof(format));
+
+    // Hash pixel data
+    const auto pixels = surf.pixels();
+    MD5_Update(&ctx, pixels.data(), pixels.size());
+
+    // Hash palette if indexed
+    if (surf.format() == onyx_image::pixel_format::indexed8) {
+        const auto palette = surf.palette();
+        MD5_Update(&ctx, palette.data(), palette.size());
+    }
+
+    unsigned char digest[MD5_DIGEST_LENGTH];
+    MD5_Final(digest, &ctx);
+
+    return md5_to_string(digest);
+}
+
+void test_tga_decode_md5(
+    const char* filename,
+    const char* expected_md5,
+    int expected_width,
+    int expected_height,
+    onyx_image::pixel_format expected_format)
+{
+    const std::filesystem::path path = std::filesystem::path(TEST_DATA_DIR) / "tga" / filename;
+
+    INFO("Testing: ", filename);
+    REQUIRE(std::filesystem::exists(path));
+
+    auto data = read_file(path);
+    REQUIRE(!data.empty());
+
+    onyx_image::memory_surface surface;
+    auto result = onyx_image::decode(data, surface);
+
+    REQUIRE(result.ok);
+    CHECK(surface.width() == expected_width);
+    CHECK(surface.height() == expected_height);
+    CHECK(surface.format() == expected_format);
+
+    std::string actual_md5 = compute_surface_md5(surface);
+    CHECK(actual_md5 == expected_md5);
+
+    // The streaming path must produce the same pixels
+    onyx_image::memory_source src(data);
+    onyx_image::memory_surface streamed;
+    REQUIRE(onyx_image::decode(src, streamed, "tga").ok);
+    CHECK(compute_surface_md5(streamed) == expected_md5);
+
+    // So must a source that delivers a few bytes per read, like a pipe
+    short_read_source trickle(data, 3);
+    onyx_image::memory_surface trickled;
+    REQUIRE(onyx_image::decode(trickle, trickled, "tga").ok);
+    CHECK(compute_surface_md5(trickled) == expected_md5);
+}
+
+} // namespace
+
+TEST_CASE("TGA decoder: sniff") {
+    const auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "tga" / "colormapped_8.tga");
+    REQUIRE(!data.empty());
+    CHECK(onyx_image::tga_decoder::sniff(data));
+
+    SUBCASE("Too short") {
+        CHECK_FALSE(onyx_image::tga_decoder::sniff(std::span(data).first(17)));
+    }
+
+    SUBCASE("Colormapped image without a color map") {
+        auto patched = data;
+        patched[1] = 0;
+        CHECK_FALSE(onyx_image::tga_decoder::sniff(patched));
+    }
+
+    SUBCASE("Truecolor image with an 8-bit depth") {
+        auto patched = data;
+        patched[2] = 2;
+        CHECK_FALSE(onyx_image::tga_decoder::sniff(patched));
+    }
+
+    SUBCASE("Interleaved rows") {
+        auto patched = data;
+        patched[17] |= 0x40;
+        CHECK_FALSE(onyx_image::tga_decoder::sniff(patched));
+    }
+}
+
+TEST_CASE("TGA decoder: MD5 verification") {
+    using onyx_image::pixel_format;
+
+    SUBCASE("Colormapped, bottom-up, with image ID") {
+        test_tga_decode_md5("colormapped_8.tga", "4384e0ec7473289802f52919b65b369c", 13, 7, pixel_format::indexed8);
+    }
+
+    SUBCASE("Colormapped RLE, top-down, map starting at entry 4") {
+        test_tga_decode_md5("colormapped_rle.tga", "6492dfdacb194e3d30b2916c6ecacae8", 19, 11, pixel_format::indexed8);
+    }
+
+    SUBCASE("Color map with alpha expands to RGBA") {
+        test_tga_decode_md5("colormapped_alpha.tga", "387f5bbb20af45c1e808d27f4fb5c665", 9, 5, pixel_format::rgba8888);
+    }
+
+    SUBCASE("24-bit RLE, packets spanning rows, TGA 2.0 footer") {
+        test_tga_decode_md5("truecolor_24_rle.tga", "3dfca45ffc342a487d7fab49355c09da", 17, 9, pixel_format::rgb888);
+    }
+
+    SUBCASE("32-bit, top-down, right-to-left") {
+        test_tga_decode_md5("truecolor_32_rtl.tga", "1f49bf3f5769dc03b8c2e056368705aa", 11, 6, pixel_format::rgba8888);
+    }
+
+    SUBCASE("16-bit RLE") {
+        test_tga_decode_md5("truecolor_16_rle.tga", "8ffe9df6c8e83ecf47ea4d3a6a69a8dc", 10, 8, pixel_format::rgb888);
+    }
+
+    SUBCASE("Grayscale RLE") {
+        test_tga_decode_md5("grayscale_rle.tga", "203d68e0bfb165dfb243c1e8d95f33af", 21, 5, pixel_format::indexed8);
+    }
+}
+
+TEST_CASE("TGA decoder: truncated pixel data") {
+    auto data = read_file(std::filesystem::path(TEST_DATA_DIR) / "tga" / "colormapped_rle.tga");
+    REQUIRE(!data.empty());
+    data.resize(data.size() - 10);
+
+    onyx_image::memory_surface surface;
+    const auto result = onyx_image::tga_decoder::decode(data, surface);
+    CHECK_FALSE(result.ok);
+    CHECK(result.error == onyx_image::decode_error::truncated_data);
+}